@@ -14,6 +14,11 @@
 
 #include "Dll.h"
 #include "helpers.h"
+#include "objectpool.h"
+#include "RaspWrapCredentialProvider.h"
+#include "refcount.h"
+#include "queryinterface.h"
+#include "flightrecorder.h"
 
 static long g_cRef = 0;   // global dll reference count
 HINSTANCE g_hinst = NULL; // global dll hinstance
@@ -21,32 +26,27 @@ HINSTANCE g_hinst = NULL; // global dll hinstance
 extern HRESULT RaspWrap_CreateInstance(__in REFIID riid, __deref_out void** ppv);
 EXTERN_C GUID CLSID_RaspWrap;
 
-class CClassFactory : public IClassFactory
+class CClassFactory : public IClassFactory, public PooledObject<CClassFactory>
 {
 public:
-    CClassFactory() : _cRef(1)
+    CClassFactory()
     {
     }
 
     // IUnknown
     IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void **ppv)
     {
-        static const QITAB qit[] =
-        {
-            QITABENT(CClassFactory, IClassFactory),
-            { 0 },
-        };
-        return QISearch(this, qit, riid, ppv);
+        return QueryInterfaceT<CClassFactory, IClassFactory>(this, riid, ppv);
     }
 
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return InterlockedIncrement(&_cRef);
+        return _cRef.AddRef();
     }
 
     IFACEMETHODIMP_(ULONG) Release()
     {
-        long cRef = InterlockedDecrement(&_cRef);
+        ULONG cRef = _cRef.Release();
         if (!cRef)
             delete this;
         return cRef;
@@ -85,7 +85,7 @@ private:
     ~CClassFactory()
     {
     }
-    long _cRef;
+    RefCount _cRef;
 };
 
 HRESULT CClassFactory_CreateInstance(__in REFCLSID rclsid, __in REFIID riid, __deref_out void **ppv)
@@ -114,6 +114,16 @@ HRESULT CClassFactory_CreateInstance(__in REFCLSID rclsid, __in REFIID riid, __d
     return hr;
 }
 
+// How well T's pool did over the life of the DLL: a pool that keeps missing shows in the log.
+template <typename T>
+static void _LogPoolStats(_In_ const char *pszClass)
+{
+    OBJECT_POOL_STATS stats;
+    ObjectPool<T>::Get().GetStats(&stats);
+    Log<LL_INFO, LC_DLL>("DllCanUnloadNow(): %s pool: hits=%ld misses=%ld returns=%ld releases=%ld\n",
+                         pszClass, stats.cHits, stats.cMisses, stats.cReturns, stats.cReleases);
+}
+
 void DllAddRef()
 {
     InterlockedIncrement(&g_cRef);
@@ -127,7 +137,19 @@ void DllRelease()
 __control_entrypoint(DllExport)
 STDAPI DllCanUnloadNow()
 {
-    return (g_cRef > 0) ? S_FALSE : S_OK;
+    if (g_cRef > 0)
+    {
+        return S_FALSE;
+    }
+
+    // Queued before the writer is stopped, so they are written out with the rest of the log.
+    _LogPoolStats<CClassFactory>("CClassFactory");
+    _LogPoolStats<RaspWrapCredentialProvider>("RaspWrapCredentialProvider");
+    _LogPoolStats<RaspWrapCredential>("RaspWrapCredential");
+
+    // The log and trace writer runs on the thread pool; it has to be gone before we unload.
+    LogShutdown();
+    return S_OK;
 }
 
 _Check_return_
@@ -136,7 +158,7 @@ STDAPI DllGetClassObject(__in REFCLSID rclsid, __in REFIID riid, __deref_out voi
     return CClassFactory_CreateInstance(rclsid, riid, ppv);
 }
 
-STDAPI_(BOOL) DllMain(__in HINSTANCE hinstDll, __in DWORD dwReason, __in void *)
+STDAPI_(BOOL) DllMain(__in HINSTANCE hinstDll, __in DWORD dwReason, __in void *pvReserved)
 {
     switch (dwReason)
     {
@@ -144,6 +166,13 @@ STDAPI_(BOOL) DllMain(__in HINSTANCE hinstDll, __in DWORD dwReason, __in void *)
         DisableThreadLibraryCalls(hinstDll);
         break;
     case DLL_PROCESS_DETACH:
+        // Only when FreeLibrary unloads us; at process exit other threads may still be counting.
+        if (pvReserved == NULL)
+        {
+            LatencyUnload();
+            FlightClose();
+        }
+        break;
     case DLL_THREAD_ATTACH:
     case DLL_THREAD_DETACH:
         break;
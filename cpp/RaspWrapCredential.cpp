@@ -19,30 +19,42 @@
 #include "RaspWrapCredentialEvents.h"
 #include "guid.h"
 
+#pragma warning(push)
+#pragma warning(disable: 4355)  // the translator only keeps the pointer
 RaspWrapCredential::RaspWrapCredential():
-    _cRef(1), _bUseSSOChecked(false)
+    _wrappedCredentialEvents(this),
+    _bUseSSOChecked(false)
 {
     DllAddRef();
 
-    log("RaspWrapCredential::RaspWrapCredential(): this(%p)\n", this);
+    TraceInstant(TEID_CREDENTIAL_CREATE, this);
 
-    _pWrappedCredential = NULL;
-    _pWrappedCredentialEvents = NULL;
-    _pCredProvCredentialEvents = NULL;
     _dwWrappedDescriptorCount = 0;
 }
+#pragma warning(pop)
 
 RaspWrapCredential::~RaspWrapCredential()
 {
-    log("RaspWrapCredential::~RaspWrapCredential(): this(%p)\n", this);
+    TraceInstant(TEID_CREDENTIAL_DESTROY, this);
 
-    _CleanupEvents();
+    DllRelease();
+}
 
-    if (_pWrappedCredential)
+//
+// Our last reference is gone.  The wrapped credential can outlive us, since its provider and
+// our provider's cache hold it too; if LogonUI never called UnAdvise, make it drop the
+// translator.  Should it keep its reference anyway, the translator is disarmed and our memory
+// stays until that reference is released.
+//
+void RaspWrapCredential::_FinalRelease()
+{
+    if (_pCredProvCredentialEvents != NULL && _pWrappedCredential != NULL)
     {
-        _pWrappedCredential->Release();
+        _pWrappedCredential->UnAdvise();
     }
-    DllRelease();
+
+    _CleanupEvents();
+    _pWrappedCredential.Reset();
 }
 
 // Initializes one credential with the field information passed in. We also keep track
@@ -53,57 +65,45 @@ HRESULT RaspWrapCredential::Initialize(
 {
     HRESULT hr = S_OK;
 
-    log("RaspWrapCredential::Initialize(): this(%p)\n", this);
+    TraceBegin(TEID_CREDENTIAL_INITIALIZE, this);
 
     // Grab the credential we're wrapping for future reference.
-    if (_pWrappedCredential != NULL)
-    {
-        _pWrappedCredential->Release();
-    }
     _pWrappedCredential = pWrappedCredential;
-    _pWrappedCredential->AddRef();
 
     _dwWrappedDescriptorCount = dwWrappedDescriptorCount;
 
-    log("RaspWrapCredential::Initialize(): this(%p): dwWrappedDescriptorCount=%d\n",
-        this, dwWrappedDescriptorCount);
-
+    TraceEnd(TEID_CREDENTIAL_INITIALIZE, this, hr);
     return hr;
 }
 
 // LogonUI calls this in order to give us a callback in case we need to notify it of
-// anything. We'll also provide it to the wrapped credential.
+// anything. We'll also provide it to the wrapped credential, through the events
+// translator we carry with us.
 HRESULT RaspWrapCredential::Advise(
     __in ICredentialProviderCredentialEvents* pcpce
     )
 {
     HRESULT hr = S_OK;
 
-    log("RaspWrapCredential::Advise(): this(%p)\n", this);
+    LatencyScope latency(LM_CREDENTIAL_ADVISE);
+    TraceBegin(TEID_CREDENTIAL_ADVISE, this);
 
     _CleanupEvents();
 
     // We keep a strong reference on the real ICredentialProviderCredentialEvents
     // to ensure that the weak reference held by the RaspWrapCredentialEvents is valid.
     _pCredProvCredentialEvents = pcpce;
-    _pCredProvCredentialEvents->AddRef();
-
-    _pWrappedCredentialEvents = new (std::nothrow) RaspWrapCredentialEvents();
 
-    if (_pWrappedCredentialEvents != NULL)
-    {
-        _pWrappedCredentialEvents->Initialize(this, pcpce, _dwWrappedDescriptorCount);
+    _wrappedCredentialEvents.Initialize(this, pcpce, WrapperFieldID(_dwWrappedDescriptorCount, WFI_USE_SSO));
 
-        if (_pWrappedCredential != NULL)
-        {
-            hr = _pWrappedCredential->Advise(_pWrappedCredentialEvents);
-        }
-    }
-    else
+    if (_pWrappedCredential != NULL)
     {
-        hr = E_OUTOFMEMORY;
+        latency.EnterWrapped();
+        hr = _pWrappedCredential->Advise(&_wrappedCredentialEvents);
+        latency.LeaveWrapped();
     }
 
+    TraceEnd(TEID_CREDENTIAL_ADVISE, this, hr);
     return hr;
 }
 
@@ -113,15 +113,19 @@ HRESULT RaspWrapCredential::UnAdvise()
 {
     HRESULT hr = S_OK;
 
-    log("RaspWrapCredential::UnAdvise(): this(%p)\n", this);
+    LatencyScope latency(LM_CREDENTIAL_UNADVISE);
+    TraceBegin(TEID_CREDENTIAL_UNADVISE, this);
 
     if (_pWrappedCredential != NULL)
     {
+        latency.EnterWrapped();
         _pWrappedCredential->UnAdvise();
+        latency.LeaveWrapped();
     }
 
     _CleanupEvents();
 
+    TraceEnd(TEID_CREDENTIAL_UNADVISE, this, hr);
     return hr;
 }
 
@@ -134,13 +138,17 @@ HRESULT RaspWrapCredential::SetSelected(__out BOOL* pbAutoLogon)
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredential::SetSelected(): this(%p)\n", this);
+    LatencyScope latency(LM_CREDENTIAL_SET_SELECTED);
+    TraceBegin(TEID_CREDENTIAL_SET_SELECTED, this);
 
     if (_pWrappedCredential != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedCredential->SetSelected(pbAutoLogon);
+        latency.LeaveWrapped();
     }
 
+    TraceEnd(TEID_CREDENTIAL_SET_SELECTED, this, hr);
     return hr;
 }
 
@@ -150,11 +158,61 @@ HRESULT RaspWrapCredential::SetDeselected()
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredential::SetDeselected(): this(%p)\n", this);
+    LatencyScope latency(LM_CREDENTIAL_SET_DESELECTED);
+    TraceBegin(TEID_CREDENTIAL_SET_DESELECTED, this);
 
     if (_pWrappedCredential != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedCredential->SetDeselected();
+        latency.LeaveWrapped();
+    }
+
+    TraceEnd(TEID_CREDENTIAL_SET_DESELECTED, this, hr);
+    return hr;
+}
+
+// What each of our own fields does, in WRAPPER_FIELD_INDEX order.
+const RaspWrapCredential::FIELD_HANDLERS RaspWrapCredential::s_rgFieldHandlers[] =
+{
+    // WFI_USE_SSO
+    { &RaspWrapCredential::_GetUseSSOString, &RaspWrapCredential::_GetUseSSOCheckbox, &RaspWrapCredential::_SetUseSSOCheckbox,
+      NULL, NULL, NULL, NULL, NULL },
+};
+
+// Works out who owns dwFieldID. For one of our fields, *ppHandlers gets its handlers and
+// *pdwRoutedID its WRAPPER_FIELD_INDEX; for a field of the wrapped credential, *ppHandlers
+// is NULL and *pdwRoutedID is the ID to pass along.
+HRESULT RaspWrapCredential::_RouteField(
+    __in DWORD dwFieldID,
+    __deref_out_opt const FIELD_HANDLERS **ppHandlers,
+    __out DWORD *pdwRoutedID
+    )
+{
+    static_assert(ARRAYSIZE(s_rgFieldHandlers) == WFI_NUM_FIELDS,
+                  "s_rgFieldHandlers needs one entry per WRAPPER_FIELD_INDEX");
+
+    HRESULT hr = E_UNEXPECTED;
+
+    *ppHandlers = NULL;
+
+    switch (RouteFieldID(dwFieldID, _dwWrappedDescriptorCount, pdwRoutedID))
+    {
+    case FR_WRAPPER:
+        *ppHandlers = &s_rgFieldHandlers[*pdwRoutedID];
+        hr = S_OK;
+        break;
+
+    case FR_WRAPPED:
+        if (_pWrappedCredential != NULL)
+        {
+            hr = S_OK;
+        }
+        break;
+
+    default:
+        hr = E_INVALIDARG;
+        break;
     }
 
     return hr;
@@ -175,23 +233,29 @@ HRESULT RaspWrapCredential::GetFieldState(
     {
         return hr;
     }
-    log("RaspWrapCredential::GetFieldState(): this(%p): dwFieldID=%d \n", this, dwFieldID);
 
-    if (dwFieldID == _dwWrappedDescriptorCount)
-    {
-        *pcpfs = CPFS_DISPLAY_IN_SELECTED_TILE;
-        *pcpfis = CPFIS_NONE;
-        return S_OK;
-    }
+    LatencyScope latency(LM_CREDENTIAL_GET_FIELD_STATE);
+    TraceBegin(TEID_CREDENTIAL_GET_FIELD_STATE, this, dwFieldID);
 
-    if (_pWrappedCredential != NULL)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        hr = _pWrappedCredential->GetFieldState(dwFieldID, pcpfs, pcpfis);
-        if (SUCCEEDED(hr)) {
-            log("RaspWrapCredential::GetFieldState(): this(%p): dwFieldID=%d *pcpfs=%d\n", this, dwFieldID, *pcpfs);
+        if (pHandlers != NULL)
+        {
+            *pcpfs = g_rgWrapperFields[dwRoutedID].cpfs;
+            *pcpfis = g_rgWrapperFields[dwRoutedID].cpfis;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->GetFieldState(dwRoutedID, pcpfs, pcpfis);
+            latency.LeaveWrapped();
         }
     }
 
+    TraceEnd(TEID_CREDENTIAL_GET_FIELD_STATE, this, hr, dwFieldID);
     return hr;
 }
 
@@ -202,24 +266,42 @@ HRESULT RaspWrapCredential::GetStringValue(
     __deref_out PWSTR* ppwsz
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::GetStringValue(): this(%p): dwFieldID=%d\n", this, dwFieldID);
+    LatencyScope latency(LM_CREDENTIAL_GET_STRING_VALUE);
+    TraceBegin(TEID_CREDENTIAL_GET_STRING_VALUE, this, dwFieldID);
 
-
-    if (dwFieldID == _dwWrappedDescriptorCount)
-    {
-        hr = SHStrDupW(L"Use SSO", ppwsz);
-    }
-    else if (_pWrappedCredential != NULL)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        hr = _pWrappedCredential->GetStringValue(dwFieldID, ppwsz);
-        if (SUCCEEDED(hr))
+        if (pHandlers != NULL)
         {
-            log("RaspWrapCredential::GetStringValue(): %S\n", *ppwsz ? *ppwsz : L"null");
+            // Built inline for anything short; LogonUI gets the CoTaskMemAlloc copy it frees.
+            SecureString str;
+            hr = pHandlers->pfnGetStringValue ? pHandlers->pfnGetStringValue(this, &str) : E_UNEXPECTED;
+            if (SUCCEEDED(hr))
+            {
+                hr = str.DetachToCoTaskMem(ppwsz);
+            }
+            else
+            {
+                *ppwsz = NULL;
+            }
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->GetStringValue(dwRoutedID, ppwsz);
+            latency.LeaveWrapped();
+            if (SUCCEEDED(hr))
+            {
+                Log<LL_VERBOSE, LC_CREDENTIAL>("RaspWrapCredential::GetStringValue(): this(%p): dwFieldID=%lu value=%s\n",
+                                               this, dwFieldID, LogSecret(*ppwsz));
+            }
         }
     }
 
+    TraceEnd(TEID_CREDENTIAL_GET_STRING_VALUE, this, hr, dwFieldID);
     return hr;
 }
 
@@ -232,21 +314,27 @@ HRESULT RaspWrapCredential::GetComboBoxValueCount(
     __out_range(<,*pcItems) DWORD* pdwSelectedItem
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::GetComboBoxValueCount(): this(%p): dwFieldID=%d\n", this, dwFieldID);
-
+    LatencyScope latency(LM_CREDENTIAL_GET_COMBOBOX_VALUE_COUNT);
+    TraceBegin(TEID_CREDENTIAL_GET_COMBOBOX_VALUE_COUNT, this, dwFieldID);
 
-    if (dwFieldID == _dwWrappedDescriptorCount)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        return hr;
-    }
-
-    if (_pWrappedCredential != NULL)
-    {
-        hr = _pWrappedCredential->GetComboBoxValueCount(dwFieldID, pcItems, pdwSelectedItem);
+        if (pHandlers != NULL)
+        {
+            hr = pHandlers->pfnGetComboBoxValueCount ? pHandlers->pfnGetComboBoxValueCount(this, pcItems, pdwSelectedItem) : E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->GetComboBoxValueCount(dwRoutedID, pcItems, pdwSelectedItem);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_GET_COMBOBOX_VALUE_COUNT, this, hr, dwFieldID);
     return hr;
 }
 
@@ -259,21 +347,27 @@ HRESULT RaspWrapCredential::GetComboBoxValueAt(
     __deref_out PWSTR* ppwszItem
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::GetComboBoxValueAt(): this(%p): dwFieldID=%d\n", this, dwFieldID);
+    LatencyScope latency(LM_CREDENTIAL_GET_COMBOBOX_VALUE_AT);
+    TraceBegin(TEID_CREDENTIAL_GET_COMBOBOX_VALUE_AT, this, dwFieldID);
 
-
-    if (dwFieldID == _dwWrappedDescriptorCount)
-    {
-        return hr;
-    }
-
-    if (_pWrappedCredential != NULL)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        hr = _pWrappedCredential->GetComboBoxValueAt(dwFieldID, dwItem, ppwszItem);
+        if (pHandlers != NULL)
+        {
+            hr = pHandlers->pfnGetComboBoxValueAt ? pHandlers->pfnGetComboBoxValueAt(this, dwItem, ppwszItem) : E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->GetComboBoxValueAt(dwRoutedID, dwItem, ppwszItem);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_GET_COMBOBOX_VALUE_AT, this, hr, dwFieldID);
     return hr;
 }
 
@@ -284,46 +378,61 @@ HRESULT RaspWrapCredential::SetComboBoxSelectedValue(
     __in DWORD dwSelectedItem
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-    log("RaspWrapCredential::SetComboBoxSelectedValue(): this(%p): dwFieldID=%d\n", this, dwFieldID);
+    LatencyScope latency(LM_CREDENTIAL_SET_COMBOBOX_SELECTED_VALUE);
+    TraceBegin(TEID_CREDENTIAL_SET_COMBOBOX_SELECTED_VALUE, this, dwFieldID);
 
-    if (dwFieldID == _dwWrappedDescriptorCount)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        return hr;
-    }
-
-    if (_pWrappedCredential != NULL)
-    {
-        hr = _pWrappedCredential->SetComboBoxSelectedValue(dwFieldID, dwSelectedItem);
+        if (pHandlers != NULL)
+        {
+            hr = pHandlers->pfnSetComboBoxSelectedValue ? pHandlers->pfnSetComboBoxSelectedValue(this, dwSelectedItem) : E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->SetComboBoxSelectedValue(dwRoutedID, dwSelectedItem);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_SET_COMBOBOX_SELECTED_VALUE, this, hr, dwFieldID);
     return hr;
 }
 
 // The following methods are for logonUI to get the values of various UI elements and
-// then communicate to the credential about what the user did in that field. Even though
-// we don't offer these field types ourselves, we need to pass along the request to the
-// wrapped credential.
+// then communicate to the credential about what the user did in that field. None of our
+// own fields is a bitmap or a submit button, so those only ever go to the wrapped
+// credential.
 
 HRESULT RaspWrapCredential::GetBitmapValue(
     __in DWORD dwFieldID,
     __out HBITMAP* phbmp
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::GetBitmapValue(): this(%p): dwFieldID=%d\n", this, dwFieldID);
+    LatencyScope latency(LM_CREDENTIAL_GET_BITMAP_VALUE);
+    TraceBegin(TEID_CREDENTIAL_GET_BITMAP_VALUE, this, dwFieldID);
 
-    if (dwFieldID == _dwWrappedDescriptorCount)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        return hr;
-    }
-
-    if (_pWrappedCredential != NULL)
-    {
-        hr = _pWrappedCredential->GetBitmapValue(dwFieldID, phbmp);
+        if (pHandlers != NULL)
+        {
+            hr = E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->GetBitmapValue(dwRoutedID, phbmp);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_GET_BITMAP_VALUE, this, hr, dwFieldID);
     return hr;
 }
 
@@ -332,21 +441,27 @@ HRESULT RaspWrapCredential::GetSubmitButtonValue(
     __out DWORD* pdwAdjacentTo
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::GetSubmitButtonValue(): this(%p): dwFieldID=%d\n", this, dwFieldID);
+    LatencyScope latency(LM_CREDENTIAL_GET_SUBMIT_BUTTON_VALUE);
+    TraceBegin(TEID_CREDENTIAL_GET_SUBMIT_BUTTON_VALUE, this, dwFieldID);
 
-
-    if (dwFieldID == _dwWrappedDescriptorCount)
-    {
-        return hr;
-    }
-
-    if (_pWrappedCredential != NULL)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        hr = _pWrappedCredential->GetSubmitButtonValue(dwFieldID, pdwAdjacentTo);
+        if (pHandlers != NULL)
+        {
+            hr = E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->GetSubmitButtonValue(dwRoutedID, pdwAdjacentTo);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_GET_SUBMIT_BUTTON_VALUE, this, hr, dwFieldID);
     return hr;
 }
 
@@ -355,23 +470,36 @@ HRESULT RaspWrapCredential::SetStringValue(
     __in PCWSTR pwz
     )
 {
-    HRESULT hr = E_UNEXPECTED;
+    LatencyScope latency(LM_CREDENTIAL_SET_STRING_VALUE);
+    TraceBegin(TEID_CREDENTIAL_SET_STRING_VALUE, this, dwFieldID);
+    Log<LL_VERBOSE, LC_CREDENTIAL>("RaspWrapCredential::SetStringValue(): this(%p): dwFieldID=%lu value=%s\n",
+                                   this, dwFieldID, LogSecret(pwz));
 
-    log("RaspWrapCredential::SetStringValue(): this(%p): dwFieldID=%d\n", this, dwFieldID);
-    log("RaspWrapCredential::SetStringValue(): %S\n", pwz ? pwz : L"null");
-
-    if (dwFieldID == _dwWrappedDescriptorCount)
-    {
-        return hr;
-    }
-
-    if (_pWrappedCredential != NULL)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        hr = _pWrappedCredential->SetStringValue(dwFieldID, pwz);
+        if (pHandlers != NULL)
+        {
+            // Whatever the handler keeps of the value is wiped when it lets go of it.
+            SecureString str;
+            hr = pHandlers->pfnSetStringValue ? str.Assign(pwz) : E_UNEXPECTED;
+            if (SUCCEEDED(hr))
+            {
+                hr = pHandlers->pfnSetStringValue(this, &str);
+            }
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->SetStringValue(dwRoutedID, pwz);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_SET_STRING_VALUE, this, hr, dwFieldID);
     return hr;
-
 }
 
 HRESULT RaspWrapCredential::GetCheckboxValue(
@@ -380,21 +508,27 @@ HRESULT RaspWrapCredential::GetCheckboxValue(
     __deref_out PWSTR* ppwszLabel
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::GetCheckboxValue(): this(%p): dwFieldID=%d\n", this, dwFieldID);
-
+    LatencyScope latency(LM_CREDENTIAL_GET_CHECKBOX_VALUE);
+    TraceBegin(TEID_CREDENTIAL_GET_CHECKBOX_VALUE, this, dwFieldID);
 
-    if (dwFieldID == _dwWrappedDescriptorCount)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        *pbChecked = _bUseSSOChecked;
-        hr = SHStrDupW(L"Use SSO", ppwszLabel); // caller should free
-    }
-    else if (_pWrappedCredential != NULL)
-    {
-        hr = _pWrappedCredential->GetCheckboxValue(dwFieldID, pbChecked, ppwszLabel);
+        if (pHandlers != NULL)
+        {
+            hr = pHandlers->pfnGetCheckboxValue ? pHandlers->pfnGetCheckboxValue(this, pbChecked, ppwszLabel) : E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->GetCheckboxValue(dwRoutedID, pbChecked, ppwszLabel);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_GET_CHECKBOX_VALUE, this, hr, dwFieldID);
     return hr;
 }
 
@@ -403,43 +537,77 @@ HRESULT RaspWrapCredential::SetCheckboxValue(
     __in BOOL bChecked
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::SetCheckboxValue(): this(%p): dwFieldID=%d\n", this, dwFieldID);
+    LatencyScope latency(LM_CREDENTIAL_SET_CHECKBOX_VALUE);
+    TraceBegin(TEID_CREDENTIAL_SET_CHECKBOX_VALUE, this, dwFieldID);
 
-    if (dwFieldID == _dwWrappedDescriptorCount)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        _bUseSSOChecked = bChecked;
-        return S_OK;
-    }
-
-    if (_pWrappedCredential != NULL)
-    {
-        hr = _pWrappedCredential->SetCheckboxValue(dwFieldID, bChecked);
+        if (pHandlers != NULL)
+        {
+            hr = pHandlers->pfnSetCheckboxValue ? pHandlers->pfnSetCheckboxValue(this, bChecked) : E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->SetCheckboxValue(dwRoutedID, bChecked);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_SET_CHECKBOX_VALUE, this, hr, dwFieldID);
     return hr;
 }
 
 HRESULT RaspWrapCredential::CommandLinkClicked(__in DWORD dwFieldID)
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    log("RaspWrapCredential::CommandLinkClicked(): this(%p): dwFieldID=%d\n", this, dwFieldID);
-
-    if (dwFieldID == _dwWrappedDescriptorCount)
-    {
-        return hr;
-    }
+    LatencyScope latency(LM_CREDENTIAL_COMMAND_LINK_CLICKED);
+    TraceBegin(TEID_CREDENTIAL_COMMAND_LINK_CLICKED, this, dwFieldID);
 
-    if (_pWrappedCredential != NULL)
+    const FIELD_HANDLERS *pHandlers;
+    DWORD dwRoutedID;
+    HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+    if (SUCCEEDED(hr))
     {
-        hr = _pWrappedCredential->CommandLinkClicked(dwFieldID);
+        if (pHandlers != NULL)
+        {
+            hr = pHandlers->pfnCommandLinkClicked ? pHandlers->pfnCommandLinkClicked(this) : E_UNEXPECTED;
+        }
+        else
+        {
+            latency.EnterWrapped();
+            hr = _pWrappedCredential->CommandLinkClicked(dwRoutedID);
+            latency.LeaveWrapped();
+        }
     }
 
+    TraceEnd(TEID_CREDENTIAL_COMMAND_LINK_CLICKED, this, hr, dwFieldID);
     return hr;
 }
 
+// The UseSSO checkbox.
+
+HRESULT RaspWrapCredential::_GetUseSSOString(RaspWrapCredential *pThis, SecureString *pstr)
+{
+    UNREFERENCED_PARAMETER(pThis);
+
+    return pstr->Assign(g_rgWrapperFields[WFI_USE_SSO].cpfd.pszLabel);
+}
+
+HRESULT RaspWrapCredential::_GetUseSSOCheckbox(RaspWrapCredential *pThis, BOOL *pbChecked, PWSTR *ppwszLabel)
+{
+    *pbChecked = pThis->_bUseSSOChecked;
+    return SHStrDupW(g_rgWrapperFields[WFI_USE_SSO].cpfd.pszLabel, ppwszLabel); // caller should free
+}
+
+HRESULT RaspWrapCredential::_SetUseSSOCheckbox(RaspWrapCredential *pThis, BOOL bChecked)
+{
+    pThis->_bUseSSOChecked = bChecked;
+    return S_OK;
+}
+
 //
 // Collect the username and password into a serialized credential for the correct usage scenario
 // (logon/unlock is what's demonstrated in this sample).  LogonUI then passes these credentials
@@ -454,9 +622,18 @@ HRESULT RaspWrapCredential::GetSerialization(
 {
     HRESULT hr = E_UNEXPECTED;
 
+    LatencyScope latency(LM_CREDENTIAL_GET_SERIALIZATION);
+    TraceBegin(TEID_CREDENTIAL_GET_SERIALIZATION, this);
+
     if (_pWrappedCredential != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedCredential->GetSerialization(pcpgsr, pcpcs, ppwszOptionalStatusText, pcpsiOptionalStatusIcon);
+        latency.LeaveWrapped();
+        if (FAILED(hr))
+        {
+            Log<LL_WARNING, LC_CREDENTIAL>("RaspWrapCredential::GetSerialization(): this(%p): hr=0x%08lx\n", this, hr);
+        }
     }
 
     if (!_bUseSSOChecked)
@@ -464,9 +641,7 @@ HRESULT RaspWrapCredential::GetSerialization(
         *pcpgsr = CPGSR_NO_CREDENTIAL_FINISHED;
     }
 
-    log("RaspWrapCredential::GetSerialization(): this(%p)\n", this);
-
-
+    TraceEnd(TEID_CREDENTIAL_GET_SERIALIZATION, this, hr);
     return hr;
 }
 
@@ -475,15 +650,21 @@ HRESULT RaspWrapCredential::Connect(IQueryContinueWithStatus* pqcws)
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredential::Connect(): this(%p)\n", this);
+    LatencyScope latency(LM_CREDENTIAL_CONNECT);
+    TraceBegin(TEID_CREDENTIAL_CONNECT, this);
 
     if (_pWrappedCredential != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedCredential->Connect(pqcws);
+        latency.LeaveWrapped();
+        if (FAILED(hr))
+        {
+            Log<LL_WARNING, LC_CREDENTIAL>("RaspWrapCredential::Connect(): this(%p): hr=0x%08lx\n", this, hr);
+        }
     }
 
-    log("RaspWrapCredential::Connect(): this(%p) returned\n", this);
-
+    TraceEnd(TEID_CREDENTIAL_CONNECT, this, hr);
     return hr;
 }
 
@@ -491,15 +672,17 @@ HRESULT RaspWrapCredential::Disconnect()
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredential::Disconnect(): this(%p)\n", this);
+    LatencyScope latency(LM_CREDENTIAL_DISCONNECT);
+    TraceBegin(TEID_CREDENTIAL_DISCONNECT, this);
 
     if (_pWrappedCredential != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedCredential->Disconnect();
+        latency.LeaveWrapped();
     }
 
-    log("RaspWrapCredential::Disconnect(): this(%p) returned\n", this);
-
+    TraceEnd(TEID_CREDENTIAL_DISCONNECT, this, hr);
     return hr;
 }
 
@@ -514,14 +697,17 @@ HRESULT RaspWrapCredential::ReportResult(
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredential::ReportResult(): this(%p)\n", this);
-
+    LatencyScope latency(LM_CREDENTIAL_REPORT_RESULT);
+    TraceBegin(TEID_CREDENTIAL_REPORT_RESULT, this);
 
     if (_pWrappedCredential != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedCredential->ReportResult(ntsStatus, ntsSubstatus, ppwszOptionalStatusText, pcpsiOptionalStatusIcon);
+        latency.LeaveWrapped();
     }
 
+    TraceEnd(TEID_CREDENTIAL_REPORT_RESULT, this, hr);
     return hr;
 }
 
@@ -530,16 +716,7 @@ void RaspWrapCredential::_CleanupEvents()
     // Call Uninitialize before releasing our reference on the real
     // ICredentialProviderCredentialEvents to avoid having an
     // invalid reference.
-    if (_pWrappedCredentialEvents != NULL)
-    {
-        _pWrappedCredentialEvents->Uninitialize();
-        _pWrappedCredentialEvents->Release();
-        _pWrappedCredentialEvents = NULL;
-    }
+    _wrappedCredentialEvents.Uninitialize();
 
-    if (_pCredProvCredentialEvents != NULL)
-    {
-        _pCredProvCredentialEvents->Release();
-        _pCredProvCredentialEvents = NULL;
-    }
+    _pCredProvCredentialEvents.Reset();
 }
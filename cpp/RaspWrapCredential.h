@@ -18,35 +18,38 @@
 #include "helpers.h"
 #include "dll.h"
 #include "RaspWrapCredentialEvents.h"
+#include "wrapperfields.h"
+#include "objectpool.h"
+#include "refcount.h"
+#include "queryinterface.h"
 
-class RaspWrapCredential : public IConnectableCredentialProviderCredential
+class RaspWrapCredential : public IConnectableCredentialProviderCredential, public PooledObject<RaspWrapCredential>
 {
     public:
     // IUnknown
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return ++_cRef;
+        return _cRef.AddRef();
     }
 
+    // At zero, we let go of everything and drop our reference on the events translator; the
+    // memory goes when the translator's count is zero too (see RaspWrapCredentialEvents.h).
     IFACEMETHODIMP_(ULONG) Release()
     {
-        LONG cRef = --_cRef;
+        ULONG cRef = _cRef.Release();
         if (!cRef)
         {
-            delete this;
+            _FinalRelease();
+            _wrappedCredentialEvents.Release();
         }
         return cRef;
     }
 
     IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
     {
-        static const QITAB qit[] =
-        {
-            //QITABENT(RaspWrapCredential, ICredentialProviderCredential), // IID_ICredentialProviderCredential
-            QITABENT(RaspWrapCredential, IConnectableCredentialProviderCredential), // IID_IConnectableCredentialProviderCredential
-            {0},
-        };
-        return QISearch(this, qit, riid, ppv);
+        // Only IConnectableCredentialProviderCredential, as before; ICredentialProviderCredential
+        // is deliberately not answered.
+        return QueryInterfaceT<RaspWrapCredential, IConnectableCredentialProviderCredential>(this, riid, ppv);
     }
 
     //IConnectableCredentialProviderCredential
@@ -91,22 +94,53 @@ class RaspWrapCredential : public IConnectableCredentialProviderCredential
                        __in DWORD dwWrappedDescriptorCount);
     RaspWrapCredential();
 
+  private:
+    friend class RaspWrapCredentialEvents;      // frees us, see Release
+
     virtual ~RaspWrapCredential();
 
-  private:
+    // What we do for each of our own fields (see wrapperfields.h); an operation the field's
+    // type doesn't have is left NULL.  String values are passed in a SecureString: a handler
+    // that keeps the one it is given takes it over by moving it.
+    struct FIELD_HANDLERS
+    {
+        HRESULT (*pfnGetStringValue)(RaspWrapCredential *pThis, SecureString *pstr);
+        HRESULT (*pfnGetCheckboxValue)(RaspWrapCredential *pThis, BOOL *pbChecked, PWSTR *ppwszLabel);
+        HRESULT (*pfnSetCheckboxValue)(RaspWrapCredential *pThis, BOOL bChecked);
+        HRESULT (*pfnGetComboBoxValueCount)(RaspWrapCredential *pThis, DWORD *pcItems, DWORD *pdwSelectedItem);
+        HRESULT (*pfnGetComboBoxValueAt)(RaspWrapCredential *pThis, DWORD dwItem, PWSTR *ppwszItem);
+        HRESULT (*pfnSetComboBoxSelectedValue)(RaspWrapCredential *pThis, DWORD dwSelectedItem);
+        HRESULT (*pfnSetStringValue)(RaspWrapCredential *pThis, SecureString *pstr);
+        HRESULT (*pfnCommandLinkClicked)(RaspWrapCredential *pThis);
+    };
+
+    static const FIELD_HANDLERS s_rgFieldHandlers[];    // one per WRAPPER_FIELD_INDEX
+
+    HRESULT                               _RouteField(__in DWORD dwFieldID,
+                                                      __deref_out_opt const FIELD_HANDLERS **ppHandlers,
+                                                      __out DWORD *pdwRoutedID);
+
+    static HRESULT                        _GetUseSSOString(RaspWrapCredential *pThis, SecureString *pstr);
+    static HRESULT                        _GetUseSSOCheckbox(RaspWrapCredential *pThis, BOOL *pbChecked, PWSTR *ppwszLabel);
+    static HRESULT                        _SetUseSSOCheckbox(RaspWrapCredential *pThis, BOOL bChecked);
+
     void                                  _CleanupEvents();
+    void                                  _FinalRelease();
 
   private:
-    LONG                                  _cRef;
+    RefCount                              _cRef;
 
-    RaspWrapCredentialEvents            *_pWrappedCredentialEvents;                     // Translate from the wrapped
-                                                                                        // credential to wrapper credential.
+    RaspWrapCredentialEvents             _wrappedCredentialEvents;                       // Translate from the wrapped
+                                                                                        // credential to wrapper credential;
+                                                                                        // armed from Advise to UnAdvise.
+                                                                                        // Counts its own references, and
+                                                                                        // keeps our memory alive.
 
-    ICredentialProviderCredentialEvents *_pCredProvCredentialEvents;                    // Used to let our parent know
+    ComPtr<ICredentialProviderCredentialEvents> _pCredProvCredentialEvents;                    // Used to let our parent know
                                                                                         // when the credentials have
                                                                                         // changed.
 
-    IConnectableCredentialProviderCredential        *_pWrappedCredential;                // Our wrapped credential.
+    ComPtr<IConnectableCredentialProviderCredential> _pWrappedCredential;                // Our wrapped credential.
 
     DWORD                                _dwWrappedDescriptorCount;                      // The number of fields in our
                                                                                          // wrapped credential.
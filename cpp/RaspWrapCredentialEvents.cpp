@@ -16,6 +16,18 @@
 #include <unknwn.h>
 
 #include "RaspWrapCredentialEvents.h"
+#include "RaspWrapCredential.h"
+
+ULONG RaspWrapCredentialEvents::Release()
+{
+    ULONG cRef = _cRef.Release();
+    if (!cRef)
+    {
+        // We are a member of the wrapper; this frees both.
+        delete _pOwner;
+    }
+    return cRef;
+}
 
 HRESULT RaspWrapCredentialEvents::SetFieldState(__in ICredentialProviderCredential* pcpc, __in DWORD dwFieldID, __in CREDENTIAL_PROVIDER_FIELD_STATE cpfs)
 {
@@ -23,13 +35,14 @@ HRESULT RaspWrapCredentialEvents::SetFieldState(__in ICredentialProviderCredenti
 
     HRESULT hr = E_FAIL;
 
+    TraceBegin(TEID_EVENTS_SET_FIELD_STATE, this, dwFieldID);
+
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->SetFieldState(_pWrapperCredential, dwFieldID, cpfs);
     }
 
-    log("RaspWrapCredentialEvents::SetFieldState(): this(%p): dwFieldID=%d cpfs=%d\n", this, dwFieldID, cpfs);
-
+    TraceEnd(TEID_EVENTS_SET_FIELD_STATE, this, hr, dwFieldID);
     return hr;
 }
 
@@ -40,14 +53,14 @@ HRESULT RaspWrapCredentialEvents::SetFieldInteractiveState(__in ICredentialProvi
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::SetFieldInteractiveState(): this(%p): dwFieldID=%d cpfis=%d\n", this, dwFieldID, cpfis);
-
+    TraceBegin(TEID_EVENTS_SET_FIELD_INTERACTIVE_STATE, this, dwFieldID);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->SetFieldInteractiveState(_pWrapperCredential, dwFieldID, cpfis);
     }
 
+    TraceEnd(TEID_EVENTS_SET_FIELD_INTERACTIVE_STATE, this, hr, dwFieldID);
     return hr;
 }
 
@@ -58,8 +71,11 @@ HRESULT RaspWrapCredentialEvents::SetFieldString(__in ICredentialProviderCredent
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::SetFieldString(): this(%p): dwFieldID=%d \n", this, dwFieldID);
-    log("RaspWrapCredentialEvents::SetFieldString(): %S\n", psz);
+    TraceBegin(TEID_EVENTS_SET_FIELD_STRING, this, dwFieldID);
+    // The connection status is the one string the RAS credential sets that is never sensitive.
+    Log<LL_VERBOSE, LC_EVENTS>("RaspWrapCredentialEvents::SetFieldString(): this(%p): dwFieldID=%lu value=%s\n",
+                               this, dwFieldID,
+                               (dwFieldID == RASP_CONNECTION_STATUS_AT) ? LogPublic(psz) : LogSecret(psz));
 
     if (_pWrapperCredential && _pEvents)
     {
@@ -72,6 +88,7 @@ HRESULT RaspWrapCredentialEvents::SetFieldString(__in ICredentialProviderCredent
         hr = SetFieldState(pcpc, _dwSSOFieldID, connected ? CPFS_HIDDEN : CPFS_DISPLAY_IN_SELECTED_TILE);
     }
 
+    TraceEnd(TEID_EVENTS_SET_FIELD_STRING, this, hr, dwFieldID);
     return hr;
 }
 
@@ -82,14 +99,14 @@ HRESULT RaspWrapCredentialEvents::SetFieldBitmap(__in ICredentialProviderCredent
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::SetFieldBitmap(): this(%p): dwFieldID=%d \n", this, dwFieldID);
-
+    TraceBegin(TEID_EVENTS_SET_FIELD_BITMAP, this, dwFieldID);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->SetFieldBitmap(_pWrapperCredential, dwFieldID, hbmp);
     }
 
+    TraceEnd(TEID_EVENTS_SET_FIELD_BITMAP, this, hr, dwFieldID);
     return hr;
 }
 
@@ -100,14 +117,14 @@ HRESULT RaspWrapCredentialEvents::SetFieldCheckbox(__in ICredentialProviderCrede
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::SetFieldCheckbox(): this(%p): dwFieldID=%d \n", this, dwFieldID);
-
+    TraceBegin(TEID_EVENTS_SET_FIELD_CHECKBOX, this, dwFieldID);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->SetFieldCheckbox(_pWrapperCredential, dwFieldID, bChecked, pszLabel);
     }
 
+    TraceEnd(TEID_EVENTS_SET_FIELD_CHECKBOX, this, hr, dwFieldID);
     return hr;
 }
 
@@ -118,14 +135,14 @@ HRESULT RaspWrapCredentialEvents::SetFieldComboBoxSelectedItem(__in ICredentialP
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::SetFieldComboBoxSelectedItem(): this(%p): dwFieldID=%d \n", this, dwFieldID);
-
+    TraceBegin(TEID_EVENTS_SET_FIELD_COMBOBOX_SELECTED_ITEM, this, dwFieldID);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->SetFieldComboBoxSelectedItem(_pWrapperCredential, dwFieldID, dwSelectedItem);
     }
 
+    TraceEnd(TEID_EVENTS_SET_FIELD_COMBOBOX_SELECTED_ITEM, this, hr, dwFieldID);
     return hr;
 }
 
@@ -136,13 +153,14 @@ HRESULT RaspWrapCredentialEvents::DeleteFieldComboBoxItem(__in ICredentialProvid
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::DeleteFieldComboBoxItem(): this(%p): dwFieldID=%d \n", this, dwFieldID);
+    TraceBegin(TEID_EVENTS_DELETE_FIELD_COMBOBOX_ITEM, this, dwFieldID);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->DeleteFieldComboBoxItem(_pWrapperCredential, dwFieldID, dwItem);
     }
 
+    TraceEnd(TEID_EVENTS_DELETE_FIELD_COMBOBOX_ITEM, this, hr, dwFieldID);
     return hr;
 }
 
@@ -153,14 +171,14 @@ HRESULT RaspWrapCredentialEvents::AppendFieldComboBoxItem(__in ICredentialProvid
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::AppendFieldComboBoxItem(): this(%p): dwFieldID=%d \n", this, dwFieldID);
-
+    TraceBegin(TEID_EVENTS_APPEND_FIELD_COMBOBOX_ITEM, this, dwFieldID);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->AppendFieldComboBoxItem(_pWrapperCredential, dwFieldID, pszItem);
     }
 
+    TraceEnd(TEID_EVENTS_APPEND_FIELD_COMBOBOX_ITEM, this, hr, dwFieldID);
     return hr;
 }
 
@@ -171,13 +189,14 @@ HRESULT RaspWrapCredentialEvents::SetFieldSubmitButton(__in ICredentialProviderC
 
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::SetFieldSubmitButton(): this(%p): dwFieldID=%d \n", this, dwFieldID);
+    TraceBegin(TEID_EVENTS_SET_FIELD_SUBMIT_BUTTON, this, dwFieldID);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->SetFieldSubmitButton(_pWrapperCredential, dwFieldID, dwAdjacentTo);
     }
 
+    TraceEnd(TEID_EVENTS_SET_FIELD_SUBMIT_BUTTON, this, hr, dwFieldID);
     return hr;
 }
 
@@ -185,20 +204,21 @@ HRESULT RaspWrapCredentialEvents::OnCreatingWindow(__out HWND* phwndOwner)
 {
     HRESULT hr = E_FAIL;
 
-    log("RaspWrapCredentialEvents::OnCreatingWindow(): this(%p)\n", this);
+    TraceBegin(TEID_EVENTS_ON_CREATING_WINDOW, this);
 
     if (_pWrapperCredential && _pEvents)
     {
         hr = _pEvents->OnCreatingWindow(phwndOwner);
     }
 
+    TraceEnd(TEID_EVENTS_ON_CREATING_WINDOW, this, hr);
     return hr;
 }
 
-RaspWrapCredentialEvents::RaspWrapCredentialEvents() :
-    _cRef(1), _pWrapperCredential(NULL), _pEvents(NULL), _dwSSOFieldID(0)
+RaspWrapCredentialEvents::RaspWrapCredentialEvents(__in RaspWrapCredential* pOwner) :
+    _pOwner(pOwner), _pWrapperCredential(NULL), _pEvents(NULL), _dwSSOFieldID(0)
 {
-    log("RaspWrapCredentialEvents::RaspWrapCredentialEvents(): this(%p)\n", this);
+    TraceInstant(TEID_EVENTS_CREATE, this);
 }
 
 //
@@ -207,10 +227,15 @@ RaspWrapCredentialEvents::RaspWrapCredentialEvents() :
 //
 // Pointers are saved as weak references (ie, without a reference count) to avoid circular
 // references.  (For instance, The wrapper credential has a reference on the wrapped credential
-// and the wrapped credential should take a reference on this object.  If we had a reference
-// on the wrapper credential, there would be a cycle.)  The wrapper credential must manage
-// the lifetime of our weak references through calls to Initialize and Uninitialize to
-// prevent our weak references from becoming invalid.
+// and the wrapped credential takes a reference on this object.  If we had a reference on the
+// wrapper credential, there would be a cycle.)  The wrapper credential must manage the
+// lifetime of our weak references through calls to Initialize and Uninitialize to prevent
+// our weak references from becoming invalid.
+//
+// We are part of the wrapper credential, so _pWrapperCredential is valid for as long as we
+// are; the wrapper sees to it that the wrapped credential has let go of us before both go
+// away.  LogonUI's pointer is kept alive by the strong reference the wrapper credential
+// holds for as long as we are initialized.
 //
 void RaspWrapCredentialEvents::Initialize(__in ICredentialProviderCredential* pWrapperCredential,
     __in ICredentialProviderCredentialEvents* pEvents, DWORD dwSSOFieldID)
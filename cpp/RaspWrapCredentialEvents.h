@@ -12,6 +12,14 @@
 // The wrapped credential will pass its "this" pointer into any calls to ICPCE,
 // but LogonUI will not recognize the wrapped "this" pointer as a valid credential.
 // Our implementation translates from the wrapped "this" pointer to the wrapper "this".
+//
+// The translator lives inside the wrapper credential, but is a COM object of its own,
+// with its own reference count and identity.  The wrapped credential's reference on it
+// does not keep the wrapper's interface alive, which would be a cycle through the wrapper's
+// reference on the wrapped credential; instead the wrapper makes the wrapped credential let
+// go, in UnAdvise or at the latest when the wrapper's last reference is released.  The
+// memory they share is freed only when both counts are down to zero, so a wrapped
+// credential that holds on to the translator anyway never calls into freed memory.
 
 #pragma once
 
@@ -20,37 +28,30 @@
 #include <shlguid.h>
 #include "helpers.h"
 #include "dll.h"
+#include "refcount.h"
+#include "queryinterface.h"
 
 /* Where the RAS Provider indicates being "connected" */
 #define RASP_CONNECTION_STATUS_AT 2
 
+class RaspWrapCredential;
+
 class RaspWrapCredentialEvents : public ICredentialProviderCredentialEvents
 {
 public:
     // IUnknown
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return ++_cRef;
+        return _cRef.AddRef();
     }
 
-    IFACEMETHODIMP_(ULONG) Release()
-    {
-        LONG cRef = --_cRef;
-        if (!cRef)
-        {
-            delete this;
-        }
-        return cRef;
-    }
+    // The first reference belongs to the wrapper credential we are part of, which releases it
+    // once its own count is zero; whichever release is the last frees the wrapper, and us.
+    IFACEMETHODIMP_(ULONG) Release();
 
-    IFACEMETHODIMP QueryInterface(__in REFIID riid, __in void** ppv)
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
     {
-        static const QITAB qit[] =
-        {
-            QITABENT(RaspWrapCredentialEvents, ICredentialProviderCredentialEvents), // IID_ICredentialProviderCredentialEvents
-            {0},
-        };
-        return QISearch(this, qit, riid, ppv);
+        return QueryInterfaceT<RaspWrapCredentialEvents, ICredentialProviderCredentialEvents>(this, riid, ppv);
     }
 
     // ICredentialProviderCredentialEvents
@@ -66,14 +67,18 @@ public:
     IFACEMETHODIMP OnCreatingWindow(__out HWND *phwndOwner);
 
     // Local
-    RaspWrapCredentialEvents();
+    RaspWrapCredentialEvents(__in RaspWrapCredential* pOwner);
 
     void Initialize(__in ICredentialProviderCredential* pWrapperCredential,
         __in ICredentialProviderCredentialEvents* pEvents, DWORD dwSSOFieldID);
     void Uninitialize();
 
 private:
-    LONG                                 _cRef;
+    RaspWrapCredentialEvents(const RaspWrapCredentialEvents&);
+    RaspWrapCredentialEvents& operator=(const RaspWrapCredentialEvents&);
+
+    RefCount                             _cRef;
+    RaspWrapCredential*                  _pOwner;                // the wrapper we are part of
     ICredentialProviderCredential*       _pWrapperCredential;
     ICredentialProviderCredentialEvents* _pEvents;
     DWORD                                _dwSSOFieldID;
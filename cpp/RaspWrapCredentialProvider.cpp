@@ -21,25 +21,22 @@
 #include "guid.h"
 
 
-RaspWrapCredentialProvider::RaspWrapCredentialProvider():
-    _cRef(1)
+RaspWrapCredentialProvider::RaspWrapCredentialProvider()
 {
     DllAddRef();
 
-    log("RaspWrapCredentialProvider::RaspWrapCredentialProvider(): this(%p)\n", this);
+    TraceInstant(TEID_PROVIDER_CREATE, this);
 
-    _pWrappedProvider = NULL;
     _dwWrappedDescriptorCount = 0;
 }
 
 RaspWrapCredentialProvider::~RaspWrapCredentialProvider()
 {
-    log("RaspWrapCredentialProvider::~RaspWrapCredentialProvider(): this(%p)\n", this);
+    TraceInstant(TEID_PROVIDER_DESTROY, this);
 
-    if (_pWrappedProvider)
-    {
-        _pWrappedProvider->Release();
-    }
+    // Release the wrappers, and through them the wrapped credentials, before the provider.
+    _credentialCache.Clear();
+    _pWrappedProvider.Reset();
 
     DllRelease();
 }
@@ -54,7 +51,14 @@ HRESULT RaspWrapCredentialProvider::SetUsageScenario(
 {
     HRESULT hr = S_OK;
 
-    log("RaspWrapCredentialProvider::SetUsageScenario: this(%p): cpus=%d\n", this, cpus);
+    LatencyScope latency(LM_PROVIDER_SET_USAGE_SCENARIO);
+    TraceInstant(TEID_PROVIDER_SET_USAGE_SCENARIO, this, cpus);
+
+    // Wrappers and descriptors made for the previous scenario have the wrong fields for the
+    // next one, including one we refuse below.
+    _credentialCache.Clear();
+    _descriptorCache.Clear();
+    _dwWrappedDescriptorCount = 0;
 
     // We expect the RAS Provider to only implements the PLAP scenario.
     if (cpus != CPUS_PLAP)
@@ -66,23 +70,44 @@ HRESULT RaspWrapCredentialProvider::SetUsageScenario(
     // and query its interface for an ICredentialProvider we can use.
     if (_pWrappedProvider == NULL)
     {
+        latency.EnterWrapped();
         hr = CoCreateInstance(CLSID_RASProvider, NULL, CLSCTX_ALL,
-                              IID_PPV_ARGS(&_pWrappedProvider));
+                              IID_PPV_ARGS(_pWrappedProvider.ReleaseAndGetAddressOf()));
+        latency.LeaveWrapped();
+        if (FAILED(hr))
+        {
+            Log<LL_ERROR, LC_PROVIDER>("RaspWrapCredentialProvider::SetUsageScenario(): this(%p): "
+                                       "can't create the RAS provider: hr=0x%08lx\n", this, hr);
+        }
     }
 
     if (SUCCEEDED(hr))
     {
-        DWORD count;
-
         // Once the provider is up and running, ask it about the usage scenario
         // being provided.
+        latency.EnterWrapped();
         hr = _pWrappedProvider->SetUsageScenario(cpus, dwFlags);
+        latency.LeaveWrapped();
         if (FAILED(hr)) {
+            Log<LL_WARNING, LC_PROVIDER>("RaspWrapCredentialProvider::SetUsageScenario(): this(%p): "
+                                         "the RAS provider refused cpus=%d: hr=0x%08lx\n", this, cpus, hr);
             return hr;
         }
 
-        /* Now that we have the wrapped provider, let's check its descriptor count */
-        hr = GetFieldDescriptorCount(&count);
+        /* Now that we have the wrapped provider, cache its descriptors along with our
+           own fields, which get the field IDs right after the wrapped ones */
+        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR rgcpfdWrapper[WFI_NUM_FIELDS];
+        for (DWORD i = 0; i < WFI_NUM_FIELDS; i++)
+        {
+            rgcpfdWrapper[i] = g_rgWrapperFields[i].cpfd;
+        }
+        hr = _descriptorCache.Fill(_pWrappedProvider, rgcpfdWrapper, WFI_NUM_FIELDS);
+        _dwWrappedDescriptorCount = _descriptorCache.GetWrappedCount();
+        if (FAILED(hr))
+        {
+            Log<LL_ERROR, LC_PROVIDER>("RaspWrapCredentialProvider::SetUsageScenario(): this(%p): "
+                                       "can't get the field descriptors: hr=0x%08lx\n", this, hr);
+        }
     }
 
     return hr;
@@ -94,13 +119,17 @@ HRESULT RaspWrapCredentialProvider::SetSerialization(
     )
 {
     HRESULT hr = E_UNEXPECTED;
-    log("RaspWrapCredentialProvider::SetSerialization: this(%p)\n", this);
+    LatencyScope latency(LM_PROVIDER_SET_SERIALIZATION);
+    TraceBegin(TEID_PROVIDER_SET_SERIALIZATION, this);
 
     if (_pWrappedProvider != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedProvider->SetSerialization(pcpcs);
+        latency.LeaveWrapped();
     }
 
+    TraceEnd(TEID_PROVIDER_SET_SERIALIZATION, this, hr);
     return hr;
 }
 
@@ -111,26 +140,37 @@ HRESULT RaspWrapCredentialProvider::Advise(
     )
 {
     HRESULT hr = E_UNEXPECTED;
-    log("RaspWrapCredentialProvider::Advise: this(%p)\n", this);
+    LatencyScope latency(LM_PROVIDER_ADVISE);
+    TraceBegin(TEID_PROVIDER_ADVISE, this);
 
     if (_pWrappedProvider != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedProvider->Advise(pcpe, upAdviseContext);
+        latency.LeaveWrapped();
     }
+    TraceEnd(TEID_PROVIDER_ADVISE, this, hr);
     return hr;
 }
 
 // Called by LogonUI when the ICredentialProviderEvents callback is no longer valid.
-// We pass this along to the wrapped provider.
+// We pass this along to the wrapped provider, and let go of the wrappers we've cached
+// since LogonUI is done with our tiles.
 HRESULT RaspWrapCredentialProvider::UnAdvise()
 {
     HRESULT hr = E_UNEXPECTED;
-    log("RaspWrapCredentialProvider::UnAdvise: this(%p)\n", this);
+    LatencyScope latency(LM_PROVIDER_UNADVISE);
+    TraceBegin(TEID_PROVIDER_UNADVISE, this);
+
+    _credentialCache.Clear();
 
     if (_pWrappedProvider != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedProvider->UnAdvise();
+        latency.LeaveWrapped();
     }
+    TraceEnd(TEID_PROVIDER_UNADVISE, this, hr);
     return hr;
 }
 
@@ -139,31 +179,30 @@ HRESULT RaspWrapCredentialProvider::UnAdvise()
 // This number must include both visible and invisible fields. If you want a tile
 // to have different fields from the other tiles you enumerate for a given usage
 // scenario you must include them all in this count and then hide/show them as desired
-// using the field descriptors. We pass this along to the wrapped provider and then append
-// our own credential count.
+// using the field descriptors. The count comes from the descriptor cache, which holds
+// the wrapped provider's fields followed by our own (see wrapperfields.h).
 HRESULT RaspWrapCredentialProvider::GetFieldDescriptorCount(
     __out DWORD* pdwCount
     )
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredentialProvider::GetFieldDescriptorCount: this(%p)\n", this);
+    LatencyScope latency(LM_PROVIDER_GET_FIELD_DESCRIPTOR_COUNT);
+    TraceBegin(TEID_PROVIDER_GET_FIELD_DESCRIPTOR_COUNT, this);
 
-    if (_pWrappedProvider != NULL)
+    if (_descriptorCache.IsFilled())
     {
-        hr = _pWrappedProvider->GetFieldDescriptorCount(&(_dwWrappedDescriptorCount));
-        if (SUCCEEDED(hr))
-        {
-            // Account for our UseSSO checkbox
-            *pdwCount = _dwWrappedDescriptorCount + 1;
-        }
+        *pdwCount = _descriptorCache.GetCount();
+        hr = S_OK;
     }
 
+    TraceEnd(TEID_PROVIDER_GET_FIELD_DESCRIPTOR_COUNT, this, hr);
     return hr;
 }
 
-// Gets the field descriptor for a particular field. If this descriptor refers to one owned
-// by our wrapped provider, we'll pass it along. Otherwise we provide our own.
+// Gets the field descriptor for a particular field. Both the wrapped provider's descriptors
+// and our own are served from the descriptor cache filled in SetUsageScenario, so LogonUI
+// laying out a tile does not call into the wrapped provider.
 HRESULT RaspWrapCredentialProvider::GetFieldDescriptorAt(
     __in DWORD dwIndex,
     __deref_out CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR** ppcpfd
@@ -171,28 +210,17 @@ HRESULT RaspWrapCredentialProvider::GetFieldDescriptorAt(
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredentialProvider::GetFieldDescriptorAt: this(%p)\n", this);
-
-    if (_pWrappedProvider == NULL || ppcpfd == NULL)
+    if (ppcpfd == NULL)
     {
         return hr;
     }
 
-    if (dwIndex == _dwWrappedDescriptorCount)
-    {
-        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR cpfd = { dwIndex, CPFT_CHECKBOX, L"USe SSO", {0} };
-        hr = FieldDescriptorCoAllocCopy(cpfd, ppcpfd);
-    }
-    else
-    {
-        hr = _pWrappedProvider->GetFieldDescriptorAt(dwIndex, ppcpfd);
-        if (SUCCEEDED(hr))
-        {
-            log("RaspWrapCredentialProvider::GetFieldDescriptorAt: dwFieldID=%d cpft=%d\n",
-                (*ppcpfd)->dwFieldID, (*ppcpfd)->cpft);
-        }
-    }
+    LatencyScope latency(LM_PROVIDER_GET_FIELD_DESCRIPTOR_AT);
+    TraceBegin(TEID_PROVIDER_GET_FIELD_DESCRIPTOR_AT, this, dwIndex);
+
+    hr = _descriptorCache.CopyAt(dwIndex, ppcpfd);
 
+    TraceEnd(TEID_PROVIDER_GET_FIELD_DESCRIPTOR_AT, this, hr, dwIndex);
     return hr;
 }
 
@@ -212,80 +240,95 @@ HRESULT RaspWrapCredentialProvider::GetCredentialCount(
 {
     HRESULT hr = E_UNEXPECTED;
 
-    log("RaspWrapCredentialProvider::GetCredentialCount: this(%p)\n", this);
+    LatencyScope latency(LM_PROVIDER_GET_CREDENTIAL_COUNT);
+    TraceBegin(TEID_PROVIDER_GET_CREDENTIAL_COUNT, this);
 
     *pdwDefault = CREDENTIAL_PROVIDER_NO_DEFAULT;
     *pbAutoLogonWithDefault = false;
 
     if (_pWrappedProvider != NULL)
     {
+        latency.EnterWrapped();
         hr = _pWrappedProvider->GetCredentialCount(pdwCount, pdwDefault, pbAutoLogonWithDefault);
-        if (SUCCEEDED(hr)) {
-            log("RaspWrapCredentialProvider::GetCredentialCount: this(%p): pbAutoLogonWithDefault=%d\n",
-                this, *pbAutoLogonWithDefault);
-        }
-        else
+        latency.LeaveWrapped();
+        if (SUCCEEDED(hr))
         {
-            log("RaspWrapCredentialProvider::GetCredentialCount: this(%p): upcall failed\n");
+            // A new enumeration: drop the wrappers of the tiles the last one didn't return.
+            _credentialCache.BeginEnumeration();
         }
     }
 
+    TraceEnd(TEID_PROVIDER_GET_CREDENTIAL_COUNT, this, hr);
     return hr;
 }
 
 // Returns the credential at the index specified by dwIndex. This function is called by
-// logonUI to enumerate the tiles.
+// logonUI to enumerate the tiles, again on every credentials-changed event, so we hand out
+// the wrapper we made for a tile the first time and only wrap credentials we haven't seen.
 HRESULT RaspWrapCredentialProvider::GetCredentialAt(
     __in DWORD dwIndex,
     __deref_out ICredentialProviderCredential** ppcpc
     )
 {
     HRESULT hr = E_UNEXPECTED;
-    ICredentialProviderCredential* pCredential;
-    IConnectableCredentialProviderCredential* pConCred;
-    RaspWrapCredential* wrapper;
+    ComPtr<ICredentialProviderCredential> pCredential;
+    ICredentialProviderCredential* pCachedWrapper;
+    ComPtr<IConnectableCredentialProviderCredential> pConCred;
+    ComPtr<RaspWrapCredential> wrapper;
 
-    log("RaspWrapCredentialProvider::GetCredentialAt: dwIndex=%d this(%p)\n", dwIndex, this);
+    LatencyScope latency(LM_PROVIDER_GET_CREDENTIAL_AT);
+    TraceInstant(TEID_PROVIDER_GET_CREDENTIAL_AT, this, dwIndex);
 
     if (_pWrappedProvider == NULL)
     {
         return hr;
     }
 
-    hr = _pWrappedProvider->GetCredentialAt(dwIndex, &pCredential);
+    latency.EnterWrapped();
+    hr = _pWrappedProvider->GetCredentialAt(dwIndex, pCredential.ReleaseAndGetAddressOf());
+    latency.LeaveWrapped();
     if (FAILED(hr))
     {
+        Log<LL_WARNING, LC_PROVIDER>("RaspWrapCredentialProvider::GetCredentialAt(): this(%p): "
+                                     "the RAS provider has no credential %lu: hr=0x%08lx\n", this, dwIndex, hr);
         return hr;
     }
 
-    log("RaspWrapCredentialProvider::GetCredentialAt: pCredential(%p)\n", pCredential);
+    if (_credentialCache.Find(pCredential, &pCachedWrapper))
+    {
+        TraceInstant(TEID_PROVIDER_CREDENTIAL_CACHED, pCachedWrapper, dwIndex);
+        *ppcpc = pCachedWrapper;
+        return S_OK;
+    }
 
     /* We're only interested in wrapping connectable credentials */
-    hr = pCredential->QueryInterface(IID_PPV_ARGS(&(pConCred)));
-    pCredential->Release();
+    hr = pCredential->QueryInterface(IID_PPV_ARGS(pConCred.ReleaseAndGetAddressOf()));
     if (FAILED(hr))
     {
         /* Shouldn't happen with the RAS backend */
-        log("RaspWrapCredentialProvider::GetCredentialAt: pCredential(%p) not connectable\n", pCredential);
+        TraceInstant(TEID_PROVIDER_CREDENTIAL_NOT_CONNECTABLE, pCredential.Get(), dwIndex);
+        Log<LL_WARNING, LC_PROVIDER>("RaspWrapCredentialProvider::GetCredentialAt(): this(%p): "
+                                     "credential %lu is not connectable: hr=0x%08lx\n", this, dwIndex, hr);
         return hr;
     }
 
-    wrapper = new (std::nothrow) RaspWrapCredential();
+    wrapper.Attach(new (std::nothrow) RaspWrapCredential());
     if (wrapper == NULL) {
-        pConCred->Release();
+        Log<LL_ERROR, LC_PROVIDER>("RaspWrapCredentialProvider::GetCredentialAt(): this(%p): "
+                                   "out of memory wrapping credential %lu\n", this, dwIndex);
         return E_OUTOFMEMORY;
     }
 
-    log("RaspWrapCredentialProvider::GetCredentialAt: wrapper(%p) wraps pConCred(%p)\n", wrapper, pConCred);
+    TraceInstant(TEID_PROVIDER_CREDENTIAL_WRAPPED, wrapper.Get(), dwIndex);
 
     hr = wrapper->Initialize(pConCred, _dwWrappedDescriptorCount);
-    pConCred->Release();
     if (SUCCEEDED(hr)) {
-        *ppcpc = wrapper;
-    }
-    else
-    {
-        delete wrapper;
+        /* Not being able to cache it only means the next enumeration wraps it again */
+        if (FAILED(_credentialCache.Add(pCredential, wrapper)))
+        {
+            TraceInstant(TEID_PROVIDER_CREDENTIAL_NOT_CACHED, wrapper.Get(), dwIndex);
+        }
+        *ppcpc = wrapper.Detach();
     }
 
     return hr;
@@ -300,7 +343,7 @@ HRESULT RaspWrapCredentialProvider::Filter(
 {
     UNREFERENCED_PARAMETER(dwFlags);
 
-    log("RaspWrapCredentialProvider::Filter: this(%p): cpus=%d\n", this, cpus);
+    TraceInstant(TEID_PROVIDER_FILTER, this, cpus);
 
     if (cpus != CPUS_PLAP) {
         return S_OK;
@@ -311,8 +354,7 @@ HRESULT RaspWrapCredentialProvider::Filter(
         if (IsEqualGUID(rgclsidProviders[i], CLSID_RASProvider))
         {
             rgbAllow[i] = false;
-            log("RaspWrapCredentialProvider::Filter: this(%p): filtered out CLSID_RASProvider\n", this);
-
+            TraceInstant(TEID_PROVIDER_FILTERED_RAS_PROVIDER, this);
         }
     }
 
@@ -325,7 +367,7 @@ HRESULT RaspWrapCredentialProvider::UpdateRemoteCredential(
 {
     UNREFERENCED_PARAMETER(pcpcsOut);
     UNREFERENCED_PARAMETER(pcpcsIn);
-    log("RaspWrapCredentialProvider::UpdateRemoteCredential: this(%p)\n", this);
+    TraceInstant(TEID_PROVIDER_UPDATE_REMOTE_CREDENTIAL, this);
     return E_NOTIMPL;
 }
 
@@ -334,12 +376,12 @@ HRESULT RaspWrap_CreateInstance(__in REFIID riid, __deref_out void** ppv)
 {
     HRESULT hr;
 
-    RaspWrapCredentialProvider* pProvider = new (std::nothrow) RaspWrapCredentialProvider();
+    ComPtr<RaspWrapCredentialProvider> pProvider;
+    pProvider.Attach(new (std::nothrow) RaspWrapCredentialProvider());
 
     if (pProvider)
     {
         hr = pProvider->QueryInterface(riid, ppv);
-        pProvider->Release();
     }
     else
     {
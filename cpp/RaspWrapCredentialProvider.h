@@ -15,19 +15,25 @@
 
 #include "RaspWrapCredential.h"
 #include "helpers.h"
+#include "fielddescriptorcache.h"
+#include "credentialcache.h"
+#include "objectpool.h"
+#include "refcount.h"
+#include "queryinterface.h"
 
-class RaspWrapCredentialProvider : public ICredentialProvider, public ICredentialProviderFilter
+class RaspWrapCredentialProvider : public ICredentialProvider, public ICredentialProviderFilter,
+                                   public PooledObject<RaspWrapCredentialProvider>
 {
   public:
     // IUnknown
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return ++_cRef;
+        return _cRef.AddRef();
     }
 
     IFACEMETHODIMP_(ULONG) Release()
     {
-        LONG cRef = --_cRef;
+        ULONG cRef = _cRef.Release();
         if (!cRef)
         {
             delete this;
@@ -37,14 +43,7 @@ class RaspWrapCredentialProvider : public ICredentialProvider, public ICredentia
 
     IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
     {
-        static const QITAB qit[] =
-        {
-            QITABENT(RaspWrapCredentialProvider, ICredentialProvider), // IID_ICredentialProvider
-            QITABENT(RaspWrapCredentialProvider, ICredentialProviderFilter), // IID_ICredentialProviderFilter
-
-            {0},
-        };
-        return QISearch(this, qit, riid, ppv);
+        return QueryInterfaceT<RaspWrapCredentialProvider, ICredentialProvider, ICredentialProviderFilter>(this, riid, ppv);
     }
   public:
     IFACEMETHODIMP SetUsageScenario(__in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus, __in DWORD dwFlags);
@@ -80,8 +79,12 @@ public:
         CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION* pcpcsOut);
 
 private:
-    LONG                _cRef;
-    ICredentialProvider *_pWrappedProvider;         // Our wrapped provider.
+    RefCount            _cRef;
+    ComPtr<ICredentialProvider> _pWrappedProvider;  // Our wrapped provider.
     DWORD               _dwWrappedDescriptorCount;  // The number of fields on each tile of our wrapped provider's
                                                     // credentials.
+    FieldDescriptorCache _descriptorCache;          // The wrapped provider's field descriptors followed by
+                                                    // ours, refreshed by every SetUsageScenario.
+    CredentialCache     _credentialCache;           // The wrapper handed out for each wrapped credential,
+                                                    // until its tile is gone, or SetUsageScenario or UnAdvise.
 };
@@ -0,0 +1,159 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Stock allocator policies for the helpers.
+
+#include "allocator.h"
+#include "utf16.h"
+#include <intsafe.h>
+#include <strsafe.h>
+
+HRESULT Allocator::StrDup(_In_ PCWSTR pwz, _Outptr_result_nullonfailure_ PWSTR *ppwz)
+{
+    *ppwz = nullptr;
+
+    size_t cch;
+    HRESULT hr = Utf16ScanString(pwz, STRSAFE_MAX_CCH - 1, &cch);
+    if (SUCCEEDED(hr))
+    {
+        void *pv;
+        hr = Alloc((cch + 1) * sizeof(wchar_t), &pv);
+        if (SUCCEEDED(hr))
+        {
+            CopyMemory(pv, pwz, (cch + 1) * sizeof(wchar_t));
+            *ppwz = (PWSTR)pv;
+        }
+    }
+
+    return hr;
+}
+
+class CoTaskMemAllocator : public Allocator
+{
+public:
+    HRESULT Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv)
+    {
+        *ppv = CoTaskMemAlloc(cb);
+        return (*ppv) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    void Free(_In_opt_ void *pv)
+    {
+        CoTaskMemFree(pv);
+    }
+};
+
+class LocalMemAllocator : public Allocator
+{
+public:
+    HRESULT Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv)
+    {
+        *ppv = LocalAlloc(0, cb);
+        return (*ppv) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    void Free(_In_opt_ void *pv)
+    {
+        if (pv)
+        {
+            LocalFree(pv);
+        }
+    }
+};
+
+Allocator *GetCoTaskMemAllocator()
+{
+    static CoTaskMemAllocator s_allocator;
+    return &s_allocator;
+}
+
+Allocator *GetLocalAllocator()
+{
+    static LocalMemAllocator s_allocator;
+    return &s_allocator;
+}
+
+HRESULT SecureArenaAllocator::Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv)
+{
+    return _parena->Alloc(cb, ppv);
+}
+
+void SecureArenaAllocator::Free(_In_opt_ void *pv)
+{
+    UNREFERENCED_PARAMETER(pv);
+}
+
+//
+// The first allocation is aligned to MEMORY_ALLOCATION_ALIGNMENT like the heap's, whatever the
+// alignment of the caller's buffer; _cbSkip is the slack that takes.
+//
+BumpAllocator::BumpAllocator(_Inout_updates_bytes_(cb) void *pv, _In_ SIZE_T cb) :
+    _pb((BYTE*)pv),
+    _cb(cb),
+    _cbSkip(0),
+    _cbUsed(0)
+{
+    SIZE_T cbMisalign = (ULONG_PTR)pv & (MEMORY_ALLOCATION_ALIGNMENT - 1);
+    if (cbMisalign)
+    {
+        _cbSkip = min(MEMORY_ALLOCATION_ALIGNMENT - cbMisalign, cb);
+    }
+    _cbUsed = _cbSkip;
+}
+
+HRESULT BumpAllocator::Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv)
+{
+    *ppv = nullptr;
+
+    SIZE_T cbAligned;
+    HRESULT hr = SizeTAdd(cb, MEMORY_ALLOCATION_ALIGNMENT - 1, &cbAligned);
+    if (SUCCEEDED(hr))
+    {
+        cbAligned &= ~(SIZE_T)(MEMORY_ALLOCATION_ALIGNMENT - 1);
+        if (cbAligned <= _cb - _cbUsed)
+        {
+            *ppv = _pb + _cbUsed;
+            _cbUsed += cbAligned;
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    return hr;
+}
+
+void BumpAllocator::Free(_In_opt_ void *pv)
+{
+    UNREFERENCED_PARAMETER(pv);
+}
+
+HRESULT CountingAllocator::Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv)
+{
+    HRESULT hr = _pInner->Alloc(cb, ppv);
+    if (SUCCEEDED(hr))
+    {
+        InterlockedIncrement(&_cAllocs);
+        InterlockedExchangeAdd64(&_cbAllocated, (LONGLONG)cb);
+    }
+    else
+    {
+        InterlockedIncrement(&_cFailures);
+    }
+    return hr;
+}
+
+void CountingAllocator::Free(_In_opt_ void *pv)
+{
+    if (pv)
+    {
+        InterlockedIncrement(&_cFrees);
+    }
+    _pInner->Free(pv);
+}
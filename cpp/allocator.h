@@ -0,0 +1,130 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Allocator is the memory policy taken by every allocating helper.  A buffer
+// a helper returns is freed through the same Allocator that produced it, so
+// callers no longer have to pair CoTaskMemFree, LocalFree and friends by hand.
+
+#pragma once
+
+#include <windows.h>
+#include "securearena.h"
+
+class Allocator
+{
+public:
+    virtual HRESULT Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv) = 0;
+
+    // Accepts NULL.
+    virtual void Free(_In_opt_ void *pv) = 0;
+
+    // Copies pwz (including the terminator) into memory from this allocator.
+    HRESULT StrDup(_In_ PCWSTR pwz, _Outptr_result_nullonfailure_ PWSTR *ppwz);
+
+protected:
+    ~Allocator()
+    {
+    }
+};
+
+// CoTaskMemAlloc/CoTaskMemFree: for anything handed to LogonUI or another COM caller.
+Allocator *GetCoTaskMemAllocator();
+
+// LocalAlloc/LocalFree: for the buffers the Cred* APIs traffic in.
+Allocator *GetLocalAllocator();
+
+//
+// Carves allocations out of a SecureArena.  Free is a no-op; the arena wipes and releases
+// everything at once.
+//
+class SecureArenaAllocator : public Allocator
+{
+public:
+    explicit SecureArenaAllocator(_In_ SecureArena *parena) : _parena(parena)
+    {
+    }
+
+    HRESULT Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv);
+    void Free(_In_opt_ void *pv);
+
+private:
+    SecureArena *_parena;
+};
+
+//
+// Carves allocations out of a buffer the caller owns (typically on the stack), so a hot path
+// can run without touching a heap.  Free is a no-op; Reset makes the whole buffer available
+// again.  The buffer is not wiped: use a SecureArena for secrets.
+//
+class BumpAllocator : public Allocator
+{
+public:
+    BumpAllocator(_Inout_updates_bytes_(cb) void *pv, _In_ SIZE_T cb);
+
+    HRESULT Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv);
+    void Free(_In_opt_ void *pv);
+
+    void Reset()
+    {
+        _cbUsed = _cbSkip;
+    }
+
+private:
+    BYTE   *_pb;
+    SIZE_T  _cb;
+    SIZE_T  _cbSkip;
+    SIZE_T  _cbUsed;
+};
+
+//
+// Forwards to another allocator and counts what goes through it, for measuring how many
+// allocations a sequence of calls makes.  The counters are updated with interlocked operations
+// so one instance can be shared across threads.
+//
+class CountingAllocator : public Allocator
+{
+public:
+    explicit CountingAllocator(_In_ Allocator *pInner) :
+        _pInner(pInner),
+        _cAllocs(0),
+        _cFrees(0),
+        _cFailures(0),
+        _cbAllocated(0)
+    {
+    }
+
+    HRESULT Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv);
+    void Free(_In_opt_ void *pv);
+
+    LONG GetAllocs() const
+    {
+        return _cAllocs;
+    }
+
+    LONG GetFrees() const
+    {
+        return _cFrees;
+    }
+
+    LONG GetFailures() const
+    {
+        return _cFailures;
+    }
+
+    LONGLONG GetBytesAllocated() const
+    {
+        return _cbAllocated;
+    }
+
+private:
+    Allocator         *_pInner;
+    volatile LONG      _cAllocs;
+    volatile LONG      _cFrees;
+    volatile LONG      _cFailures;
+    volatile LONGLONG  _cbAllocated;
+};
@@ -0,0 +1,121 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Cache of wrapper credentials, keyed by the wrapped credential.
+
+#include <new>
+#include "credentialcache.h"
+
+CredentialCache::CredentialCache() :
+    _rgEntries(NULL),
+    _cEntries(0),
+    _cEntriesMax(0),
+    _dwGeneration(0)
+{
+}
+
+CredentialCache::~CredentialCache()
+{
+    Clear();
+    delete[] _rgEntries;
+}
+
+//
+// The key is the interface pointer the wrapped provider hands out, not its IUnknown: that
+// saves a QueryInterface per lookup, and the RAS provider returns the same pointer for the
+// same tile.  A provider that didn't would only cost us a miss, never a wrong wrapper.
+// There are only ever a handful of tiles, so a linear search is as fast as anything.
+//
+bool CredentialCache::Find(
+    _In_ ICredentialProviderCredential *pcpcWrapped,
+    _Outptr_result_maybenull_ ICredentialProviderCredential **ppcpcWrapper
+    )
+{
+    *ppcpcWrapper = NULL;
+
+    for (DWORD i = 0; i < _cEntries; i++)
+    {
+        if (_rgEntries[i].pcpcWrapped == pcpcWrapped)
+        {
+            _rgEntries[i].dwGeneration = _dwGeneration;
+            *ppcpcWrapper = _rgEntries[i].pcpcWrapper;
+            (*ppcpcWrapper)->AddRef();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+HRESULT CredentialCache::Add(
+    _In_ ICredentialProviderCredential *pcpcWrapped,
+    _In_ ICredentialProviderCredential *pcpcWrapper
+    )
+{
+    if (_cEntries == _cEntriesMax)
+    {
+        DWORD cEntriesMax = _cEntriesMax ? _cEntriesMax * 2 : 4;
+        ENTRY *rgEntries = new (std::nothrow) ENTRY[cEntriesMax];
+        if (rgEntries == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        if (_cEntries)
+        {
+            CopyMemory(rgEntries, _rgEntries, _cEntries * sizeof(*_rgEntries));
+        }
+        delete[] _rgEntries;
+        _rgEntries = rgEntries;
+        _cEntriesMax = cEntriesMax;
+    }
+
+    pcpcWrapped->AddRef();
+    pcpcWrapper->AddRef();
+    _rgEntries[_cEntries].pcpcWrapped = pcpcWrapped;
+    _rgEntries[_cEntries].pcpcWrapper = pcpcWrapper;
+    _rgEntries[_cEntries].dwGeneration = _dwGeneration;
+    _cEntries++;
+
+    return S_OK;
+}
+
+//
+// LogonUI asks for the count and then for every tile, so whatever the previous enumeration did
+// not ask for is no longer among the wrapped provider's tiles.  Sweeping here rather than at the
+// end of an enumeration means a stale wrapper lives until the next one, which LogonUI has no
+// use for anyway.
+//
+void CredentialCache::BeginEnumeration()
+{
+    DWORD cKept = 0;
+    for (DWORD i = 0; i < _cEntries; i++)
+    {
+        if (_rgEntries[i].dwGeneration == _dwGeneration)
+        {
+            _rgEntries[cKept++] = _rgEntries[i];
+        }
+        else
+        {
+            _rgEntries[i].pcpcWrapper->Release();
+            _rgEntries[i].pcpcWrapped->Release();
+        }
+    }
+    _cEntries = cKept;
+    _dwGeneration++;
+}
+
+void CredentialCache::Clear()
+{
+    for (DWORD i = 0; i < _cEntries; i++)
+    {
+        _rgEntries[i].pcpcWrapper->Release();
+        _rgEntries[i].pcpcWrapped->Release();
+    }
+    _cEntries = 0;
+}
@@ -0,0 +1,68 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CredentialCache remembers the wrapper credential handed out for each of
+// the wrapped provider's credentials.  LogonUI enumerates the tiles again
+// on every credentials-changed event; with the cache, a tile it has seen
+// before gets the same wrapper back (and keeps its state, such as the SSO
+// checkbox) instead of a new one.  Each enumeration marks the wrappers it
+// hands out, and the next one releases those of the tiles that are gone.
+
+#pragma once
+
+#include <windows.h>
+#include <credentialprovider.h>
+
+class CredentialCache
+{
+public:
+    CredentialCache();
+    ~CredentialCache();
+
+    // Starts an enumeration of the tiles, for GetCredentialCount.  Releases the wrappers that
+    // the previous enumeration neither found nor added: their tiles are gone.
+    void BeginEnumeration();
+
+    // If a wrapper was cached for pcpcWrapped, returns true with an AddRef'd pointer to it in
+    // *ppcpcWrapper, and keeps it for the next enumeration.
+    bool Find(
+        _In_ ICredentialProviderCredential *pcpcWrapped,
+        _Outptr_result_maybenull_ ICredentialProviderCredential **ppcpcWrapper
+        );
+
+    // Remembers pcpcWrapper as the wrapper for pcpcWrapped; the cache holds a reference on
+    // both until an enumeration passes it by or the cache is cleared.
+    HRESULT Add(
+        _In_ ICredentialProviderCredential *pcpcWrapped,
+        _In_ ICredentialProviderCredential *pcpcWrapper
+        );
+
+    // Releases every cached wrapper, for when the tiles they belong to are no longer valid.
+    void Clear();
+
+    DWORD GetCount() const
+    {
+        return _cEntries;
+    }
+
+private:
+    CredentialCache(const CredentialCache&);
+    CredentialCache& operator=(const CredentialCache&);
+
+    struct ENTRY
+    {
+        ICredentialProviderCredential *pcpcWrapped;     // the key; held so its address can't be reused
+        ICredentialProviderCredential *pcpcWrapper;
+        DWORD                          dwGeneration;    // the last enumeration that returned it
+    };
+
+    ENTRY *_rgEntries;
+    DWORD  _cEntries;
+    DWORD  _cEntriesMax;
+    DWORD  _dwGeneration;   // the current enumeration
+};
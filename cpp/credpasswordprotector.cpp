@@ -0,0 +1,65 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The CredProtect password protector, the one the provider itself uses.
+
+#include "passwordprotector.h"
+
+#pragma warning(push)
+#pragma warning(disable: 28301)
+#include <wincred.h>
+#pragma warning(pop)
+
+//
+// CredIsProtected and CredProtect only read the password, their prototypes just lack the const.
+// Casting it away here is what lets the pipeline work on the caller's string instead of a copy.
+//
+class CredPasswordProtector : public PasswordProtector
+{
+public:
+    HRESULT IsProtected(_In_reads_(cch + 1) PCWSTR pwz, _In_ DWORD cch, _Out_ bool *pfProtected)
+    {
+        UNREFERENCED_PARAMETER(cch);
+
+        CRED_PROTECTION_TYPE protectionType;
+        *pfProtected = CredIsProtectedW(const_cast<PWSTR>(pwz), &protectionType) && (CredUnprotected != protectionType);
+        return S_OK;
+    }
+
+    // The encrypted bytes carry a fixed-size header and are text encoded, which grows them by a
+    // third.  This errs on the generous side; a miss only costs one more call to Protect.
+    DWORD EstimateProtectedCch(_In_ DWORD cch)
+    {
+        return ((cch * sizeof(wchar_t) + 256) * 4) / 3 + 8;
+    }
+
+    HRESULT Protect(
+        _In_reads_(cch + 1) PCWSTR pwz,
+        _In_ DWORD cch,
+        _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+        _In_ DWORD cchOut,
+        _Out_ DWORD *pcchOut
+        )
+    {
+        // Note that the character count passed to CredProtect must include the terminator.
+        DWORD cchProtected = cchOut;
+        HRESULT hr = S_OK;
+        if (!CredProtectW(FALSE, const_cast<PWSTR>(pwz), cch + 1, pwzOut, &cchProtected, nullptr))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        *pcchOut = cchProtected;
+        return hr;
+    }
+};
+
+PasswordProtector *GetDefaultPasswordProtector()
+{
+    static CredPasswordProtector s_protector;
+    return &s_protector;
+}
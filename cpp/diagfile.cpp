@@ -0,0 +1,129 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The files the diagnostics write.
+
+#include "diagfile.h"
+#include "logger.h"
+#include <strsafe.h>
+#include <sddl.h>
+#include <aclapi.h>
+
+// Full control for SYSTEM and the Administrators, inherited by the files, and nothing from the
+// parent.
+#define DIAG_DIRECTORY_SDDL     L"D:P(A;OICI;FA;;;SY)(A;OICI;FA;;;BA)"
+
+bool DiagReadPath(
+    _In_ PCWSTR pwzValue,
+    _In_ PCWSTR pwzDefault,
+    _Out_writes_(cch) PWSTR pwzPath,
+    _In_ DWORD cch
+    )
+{
+    // A REG_EXPAND_SZ value comes back expanded.
+    DWORD cb = cch * sizeof(WCHAR);
+    if (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, RASPWRAP_CONFIG_KEY, pwzValue, RRF_RT_REG_SZ, NULL,
+                                      pwzPath, &cb))
+    {
+        return true;
+    }
+
+    DWORD cchExpanded = ExpandEnvironmentStringsW(pwzDefault, pwzPath, cch);
+    return cchExpanded != 0 && cchExpanded <= cch;
+}
+
+//
+// Anyone else who could make the directory could plant links in it, or read what we write, so
+// an existing one must be a real directory, not a junction or a link, and be owned by SYSTEM or
+// the Administrators.
+//
+bool DiagPrepareDirectory(_In_ PCWSTR pwzDirectory)
+{
+    PSECURITY_DESCRIPTOR psd;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(DIAG_DIRECTORY_SDDL, SDDL_REVISION_1, &psd, NULL))
+    {
+        return false;
+    }
+
+    SECURITY_ATTRIBUTES sa = { sizeof(sa), psd, FALSE };
+    BOOL fCreated = CreateDirectoryW(pwzDirectory, &sa);
+    DWORD dwError = GetLastError();
+    LocalFree(psd);
+    if (!fCreated && dwError != ERROR_ALREADY_EXISTS)
+    {
+        return false;
+    }
+
+    HANDLE hDirectory = CreateFileW(pwzDirectory, READ_CONTROL | FILE_READ_ATTRIBUTES,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                                    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, NULL);
+    if (hDirectory == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    bool fTrusted = false;
+    BY_HANDLE_FILE_INFORMATION bhfi;
+    if (GetFileInformationByHandle(hDirectory, &bhfi) &&
+        (bhfi.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_REPARSE_POINT)) == FILE_ATTRIBUTE_DIRECTORY)
+    {
+        PSID psidOwner;
+        PSECURITY_DESCRIPTOR psdDirectory;
+        if (ERROR_SUCCESS == GetSecurityInfo(hDirectory, SE_FILE_OBJECT, OWNER_SECURITY_INFORMATION, &psidOwner,
+                                             NULL, NULL, NULL, &psdDirectory))
+        {
+            fTrusted = IsWellKnownSid(psidOwner, WinLocalSystemSid) ||
+                       IsWellKnownSid(psidOwner, WinBuiltinAdministratorsSid);
+            LocalFree(psdDirectory);
+        }
+    }
+
+    CloseHandle(hDirectory);
+    return fTrusted;
+}
+
+bool DiagPrepareDirectoryOf(_In_ PCWSTR pwzFile)
+{
+    WCHAR wszDirectory[MAX_PATH];
+    if (FAILED(StringCchCopyW(wszDirectory, ARRAYSIZE(wszDirectory), pwzFile)))
+    {
+        return false;
+    }
+
+    // A bare file name would go in whatever the current directory is; that is never checked.
+    PWSTR pwchSeparator = wcsrchr(wszDirectory, L'\\');
+    if (!pwchSeparator || pwchSeparator == wszDirectory)
+    {
+        return false;
+    }
+    *pwchSeparator = L'\0';
+
+    return DiagPrepareDirectory(wszDirectory);
+}
+
+//
+// CREATE_NEW never opens whatever is already there under the name, a link included; the file
+// is checked again once open, in case the name was swapped for a link under us.
+//
+HANDLE DiagCreateFile(_In_ PCWSTR pwzFile, _In_ DWORD dwDesiredAccess)
+{
+    // GetFileInformationByHandle needs FILE_READ_ATTRIBUTES, which FILE_APPEND_DATA lacks.
+    HANDLE hFile = CreateFileW(pwzFile, dwDesiredAccess | FILE_READ_ATTRIBUTES, FILE_SHARE_READ, NULL, CREATE_NEW,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OPEN_REPARSE_POINT, NULL);
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        BY_HANDLE_FILE_INFORMATION bhfi;
+        if (!GetFileInformationByHandle(hFile, &bhfi) || bhfi.nNumberOfLinks != 1 ||
+            (bhfi.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+        {
+            CloseHandle(hFile);
+            hFile = INVALID_HANDLE_VALUE;
+        }
+    }
+    return hFile;
+}
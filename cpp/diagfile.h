@@ -0,0 +1,41 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The files the diagnostics write: the trace, the latency histograms and
+// the flight recorder.  LogonUI runs as SYSTEM, so whoever controls the
+// directory such a file goes in could have us create, or overwrite, a file
+// anywhere through a link.  Every diagnostics file is therefore created
+// new, in a directory that only SYSTEM and the Administrators have access
+// to, and never through a link.
+
+#pragma once
+
+#include <windows.h>
+
+// Where the diagnostics files go unless the configuration says otherwise.
+#define RASPWRAP_DIAG_DIRECTORY_DEFAULT L"%ProgramData%\\RaspWrap"
+
+// Reads the REG_SZ or REG_EXPAND_SZ path pwzValue from the configuration, or, if it is absent,
+// expands pwzDefault.  Fails if the path doesn't fit in cch characters.
+bool DiagReadPath(
+    _In_ PCWSTR pwzValue,
+    _In_ PCWSTR pwzDefault,
+    _Out_writes_(cch) PWSTR pwzPath,
+    _In_ DWORD cch
+    );
+
+// Creates the directory so that only SYSTEM and the Administrators have access to it or, if it
+// is already there, checks that only they could have made it.
+bool DiagPrepareDirectory(_In_ PCWSTR pwzDirectory);
+
+// The same, for the directory pwzFile is in.
+bool DiagPrepareDirectoryOf(_In_ PCWSTR pwzFile);
+
+// Creates pwzFile, which must not exist yet, and checks that the name didn't turn into a link
+// while it did.  Returns INVALID_HANDLE_VALUE if either fails.
+HANDLE DiagCreateFile(_In_ PCWSTR pwzFile, _In_ DWORD dwDesiredAccess);
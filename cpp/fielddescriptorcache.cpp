@@ -0,0 +1,286 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Per-scenario cache of field descriptors, and field descriptor copies.
+
+#include "fielddescriptorcache.h"
+#include "utf16.h"
+#include <intsafe.h>
+
+FieldDescriptorCache::FieldDescriptorCache() :
+    _pallocator(GetCoTaskMemAllocator()),
+    _rgcpfd(nullptr),
+    _ccpfd(0),
+    _ccpfdWrapped(0)
+{
+}
+
+FieldDescriptorCache::FieldDescriptorCache(_In_ Allocator *pallocator) :
+    _pallocator(pallocator),
+    _rgcpfd(nullptr),
+    _ccpfd(0),
+    _ccpfdWrapped(0)
+{
+}
+
+FieldDescriptorCache::~FieldDescriptorCache()
+{
+    Clear();
+}
+
+void FieldDescriptorCache::Clear()
+{
+    _pallocator->Free(_rgcpfd);
+    _rgcpfd = nullptr;
+    _ccpfd = 0;
+    _ccpfdWrapped = 0;
+}
+
+//
+// The wrapped provider hands out each descriptor in two allocations of its own.  They are
+// collected first, then the whole set is packed into a single block: the descriptor array,
+// followed by every label, with each pszLabel pointing into the block.
+//
+HRESULT FieldDescriptorCache::Fill(
+    _In_ ICredentialProvider *pProvider,
+    _In_reads_(cExtra) const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *rgExtra,
+    _In_ DWORD cExtra
+    )
+{
+    Clear();
+
+    DWORD ccpfdWrapped;
+    HRESULT hr = pProvider->GetFieldDescriptorCount(&ccpfdWrapped);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    DWORD ccpfd;
+    hr = DWordAdd(ccpfdWrapped, cExtra, &ccpfd);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Our own memory comes from _pallocator; the wrapped provider's descriptors, and their
+    // labels, were allocated with CoTaskMemAlloc, as GetFieldDescriptorAt requires.
+    Allocator *pallocator = _pallocator;
+    Allocator *pallocatorWrapped = GetCoTaskMemAllocator();
+
+    CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **rgpcpfdWrapped = nullptr;
+    if (ccpfdWrapped)
+    {
+        void *pv;
+        hr = pallocator->Alloc(ccpfdWrapped * sizeof(*rgpcpfdWrapped), &pv);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        rgpcpfdWrapped = (CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR**)pv;
+        ZeroMemory(rgpcpfdWrapped, ccpfdWrapped * sizeof(*rgpcpfdWrapped));
+    }
+
+    size_t cb;
+    hr = SizeTMult(ccpfd, sizeof(CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR), &cb);
+    for (DWORD i = 0; i < ccpfd && SUCCEEDED(hr); i++)
+    {
+        const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd;
+        if (i < ccpfdWrapped)
+        {
+            hr = pProvider->GetFieldDescriptorAt(i, &rgpcpfdWrapped[i]);
+            pcpfd = rgpcpfdWrapped[i];
+            if (SUCCEEDED(hr) && !pcpfd)
+            {
+                hr = E_UNEXPECTED;
+            }
+        }
+        else
+        {
+            pcpfd = &rgExtra[i - ccpfdWrapped];
+        }
+
+        if (SUCCEEDED(hr) && pcpfd->pszLabel)
+        {
+            size_t cchLabel;
+            hr = Utf16ScanString(pcpfd->pszLabel, UNICODE_STRING_MAX_CHARS, &cchLabel);
+            if (SUCCEEDED(hr))
+            {
+                // cchLabel is at most UNICODE_STRING_MAX_CHARS, so only the sum can overflow.
+                hr = SizeTAdd(cb, (cchLabel + 1) * sizeof(wchar_t), &cb);
+            }
+        }
+    }
+
+    void *pvBlock = nullptr;
+    if (SUCCEEDED(hr))
+    {
+        hr = pallocator->Alloc(cb, &pvBlock);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *rgcpfd = (CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR*)pvBlock;
+        PWSTR pwchLabels = (PWSTR)(rgcpfd + ccpfd);
+
+        for (DWORD i = 0; i < ccpfd; i++)
+        {
+            const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd = (i < ccpfdWrapped) ? rgpcpfdWrapped[i] : &rgExtra[i - ccpfdWrapped];
+
+            rgcpfd[i] = *pcpfd;
+            if (i >= ccpfdWrapped)
+            {
+                rgcpfd[i].dwFieldID = i;
+            }
+
+            if (pcpfd->pszLabel)
+            {
+                // Already scanned, and found to fit, by the sizing pass above.
+                size_t cchLabel;
+                (void)Utf16ScanString(pcpfd->pszLabel, UNICODE_STRING_MAX_CHARS, &cchLabel);
+                CopyMemory(pwchLabels, pcpfd->pszLabel, (cchLabel + 1) * sizeof(wchar_t));
+                rgcpfd[i].pszLabel = pwchLabels;
+                pwchLabels += cchLabel + 1;
+            }
+        }
+
+        _rgcpfd = rgcpfd;
+        _ccpfd = ccpfd;
+        _ccpfdWrapped = ccpfdWrapped;
+    }
+
+    for (DWORD i = 0; i < ccpfdWrapped; i++)
+    {
+        if (rgpcpfdWrapped[i])
+        {
+            pallocatorWrapped->Free(rgpcpfdWrapped[i]->pszLabel);
+            pallocatorWrapped->Free(rgpcpfdWrapped[i]);
+        }
+    }
+    pallocator->Free(rgpcpfdWrapped);
+
+    return hr;
+}
+
+//
+// LogonUI frees the struct and its pszLabel separately with CoTaskMemFree, so the copy it gets
+// cannot share a single allocation the way the cached entries do.
+//
+HRESULT FieldDescriptorCache::CopyAt(
+    _In_ DWORD dwIndex,
+    _Outptr_result_nullonfailure_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
+    ) const
+{
+    *ppcpfd = nullptr;
+
+    HRESULT hr;
+    const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd = GetAt(dwIndex);
+    if (pcpfd)
+    {
+        hr = FieldDescriptorCoAllocCopy(*pcpfd, ppcpfd);
+    }
+    else
+    {
+        hr = (IsFilled()) ? E_INVALIDARG : E_UNEXPECTED;
+    }
+
+    return hr;
+}
+
+//
+// Copies the field descriptor pointed to by rcpfd into a buffer allocated
+// using pallocator. Returns that buffer in ppcpfd.  The label is allocated
+// separately, from the same allocator.
+//
+HRESULT FieldDescriptorAllocCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _In_ Allocator *pallocator,
+    _Outptr_result_nullonfailure_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
+    )
+{
+    *ppcpfd = nullptr;
+
+    void *pv;
+    HRESULT hr = pallocator->Alloc(sizeof(**ppcpfd), &pv);
+    if (SUCCEEDED(hr))
+    {
+        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd = (CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR*)pv;
+        hr = FieldDescriptorCopy(rcpfd, pallocator, pcpfd);
+        if (SUCCEEDED(hr))
+        {
+            *ppcpfd = pcpfd;
+        }
+        else
+        {
+            pallocator->Free(pcpfd);
+        }
+    }
+
+    return hr;
+}
+
+//
+// Copies the field descriptor pointed to by rcpfd into a buffer allocated
+// using CoTaskMemAlloc. Returns that buffer in ppcpfd.
+//
+HRESULT FieldDescriptorCoAllocCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _Outptr_result_nullonfailure_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
+    )
+{
+    return FieldDescriptorAllocCopy(rcpfd, GetCoTaskMemAllocator(), ppcpfd);
+}
+
+//
+// Coppies rcpfd into the buffer pointed to by pcpfd. The caller is responsible for
+// allocating pcpfd. This function uses pallocator to allocate memory for
+// pcpfd->pszLabel.
+//
+HRESULT FieldDescriptorCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _In_ Allocator *pallocator,
+    _Out_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd
+    )
+{
+    HRESULT hr;
+    CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR cpfd;
+
+    cpfd.dwFieldID = rcpfd.dwFieldID;
+    cpfd.cpft = rcpfd.cpft;
+    cpfd.guidFieldType = rcpfd.guidFieldType;
+
+    if (rcpfd.pszLabel)
+    {
+        hr = pallocator->StrDup(rcpfd.pszLabel, &cpfd.pszLabel);
+    }
+    else
+    {
+        cpfd.pszLabel = nullptr;
+        hr = S_OK;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        *pcpfd = cpfd;
+    }
+
+    return hr;
+}
+
+//
+// Coppies rcpfd into the buffer pointed to by pcpfd. The caller is responsible for
+// allocating pcpfd. This function uses CoTaskMemAlloc to allocate memory for
+// pcpfd->pszLabel.
+//
+HRESULT FieldDescriptorCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _Out_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd
+    )
+{
+    return FieldDescriptorCopy(rcpfd, GetCoTaskMemAllocator(), pcpfd);
+}
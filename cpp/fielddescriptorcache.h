@@ -0,0 +1,107 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// FieldDescriptorCache keeps the wrapped provider's field descriptors, plus
+// the ones we add ourselves, for the current usage scenario.  LogonUI asks
+// for every descriptor each time it lays out a tile; with the cache those
+// calls are answered without going back to the wrapped provider.
+//
+// The field descriptor copies the rest of the provider makes are here too.
+
+#pragma once
+
+#pragma warning(push)
+#pragma warning(disable: 28251)
+#include <credentialprovider.h>
+#pragma warning(pop)
+
+#include <windows.h>
+#include "allocator.h"
+
+//makes a copy of a field descriptor using CoTaskMemAlloc
+HRESULT FieldDescriptorCoAllocCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _Outptr_result_nullonfailure_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
+    );
+
+//makes a copy of a field descriptor, and its label, using pallocator
+HRESULT FieldDescriptorAllocCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _In_ Allocator *pallocator,
+    _Outptr_result_nullonfailure_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
+    );
+
+//makes a copy of a field descriptor on the normal heap
+HRESULT FieldDescriptorCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _Out_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd
+    );
+
+//makes a copy of a field descriptor into a caller-provided struct, allocating the label using pallocator
+HRESULT FieldDescriptorCopy(
+    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
+    _In_ Allocator *pallocator,
+    _Out_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd
+    );
+
+
+class FieldDescriptorCache
+{
+public:
+    // The cache's own memory comes from pallocator; CoTaskMemAlloc if none is given.
+    FieldDescriptorCache();
+    explicit FieldDescriptorCache(_In_ Allocator *pallocator);
+    ~FieldDescriptorCache();
+
+    // Replaces the contents with the descriptors of pProvider (which must already have had its
+    // usage scenario set) followed by the cExtra descriptors in rgExtra.  The extra descriptors
+    // are renumbered to follow the wrapped ones.  On failure the cache is left empty.
+    HRESULT Fill(
+        _In_ ICredentialProvider *pProvider,
+        _In_reads_(cExtra) const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *rgExtra,
+        _In_ DWORD cExtra
+        );
+
+    void Clear();
+
+    bool IsFilled() const
+    {
+        return _rgcpfd != nullptr;
+    }
+
+    DWORD GetCount() const
+    {
+        return _ccpfd;
+    }
+
+    DWORD GetWrappedCount() const
+    {
+        return _ccpfdWrapped;
+    }
+
+    // The cached descriptor; owned by the cache.
+    const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *GetAt(_In_ DWORD dwIndex) const
+    {
+        return (dwIndex < _ccpfd) ? &_rgcpfd[dwIndex] : nullptr;
+    }
+
+    // A copy of the descriptor for LogonUI, allocated the way GetFieldDescriptorAt requires.
+    HRESULT CopyAt(
+        _In_ DWORD dwIndex,
+        _Outptr_result_nullonfailure_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
+        ) const;
+
+private:
+    FieldDescriptorCache(const FieldDescriptorCache&);
+    FieldDescriptorCache& operator=(const FieldDescriptorCache&);
+
+    Allocator                            *_pallocator;
+    CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *_rgcpfd;  // the descriptors, followed by their labels
+    DWORD                                 _ccpfd;
+    DWORD                                 _ccpfdWrapped;
+};
@@ -0,0 +1,59 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The layout of the flight recorder file, shared by the provider
+// (flightrecorder.cpp) and the reader (tools/flightdump.cpp).  Like
+// traceformat.h, it only uses the fixed-width C types.
+//
+// The file is a FLIGHT_FILE_HEADER followed by cSlots FLIGHT_SLOTs, all
+// little-endian.  Event number n (counting from 0) goes in slot n % cSlots,
+// and its slot's ullSequence is set to n + 1 once the record is complete.
+// ullNext is the number of events ever recorded, so the ring holds events
+// max(ullNext, cSlots) - cSlots to ullNext - 1; a slot in that range whose
+// ullSequence doesn't match was still being written when the process died,
+// or is being written now.
+//
+// The records are TRACE_RECORDs, except that ullTimestamp is a
+// QueryPerformanceCounter reading rather than a TSC one, so it converts to
+// time with ullQpcFrequency alone.
+
+#pragma once
+
+#include "traceformat.h"
+
+#define FLIGHT_MAGIC            0x52465752      // "RWFR"
+#define FLIGHT_VERSION          1
+
+#pragma pack(push, 8)
+
+struct FLIGHT_FILE_HEADER
+{
+    uint32_t    dwMagic;            // FLIGHT_MAGIC
+    uint16_t    usVersion;          // FLIGHT_VERSION
+    uint16_t    cbHeader;           // sizeof(FLIGHT_FILE_HEADER)
+    uint32_t    dwProcessId;
+    uint32_t    cSlots;             // a power of two
+    uint32_t    cbSlot;             // sizeof(FLIGHT_SLOT)
+    uint32_t    dwReserved;
+    uint64_t    ullQpcFrequency;    // QueryPerformanceFrequency
+    uint64_t    ullStartTime;       // FILETIME (UTC)...
+    uint64_t    ullStartQpc;        // ...and QueryPerformanceCounter, read together when the file was created
+    uint64_t    ullNext;            // events recorded so far
+    uint64_t    ullReserved;
+};
+
+struct FLIGHT_SLOT
+{
+    uint64_t        ullSequence;    // event number + 1, once rec is complete; 0 if never written
+    TRACE_RECORD    rec;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(FLIGHT_FILE_HEADER) == 64, "the flight recorder file layout changed");
+static_assert(sizeof(FLIGHT_SLOT) == 40, "the flight recorder file layout changed");
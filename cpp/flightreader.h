@@ -0,0 +1,84 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Reads a flight recorder file (see flightformat.h): checks its header and
+// hands out the events it keeps, oldest first.  tools/flightdump.cpp prints
+// them; tests/flightrecordertest.cpp reads back what the recorder wrote.
+// Like flightformat.h it is plain C++, and reads a copy of the file, so
+// what it sees of a slot is what was in the file when it was copied.
+
+#pragma once
+
+#include "flightformat.h"
+
+#include <stddef.h>
+#include <string.h>
+
+struct FLIGHT_RING
+{
+    FLIGHT_FILE_HEADER  ffh;
+    const uint8_t       *pbSlots;
+    uint64_t            ullFirst;   // the oldest event the ring keeps; ffh.ullNext is one past the newest
+};
+
+enum FLIGHT_EVENT_STATE
+{
+    FES_COMPLETE,       // the record is the event's
+    FES_INCOMPLETE,     // the event was still being written, when the process died or the file was copied
+    FES_OVERWRITTEN,    // a newer event has taken the slot since ullNext was read: the recorder is still running
+};
+
+// Checks the cb bytes at pb are a flight recorder file this reader knows; if not, returns false
+// and says why in *ppszError.
+inline bool FlightRingOpen(const uint8_t *pb, size_t cb, FLIGHT_RING *pring, const char **ppszError)
+{
+    FLIGHT_FILE_HEADER &ffh = pring->ffh;
+    if (cb < sizeof(ffh))
+    {
+        *ppszError = "the file is too short";
+        return false;
+    }
+    memcpy(&ffh, pb, sizeof(ffh));
+
+    if (ffh.dwMagic != FLIGHT_MAGIC || ffh.usVersion != FLIGHT_VERSION || ffh.cbHeader < sizeof(ffh) ||
+        ffh.cbSlot < sizeof(FLIGHT_SLOT) || ffh.cSlots == 0 || (ffh.cSlots & (ffh.cSlots - 1)) != 0 ||
+        ffh.ullQpcFrequency == 0)
+    {
+        *ppszError = "not a flight recorder file, or a version this reader doesn't know";
+        return false;
+    }
+    if (cb < ffh.cbHeader + (size_t)ffh.cSlots * ffh.cbSlot)
+    {
+        *ppszError = "the file is too short for its slots";
+        return false;
+    }
+
+    pring->pbSlots = pb + ffh.cbHeader;
+    pring->ullFirst = (ffh.ullNext > ffh.cSlots) ? ffh.ullNext - ffh.cSlots : 0;
+    return true;
+}
+
+// Copies the slot of event ullEvent, from ring.ullFirst to ring.ffh.ullNext - 1, into *pslot.
+inline FLIGHT_EVENT_STATE FlightRingRead(const FLIGHT_RING &ring, uint64_t ullEvent, FLIGHT_SLOT *pslot)
+{
+    memcpy(pslot, ring.pbSlots + (size_t)(ullEvent & (ring.ffh.cSlots - 1)) * ring.ffh.cbSlot, sizeof(*pslot));
+
+    if (pslot->ullSequence > ullEvent + 1)
+    {
+        return FES_OVERWRITTEN;
+    }
+    return (pslot->ullSequence == ullEvent + 1) ? FES_COMPLETE : FES_INCOMPLETE;
+}
+
+// When a record was made, as a FILETIME: its timestamp is a QPC reading, counted from the one
+// taken with ullStartTime.
+inline uint64_t FlightRingGetTime(const FLIGHT_RING &ring, const TRACE_RECORD &rec)
+{
+    double dTicks = (double)(int64_t)(rec.ullTimestamp - ring.ffh.ullStartQpc);
+    return ring.ffh.ullStartTime + (uint64_t)(int64_t)(dTicks * 1e7 / (double)ring.ffh.ullQpcFrequency);
+}
@@ -0,0 +1,115 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The flight recorder's ring.  The file behind it is in
+// flightrecorderfile.cpp.
+
+#include "flightrecorder.h"
+
+static INIT_ONCE            s_flightInitOnce = INIT_ONCE_STATIC_INIT;
+static FLIGHT_FILE_HEADER   *s_pFlightHeader;
+static FLIGHT_SLOT          *s_rgFlightSlots;
+static ULONGLONG            s_ullFlightSlotMask;
+
+//
+// Maps the file and starts the ring in it.  If the recorder is off, or the file can't be made,
+// the recorder stays off for the life of the process.
+//
+static BOOL CALLBACK _FlightOpen(
+    _Inout_ PINIT_ONCE pInitOnce,
+    _Inout_opt_ PVOID pvParameter,
+    _Outptr_opt_result_maybenull_ PVOID *ppvContext
+    )
+{
+    UNREFERENCED_PARAMETER(pInitOnce);
+    UNREFERENCED_PARAMETER(pvParameter);
+    UNREFERENCED_PARAMETER(ppvContext);
+
+    DWORD cEvents;
+    FLIGHT_FILE_HEADER *pffh = FlightMapFile(&cEvents);
+    if (!pffh)
+    {
+        return TRUE;
+    }
+
+    // The file is new, so every slot starts out never written.
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liQpc;
+    FILETIME ftNow;
+    QueryPerformanceFrequency(&liFrequency);
+    GetSystemTimeAsFileTime(&ftNow);
+    QueryPerformanceCounter(&liQpc);
+
+    pffh->dwMagic = FLIGHT_MAGIC;
+    pffh->usVersion = FLIGHT_VERSION;
+    pffh->cbHeader = sizeof(*pffh);
+    pffh->dwProcessId = GetCurrentProcessId();
+    pffh->cSlots = cEvents;
+    pffh->cbSlot = sizeof(FLIGHT_SLOT);
+    pffh->ullQpcFrequency = (ULONGLONG)liFrequency.QuadPart;
+    pffh->ullStartTime = ((ULONGLONG)ftNow.dwHighDateTime << 32) | ftNow.dwLowDateTime;
+    pffh->ullStartQpc = (ULONGLONG)liQpc.QuadPart;
+    pffh->ullNext = 0;
+
+    s_rgFlightSlots = reinterpret_cast<FLIGHT_SLOT *>(pffh + 1);
+    s_ullFlightSlotMask = cEvents - 1;
+    s_pFlightHeader = pffh;
+
+    return TRUE;
+}
+
+//
+// A writer takes the next event number with one interlocked increment, fills in the slot, and
+// then publishes the event number in the slot.  A thread that dies halfway leaves the slot's
+// old event number, which tells the reader to skip it.
+//
+void FlightRecord(
+    _In_ TRACE_EVENT_ID teid,
+    _In_ TRACE_PHASE tph,
+    _In_ ULONGLONG ullObject,
+    _In_ DWORD dwFieldID,
+    _In_ HRESULT hr
+    )
+{
+    // InitOnceExecuteOnce only fails if our callback does, and it doesn't.
+    (void)InitOnceExecuteOnce(&s_flightInitOnce, _FlightOpen, NULL, NULL);
+
+    FLIGHT_FILE_HEADER *pffh = s_pFlightHeader;
+    if (!pffh)
+    {
+        return;
+    }
+
+    LONG64 llEvent = InterlockedIncrement64(reinterpret_cast<volatile LONG64 *>(&pffh->ullNext)) - 1;
+    FLIGHT_SLOT *pslot = &s_rgFlightSlots[(ULONGLONG)llEvent & s_ullFlightSlotMask];
+
+    LARGE_INTEGER liQpc;
+    QueryPerformanceCounter(&liQpc);
+
+    pslot->rec.usEventID = (uint16_t)teid;
+    pslot->rec.usPhase = (uint16_t)tph;
+    pslot->rec.dwThreadId = GetCurrentThreadId();
+    pslot->rec.ullTimestamp = (ULONGLONG)liQpc.QuadPart;
+    pslot->rec.ullObject = ullObject;
+    pslot->rec.dwFieldID = dwFieldID;
+    pslot->rec.hr = hr;
+
+    // A full barrier: the record is in place before its event number is.
+    (void)InterlockedExchange64(reinterpret_cast<volatile LONG64 *>(&pslot->ullSequence), llEvent + 1);
+}
+
+void FlightClose()
+{
+    if (s_pFlightHeader)
+    {
+        FLIGHT_FILE_HEADER *pffh = s_pFlightHeader;
+        s_pFlightHeader = NULL;
+        s_rgFlightSlots = NULL;
+        FlightUnmapFile(pffh);
+    }
+}
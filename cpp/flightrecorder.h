@@ -0,0 +1,70 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The flight recorder.  Every Trace() event (method, object, field,
+// HRESULT, timestamp) is also written straight into a fixed-size ring in a
+// mapped file, which keeps the most recent events.  There is no writer
+// thread and no buffering: the pages belong to the file, so the system
+// writes them out even if LogonUI crashes or is killed, and the ring can
+// be read after the fact with tools/flightdump.cpp.  The file layout is in
+// flightformat.h.
+//
+// Each logon session records into a file of its own in the recorder's
+// directory, "raspwrap.<session ID>.flight".  When a process opens the
+// recorder, the file left by the previous one in its session is renamed to
+// "<file>.prev", so a restart after a crash keeps the crashed process's
+// ring.  Only one process per session records at a time: while the file is
+// open, another process can neither rename nor open it, and records
+// nothing.
+//
+// The recorder is off unless the configuration turns it on:
+//
+//   HKLM\SOFTWARE\RaspWrap
+//       FlightRecorderEnabled    REG_DWORD  1 to turn the recorder on
+//       FlightRecorderDirectory  REG_SZ     the directory (RASPWRAP_DIAG_DIRECTORY_DEFAULT if absent)
+//       FlightRecorderEvents     REG_DWORD  how many events the ring keeps (RASPWRAP_FLIGHT_EVENTS_DEFAULT
+//                                           if absent; rounded up to a power of two)
+//
+// Like the trace, the ring never holds field values, and it identifies our
+// objects by the IDs Trace() gives them rather than by their addresses.
+// The file is made as diagfile.h makes every diagnostics file; the
+// recorder records nothing if the directory could have been made by
+// anyone but SYSTEM or the Administrators, or if the file name in it turns
+// out to be a link.
+
+#pragma once
+
+#include <windows.h>
+#include "diagfile.h"
+#include "flightformat.h"
+
+#define RASPWRAP_FLIGHT_ENABLED_VALUE   L"FlightRecorderEnabled"
+#define RASPWRAP_FLIGHT_DIRECTORY_VALUE L"FlightRecorderDirectory"
+#define RASPWRAP_FLIGHT_EVENTS_VALUE    L"FlightRecorderEvents"
+#define RASPWRAP_FLIGHT_EVENTS_DEFAULT  4096
+
+// Writes one event into the ring.  Trace() calls this for every event, whether or not tracing
+// is on, with the object's ID; the first call reads the configuration and opens the file.
+void FlightRecord(
+    _In_ TRACE_EVENT_ID teid,
+    _In_ TRACE_PHASE tph,
+    _In_ ULONGLONG ullObject,
+    _In_ DWORD dwFieldID,
+    _In_ HRESULT hr
+    );
+
+// Unmaps and closes the file; for DllMain, when the DLL is unloaded.
+void FlightClose();
+
+// The file behind the ring, in flightrecorderfile.cpp.  FlightMapFile reads the configuration
+// and, if the recorder is on, maps a new file of a FLIGHT_FILE_HEADER and *pcEvents slots, all
+// zero.  It returns NULL if the recorder is off or the file can't be made.
+FLIGHT_FILE_HEADER *FlightMapFile(_Out_ DWORD *pcEvents);
+
+// Unmaps the view FlightMapFile returned, and closes the file.
+void FlightUnmapFile(_In_ FLIGHT_FILE_HEADER *pffh);
@@ -0,0 +1,117 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The file behind the flight recorder's ring.
+
+#include "flightrecorder.h"
+#include "diagfile.h"
+#include "logger.h"
+#include <strsafe.h>
+
+// The ring is between 10KB and 40MB.
+static const DWORD c_cFlightEventsMin = 256;
+static const DWORD c_cFlightEventsMax = 1 << 20;
+
+static HANDLE               s_hFlightFile = INVALID_HANDLE_VALUE;
+static HANDLE               s_hFlightMapping;
+
+static DWORD _FlightRoundUpEvents(_In_ DWORD cEvents)
+{
+    DWORD cRounded = c_cFlightEventsMin;
+    while (cRounded < cEvents && cRounded < c_cFlightEventsMax)
+    {
+        cRounded <<= 1;
+    }
+    return cRounded;
+}
+
+static void _FlightCloseFile()
+{
+    if (s_hFlightMapping)
+    {
+        CloseHandle(s_hFlightMapping);
+        s_hFlightMapping = NULL;
+    }
+    if (s_hFlightFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(s_hFlightFile);
+        s_hFlightFile = INVALID_HANDLE_VALUE;
+    }
+}
+
+//
+// Reads the configuration and, if the recorder is on, sets the previous process's file aside
+// and creates and maps a new one.
+//
+FLIGHT_FILE_HEADER *FlightMapFile(_Out_ DWORD *pcEvents)
+{
+    *pcEvents = 0;
+
+    DWORD dwEnabled = 0;
+    DWORD cb = sizeof(dwEnabled);
+    (void)RegGetValueW(HKEY_LOCAL_MACHINE, RASPWRAP_CONFIG_KEY, RASPWRAP_FLIGHT_ENABLED_VALUE,
+                       RRF_RT_REG_DWORD, NULL, &dwEnabled, &cb);
+    if (!dwEnabled)
+    {
+        return NULL;
+    }
+
+    DWORD cEvents = RASPWRAP_FLIGHT_EVENTS_DEFAULT;
+    cb = sizeof(cEvents);
+    (void)RegGetValueW(HKEY_LOCAL_MACHINE, RASPWRAP_CONFIG_KEY, RASPWRAP_FLIGHT_EVENTS_VALUE,
+                       RRF_RT_REG_DWORD, NULL, &cEvents, &cb);
+    cEvents = _FlightRoundUpEvents(cEvents);
+
+    WCHAR wszDirectory[MAX_PATH];
+    if (!DiagReadPath(RASPWRAP_FLIGHT_DIRECTORY_VALUE, RASPWRAP_DIAG_DIRECTORY_DEFAULT, wszDirectory,
+                      ARRAYSIZE(wszDirectory)))
+    {
+        return NULL;
+    }
+
+    DWORD dwSessionId;
+    WCHAR wszFile[MAX_PATH];
+    WCHAR wszPrevious[MAX_PATH];
+    if (!ProcessIdToSessionId(GetCurrentProcessId(), &dwSessionId) ||
+        FAILED(StringCchPrintfW(wszFile, ARRAYSIZE(wszFile), L"%s\\raspwrap.%lu.flight", wszDirectory, dwSessionId)) ||
+        FAILED(StringCchPrintfW(wszPrevious, ARRAYSIZE(wszPrevious), L"%s.prev", wszFile)) ||
+        !DiagPrepareDirectory(wszDirectory))
+    {
+        return NULL;
+    }
+
+    // If the file is still open in a live process, this fails, and so does the CreateFileW below.
+    (void)MoveFileExW(wszFile, wszPrevious, MOVEFILE_REPLACE_EXISTING);
+
+    const DWORD cbFile = (DWORD)(sizeof(FLIGHT_FILE_HEADER) + cEvents * sizeof(FLIGHT_SLOT));
+
+    FLIGHT_FILE_HEADER *pffh = NULL;
+    s_hFlightFile = DiagCreateFile(wszFile, GENERIC_READ | GENERIC_WRITE);
+    if (s_hFlightFile != INVALID_HANDLE_VALUE)
+    {
+        s_hFlightMapping = CreateFileMappingW(s_hFlightFile, NULL, PAGE_READWRITE, 0, cbFile, NULL);
+    }
+    if (s_hFlightMapping)
+    {
+        pffh = static_cast<FLIGHT_FILE_HEADER *>(MapViewOfFile(s_hFlightMapping, FILE_MAP_WRITE, 0, 0, cbFile));
+    }
+    if (!pffh)
+    {
+        _FlightCloseFile();
+        return NULL;
+    }
+
+    *pcEvents = cEvents;
+    return pffh;
+}
+
+void FlightUnmapFile(_In_ FLIGHT_FILE_HEADER *pffh)
+{
+    UnmapViewOfFile(pffh);
+    _FlightCloseFile();
+}
@@ -34,54 +34,34 @@
 #include <wincred.h>
 #pragma warning(pop)
 
-void log(const char* fmt, ...);
-
-//makes a copy of a field descriptor using CoTaskMemAlloc
-HRESULT FieldDescriptorCoAllocCopy(
-    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
-    _Outptr_result_nullonfailure_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
-    );
-
-//makes a copy of a field descriptor on the normal heap
-HRESULT FieldDescriptorCopy(
-    _In_ const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR &rcpfd,
-    _Out_ CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd
-    );
-
-//creates a UNICODE_STRING from a NULL-terminated string
-HRESULT UnicodeStringInitWithString(
-    _In_ PWSTR pwz,
-    _Out_ UNICODE_STRING *pus
-    );
-
-//initializes a KERB_INTERACTIVE_UNLOCK_LOGON with weak references to the provided credentials
-HRESULT KerbInteractiveUnlockLogonInit(
-    _In_ PWSTR pwzDomain,
-    _In_ PWSTR pwzUsername,
-    _In_ PWSTR pwzPassword,
+#include "securearena.h"
+#include "allocator.h"
+#include "securestring.h"
+#include "fielddescriptorcache.h"
+#include "logonpack.h"
+#include "qualifiedusername.h"
+#include "passwordprotector.h"
+#include "lsabackend.h"
+#include "logger.h"
+#include "trace.h"
+#include "latency.h"
+
+//encrypt a password with CredProtect (if necessary) and copy it; if not, just copy it
+HRESULT ProtectIfNecessaryAndCopyPassword(
+    _In_ PCWSTR pwzPassword,
     _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
-    _Out_ KERB_INTERACTIVE_UNLOCK_LOGON *pkiul
-    );
-
-//packages the credentials into the buffer that the system expects
-HRESULT KerbInteractiveUnlockLogonPack(
-    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
-    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
-    _Out_ DWORD *pcb
-    );
-
-//get the authentication package that will be used for our logon attempt
-HRESULT RetrieveNegotiateAuthPackage(
-    _Out_ ULONG *pulAuthPackage
+    _Outptr_result_nullonfailure_ PWSTR *ppwzProtectedPassword
     );
 
-//encrypt a password (if necessary) and copy it; if not, just copy it
+//same as above, but the copy comes from pallocator (a SecureArenaAllocator keeps it in locked, wiped memory)
 HRESULT ProtectIfNecessaryAndCopyPassword(
     _In_ PCWSTR pwzPassword,
     _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _In_ Allocator *pallocator,
     _Outptr_result_nullonfailure_ PWSTR *ppwzProtectedPassword
     );
 
+//converts a packed 32 bit (WOW) KERB_INTERACTIVE_UNLOCK_LOGON into the native layout
 HRESULT KerbInteractiveUnlockLogonRepackNative(
     _In_reads_bytes_(cbWow) BYTE *rgbWow,
     _In_ DWORD cbWow,
@@ -89,15 +69,33 @@ HRESULT KerbInteractiveUnlockLogonRepackNative(
     _Out_ DWORD *pcbNative
     );
 
-void KerbInteractiveUnlockLogonUnpackInPlace(
-    _Inout_updates_bytes_(cb) KERB_INTERACTIVE_UNLOCK_LOGON *pkiul,
-    DWORD cb
+//same as above, but the native buffer comes from pallocator
+HRESULT KerbInteractiveUnlockLogonRepackNative(
+    _In_reads_bytes_(cbWow) BYTE *rgbWow,
+    _In_ DWORD cbWow,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcbNative) BYTE **prgbNative,
+    _Out_ DWORD *pcbNative
     );
 
-HRESULT DomainUsernameStringAlloc(
-    _In_ PCWSTR pwszDomain,
-    _In_ PCWSTR pwszUsername,
-    _Outptr_result_nullonfailure_ PWSTR *ppwszDomainUsername
+//read-only view of a packed KERB_INTERACTIVE_UNLOCK_LOGON; the strings point into the packed buffer
+struct KERB_INTERACTIVE_UNLOCK_LOGON_VIEW
+{
+    KERB_LOGON_SUBMIT_TYPE MessageType;
+    LUID LogonId;
+    PACKED_STRING_VIEW LogonDomainName;
+    PACKED_STRING_VIEW UserName;
+    PACKED_STRING_VIEW Password;
+};
+
+//validates a packed KERB_INTERACTIVE_UNLOCK_LOGON without modifying or copying it
+HRESULT KerbInteractiveUnlockLogonGetView(
+    _In_reads_bytes_(cb) const BYTE *rgb,
+    _In_ DWORD cb,
+    _Out_ KERB_INTERACTIVE_UNLOCK_LOGON_VIEW *pview
     );
 
-HRESULT SplitDomainAndUsername(_In_ PCWSTR pszQualifiedUserName, _Outptr_result_nullonfailure_ PWSTR *ppszDomain, _Outptr_result_nullonfailure_ PWSTR *ppszUsername);
\ No newline at end of file
+HRESULT KerbInteractiveUnlockLogonUnpackInPlace(
+    _Inout_updates_bytes_(cb) KERB_INTERACTIVE_UNLOCK_LOGON *pkiul,
+    DWORD cb
+    );
\ No newline at end of file
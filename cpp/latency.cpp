@@ -0,0 +1,196 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Per-method latency histograms.  The file they are dumped to is latencyfile.cpp's.
+
+#include "latency.h"
+#include "logger.h"
+#include <atomic>
+#include <new>
+
+// Only the owning thread writes to a histogram, so it counts with plain loads and stores; they
+// are atomic so that LatencyGetSnapshot can read them at the same time.
+struct LATENCY_THREAD_HISTOGRAM
+{
+    std::atomic<ULONGLONG>  cCalls;
+    std::atomic<ULONGLONG>  ullTotalTicks;
+    std::atomic<ULONGLONG>  ullMaxTicks;
+    std::atomic<ULONG>      rgcBuckets[LATENCY_BUCKET_COUNT];
+};
+
+struct LATENCY_THREAD_BLOCK
+{
+    LATENCY_THREAD_BLOCK        *pNext;
+    LATENCY_THREAD_HISTOGRAM    rghist[LM_COUNT][LK_COUNT];
+};
+
+// A thread's block outlives the thread, so that what it counted stays in the snapshots; the
+// blocks are only freed with the DLL.
+static thread_local LATENCY_THREAD_BLOCK        *t_pLatencyBlock;
+static std::atomic<LATENCY_THREAD_BLOCK *>      s_pLatencyBlocks;
+
+static INIT_ONCE            s_latencyConfigInitOnce = INIT_ONCE_STATIC_INIT;
+static bool                 s_bLatencyEnabled;
+
+// Where the TSC frequency is measured from.
+static ULONGLONG            s_ullTscOrigin;
+static LONGLONG             s_llQpcOrigin;
+
+static BOOL CALLBACK _LatencyReadConfig(
+    _Inout_ PINIT_ONCE pInitOnce,
+    _Inout_opt_ PVOID pvParameter,
+    _Outptr_opt_result_maybenull_ PVOID *ppvContext
+    )
+{
+    UNREFERENCED_PARAMETER(pInitOnce);
+    UNREFERENCED_PARAMETER(pvParameter);
+    UNREFERENCED_PARAMETER(ppvContext);
+
+    DWORD dwEnabled = 0;
+    DWORD cb = sizeof(dwEnabled);
+    if (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, RASPWRAP_CONFIG_KEY, RASPWRAP_LATENCY_ENABLED_VALUE,
+                                      RRF_RT_REG_DWORD, NULL, &dwEnabled, &cb))
+    {
+        s_bLatencyEnabled = (dwEnabled != 0);
+    }
+
+    LARGE_INTEGER liQpc;
+    QueryPerformanceCounter(&liQpc);
+    s_ullTscOrigin = __rdtsc();
+    s_llQpcOrigin = liQpc.QuadPart;
+
+    return TRUE;
+}
+
+bool LatencyIsEnabled()
+{
+    // InitOnceExecuteOnce only fails if our callback does, and it doesn't.
+    (void)InitOnceExecuteOnce(&s_latencyConfigInitOnce, _LatencyReadConfig, NULL, NULL);
+    return s_bLatencyEnabled;
+}
+
+static LATENCY_THREAD_BLOCK *_LatencyGetThreadBlock()
+{
+    LATENCY_THREAD_BLOCK *pBlock = t_pLatencyBlock;
+    if (!pBlock)
+    {
+        // Value-initialized, so every count starts at zero.
+        pBlock = new (std::nothrow) LATENCY_THREAD_BLOCK();
+        if (pBlock)
+        {
+            pBlock->pNext = s_pLatencyBlocks.load(std::memory_order_relaxed);
+            while (!s_pLatencyBlocks.compare_exchange_weak(pBlock->pNext, pBlock, std::memory_order_release,
+                                                           std::memory_order_relaxed))
+            {
+            }
+            t_pLatencyBlock = pBlock;
+        }
+    }
+    return pBlock;
+}
+
+static void _LatencyCount(_Inout_ LATENCY_THREAD_HISTOGRAM *phist, _In_ ULONGLONG ullTicks)
+{
+    phist->cCalls.store(phist->cCalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    phist->ullTotalTicks.store(phist->ullTotalTicks.load(std::memory_order_relaxed) + ullTicks, std::memory_order_relaxed);
+    if (ullTicks > phist->ullMaxTicks.load(std::memory_order_relaxed))
+    {
+        phist->ullMaxTicks.store(ullTicks, std::memory_order_relaxed);
+    }
+
+    std::atomic<ULONG> &cBucket = phist->rgcBuckets[LatencyBucketFromTicks(ullTicks)];
+    cBucket.store(cBucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void LatencyRecord(
+    _In_ LATENCY_METHOD lm,
+    _In_ ULONGLONG ullSelfTicks,
+    _In_ bool fWrapped,
+    _In_ ULONGLONG ullWrappedTicks
+    )
+{
+    // Without a block of its own, the thread's calls go uncounted.
+    LATENCY_THREAD_BLOCK *pBlock = _LatencyGetThreadBlock();
+    if (pBlock)
+    {
+        _LatencyCount(&pBlock->rghist[lm][LK_SELF], ullSelfTicks);
+        if (fWrapped)
+        {
+            _LatencyCount(&pBlock->rghist[lm][LK_WRAPPED], ullWrappedTicks);
+        }
+    }
+
+    // The writer is what dumps the histograms.
+    LogEnsureWriter();
+}
+
+static ULONGLONG _LatencyTicksPerSecond()
+{
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liQpc;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liQpc);
+    ULONGLONG ullTsc = __rdtsc();
+
+    // Less than 100ms is too short to tell the frequency from.
+    LONGLONG llQpcElapsed = liQpc.QuadPart - s_llQpcOrigin;
+    if (llQpcElapsed < liFrequency.QuadPart / 10)
+    {
+        return 0;
+    }
+
+    return (ULONGLONG)((double)(ullTsc - s_ullTscOrigin) * (double)liFrequency.QuadPart / (double)llQpcElapsed);
+}
+
+HRESULT LatencyGetSnapshot(_Out_ LATENCY_SNAPSHOT *psnap)
+{
+    ZeroMemory(psnap, sizeof(*psnap));
+    if (!LatencyIsEnabled())
+    {
+        return S_FALSE;
+    }
+
+    psnap->ullTicksPerSecond = _LatencyTicksPerSecond();
+
+    for (const LATENCY_THREAD_BLOCK *pBlock = s_pLatencyBlocks.load(std::memory_order_acquire); pBlock; pBlock = pBlock->pNext)
+    {
+        for (size_t i = 0; i < (size_t)LM_COUNT; i++)
+        {
+            for (size_t j = 0; j < (size_t)LK_COUNT; j++)
+            {
+                const LATENCY_THREAD_HISTOGRAM &histThread = pBlock->rghist[i][j];
+                LATENCY_HISTOGRAM &hist = psnap->rghist[i][j];
+
+                hist.cCalls += histThread.cCalls.load(std::memory_order_relaxed);
+                hist.ullTotalTicks += histThread.ullTotalTicks.load(std::memory_order_relaxed);
+                ULONGLONG ullMaxTicks = histThread.ullMaxTicks.load(std::memory_order_relaxed);
+                if (ullMaxTicks > hist.ullMaxTicks)
+                {
+                    hist.ullMaxTicks = ullMaxTicks;
+                }
+                for (size_t k = 0; k < LATENCY_BUCKET_COUNT; k++)
+                {
+                    hist.rgcBuckets[k] += histThread.rgcBuckets[k].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+void LatencyUnload()
+{
+    LATENCY_THREAD_BLOCK *pBlock = s_pLatencyBlocks.exchange(NULL, std::memory_order_acquire);
+    while (pBlock)
+    {
+        LATENCY_THREAD_BLOCK *pNext = pBlock->pNext;
+        delete pBlock;
+        pBlock = pNext;
+    }
+}
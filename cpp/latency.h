@@ -0,0 +1,137 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Per-method latency histograms.  A LatencyScope at the top of a
+// forwarding method times the call; the time spent in the wrapped
+// provider, bracketed by EnterWrapped()/LeaveWrapped(), goes in one
+// histogram, and the rest, the wrapper's own overhead, in another.
+//
+// Every thread counts into histograms of its own, without locks or
+// interlocked instructions; LatencyGetSnapshot() adds them up.  The
+// background writer of the debug log dumps a snapshot every few seconds
+// into a file that the provider keeps mapped, so any process can map it
+// and read it while LogonUI runs; tools/latencydump.cpp prints it as
+// percentiles.  The file layout is in latencyformat.h.
+//
+// The histograms are off unless the configuration turns them on:
+//
+//   HKLM\SOFTWARE\RaspWrap
+//       LatencyEnabled  REG_DWORD  1 to time calls
+//       LatencyFile     REG_SZ     the file to dump to (RASPWRAP_LATENCY_FILE_DEFAULT if absent)
+//
+// Each logon session dumps into a file of its own, LatencyFile with ".<session ID>" added.  When
+// a process starts dumping, the file left by the previous one in its session is renamed to
+// "<file>.prev".  The file is made as diagfile.h makes every diagnostics file, so nothing is
+// dumped if its directory could have been made by anyone but SYSTEM or the Administrators, or
+// if its name turns out to be a link.
+
+#pragma once
+
+#include <windows.h>
+#include <intrin.h>
+#include "diagfile.h"
+#include "latencyformat.h"
+
+#define RASPWRAP_LATENCY_ENABLED_VALUE  L"LatencyEnabled"
+#define RASPWRAP_LATENCY_FILE_VALUE     L"LatencyFile"
+#define RASPWRAP_LATENCY_FILE_DEFAULT   RASPWRAP_DIAG_DIRECTORY_DEFAULT L"\\raspwrap.latency"
+
+typedef LATENCY_FILE_HISTOGRAM LATENCY_HISTOGRAM;
+
+struct LATENCY_SNAPSHOT
+{
+    ULONGLONG           ullTicksPerSecond;  // 0 until enough time has passed to measure it
+    LATENCY_HISTOGRAM   rghist[LM_COUNT][LK_COUNT];
+};
+
+// Whether the configuration turns the histograms on; read once per process.
+bool LatencyIsEnabled();
+
+// Counts one call of lm into the calling thread's histograms.  Use LatencyScope rather than
+// calling this directly.
+void LatencyRecord(
+    _In_ LATENCY_METHOD lm,
+    _In_ ULONGLONG ullSelfTicks,
+    _In_ bool fWrapped,
+    _In_ ULONGLONG ullWrappedTicks
+    );
+
+// Adds up every thread's histograms.  Threads keep counting while this reads, so a snapshot
+// may be a call or two short, but never counts a call that didn't happen.
+HRESULT LatencyGetSnapshot(_Out_ LATENCY_SNAPSHOT *psnap);
+
+// For the log's background writer: LatencyDump rewrites the mapped file with a fresh snapshot,
+// LatencyClose unmaps it.  Only ever called from the writer; both are in latencyfile.cpp.
+void LatencyDump();
+void LatencyClose();
+
+// Frees every thread's histograms; for DllMain, when the DLL is unloaded.
+void LatencyUnload();
+
+//
+// LatencyScope latency(LM_CREDENTIAL_CONNECT);
+// ...
+// latency.EnterWrapped();
+// hr = _pWrappedCredential->Connect(pqcws);
+// latency.LeaveWrapped();
+//
+class LatencyScope
+{
+public:
+    explicit LatencyScope(_In_ LATENCY_METHOD lm) :
+        _lm(lm),
+        _fEnabled(LatencyIsEnabled()),
+        _fWrapped(false),
+        _ullStart(0),
+        _ullWrapped(0),
+        _ullWrappedStart(0)
+    {
+        if (_fEnabled)
+        {
+            _ullStart = __rdtsc();
+        }
+    }
+
+    ~LatencyScope()
+    {
+        if (_fEnabled)
+        {
+            ULONGLONG ullTotal = __rdtsc() - _ullStart;
+            LatencyRecord(_lm, (ullTotal > _ullWrapped) ? ullTotal - _ullWrapped : 0, _fWrapped, _ullWrapped);
+        }
+    }
+
+    void EnterWrapped()
+    {
+        if (_fEnabled)
+        {
+            _ullWrappedStart = __rdtsc();
+        }
+    }
+
+    // A method that calls into the wrapped provider more than once has all of them added up.
+    void LeaveWrapped()
+    {
+        if (_fEnabled)
+        {
+            _ullWrapped += __rdtsc() - _ullWrappedStart;
+            _fWrapped = true;
+        }
+    }
+
+private:
+    LatencyScope(const LatencyScope &);
+    LatencyScope &operator=(const LatencyScope &);
+
+    LATENCY_METHOD  _lm;
+    bool            _fEnabled;
+    bool            _fWrapped;
+    ULONGLONG       _ullStart;
+    ULONGLONG       _ullWrapped;
+    ULONGLONG       _ullWrappedStart;
+};
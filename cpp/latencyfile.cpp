@@ -0,0 +1,135 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The file the latency histograms are dumped to.
+
+#include "latency.h"
+#include "diagfile.h"
+#include <strsafe.h>
+
+// The writer's.
+static LATENCY_SNAPSHOT     s_snapDump;
+static bool                 s_bLatencyFileFailed;
+static HANDLE               s_hLatencyFile = INVALID_HANDLE_VALUE;
+static HANDLE               s_hLatencyMapping;
+static LATENCY_FILE_HEADER  *s_pLatencyView;
+
+//
+// Sets the file left by the previous process in our session aside, and creates a new one.  If
+// the file is still open in a live process, both fail, and this process dumps nothing.
+//
+static HANDLE _LatencyCreateFile()
+{
+    WCHAR wszLatencyFile[MAX_PATH];
+    DWORD dwSessionId;
+    WCHAR wszFile[MAX_PATH];
+    WCHAR wszPrevious[MAX_PATH];
+    if (!DiagReadPath(RASPWRAP_LATENCY_FILE_VALUE, RASPWRAP_LATENCY_FILE_DEFAULT, wszLatencyFile,
+                      ARRAYSIZE(wszLatencyFile)) ||
+        !ProcessIdToSessionId(GetCurrentProcessId(), &dwSessionId) ||
+        FAILED(StringCchPrintfW(wszFile, ARRAYSIZE(wszFile), L"%s.%lu", wszLatencyFile, dwSessionId)) ||
+        FAILED(StringCchPrintfW(wszPrevious, ARRAYSIZE(wszPrevious), L"%s.prev", wszFile)) ||
+        !DiagPrepareDirectoryOf(wszFile))
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    (void)MoveFileExW(wszFile, wszPrevious, MOVEFILE_REPLACE_EXISTING);
+
+    return DiagCreateFile(wszFile, GENERIC_READ | GENERIC_WRITE);
+}
+
+// Maps the dump file, on the first dump.  The file keeps its last snapshot after the process
+// is gone.  If it can't be made, nothing is dumped for the life of the process.
+static bool _LatencyOpen()
+{
+    if (!s_pLatencyView && !s_bLatencyFileFailed)
+    {
+        const DWORD cbFile = (DWORD)(sizeof(LATENCY_FILE_HEADER) + sizeof(s_snapDump.rghist));
+
+        s_hLatencyFile = _LatencyCreateFile();
+        if (s_hLatencyFile != INVALID_HANDLE_VALUE)
+        {
+            s_hLatencyMapping = CreateFileMappingW(s_hLatencyFile, NULL, PAGE_READWRITE, 0, cbFile, NULL);
+        }
+        if (s_hLatencyMapping)
+        {
+            s_pLatencyView = static_cast<LATENCY_FILE_HEADER *>(MapViewOfFile(s_hLatencyMapping, FILE_MAP_WRITE, 0, 0, cbFile));
+        }
+        if (s_pLatencyView)
+        {
+            LATENCY_FILE_HEADER *plfh = s_pLatencyView;
+            plfh->dwGeneration = 1;
+            MemoryBarrier();
+
+            plfh->dwMagic = LATENCY_MAGIC;
+            plfh->usVersion = LATENCY_VERSION;
+            plfh->cbHeader = sizeof(*plfh);
+            plfh->dwProcessId = GetCurrentProcessId();
+            plfh->cMethods = LM_COUNT;
+            plfh->cKinds = LK_COUNT;
+            plfh->cBuckets = LATENCY_BUCKET_COUNT;
+            plfh->dwSubBucketBits = LATENCY_SUB_BUCKET_BITS;
+        }
+        else
+        {
+            LatencyClose();
+            s_bLatencyFileFailed = true;
+        }
+    }
+
+    return s_pLatencyView != NULL;
+}
+
+//
+// Readers map the same file, so the rewrite is bracketed by a generation count that is odd
+// while it goes on: a reader that sees the same even count before and after its read has a
+// consistent snapshot.
+//
+void LatencyDump()
+{
+    if (LatencyGetSnapshot(&s_snapDump) == S_OK && _LatencyOpen())
+    {
+        LATENCY_FILE_HEADER *plfh = s_pLatencyView;
+        volatile LONG *plGeneration = reinterpret_cast<volatile LONG *>(&plfh->dwGeneration);
+
+        if (!(*plGeneration & 1))
+        {
+            InterlockedIncrement(plGeneration);
+        }
+
+        FILETIME ftNow;
+        GetSystemTimeAsFileTime(&ftNow);
+
+        plfh->ullTicksPerSecond = s_snapDump.ullTicksPerSecond;
+        plfh->ullSnapshotTime = ((ULONGLONG)ftNow.dwHighDateTime << 32) | ftNow.dwLowDateTime;
+        CopyMemory(plfh + 1, s_snapDump.rghist, sizeof(s_snapDump.rghist));
+
+        InterlockedIncrement(plGeneration);
+    }
+}
+
+void LatencyClose()
+{
+    if (s_pLatencyView)
+    {
+        (void)FlushViewOfFile(s_pLatencyView, 0);
+        UnmapViewOfFile(s_pLatencyView);
+        s_pLatencyView = NULL;
+    }
+    if (s_hLatencyMapping)
+    {
+        CloseHandle(s_hLatencyMapping);
+        s_hLatencyMapping = NULL;
+    }
+    if (s_hLatencyFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(s_hLatencyFile);
+        s_hLatencyFile = INVALID_HANDLE_VALUE;
+    }
+}
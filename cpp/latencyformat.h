@@ -0,0 +1,163 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The latency histograms: the methods that are timed, the bucket layout,
+// and the layout of the file the histograms are dumped to, shared by the
+// provider (latency.cpp) and the reader (tools/latencydump.cpp).  Like
+// traceformat.h, it only uses the fixed-width C types.
+//
+// Latencies are CPU time stamp counter ticks, counted in log-linear
+// buckets: the first LATENCY_SUB_BUCKETS buckets hold 0, 1, 2, ... ticks,
+// and from there every power of two is split into LATENCY_SUB_BUCKETS
+// equal buckets, so a bucket is never wider than 1/LATENCY_SUB_BUCKETS of
+// the values it holds.
+//
+// The dump file is a LATENCY_FILE_HEADER followed by a LATENCY_FILE_HISTOGRAM
+// for each method and each LATENCY_KIND, method-major, all little-endian.
+// The provider keeps the file mapped and rewrites it in place; a reader
+// that sees dwGeneration odd, or changed across its read, has to read again.
+
+#pragma once
+
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define LATENCY_MAGIC               0x544C5752      // "RWLT"
+#define LATENCY_VERSION             1
+
+#define LATENCY_SUB_BUCKET_BITS     3
+#define LATENCY_SUB_BUCKETS         (1u << LATENCY_SUB_BUCKET_BITS)
+
+// Up to 2^42 ticks, over twenty minutes at 3GHz; longer calls land in the last bucket.
+#define LATENCY_BUCKET_COUNT        320
+
+//
+// Every timed method, as X(id, name).  The index of a method is its position in the list, and is
+// what the dump file is laid out by, so methods are only ever added at the end.
+//
+#define RASPWRAP_LATENCY_METHODS(X) \
+    X(LM_CREDENTIAL_ADVISE,                         "RaspWrapCredential::Advise") \
+    X(LM_CREDENTIAL_UNADVISE,                       "RaspWrapCredential::UnAdvise") \
+    X(LM_CREDENTIAL_SET_SELECTED,                   "RaspWrapCredential::SetSelected") \
+    X(LM_CREDENTIAL_SET_DESELECTED,                 "RaspWrapCredential::SetDeselected") \
+    X(LM_CREDENTIAL_GET_FIELD_STATE,                "RaspWrapCredential::GetFieldState") \
+    X(LM_CREDENTIAL_GET_STRING_VALUE,               "RaspWrapCredential::GetStringValue") \
+    X(LM_CREDENTIAL_GET_BITMAP_VALUE,               "RaspWrapCredential::GetBitmapValue") \
+    X(LM_CREDENTIAL_GET_CHECKBOX_VALUE,             "RaspWrapCredential::GetCheckboxValue") \
+    X(LM_CREDENTIAL_GET_SUBMIT_BUTTON_VALUE,        "RaspWrapCredential::GetSubmitButtonValue") \
+    X(LM_CREDENTIAL_GET_COMBOBOX_VALUE_COUNT,       "RaspWrapCredential::GetComboBoxValueCount") \
+    X(LM_CREDENTIAL_GET_COMBOBOX_VALUE_AT,          "RaspWrapCredential::GetComboBoxValueAt") \
+    X(LM_CREDENTIAL_SET_STRING_VALUE,               "RaspWrapCredential::SetStringValue") \
+    X(LM_CREDENTIAL_SET_CHECKBOX_VALUE,             "RaspWrapCredential::SetCheckboxValue") \
+    X(LM_CREDENTIAL_SET_COMBOBOX_SELECTED_VALUE,    "RaspWrapCredential::SetComboBoxSelectedValue") \
+    X(LM_CREDENTIAL_COMMAND_LINK_CLICKED,           "RaspWrapCredential::CommandLinkClicked") \
+    X(LM_CREDENTIAL_GET_SERIALIZATION,              "RaspWrapCredential::GetSerialization") \
+    X(LM_CREDENTIAL_REPORT_RESULT,                  "RaspWrapCredential::ReportResult") \
+    X(LM_CREDENTIAL_CONNECT,                        "RaspWrapCredential::Connect") \
+    X(LM_CREDENTIAL_DISCONNECT,                     "RaspWrapCredential::Disconnect") \
+    \
+    X(LM_PROVIDER_SET_USAGE_SCENARIO,               "RaspWrapCredentialProvider::SetUsageScenario") \
+    X(LM_PROVIDER_SET_SERIALIZATION,                "RaspWrapCredentialProvider::SetSerialization") \
+    X(LM_PROVIDER_ADVISE,                           "RaspWrapCredentialProvider::Advise") \
+    X(LM_PROVIDER_UNADVISE,                         "RaspWrapCredentialProvider::UnAdvise") \
+    X(LM_PROVIDER_GET_FIELD_DESCRIPTOR_COUNT,       "RaspWrapCredentialProvider::GetFieldDescriptorCount") \
+    X(LM_PROVIDER_GET_FIELD_DESCRIPTOR_AT,          "RaspWrapCredentialProvider::GetFieldDescriptorAt") \
+    X(LM_PROVIDER_GET_CREDENTIAL_COUNT,             "RaspWrapCredentialProvider::GetCredentialCount") \
+    X(LM_PROVIDER_GET_CREDENTIAL_AT,                "RaspWrapCredentialProvider::GetCredentialAt")
+
+enum LATENCY_METHOD
+{
+#define LATENCY_METHOD_ENUM(id, name) id,
+    RASPWRAP_LATENCY_METHODS(LATENCY_METHOD_ENUM)
+#undef LATENCY_METHOD_ENUM
+    LM_COUNT
+};
+
+enum LATENCY_KIND
+{
+    LK_SELF,        // time spent in the wrapper itself
+    LK_WRAPPED,     // time spent in the wrapped provider's calls; only for calls that made one
+    LK_COUNT
+};
+
+#pragma pack(push, 4)
+
+struct LATENCY_FILE_HEADER
+{
+    uint32_t    dwMagic;            // LATENCY_MAGIC
+    uint16_t    usVersion;          // LATENCY_VERSION
+    uint16_t    cbHeader;           // sizeof(LATENCY_FILE_HEADER)
+    uint32_t    dwProcessId;
+    uint32_t    dwGeneration;       // odd while the provider is rewriting the histograms
+    uint32_t    cMethods;           // LM_COUNT when the file was written
+    uint32_t    cKinds;             // LK_COUNT
+    uint32_t    cBuckets;           // LATENCY_BUCKET_COUNT
+    uint32_t    dwSubBucketBits;    // LATENCY_SUB_BUCKET_BITS
+    uint64_t    ullTicksPerSecond;  // measured TSC frequency; 0 if not known yet
+    uint64_t    ullSnapshotTime;    // FILETIME (UTC) of the last rewrite
+};
+
+struct LATENCY_FILE_HISTOGRAM
+{
+    uint64_t    cCalls;
+    uint64_t    ullTotalTicks;
+    uint64_t    ullMaxTicks;
+    uint32_t    rgcBuckets[LATENCY_BUCKET_COUNT];
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(LATENCY_FILE_HEADER) == 48, "the latency file layout changed");
+static_assert(sizeof(LATENCY_FILE_HISTOGRAM) == 24 + 4 * LATENCY_BUCKET_COUNT, "the latency file layout changed");
+
+// The bit number of the highest set bit of ull, which must not be 0.
+inline unsigned LatencyHighBit(uint64_t ull)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long ulBit;
+    _BitScanReverse64(&ulBit, ull);
+    return ulBit;
+#elif defined(_MSC_VER)
+    unsigned long ulBit;
+    if (_BitScanReverse(&ulBit, (unsigned long)(ull >> 32)))
+    {
+        return ulBit + 32;
+    }
+    _BitScanReverse(&ulBit, (unsigned long)ull);
+    return ulBit;
+#else
+    return 63 - (unsigned)__builtin_clzll(ull);
+#endif
+}
+
+inline unsigned LatencyBucketFromTicks(uint64_t ullTicks)
+{
+    if (ullTicks < LATENCY_SUB_BUCKETS)
+    {
+        return (unsigned)ullTicks;
+    }
+
+    unsigned uShift = LatencyHighBit(ullTicks) - LATENCY_SUB_BUCKET_BITS;
+    unsigned uBucket = (uShift + 1) * LATENCY_SUB_BUCKETS +
+                       (unsigned)((ullTicks >> uShift) & (LATENCY_SUB_BUCKETS - 1));
+    return (uBucket < LATENCY_BUCKET_COUNT) ? uBucket : LATENCY_BUCKET_COUNT - 1;
+}
+
+// The smallest tick count that falls in uBucket; the bucket ends where the next one starts.
+inline uint64_t LatencyBucketLowerBound(unsigned uBucket)
+{
+    if (uBucket < LATENCY_SUB_BUCKETS)
+    {
+        return uBucket;
+    }
+
+    unsigned uShift = uBucket / LATENCY_SUB_BUCKETS - 1;
+    return (uint64_t)(LATENCY_SUB_BUCKETS + uBucket % LATENCY_SUB_BUCKETS) << uShift;
+}
@@ -0,0 +1,388 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Asynchronous debug log.
+
+#include "logger.h"
+#include "trace.h"
+#include "latency.h"
+#include "mpscring.h"
+#include "Dll.h"
+#include <bcrypt.h>
+#include <strsafe.h>
+#include <stdarg.h>
+#include <string.h>
+#include <atomic>
+
+static const size_t c_cLogSlots = 256;
+
+// How long the writer waits between batches, in 100ns units (negative: relative).
+static const LONGLONG c_llLogFlushInterval = -2000000LL;    // 200ms
+
+// The latency histograms are dumped every this many batches: every 5s.
+static const ULONG c_cLatencyDumpInterval = 25;
+
+struct LOG_MESSAGE
+{
+    ULONG   cch;
+    char    rgch[500];
+};
+
+// A message that finds the ring full is dropped, and counted, rather than waited for.
+static MpscRing<LOG_MESSAGE, c_cLogSlots>   s_logRing;
+static std::atomic<LONG>                    s_cDropped;
+
+// The consumer, of this ring and of the trace's, and the latency dumper: one timer callback at a time (the timer is
+// re-armed at the end of each one), or LogShutdown once the timer is gone.
+static char                 s_rgchLogBatch[32768];
+static HANDLE               s_hLogFile = INVALID_HANDLE_VALUE;
+static ULONG                s_cLatencyDumpCountdown;
+
+enum LOG_WRITER_STATE
+{
+    LWS_STOPPED,
+    LWS_STARTING,
+    LWS_RUNNING,
+};
+
+static std::atomic<LONG>    s_writerState;
+static PTP_TIMER            s_pLogTimer;
+
+static INIT_ONCE            s_logConfigInitOnce = INIT_ONCE_STATIC_INIT;
+static bool                 s_bLogEnabled;
+static WCHAR                s_wszLogFile[MAX_PATH];
+
+static BOOL CALLBACK _LogReadConfig(
+    _Inout_ PINIT_ONCE pInitOnce,
+    _Inout_opt_ PVOID pvParameter,
+    _Outptr_opt_result_maybenull_ PVOID *ppvContext
+    )
+{
+    UNREFERENCED_PARAMETER(pInitOnce);
+    UNREFERENCED_PARAMETER(pvParameter);
+    UNREFERENCED_PARAMETER(ppvContext);
+
+    DWORD dwEnabled = 0;
+    DWORD cb = sizeof(dwEnabled);
+    if (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, RASPWRAP_CONFIG_KEY, RASPWRAP_LOG_ENABLED_VALUE,
+                                      RRF_RT_REG_DWORD, NULL, &dwEnabled, &cb))
+    {
+        s_bLogEnabled = (dwEnabled != 0);
+    }
+
+    cb = sizeof(s_wszLogFile);
+    if (ERROR_SUCCESS != RegGetValueW(HKEY_LOCAL_MACHINE, RASPWRAP_CONFIG_KEY, RASPWRAP_LOG_FILE_VALUE,
+                                      RRF_RT_REG_SZ, NULL, s_wszLogFile, &cb))
+    {
+        (void)StringCchCopyW(s_wszLogFile, ARRAYSIZE(s_wszLogFile), RASPWRAP_LOG_FILE_DEFAULT);
+    }
+
+    return TRUE;
+}
+
+bool LogIsEnabled()
+{
+    // InitOnceExecuteOnce only fails if our callback does, and it doesn't.
+    (void)InitOnceExecuteOnce(&s_logConfigInitOnce, _LogReadConfig, NULL, NULL);
+    return s_bLogEnabled;
+}
+
+static void _LogWrite(_In_reads_(cch) const char *pch, _In_ DWORD cch)
+{
+    if (s_hLogFile == INVALID_HANDLE_VALUE)
+    {
+        s_hLogFile = CreateFileW(s_wszLogFile, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                 OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
+
+    if (s_hLogFile != INVALID_HANDLE_VALUE)
+    {
+        DWORD cbWritten;
+        (void)WriteFile(s_hLogFile, pch, cch, &cbWritten, NULL);
+    }
+}
+
+// Moves every published message to the file, in as few writes as the batch buffer allows.
+static void _LogDrain()
+{
+    size_t cchBatch = 0;
+
+    LONG cDropped = s_cDropped.exchange(0, std::memory_order_relaxed);
+    if (cDropped)
+    {
+        char szDropped[64];
+        if (SUCCEEDED(StringCchPrintfA(szDropped, ARRAYSIZE(szDropped), "[%ld log messages dropped]\r\n", cDropped)))
+        {
+            size_t cch = strlen(szDropped);
+            CopyMemory(s_rgchLogBatch, szDropped, cch);
+            cchBatch = cch;
+        }
+    }
+
+    for (const LOG_MESSAGE *pmsg = s_logRing.BeginDequeue(); pmsg; pmsg = s_logRing.BeginDequeue())
+    {
+        if (cchBatch + pmsg->cch > sizeof(s_rgchLogBatch))
+        {
+            _LogWrite(s_rgchLogBatch, (DWORD)cchBatch);
+            cchBatch = 0;
+        }
+        CopyMemory(s_rgchLogBatch + cchBatch, pmsg->rgch, pmsg->cch);
+        cchBatch += pmsg->cch;
+
+        s_logRing.EndDequeue();
+    }
+
+    if (cchBatch)
+    {
+        _LogWrite(s_rgchLogBatch, (DWORD)cchBatch);
+    }
+}
+
+static void _LogArmTimer(_In_ PTP_TIMER pTimer)
+{
+    ULARGE_INTEGER uliDue;
+    uliDue.QuadPart = (ULONGLONG)c_llLogFlushInterval;
+
+    FILETIME ftDue;
+    ftDue.dwLowDateTime = uliDue.LowPart;
+    ftDue.dwHighDateTime = uliDue.HighPart;
+
+    SetThreadpoolTimer(pTimer, &ftDue, 0, 0);
+}
+
+static void CALLBACK _LogTimerCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE pInstance,
+    _Inout_opt_ PVOID pvContext,
+    _Inout_ PTP_TIMER pTimer
+    )
+{
+    UNREFERENCED_PARAMETER(pInstance);
+    UNREFERENCED_PARAMETER(pvContext);
+
+    _LogDrain();
+    TraceDrain();
+
+    if (s_cLatencyDumpCountdown-- == 0)
+    {
+        LatencyDump();
+        s_cLatencyDumpCountdown = c_cLatencyDumpInterval;
+    }
+
+    // Once LogShutdown has started, let the timer run down instead.
+    if (s_writerState.load(std::memory_order_acquire) == LWS_RUNNING)
+    {
+        _LogArmTimer(pTimer);
+    }
+}
+
+//
+// The first LogWrite() or Trace() after the DLL loads, or after LogShutdown, creates the timer.
+// The callback environment names this DLL, so the thread pool keeps it loaded while a callback
+// runs; LogShutdown makes sure none is left pending before the DLL can unload.
+//
+static void _LogStartWriter()
+{
+    LONG lState = LWS_STOPPED;
+    if (s_writerState.compare_exchange_strong(lState, LWS_STARTING, std::memory_order_acquire))
+    {
+        TP_CALLBACK_ENVIRON env;
+        InitializeThreadpoolEnvironment(&env);
+        SetThreadpoolCallbackLibrary(&env, HINST_THISDLL);
+
+        s_pLogTimer = CreateThreadpoolTimer(_LogTimerCallback, NULL, &env);
+        DestroyThreadpoolEnvironment(&env);
+
+        if (s_pLogTimer)
+        {
+            _LogArmTimer(s_pLogTimer);
+            s_writerState.store(LWS_RUNNING, std::memory_order_release);
+        }
+        else
+        {
+            // Messages stay queued (or get dropped) until a later call manages to start it.
+            s_writerState.store(LWS_STOPPED, std::memory_order_release);
+        }
+    }
+}
+
+void LogEnsureWriter()
+{
+    if (s_writerState.load(std::memory_order_acquire) != LWS_RUNNING)
+    {
+        _LogStartWriter();
+    }
+}
+
+static const char c_rgchLevel[] = "-EWIV";   // by LOG_LEVEL
+
+static const char *const c_rgpszCategory[] =
+{
+    "dll",          // LC_DLL
+    "provider",     // LC_PROVIDER
+    "credential",   // LC_CREDENTIAL
+    "events",       // LC_EVENTS
+};
+
+static void _LogEnqueue(_In_ LOG_LEVEL ll, _In_ LOG_CATEGORY lc, _In_ const char *fmt, _In_ va_list args)
+{
+    size_t pos;
+    LOG_MESSAGE *pmsg = s_logRing.BeginEnqueue(&pos);
+    if (!pmsg)
+    {
+        s_cDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // A message too long for the slot is cut short, which StringCchVPrintfA reports but
+    // still terminates.
+    char *pszEnd;
+    size_t cchRemaining;
+    (void)StringCchPrintfExA(pmsg->rgch, ARRAYSIZE(pmsg->rgch), &pszEnd, &cchRemaining, 0, "[%c %s] ",
+                             c_rgchLevel[((size_t)ll < ARRAYSIZE(c_rgchLevel) - 1) ? ll : LL_NONE],
+                             ((size_t)lc < ARRAYSIZE(c_rgpszCategory)) ? c_rgpszCategory[lc] : "?");
+    (void)StringCchVPrintfA(pszEnd, cchRemaining, fmt, args);
+    pmsg->cch = (ULONG)strlen(pmsg->rgch);
+
+    s_logRing.EndEnqueue(pos);
+}
+
+void LogWrite(_In_ LOG_LEVEL ll, _In_ LOG_CATEGORY lc, _In_ const char *fmt, ...)
+{
+    if (!LogIsEnabled())
+    {
+        return;
+    }
+
+    LogEnsureWriter();
+
+    va_list args;
+    va_start(args, fmt);
+    _LogEnqueue(ll, lc, fmt, args);
+    va_end(args);
+}
+
+static INIT_ONCE            s_logHashInitOnce = INIT_ONCE_STATIC_INIT;
+static BCRYPT_ALG_HANDLE    s_hLogHashAlgorithm;
+static BYTE                 s_rgbLogHashKey[16];
+
+static BOOL CALLBACK _LogInitHash(
+    _Inout_ PINIT_ONCE pInitOnce,
+    _Inout_opt_ PVOID pvParameter,
+    _Outptr_opt_result_maybenull_ PVOID *ppvContext
+    )
+{
+    UNREFERENCED_PARAMETER(pInitOnce);
+    UNREFERENCED_PARAMETER(pvParameter);
+    UNREFERENCED_PARAMETER(ppvContext);
+
+    // Without a random key there is no hashing at all; secrets are then redacted.
+    if (BCRYPT_SUCCESS(BCryptGenRandom(NULL, s_rgbLogHashKey, sizeof(s_rgbLogHashKey),
+                                       BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+    {
+        if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&s_hLogHashAlgorithm, BCRYPT_SHA256_ALGORITHM, NULL,
+                                                        BCRYPT_ALG_HANDLE_HMAC_FLAG)))
+        {
+            s_hLogHashAlgorithm = NULL;
+        }
+    }
+    return TRUE;
+}
+
+//
+// The hash is HMAC-SHA256 of the UTF-16 code units, under a 128-bit key drawn when the first
+// secret is logged and never written anywhere, cut to its first 64 bits.  It shows whether a
+// value changed between two lines of one log, but without the key can't be used to look the
+// value up or to compare it across processes.
+//
+static bool _LogHashSecret(_In_ PCWSTR pwz, _Out_ ULONG64 *pullHash)
+{
+    (void)InitOnceExecuteOnce(&s_logHashInitOnce, _LogInitHash, NULL, NULL);
+    if (!s_hLogHashAlgorithm)
+    {
+        return false;
+    }
+
+    BYTE rgbHash[32];
+    bool fHashed = false;
+    BCRYPT_HASH_HANDLE hHash;
+    if (BCRYPT_SUCCESS(BCryptCreateHash(s_hLogHashAlgorithm, &hHash, NULL, 0, s_rgbLogHashKey,
+                                        sizeof(s_rgbLogHashKey), 0)))
+    {
+        fHashed = BCRYPT_SUCCESS(BCryptHashData(hHash, (PUCHAR)pwz, (ULONG)(wcslen(pwz) * sizeof(WCHAR)), 0)) &&
+                  BCRYPT_SUCCESS(BCryptFinishHash(hHash, rgbHash, sizeof(rgbHash), 0));
+        BCryptDestroyHash(hHash);
+    }
+
+    if (fHashed)
+    {
+        *pullHash = 0;
+        for (size_t i = 0; i < sizeof(*pullHash); i++)
+        {
+            *pullHash = (*pullHash << 8) | rgbHash[i];
+        }
+    }
+    SecureZeroMemory(rgbHash, sizeof(rgbHash));
+    return fHashed;
+}
+
+void LogFormatString(_In_ const LOG_STRING &str, _Out_writes_(cch) char *psz, _In_ size_t cch)
+{
+    // Truncation is fine here; StringCchPrintfA still terminates.
+    if (!str.pwz)
+    {
+        (void)StringCchCopyA(psz, cch, "(null)");
+    }
+    else if (!str.fSecret)
+    {
+        (void)StringCchPrintfA(psz, cch, "%S", str.pwz);
+    }
+    else
+    {
+        ULONG64 ullHash;
+        if (RASPWRAP_LOG_SECRETS == LSP_HASH && _LogHashSecret(str.pwz, &ullHash))
+        {
+            (void)StringCchPrintfA(psz, cch, "<secret:%016llx>", ullHash);
+        }
+        else
+        {
+            (void)StringCchCopyA(psz, cch, "<secret>");
+        }
+    }
+}
+
+void LogShutdown()
+{
+    LONG lState = LWS_RUNNING;
+    if (s_writerState.compare_exchange_strong(lState, LWS_STARTING, std::memory_order_acquire))
+    {
+        // Stop the timer and wait out a callback in progress.  That callback may have seen
+        // LWS_RUNNING and re-armed the timer, so do it twice: no callback that starts now
+        // re-arms it.  Then we are the consumer, for one last drain.
+        for (int i = 0; i < 2; i++)
+        {
+            SetThreadpoolTimer(s_pLogTimer, NULL, 0, 0);
+            WaitForThreadpoolTimerCallbacks(s_pLogTimer, TRUE);
+        }
+        CloseThreadpoolTimer(s_pLogTimer);
+        s_pLogTimer = NULL;
+
+        _LogDrain();
+        TraceDrain();
+        LatencyDump();
+
+        if (s_hLogFile != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(s_hLogFile);
+            s_hLogFile = INVALID_HANDLE_VALUE;
+        }
+        TraceClose();
+        LatencyClose();
+
+        s_writerState.store(LWS_STOPPED, std::memory_order_release);
+    }
+}
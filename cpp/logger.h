@@ -0,0 +1,201 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The debug log.  Log<level, category>() formats the message into a slot of
+// an in-memory ring and returns; a thread pool timer writes the ring out to
+// the log file in batches, so LogonUI's threads never wait on the file
+// system.  The same writer empties the binary trace (see trace.h) and
+// dumps the latency histograms (see latency.h).
+//
+// What gets compiled in is decided at build time, by these preprocessor
+// definitions:
+//
+//   RASPWRAP_LOG_LEVEL       the most verbose LOG_LEVEL kept (LL_VERBOSE for
+//                            debug builds, LL_WARNING otherwise)
+//   RASPWRAP_LOG_CATEGORIES  a mask of LOG_CATEGORY_MASK()s to keep (all)
+//   RASPWRAP_LOG_SECRETS     how LogSecret() strings are written, LSP_REDACT
+//                            (the default) or LSP_HASH
+//
+// A Log() call below the level, or outside the categories, is an empty
+// inline function: the optimizer drops the call and its format string.
+//
+// Release builds keep the errors and warnings: the wrapped provider failing,
+// or handing us something we can't wrap.  The per-call detail is LL_VERBOSE.
+//
+// Field values must be tagged: a wide string argument that isn't wrapped in
+// LogSecret() or LogPublic() does not compile.  A secret is never written in
+// the clear.
+//
+// Whether anything is actually written is up to the configuration:
+//
+//   HKLM\SOFTWARE\RaspWrap
+//       LogEnabled  REG_DWORD  1 to log
+//       LogFile     REG_SZ     the file to append to (RASPWRAP_LOG_FILE_DEFAULT if absent)
+
+#pragma once
+
+#include <windows.h>
+#include <type_traits>
+
+#define RASPWRAP_CONFIG_KEY         L"SOFTWARE\\RaspWrap"
+#define RASPWRAP_LOG_ENABLED_VALUE  L"LogEnabled"
+#define RASPWRAP_LOG_FILE_VALUE     L"LogFile"
+#define RASPWRAP_LOG_FILE_DEFAULT   L"C:\\log\\raspwrap.log"
+
+enum LOG_LEVEL
+{
+    LL_NONE,
+    LL_ERROR,
+    LL_WARNING,
+    LL_INFO,
+    LL_VERBOSE,
+};
+
+enum LOG_CATEGORY
+{
+    LC_DLL,
+    LC_PROVIDER,
+    LC_CREDENTIAL,
+    LC_EVENTS,
+};
+
+#define LOG_CATEGORY_MASK(lc)   (1u << (lc))
+
+enum LOG_SECRET_POLICY
+{
+    LSP_REDACT,     // "<secret>"
+    LSP_HASH,       // "<secret:xxxxxxxxxxxxxxxx>", a keyed hash that only tells equal values apart within one process
+};
+
+#ifndef RASPWRAP_LOG_LEVEL
+#ifdef _DEBUG
+#define RASPWRAP_LOG_LEVEL          LL_VERBOSE
+#else
+#define RASPWRAP_LOG_LEVEL          LL_WARNING
+#endif
+#endif
+
+#ifndef RASPWRAP_LOG_CATEGORIES
+#define RASPWRAP_LOG_CATEGORIES     0xFFFFFFFFu
+#endif
+
+#ifndef RASPWRAP_LOG_SECRETS
+#define RASPWRAP_LOG_SECRETS        LSP_REDACT
+#endif
+
+// A wide string argument, tagged with whether it may be written as is.  Logged with %s.
+struct LOG_STRING
+{
+    PCWSTR  pwz;
+    bool    fSecret;
+};
+
+inline LOG_STRING LogSecret(_In_opt_ PCWSTR pwz)
+{
+    LOG_STRING str = { pwz, true };
+    return str;
+}
+
+inline LOG_STRING LogPublic(_In_opt_ PCWSTR pwz)
+{
+    LOG_STRING str = { pwz, false };
+    return str;
+}
+
+// Writes str into psz, in the clear, redacted or hashed as RASPWRAP_LOG_SECRETS says.
+void LogFormatString(_In_ const LOG_STRING &str, _Out_writes_(cch) char *psz, _In_ size_t cch);
+
+// Queues a printf-style message for the log file; a message that doesn't fit the ring, or in
+// its slot, is dropped or truncated rather than waited for.  Use Log<>() rather than calling
+// this directly.
+void LogWrite(_In_ LOG_LEVEL ll, _In_ LOG_CATEGORY lc, _In_ const char *fmt, ...);
+
+// How one Log() argument reaches printf: as is, except for tagged strings.
+template <typename T>
+class LogArg
+{
+    static_assert(!std::is_same<T, PWSTR>::value && !std::is_same<T, PCWSTR>::value,
+                  "wrap wide strings in LogSecret() or LogPublic()");
+
+public:
+    explicit LogArg(const T &v) : _v(v)
+    {
+    }
+
+    T Get() const
+    {
+        return _v;
+    }
+
+private:
+    T _v;
+};
+
+template <>
+class LogArg<LOG_STRING>
+{
+public:
+    explicit LogArg(const LOG_STRING &str)
+    {
+        LogFormatString(str, _sz, ARRAYSIZE(_sz));
+    }
+
+    const char *Get() const
+    {
+        return _sz;
+    }
+
+private:
+    char _sz[128];
+};
+
+template <bool fEnabled>
+struct LogDispatch
+{
+    // Each LogArg lives until LogWrite returns, so the strings they hand out stay valid.
+    template <typename... TArgs>
+    static void Write(_In_ LOG_LEVEL ll, _In_ LOG_CATEGORY lc, _In_ const char *fmt, const TArgs&... args)
+    {
+        LogWrite(ll, lc, fmt, LogArg<typename std::decay<TArgs>::type>(args).Get()...);
+    }
+};
+
+template <>
+struct LogDispatch<false>
+{
+    template <typename... TArgs>
+    static void Write(_In_ LOG_LEVEL, _In_ LOG_CATEGORY, _In_ const char *, const TArgs&...)
+    {
+    }
+};
+
+template <LOG_LEVEL ll, LOG_CATEGORY lc>
+struct LogIsCompiledIn
+{
+    static const bool value = (ll != LL_NONE) && (ll <= RASPWRAP_LOG_LEVEL) &&
+                              ((RASPWRAP_LOG_CATEGORIES & LOG_CATEGORY_MASK(lc)) != 0);
+};
+
+// Log<LL_INFO, LC_PROVIDER>("...%p...%s\n", this, LogSecret(pwz));
+template <LOG_LEVEL ll, LOG_CATEGORY lc, typename... TArgs>
+inline void Log(_In_ const char *fmt, const TArgs&... args)
+{
+    LogDispatch<LogIsCompiledIn<ll, lc>::value>::Write(ll, lc, fmt, args...);
+}
+
+// Whether the configuration turns logging on; read once per process.
+bool LogIsEnabled();
+
+// Starts the background writer if it isn't running yet; LogWrite(), Trace() and LatencyRecord()
+// call this.
+void LogEnsureWriter();
+
+// Writes out whatever is queued, in the log and the trace, and stops the background writer,
+// so the DLL can unload.  Must not be called under the loader lock.  A later LogWrite() or
+// Trace() starts the writer again.
+void LogShutdown();
@@ -0,0 +1,531 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Compile-time descriptions of the packed logon structures for 32 and 64 bit
+// processes, and the packer engine built on them.  Each layout lists the
+// fields of its structure; the engine sizes, packs and unpacks any layout by
+// walking that list.  Because the target layout is a template parameter, a 64
+// bit process can emit 32 bit blobs and the reverse, with every offset
+// resolved at compile time.
+//
+// Only the SDK types and the Allocator are needed, so the tests in tests/
+// build this header on its own.
+
+#pragma once
+
+#include <stddef.h>
+#include <type_traits>
+#include <windows.h>
+#include <ntsecapi.h>
+#include <intsafe.h>
+#include "allocator.h"
+
+//
+// A UNICODE_STRING as it appears in a packed buffer: Buffer is a byte offset from the start of
+// the buffer, stored in a field as wide as a pointer of the target bitness.
+//
+template <typename TPointer>
+struct PACKED_UNICODE_STRING_T
+{
+    USHORT   Length;
+    USHORT   MaximumLength;
+    TPointer Buffer;
+};
+
+template <typename TPointer>
+struct PACKED_KERB_INTERACTIVE_LOGON_T
+{
+    KERB_LOGON_SUBMIT_TYPE            MessageType;
+    PACKED_UNICODE_STRING_T<TPointer> LogonDomainName;
+    PACKED_UNICODE_STRING_T<TPointer> UserName;
+    PACKED_UNICODE_STRING_T<TPointer> Password;
+};
+
+template <typename TPointer>
+struct PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T
+{
+    PACKED_KERB_INTERACTIVE_LOGON_T<TPointer> Logon;
+    LUID                                      LogonId;
+};
+
+template <typename TPointer>
+struct PACKED_KERB_CERTIFICATE_LOGON_T
+{
+    KERB_LOGON_SUBMIT_TYPE            MessageType;
+    PACKED_UNICODE_STRING_T<TPointer> DomainName;
+    PACKED_UNICODE_STRING_T<TPointer> UserName;
+    PACKED_UNICODE_STRING_T<TPointer> Pin;
+    ULONG                             Flags;
+    ULONG                             CspDataLength;
+    TPointer                          CspData;
+};
+
+template <typename TPointer>
+struct PACKED_MSV1_0_INTERACTIVE_LOGON_T
+{
+    MSV1_0_LOGON_SUBMIT_TYPE          MessageType;
+    PACKED_UNICODE_STRING_T<TPointer> LogonDomainName;
+    PACKED_UNICODE_STRING_T<TPointer> UserName;
+    PACKED_UNICODE_STRING_T<TPointer> Password;
+};
+
+//
+// One entry of a layout's field list.  Offsets are given both in the native structure (with
+// real pointers) and in the packed header of the target bitness.
+//
+enum PACKED_FIELD_TYPE
+{
+    PFT_SCALAR,                 // copied as is: MessageType, Flags, LogonId...
+    PFT_UNICODE_STRING,         // UNICODE_STRING whose characters follow the header
+    PFT_BYTES,                  // ULONG byte count plus pointer; the bytes follow the header
+};
+
+struct PACKED_FIELD
+{
+    PACKED_FIELD_TYPE pft;
+    DWORD             offNative;        // the field itself (PFT_BYTES: its pointer)
+    DWORD             offPacked;
+    DWORD             cbScalar;         // PFT_SCALAR only
+    DWORD             offNativeLength;  // PFT_BYTES only: its ULONG byte count
+    DWORD             offPackedLength;
+};
+
+// For use inside a layout, where Native and Header name the two structures.  Data is appended
+// in list order, so PFT_BYTES fields go last to keep the strings wchar_t aligned.
+#define PACKED_FIELD_SCALAR(f) \
+    { PFT_SCALAR, offsetof(Native, f), offsetof(Header, f), sizeof(((Native*)0)->f), 0, 0 }
+#define PACKED_FIELD_UNICODE_STRING(f) \
+    { PFT_UNICODE_STRING, offsetof(Native, f), offsetof(Header, f), 0, 0, 0 }
+#define PACKED_FIELD_BYTES(f, cbf) \
+    { PFT_BYTES, offsetof(Native, f), offsetof(Header, f), 0, offsetof(Native, cbf), offsetof(Header, cbf) }
+
+//
+// Layout descriptors.  TPointer is ULONG for 32 bit blobs and ULONG64 for 64 bit blobs.
+//
+template <typename TPointer>
+struct KerbInteractiveUnlockLogonLayout
+{
+    typedef TPointer                                         Pointer;
+    typedef KERB_INTERACTIVE_UNLOCK_LOGON                    Native;
+    typedef PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<TPointer> Header;
+
+    static constexpr DWORD cbHeader = sizeof(Header);
+    static constexpr PACKED_FIELD rgFields[] =
+    {
+        PACKED_FIELD_SCALAR(Logon.MessageType),
+        PACKED_FIELD_UNICODE_STRING(Logon.LogonDomainName),
+        PACKED_FIELD_UNICODE_STRING(Logon.UserName),
+        PACKED_FIELD_UNICODE_STRING(Logon.Password),
+        PACKED_FIELD_SCALAR(LogonId),
+    };
+};
+
+template <typename TPointer>
+struct KerbCertificateLogonLayout
+{
+    typedef TPointer                                  Pointer;
+    typedef KERB_CERTIFICATE_LOGON                    Native;
+    typedef PACKED_KERB_CERTIFICATE_LOGON_T<TPointer> Header;
+
+    static constexpr DWORD cbHeader = sizeof(Header);
+    static constexpr PACKED_FIELD rgFields[] =
+    {
+        PACKED_FIELD_SCALAR(MessageType),
+        PACKED_FIELD_UNICODE_STRING(DomainName),
+        PACKED_FIELD_UNICODE_STRING(UserName),
+        PACKED_FIELD_UNICODE_STRING(Pin),
+        PACKED_FIELD_SCALAR(Flags),
+        PACKED_FIELD_BYTES(CspData, CspDataLength),
+    };
+};
+
+template <typename TPointer>
+struct Msv1_0InteractiveLogonLayout
+{
+    typedef TPointer                                    Pointer;
+    typedef MSV1_0_INTERACTIVE_LOGON                    Native;
+    typedef PACKED_MSV1_0_INTERACTIVE_LOGON_T<TPointer> Header;
+
+    static constexpr DWORD cbHeader = sizeof(Header);
+    static constexpr PACKED_FIELD rgFields[] =
+    {
+        PACKED_FIELD_SCALAR(MessageType),
+        PACKED_FIELD_UNICODE_STRING(LogonDomainName),
+        PACKED_FIELD_UNICODE_STRING(UserName),
+        PACKED_FIELD_UNICODE_STRING(Password),
+    };
+};
+
+template <typename TPointer> constexpr PACKED_FIELD KerbInteractiveUnlockLogonLayout<TPointer>::rgFields[];
+template <typename TPointer> constexpr PACKED_FIELD KerbCertificateLogonLayout<TPointer>::rgFields[];
+template <typename TPointer> constexpr PACKED_FIELD Msv1_0InteractiveLogonLayout<TPointer>::rgFields[];
+
+typedef KerbInteractiveUnlockLogonLayout<ULONG>   KerbLayout32;
+typedef KerbInteractiveUnlockLogonLayout<ULONG64> KerbLayout64;
+typedef KerbCertificateLogonLayout<ULONG>         KerbCertificateLayout32;
+typedef KerbCertificateLogonLayout<ULONG64>       KerbCertificateLayout64;
+typedef Msv1_0InteractiveLogonLayout<ULONG>       Msv1_0Layout32;
+typedef Msv1_0InteractiveLogonLayout<ULONG64>     Msv1_0Layout64;
+
+#ifdef _WIN64
+typedef KerbLayout64            KerbLayoutNative;
+typedef KerbCertificateLayout64 KerbCertificateLayoutNative;
+typedef Msv1_0Layout64          Msv1_0LayoutNative;
+#else
+typedef KerbLayout32            KerbLayoutNative;
+typedef KerbCertificateLayout32 KerbCertificateLayoutNative;
+typedef Msv1_0Layout32          Msv1_0LayoutNative;
+#endif
+
+static_assert(sizeof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG>) == 36, "unexpected 32 bit KERB_INTERACTIVE_UNLOCK_LOGON size");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG>, Logon.LogonDomainName) == 4, "unexpected 32 bit LogonDomainName offset");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG>, Logon.UserName) == 12, "unexpected 32 bit UserName offset");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG>, Logon.Password) == 20, "unexpected 32 bit Password offset");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG>, LogonId) == 28, "unexpected 32 bit LogonId offset");
+
+static_assert(sizeof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG64>) == 64, "unexpected 64 bit KERB_INTERACTIVE_UNLOCK_LOGON size");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG64>, Logon.LogonDomainName) == 8, "unexpected 64 bit LogonDomainName offset");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG64>, Logon.UserName) == 24, "unexpected 64 bit UserName offset");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG64>, Logon.Password) == 40, "unexpected 64 bit Password offset");
+static_assert(offsetof(PACKED_KERB_INTERACTIVE_UNLOCK_LOGON_T<ULONG64>, LogonId) == 56, "unexpected 64 bit LogonId offset");
+
+static_assert(sizeof(PACKED_KERB_CERTIFICATE_LOGON_T<ULONG>) == 40, "unexpected 32 bit KERB_CERTIFICATE_LOGON size");
+static_assert(offsetof(PACKED_KERB_CERTIFICATE_LOGON_T<ULONG>, Flags) == 28, "unexpected 32 bit Flags offset");
+static_assert(offsetof(PACKED_KERB_CERTIFICATE_LOGON_T<ULONG>, CspData) == 36, "unexpected 32 bit CspData offset");
+
+static_assert(sizeof(PACKED_KERB_CERTIFICATE_LOGON_T<ULONG64>) == 72, "unexpected 64 bit KERB_CERTIFICATE_LOGON size");
+static_assert(offsetof(PACKED_KERB_CERTIFICATE_LOGON_T<ULONG64>, Flags) == 56, "unexpected 64 bit Flags offset");
+static_assert(offsetof(PACKED_KERB_CERTIFICATE_LOGON_T<ULONG64>, CspData) == 64, "unexpected 64 bit CspData offset");
+
+static_assert(sizeof(PACKED_MSV1_0_INTERACTIVE_LOGON_T<ULONG>) == 28, "unexpected 32 bit MSV1_0_INTERACTIVE_LOGON size");
+static_assert(sizeof(PACKED_MSV1_0_INTERACTIVE_LOGON_T<ULONG64>) == 56, "unexpected 64 bit MSV1_0_INTERACTIVE_LOGON size");
+
+// The native descriptors must describe exactly what the SDK headers declare.
+static_assert(KerbLayoutNative::cbHeader == sizeof(KERB_INTERACTIVE_UNLOCK_LOGON), "native layout mismatch");
+static_assert(offsetof(KerbLayoutNative::Header, Logon.Password) == offsetof(KERB_INTERACTIVE_UNLOCK_LOGON, Logon.Password), "native layout mismatch");
+static_assert(offsetof(KerbLayoutNative::Header, LogonId) == offsetof(KERB_INTERACTIVE_UNLOCK_LOGON, LogonId), "native layout mismatch");
+static_assert(KerbCertificateLayoutNative::cbHeader == sizeof(KERB_CERTIFICATE_LOGON), "native layout mismatch");
+static_assert(offsetof(KerbCertificateLayoutNative::Header, CspData) == offsetof(KERB_CERTIFICATE_LOGON, CspData), "native layout mismatch");
+static_assert(Msv1_0LayoutNative::cbHeader == sizeof(MSV1_0_INTERACTIVE_LOGON), "native layout mismatch");
+static_assert(offsetof(Msv1_0LayoutNative::Header, Password) == offsetof(MSV1_0_INTERACTIVE_LOGON, Password), "native layout mismatch");
+
+//
+// Returns the exact size of rIn once packed in the TLayout format.  Fails if a string or byte
+// field has a length but no buffer.
+//
+template <typename TLayout>
+HRESULT PackedLogonGetPackedSizeT(
+    _In_ const typename TLayout::Native &rIn,
+    _Out_ DWORD *pcb
+    )
+{
+    const BYTE *pbIn = (const BYTE*)&rIn;
+    DWORD cb = TLayout::cbHeader;
+    HRESULT hr = S_OK;
+
+    *pcb = 0;
+
+    for (size_t i = 0; SUCCEEDED(hr) && i < ARRAYSIZE(TLayout::rgFields); i++)
+    {
+        const PACKED_FIELD &rpf = TLayout::rgFields[i];
+
+        if (rpf.pft == PFT_UNICODE_STRING)
+        {
+            const UNICODE_STRING *pus = (const UNICODE_STRING*)(pbIn + rpf.offNative);
+            hr = (pus->Length && !pus->Buffer) ? E_INVALIDARG : DWordAdd(cb, pus->Length, &cb);
+        }
+        else if (rpf.pft == PFT_BYTES)
+        {
+            ULONG cbBytes = *(const ULONG*)(pbIn + rpf.offNativeLength);
+            const BYTE *pb = *(const BYTE* const*)(pbIn + rpf.offNative);
+            hr = (cbBytes && !pb) ? E_INVALIDARG : DWordAdd(cb, cbBytes, &cb);
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        *pcb = cb;
+    }
+
+    return hr;
+}
+
+//
+// Packs rIn into rgb in the TLayout format in a single pass over the field list, without
+// allocating.  The header is assembled on the stack and copied in last, so rgb needs no
+// particular alignment.  String and byte data follow the header in field order, and each
+// Buffer member holds the byte offset of its data instead of a pointer.
+//
+template <typename TLayout>
+HRESULT PackedLogonPackToBufferT(
+    _In_ const typename TLayout::Native &rIn,
+    _Out_writes_bytes_to_(cb, *pcbWritten) BYTE *rgb,
+    _In_ DWORD cb,
+    _Out_ DWORD *pcbWritten
+    )
+{
+    typedef typename TLayout::Pointer Pointer;
+
+    *pcbWritten = 0;
+
+    if (rgb == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    DWORD cbPacked;
+    HRESULT hr = PackedLogonGetPackedSizeT<TLayout>(rIn, &cbPacked);
+    if (SUCCEEDED(hr))
+    {
+        if (cb >= cbPacked)
+        {
+            const BYTE *pbIn = (const BYTE*)&rIn;
+            typename TLayout::Header header;
+            BYTE *pbHeader = (BYTE*)&header;
+            DWORD cbOffset = TLayout::cbHeader;
+
+            ZeroMemory(&header, sizeof(header));
+
+            for (size_t i = 0; i < ARRAYSIZE(TLayout::rgFields); i++)
+            {
+                const PACKED_FIELD &rpf = TLayout::rgFields[i];
+
+                if (rpf.pft == PFT_SCALAR)
+                {
+                    CopyMemory(pbHeader + rpf.offPacked, pbIn + rpf.offNative, rpf.cbScalar);
+                }
+                else if (rpf.pft == PFT_UNICODE_STRING)
+                {
+                    const UNICODE_STRING *pusIn = (const UNICODE_STRING*)(pbIn + rpf.offNative);
+                    // Zeroed first: in a 64 bit header there is padding before Buffer.
+                    PACKED_UNICODE_STRING_T<Pointer> usOut;
+                    ZeroMemory(&usOut, sizeof(usOut));
+                    usOut.Length = pusIn->Length;
+                    usOut.MaximumLength = pusIn->Length;
+                    usOut.Buffer = (Pointer)cbOffset;
+                    CopyMemory(pbHeader + rpf.offPacked, &usOut, sizeof(usOut));
+
+                    if (pusIn->Length)
+                    {
+                        CopyMemory(rgb + cbOffset, pusIn->Buffer, pusIn->Length);
+                    }
+                    cbOffset += pusIn->Length;
+                }
+                else
+                {
+                    ULONG cbBytes = *(const ULONG*)(pbIn + rpf.offNativeLength);
+                    const BYTE *pb = *(const BYTE* const*)(pbIn + rpf.offNative);
+                    Pointer offBytes = cbBytes ? (Pointer)cbOffset : 0;
+                    CopyMemory(pbHeader + rpf.offPackedLength, &cbBytes, sizeof(cbBytes));
+                    CopyMemory(pbHeader + rpf.offPacked, &offBytes, sizeof(offBytes));
+
+                    if (cbBytes)
+                    {
+                        CopyMemory(rgb + cbOffset, pb, cbBytes);
+                    }
+                    cbOffset += cbBytes;
+                }
+            }
+
+            CopyMemory(rgb, &header, sizeof(header));
+
+            *pcbWritten = cbOffset;
+            hr = S_OK;
+        }
+        else
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+        }
+    }
+
+    return hr;
+}
+
+//
+// Packs rIn in the TLayout format into a single buffer from pallocator.
+//
+template <typename TLayout>
+HRESULT PackedLogonPackT(
+    _In_ const typename TLayout::Native &rIn,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    )
+{
+    DWORD cb;
+    HRESULT hr = PackedLogonGetPackedSizeT<TLayout>(rIn, &cb);
+    if (SUCCEEDED(hr))
+    {
+        void *pv;
+        hr = pallocator->Alloc(cb, &pv);
+        if (SUCCEEDED(hr))
+        {
+            hr = PackedLogonPackToBufferT<TLayout>(rIn, (BYTE*)pv, cb, pcb);
+            if (SUCCEEDED(hr))
+            {
+                *prgb = (BYTE*)pv;
+            }
+            else
+            {
+                pallocator->Free(pv);
+            }
+        }
+    }
+
+    return hr;
+}
+
+//
+// Checks that a range of cbRange bytes at ullOffset lies entirely after the packed header and
+// inside the buffer.  An offset of 0 is only allowed for an empty range.
+//
+template <typename TLayout>
+HRESULT _PackedRangeValidateT(
+    _In_ ULONG64 ullOffset,
+    _In_ DWORD cbRange,
+    _In_ DWORD cb
+    )
+{
+    if (ullOffset == 0)
+    {
+        return (cbRange == 0) ? S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    if (ullOffset < TLayout::cbHeader || ullOffset > cb || cbRange > cb - ullOffset)
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    return S_OK;
+}
+
+//
+// Validates a packed buffer in the TLayout format and fills *pOut with weak references into
+// it: every string and byte pointer in *pOut points inside rgb, which is neither modified nor
+// copied.  *pOut is only valid as long as rgb is, and must not be written through.
+//
+template <typename TLayout>
+HRESULT PackedLogonUnpackT(
+    _In_reads_bytes_(cb) const BYTE *rgb,
+    _In_ DWORD cb,
+    _Out_ typename TLayout::Native *pOut
+    )
+{
+    typedef typename TLayout::Pointer Pointer;
+
+    ZeroMemory(pOut, sizeof(*pOut));
+
+    if (rgb == nullptr || cb < TLayout::cbHeader || ((ULONG_PTR)rgb % sizeof(wchar_t)))
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    // The buffer may not be aligned for the header itself, so read it through a copy.
+    typename TLayout::Header header;
+    const BYTE *pbHeader = (const BYTE*)&header;
+    BYTE *pbOut = (BYTE*)pOut;
+    HRESULT hr = S_OK;
+
+    CopyMemory(&header, rgb, sizeof(header));
+
+    for (size_t i = 0; SUCCEEDED(hr) && i < ARRAYSIZE(TLayout::rgFields); i++)
+    {
+        const PACKED_FIELD &rpf = TLayout::rgFields[i];
+
+        if (rpf.pft == PFT_SCALAR)
+        {
+            CopyMemory(pbOut + rpf.offNative, pbHeader + rpf.offPacked, rpf.cbScalar);
+        }
+        else if (rpf.pft == PFT_UNICODE_STRING)
+        {
+            PACKED_UNICODE_STRING_T<Pointer> usIn;
+            CopyMemory(&usIn, pbHeader + rpf.offPacked, sizeof(usIn));
+
+            if ((usIn.Length % sizeof(wchar_t)) || usIn.Length > usIn.MaximumLength ||
+                (usIn.Buffer % sizeof(wchar_t)))
+            {
+                hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+            else
+            {
+                hr = _PackedRangeValidateT<TLayout>(usIn.Buffer, usIn.MaximumLength, cb);
+            }
+
+            if (SUCCEEDED(hr))
+            {
+                UNICODE_STRING *pusOut = (UNICODE_STRING*)(pbOut + rpf.offNative);
+                pusOut->Length = usIn.Length;
+                pusOut->MaximumLength = usIn.MaximumLength;
+                pusOut->Buffer = usIn.Buffer ? (PWSTR)(rgb + (DWORD)usIn.Buffer) : nullptr;
+            }
+        }
+        else
+        {
+            ULONG cbBytes;
+            Pointer offBytes;
+            CopyMemory(&cbBytes, pbHeader + rpf.offPackedLength, sizeof(cbBytes));
+            CopyMemory(&offBytes, pbHeader + rpf.offPacked, sizeof(offBytes));
+
+            hr = _PackedRangeValidateT<TLayout>(offBytes, cbBytes, cb);
+            if (SUCCEEDED(hr))
+            {
+                *(ULONG*)(pbOut + rpf.offNativeLength) = cbBytes;
+                *(const BYTE**)(pbOut + rpf.offNative) = offBytes ? rgb + (DWORD)offBytes : nullptr;
+            }
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        ZeroMemory(pOut, sizeof(*pOut));
+    }
+
+    return hr;
+}
+
+//
+// Converts a packed buffer from the TLayoutIn format to the TLayoutOut format, writing into a
+// buffer the caller provides.  Use with a NULL rgbOut and cbOut of 0 to get the required size:
+// that fails with ERROR_INSUFFICIENT_BUFFER and sets *pcbOut.
+//
+template <typename TLayoutIn, typename TLayoutOut>
+HRESULT PackedLogonTranscodeT(
+    _In_reads_bytes_(cbIn) const BYTE *rgbIn,
+    _In_ DWORD cbIn,
+    _Out_writes_bytes_to_opt_(cbOut, *pcbOut) BYTE *rgbOut,
+    _In_ DWORD cbOut,
+    _Out_ DWORD *pcbOut
+    )
+{
+    static_assert(std::is_same<typename TLayoutIn::Native, typename TLayoutOut::Native>::value,
+                  "can only transcode between layouts of the same structure");
+
+    *pcbOut = 0;
+
+    typename TLayoutIn::Native native;
+    HRESULT hr = PackedLogonUnpackT<TLayoutIn>(rgbIn, cbIn, &native);
+    if (SUCCEEDED(hr))
+    {
+        DWORD cbPacked;
+        hr = PackedLogonGetPackedSizeT<TLayoutOut>(native, &cbPacked);
+        if (SUCCEEDED(hr))
+        {
+            if (rgbOut != nullptr && cbOut >= cbPacked)
+            {
+                hr = PackedLogonPackToBufferT<TLayoutOut>(native, rgbOut, cbOut, pcbOut);
+            }
+            else
+            {
+                *pcbOut = cbPacked;
+                hr = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+            }
+        }
+    }
+
+    return hr;
+}
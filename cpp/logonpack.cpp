@@ -0,0 +1,448 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Packing of the logon structures for GetSerialization.
+
+#include "logonpack.h"
+#include "logonlayout.h"
+#include "utf16.h"
+#include <intsafe.h>
+
+//
+// This function copies the length of pwz and the pointer pwz into the UNICODE_STRING structure
+// This function is intended for serializing a credential in GetSerialization only.
+// Note that this function just makes a copy of the string pointer. It DOES NOT ALLOCATE storage!
+// Be very, very sure that this is what you want, because it probably isn't outside of the
+// exact GetSerialization call where the sample uses it.
+//
+HRESULT UnicodeStringInitWithString(
+    _In_ PWSTR pwz,
+    _Out_ UNICODE_STRING *pus
+    )
+{
+    HRESULT hr;
+    if (pwz)
+    {
+        // Capping the scan at UNICODE_STRING_MAX_CHARS guarantees the byte count fits in the
+        // USHORT.
+        size_t cchString;
+        hr = Utf16ScanString(pwz, UNICODE_STRING_MAX_CHARS, &cchString);
+        if (SUCCEEDED(hr))
+        {
+            pus->Length = (USHORT)(cchString * sizeof(wchar_t)); // Explicitly NOT including NULL terminator
+            pus->MaximumLength = pus->Length;
+            pus->Buffer = pwz;
+        }
+    }
+    else
+    {
+        hr = E_INVALIDARG;
+    }
+    return hr;
+}
+
+//
+// Returns the MessageType of a KERB_INTERACTIVE_UNLOCK_LOGON for the usage scenario cpus.
+//
+static HRESULT _KerbLogonSubmitTypeFromUsageScenario(
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _Out_ KERB_LOGON_SUBMIT_TYPE *pkst
+    )
+{
+    HRESULT hr;
+
+    switch (cpus)
+    {
+    case CPUS_UNLOCK_WORKSTATION:
+        *pkst = KerbWorkstationUnlockLogon;
+        hr = S_OK;
+        break;
+
+    case CPUS_LOGON:
+        *pkst = KerbInteractiveLogon;
+        hr = S_OK;
+        break;
+
+    case CPUS_CREDUI:
+        *pkst = (KERB_LOGON_SUBMIT_TYPE)0; // MessageType does not apply to CredUI
+        hr = S_OK;
+        break;
+
+    default:
+        hr = E_FAIL;
+        break;
+    }
+
+    return hr;
+}
+
+//
+// Initialize the members of a KERB_INTERACTIVE_UNLOCK_LOGON with weak references to the
+// passed-in strings.  This is useful if you will later use KerbInteractiveUnlockLogonPack
+// to serialize the structure.
+//
+// The password is stored in encrypted form for CPUS_LOGON and CPUS_UNLOCK_WORKSTATION
+// because the system can accept encrypted credentials.  It is not encrypted in CPUS_CREDUI
+// because we cannot know whether our caller can accept encrypted credentials.
+//
+HRESULT KerbInteractiveUnlockLogonInit(
+    _In_ PWSTR pwzDomain,
+    _In_ PWSTR pwzUsername,
+    _In_ PWSTR pwzPassword,
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _Out_ KERB_INTERACTIVE_UNLOCK_LOGON *pkiul
+    )
+{
+    KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+    ZeroMemory(&kiul, sizeof(kiul));
+
+    KERB_INTERACTIVE_LOGON *pkil = &kiul.Logon;
+
+    // Note: this method uses custom logic to pack a KERB_INTERACTIVE_UNLOCK_LOGON with a
+    // serialized credential.  We could replace the calls to UnicodeStringInitWithString
+    // and KerbInteractiveUnlockLogonPack with a single cal to CredPackAuthenticationBuffer,
+    // but that API has a drawback: it returns a KERB_INTERACTIVE_UNLOCK_LOGON whose
+    // MessageType is always KerbInteractiveLogon.
+    //
+    // If we only handled CPUS_LOGON, this drawback would not be a problem.  For
+    // CPUS_UNLOCK_WORKSTATION, we could cast the output buffer of CredPackAuthenticationBuffer
+    // to KERB_INTERACTIVE_UNLOCK_LOGON and modify the MessageType to KerbWorkstationUnlockLogon,
+    // but such a cast would be unsupported -- the output format of CredPackAuthenticationBuffer
+    // is not officially documented.
+
+    // Initialize the UNICODE_STRINGS to share our username and password strings.
+    HRESULT hr = UnicodeStringInitWithString(pwzDomain, &pkil->LogonDomainName);
+    if (SUCCEEDED(hr))
+    {
+        hr = UnicodeStringInitWithString(pwzUsername, &pkil->UserName);
+        if (SUCCEEDED(hr))
+        {
+            hr = UnicodeStringInitWithString(pwzPassword, &pkil->Password);
+            if (SUCCEEDED(hr))
+            {
+                // Set a MessageType based on the usage scenario.
+                hr = _KerbLogonSubmitTypeFromUsageScenario(cpus, &pkil->MessageType);
+                if (SUCCEEDED(hr))
+                {
+                    // KERB_INTERACTIVE_UNLOCK_LOGON is just a series of structures.  A
+                    // flat copy will properly initialize the output parameter.
+                    CopyMemory(pkiul, &kiul, sizeof(*pkiul));
+                }
+            }
+        }
+    }
+
+    return hr;
+}
+
+//
+// WinLogon and LSA consume "packed" KERB_INTERACTIVE_UNLOCK_LOGONs.  In these, the PWSTR members of each
+// UNICODE_STRING are not actually pointers but byte offsets into the overall buffer represented
+// by the packed KERB_INTERACTIVE_UNLOCK_LOGON.  For example:
+//
+// rkiulIn.Logon.LogonDomainName.Length = 14                                    -> Length is in bytes, not characters
+// rkiulIn.Logon.LogonDomainName.Buffer = sizeof(KERB_INTERACTIVE_UNLOCK_LOGON) -> LogonDomainName begins immediately
+//                                                                              after the KERB_... struct in the buffer
+// rkiulIn.Logon.UserName.Length = 10
+// rkiulIn.Logon.UserName.Buffer = sizeof(KERB_INTERACTIVE_UNLOCK_LOGON) + 14   -> UNICODE_STRINGS are NOT null-terminated
+//
+// rkiulIn.Logon.Password.Length = 16
+// rkiulIn.Logon.Password.Buffer = sizeof(KERB_INTERACTIVE_UNLOCK_LOGON) + 14 + 10
+//
+// THere's more information on this at:
+// http://msdn.microsoft.com/msdnmag/issues/05/06/SecurityBriefs/#void
+//
+// Packing is split in two phases so that callers packing many credentials can avoid the
+// allocator: KerbInteractiveUnlockLogonGetPackedSize returns the exact (overflow-checked)
+// size, and KerbInteractiveUnlockLogonPackToBuffer writes the packed struct into a buffer
+// the caller provides.  KerbInteractiveUnlockLogonPack wraps both with one allocation from an
+// Allocator, CoTaskMemAlloc unless the caller passes another.
+// The Buffer offsets are pointer sized, so the layout depends on the bitness of the
+// consumer; see logonlayout.h.
+//
+
+HRESULT KerbInteractiveUnlockLogonGetPackedSize(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _Out_ DWORD *pcb
+    )
+{
+    return PackedLogonGetPackedSizeT<KerbLayoutNative>(rkiulIn, pcb);
+}
+
+//
+// Packs rkiulIn into rgb, a buffer owned by the caller (stack, arena, pool...).  No memory is
+// allocated.  cb must be at least the size returned by KerbInteractiveUnlockLogonGetPackedSize.
+// The packing itself is done by the engine in logonlayout.h, which can also target the other
+// bitness.
+//
+HRESULT KerbInteractiveUnlockLogonPackToBuffer(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _Out_writes_bytes_to_(cb, *pcbWritten) BYTE *rgb,
+    _In_ DWORD cb,
+    _Out_ DWORD *pcbWritten
+    )
+{
+    return PackedLogonPackToBufferT<KerbLayoutNative>(rkiulIn, rgb, cb, pcbWritten);
+}
+
+HRESULT KerbInteractiveUnlockLogonPack(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    )
+{
+    return PackedLogonPackT<KerbLayoutNative>(rkiulIn, pallocator, prgb, pcb);
+}
+
+HRESULT KerbInteractiveUnlockLogonPack(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    )
+{
+    return KerbInteractiveUnlockLogonPack(rkiulIn, GetCoTaskMemAllocator(), prgb, pcb);
+}
+
+//
+// Packs a KERB_CERTIFICATE_LOGON (smart card logon) the same way.  The CspData bytes follow the
+// three strings and CspData holds their offset.
+//
+HRESULT KerbCertificateLogonPack(
+    _In_ const KERB_CERTIFICATE_LOGON &rkclIn,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    )
+{
+    return PackedLogonPackT<KerbCertificateLayoutNative>(rkclIn, pallocator, prgb, pcb);
+}
+
+HRESULT KerbCertificateLogonPack(
+    _In_ const KERB_CERTIFICATE_LOGON &rkclIn,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    )
+{
+    return KerbCertificateLogonPack(rkclIn, GetCoTaskMemAllocator(), prgb, pcb);
+}
+
+//
+// Packs a MSV1_0_INTERACTIVE_LOGON the same way.
+//
+HRESULT Msv1_0InteractiveLogonPack(
+    _In_ const MSV1_0_INTERACTIVE_LOGON &rmilIn,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    )
+{
+    return PackedLogonPackT<Msv1_0LayoutNative>(rmilIn, pallocator, prgb, pcb);
+}
+
+HRESULT Msv1_0InteractiveLogonPack(
+    _In_ const MSV1_0_INTERACTIVE_LOGON &rmilIn,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    )
+{
+    return Msv1_0InteractiveLogonPack(rmilIn, GetCoTaskMemAllocator(), prgb, pcb);
+}
+
+//
+// Batch packing.  Phase one initializes every entry, sizes its blob and lays the blobs out
+// back to back in the arena, each aligned for a KERB_INTERACTIVE_UNLOCK_LOGON so it can be used
+// in place; it keeps the string lengths it found with each blob.  Phase two packs the blobs from
+// those lengths; since every blob already has its own slice of the arena, chunks of entries can
+// be packed by several thread pool callbacks at once.
+//
+
+#define KERB_LOGON_BATCH_CHUNK 64
+
+struct KERB_LOGON_BATCH_CONTEXT
+{
+    const KERB_LOGON_BATCH_ENTRY *rgEntries;
+    KERB_LOGON_BATCH_BLOB        *rgBlobs;
+    BYTE                         *rgbArena;
+    DWORD                         cEntries;
+    volatile LONG                 lNextChunk;
+    volatile LONG                 hrFailure;
+};
+
+static void _UnicodeStringInitWithLength(
+    _In_ PWSTR pwz,
+    _In_ USHORT cb,
+    _Out_ UNICODE_STRING *pus
+    )
+{
+    pus->Length = cb;
+    pus->MaximumLength = cb;
+    pus->Buffer = pwz;
+}
+
+//
+// Rebuilds, for the packing phase, the weak references that phase one built from rEntry.  The
+// string lengths come from rBlob, where phase one left them, so no string is scanned twice.
+//
+static HRESULT _KerbLogonBatchEntryFromBlob(
+    _In_ const KERB_LOGON_BATCH_ENTRY &rEntry,
+    _In_ const KERB_LOGON_BATCH_BLOB &rBlob,
+    _Out_ KERB_INTERACTIVE_UNLOCK_LOGON *pkiul
+    )
+{
+    ZeroMemory(pkiul, sizeof(*pkiul));
+
+    KERB_INTERACTIVE_LOGON *pkil = &pkiul->Logon;
+    _UnicodeStringInitWithLength(rEntry.pwzDomain, rBlob.cbDomain, &pkil->LogonDomainName);
+    _UnicodeStringInitWithLength(rEntry.pwzUsername, rBlob.cbUsername, &pkil->UserName);
+    _UnicodeStringInitWithLength(rEntry.pwzPassword, rBlob.cbPassword, &pkil->Password);
+
+    return _KerbLogonSubmitTypeFromUsageScenario(rEntry.cpus, &pkil->MessageType);
+}
+
+//
+// Packs chunks of the batch until none are left.  Called on the calling thread and on each
+// thread pool callback; the first failure is kept in pctx->hrFailure.
+//
+static void _KerbLogonBatchPackChunks(_Inout_ KERB_LOGON_BATCH_CONTEXT *pctx)
+{
+    for (;;)
+    {
+        DWORD iFirst = (DWORD)(InterlockedIncrement(&pctx->lNextChunk) - 1) * KERB_LOGON_BATCH_CHUNK;
+        if (iFirst >= pctx->cEntries || FAILED(pctx->hrFailure))
+        {
+            break;
+        }
+
+        DWORD iEnd = min(iFirst + KERB_LOGON_BATCH_CHUNK, pctx->cEntries);
+        for (DWORD i = iFirst; i < iEnd; i++)
+        {
+            KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+            DWORD cbWritten;
+            HRESULT hr = _KerbLogonBatchEntryFromBlob(pctx->rgEntries[i], pctx->rgBlobs[i], &kiul);
+            if (SUCCEEDED(hr))
+            {
+                hr = KerbInteractiveUnlockLogonPackToBuffer(kiul, pctx->rgbArena + pctx->rgBlobs[i].dwOffset,
+                                                            pctx->rgBlobs[i].cb, &cbWritten);
+            }
+
+            if (FAILED(hr))
+            {
+                InterlockedCompareExchange(&pctx->hrFailure, hr, S_OK);
+                break;
+            }
+        }
+    }
+}
+
+static VOID CALLBACK _KerbLogonBatchWorkCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE pInstance,
+    _Inout_opt_ PVOID pvContext,
+    _Inout_ PTP_WORK pWork
+    )
+{
+    UNREFERENCED_PARAMETER(pInstance);
+    UNREFERENCED_PARAMETER(pWork);
+
+    _KerbLogonBatchPackChunks((KERB_LOGON_BATCH_CONTEXT*)pvContext);
+}
+
+//
+// Packs cEntries credentials contiguously into rgbArena.  rgBlobs receives the offset and size
+// of each blob.  Call with a NULL rgbArena to learn the arena size: that fails with
+// ERROR_INSUFFICIENT_BUFFER and sets *pcbArena.  With cThreads > 1 the packing is shared with
+// up to cThreads - 1 thread pool callbacks; the calling thread always takes part.
+//
+HRESULT KerbInteractiveUnlockLogonPackBatch(
+    _In_reads_(cEntries) const KERB_LOGON_BATCH_ENTRY *rgEntries,
+    _In_ DWORD cEntries,
+    _In_ DWORD cThreads,
+    _Out_writes_bytes_opt_(cbArena) BYTE *rgbArena,
+    _In_ DWORD cbArena,
+    _Out_writes_(cEntries) KERB_LOGON_BATCH_BLOB *rgBlobs,
+    _Out_ DWORD *pcbArena
+    )
+{
+    const DWORD cbAlign = TYPE_ALIGNMENT(KERB_INTERACTIVE_UNLOCK_LOGON);
+    DWORD cbTotal = 0;
+    HRESULT hr = S_OK;
+
+    *pcbArena = 0;
+
+    for (DWORD i = 0; SUCCEEDED(hr) && i < cEntries; i++)
+    {
+        KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+        DWORD cb;
+        hr = KerbInteractiveUnlockLogonInit(rgEntries[i].pwzDomain, rgEntries[i].pwzUsername, rgEntries[i].pwzPassword,
+                                            rgEntries[i].cpus, &kiul);
+        if (SUCCEEDED(hr))
+        {
+            hr = KerbInteractiveUnlockLogonGetPackedSize(kiul, &cb);
+            if (SUCCEEDED(hr))
+            {
+                rgBlobs[i].dwOffset = cbTotal;
+                rgBlobs[i].cb = cb;
+                rgBlobs[i].cbDomain = kiul.Logon.LogonDomainName.Length;
+                rgBlobs[i].cbUsername = kiul.Logon.UserName.Length;
+                rgBlobs[i].cbPassword = kiul.Logon.Password.Length;
+                hr = DWordAdd(cbTotal, cb, &cbTotal);
+                if (SUCCEEDED(hr))
+                {
+                    hr = DWordAdd(cbTotal, (cbAlign - cbTotal % cbAlign) % cbAlign, &cbTotal);
+                }
+            }
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    *pcbArena = cbTotal;
+    if (rgbArena == nullptr || cbArena < cbTotal)
+    {
+        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+    }
+
+    if ((ULONG_PTR)rgbArena % cbAlign)
+    {
+        return E_INVALIDARG;
+    }
+
+    KERB_LOGON_BATCH_CONTEXT ctx;
+    ctx.rgEntries = rgEntries;
+    ctx.rgBlobs = rgBlobs;
+    ctx.rgbArena = rgbArena;
+    ctx.cEntries = cEntries;
+    ctx.lNextChunk = 0;
+    ctx.hrFailure = S_OK;
+
+    // There's no point in more callbacks than chunks.
+    DWORD cChunks = (cEntries + KERB_LOGON_BATCH_CHUNK - 1) / KERB_LOGON_BATCH_CHUNK;
+    DWORD cCallbacks = min(cThreads, cChunks);
+    PTP_WORK pWork = (cCallbacks > 1) ? CreateThreadpoolWork(_KerbLogonBatchWorkCallback, &ctx, nullptr) : nullptr;
+
+    if (pWork)
+    {
+        for (DWORD i = 1; i < cCallbacks; i++)
+        {
+            SubmitThreadpoolWork(pWork);
+        }
+    }
+
+    _KerbLogonBatchPackChunks(&ctx);
+
+    if (pWork)
+    {
+        WaitForThreadpoolWorkCallbacks(pWork, FALSE);
+        CloseThreadpoolWork(pWork);
+    }
+
+    return ctx.hrFailure;
+}
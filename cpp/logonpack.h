@@ -0,0 +1,126 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Building and packing the logon structures GetSerialization hands to
+// LogonUI: one credential at a time, or many into one arena.  The packing
+// itself is done by the engine in logonlayout.h.
+
+#pragma once
+
+#pragma warning(push)
+#pragma warning(disable: 28251)
+#include <credentialprovider.h>
+#include <ntsecapi.h>
+#pragma warning(pop)
+
+#include <windows.h>
+#include "allocator.h"
+
+//creates a UNICODE_STRING from a NULL-terminated string
+HRESULT UnicodeStringInitWithString(
+    _In_ PWSTR pwz,
+    _Out_ UNICODE_STRING *pus
+    );
+
+//initializes a KERB_INTERACTIVE_UNLOCK_LOGON with weak references to the provided credentials
+HRESULT KerbInteractiveUnlockLogonInit(
+    _In_ PWSTR pwzDomain,
+    _In_ PWSTR pwzUsername,
+    _In_ PWSTR pwzPassword,
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _Out_ KERB_INTERACTIVE_UNLOCK_LOGON *pkiul
+    );
+
+//computes the exact size of the packed buffer for the credentials
+HRESULT KerbInteractiveUnlockLogonGetPackedSize(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _Out_ DWORD *pcb
+    );
+
+//packages the credentials into a caller-provided buffer, without allocating (see logonlayout.h for other layouts)
+HRESULT KerbInteractiveUnlockLogonPackToBuffer(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _Out_writes_bytes_to_(cb, *pcbWritten) BYTE *rgb,
+    _In_ DWORD cb,
+    _Out_ DWORD *pcbWritten
+    );
+
+//packages the credentials into the buffer that the system expects
+HRESULT KerbInteractiveUnlockLogonPack(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    );
+
+//same as above, but the buffer comes from pallocator
+HRESULT KerbInteractiveUnlockLogonPack(
+    _In_ const KERB_INTERACTIVE_UNLOCK_LOGON &rkiulIn,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    );
+
+//packages a KERB_CERTIFICATE_LOGON into the buffer that the system expects
+HRESULT KerbCertificateLogonPack(
+    _In_ const KERB_CERTIFICATE_LOGON &rkclIn,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    );
+
+//same as above, but the buffer comes from pallocator
+HRESULT KerbCertificateLogonPack(
+    _In_ const KERB_CERTIFICATE_LOGON &rkclIn,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    );
+
+//packages a MSV1_0_INTERACTIVE_LOGON into the buffer that the system expects
+HRESULT Msv1_0InteractiveLogonPack(
+    _In_ const MSV1_0_INTERACTIVE_LOGON &rmilIn,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    );
+
+//same as above, but the buffer comes from pallocator
+HRESULT Msv1_0InteractiveLogonPack(
+    _In_ const MSV1_0_INTERACTIVE_LOGON &rmilIn,
+    _In_ Allocator *pallocator,
+    _Outptr_result_bytebuffer_(*pcb) BYTE **prgb,
+    _Out_ DWORD *pcb
+    );
+
+//one credential for KerbInteractiveUnlockLogonPackBatch
+struct KERB_LOGON_BATCH_ENTRY
+{
+    PWSTR pwzDomain;
+    PWSTR pwzUsername;
+    PWSTR pwzPassword;
+    CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus;
+};
+
+//where KerbInteractiveUnlockLogonPackBatch put one packed credential in the arena
+struct KERB_LOGON_BATCH_BLOB
+{
+    DWORD dwOffset;
+    DWORD cb;
+    USHORT cbDomain;        // the lengths of the packed strings, in bytes
+    USHORT cbUsername;
+    USHORT cbPassword;
+};
+
+//packages many credentials contiguously into one caller-provided arena, optionally on several threads
+HRESULT KerbInteractiveUnlockLogonPackBatch(
+    _In_reads_(cEntries) const KERB_LOGON_BATCH_ENTRY *rgEntries,
+    _In_ DWORD cEntries,
+    _In_ DWORD cThreads,
+    _Out_writes_bytes_opt_(cbArena) BYTE *rgbArena,
+    _In_ DWORD cbArena,
+    _Out_writes_(cEntries) KERB_LOGON_BATCH_BLOB *rgBlobs,
+    _Out_ DWORD *pcbArena
+    );
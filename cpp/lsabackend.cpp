@@ -0,0 +1,91 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The process-wide authentication package cache, and the backend that
+// stands in for the LSA.  Nothing here calls the LSA, so it builds for the
+// tests too; the LSA backend is in lsauntrustedbackend.cpp.
+
+#include "lsabackend.h"
+
+#define SECURITY_WIN32
+#include <security.h>
+
+HRESULT LocalLsaBackend::LookupAuthenticationPackage(_In_ PCSTR pszPackageName, _Out_ ULONG *pulAuthPackage)
+{
+    UNREFERENCED_PARAMETER(pszPackageName);
+
+    InterlockedIncrement(&_cLookups);
+    if (_dwLatency)
+    {
+        Sleep(_dwLatency);
+    }
+    *pulAuthPackage = _ulAuthPackage;
+    return S_OK;
+}
+
+struct AUTH_PACKAGE_CACHE_LOOKUP
+{
+    AUTH_PACKAGE_CACHE *pcache;
+    LsaBackend         *pbackend;
+    HRESULT             hr;
+};
+
+static BOOL CALLBACK _AuthPackageCacheInitOnce(
+    _Inout_ PINIT_ONCE pInitOnce,
+    _Inout_opt_ PVOID pvParameter,
+    _Outptr_opt_result_maybenull_ PVOID *ppvContext
+    )
+{
+    UNREFERENCED_PARAMETER(pInitOnce);
+    UNREFERENCED_PARAMETER(ppvContext);
+
+    AUTH_PACKAGE_CACHE_LOOKUP *plookup = (AUTH_PACKAGE_CACHE_LOOKUP*)pvParameter;
+    AUTH_PACKAGE_CACHE *pcache = plookup->pcache;
+
+    // INIT_ONCE publishes ulAuthPackage to every later caller once this returns TRUE.
+    plookup->hr = plookup->pbackend->LookupAuthenticationPackage(pcache->pszPackageName, &pcache->ulAuthPackage);
+    return SUCCEEDED(plookup->hr);
+}
+
+HRESULT AuthPackageCacheLookup(
+    _Inout_ AUTH_PACKAGE_CACHE *pcache,
+    _In_ LsaBackend *pbackend,
+    _Out_ ULONG *pulAuthPackage
+    )
+{
+    *pulAuthPackage = 0;
+
+    AUTH_PACKAGE_CACHE_LOOKUP lookup = { pcache, pbackend, S_OK };
+    HRESULT hr;
+    if (InitOnceExecuteOnce(&pcache->initOnce, _AuthPackageCacheInitOnce, &lookup, nullptr))
+    {
+        *pulAuthPackage = pcache->ulAuthPackage;
+        hr = S_OK;
+    }
+    else
+    {
+        // Either our lookup failed, or InitOnceExecuteOnce itself did.
+        hr = FAILED(lookup.hr) ? lookup.hr : HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return hr;
+}
+
+static AUTH_PACKAGE_CACHE s_negotiateAuthPackageCache = AUTH_PACKAGE_CACHE_INIT(NEGOSSP_NAME_A);
+
+//
+// Retrieves the 'negotiate' AuthPackage from the LSA. In this case, Kerberos
+// For more information on auth packages see this msdn page:
+// http://msdn.microsoft.com/library/default.asp?url=/library/en-us/secauthn/security/msv1_0_lm20_logon.asp
+//
+// Only the first call goes to the LSA; the ID is cached for the life of the process.
+//
+HRESULT RetrieveNegotiateAuthPackage(_Out_ ULONG *pulAuthPackage)
+{
+    return AuthPackageCacheLookup(&s_negotiateAuthPackageCache, GetDefaultLsaBackend(), pulAuthPackage);
+}
@@ -0,0 +1,87 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// LsaBackend hides the LSA round trip behind RetrieveNegotiateAuthPackage,
+// and AUTH_PACKAGE_CACHE remembers its answer for the life of the process.
+
+#pragma once
+
+#include <windows.h>
+
+class LsaBackend
+{
+public:
+    // Looks up the ID of the authentication package called pszPackageName.
+    virtual HRESULT LookupAuthenticationPackage(
+        _In_ PCSTR pszPackageName,
+        _Out_ ULONG *pulAuthPackage
+        ) = 0;
+
+protected:
+    ~LsaBackend()
+    {
+    }
+};
+
+// The backend that talks to the LSA over an untrusted connection.
+LsaBackend *GetDefaultLsaBackend();
+
+//
+// Stand-in backend that answers every lookup with a fixed package ID after sleeping for
+// dwLatency milliseconds, so the cost of uncached lookups can be measured without an LSA.
+//
+class LocalLsaBackend : public LsaBackend
+{
+public:
+    LocalLsaBackend(_In_ ULONG ulAuthPackage, _In_ DWORD dwLatency) :
+        _ulAuthPackage(ulAuthPackage),
+        _dwLatency(dwLatency),
+        _cLookups(0)
+    {
+    }
+
+    HRESULT LookupAuthenticationPackage(_In_ PCSTR pszPackageName, _Out_ ULONG *pulAuthPackage);
+
+    LONG GetLookups() const
+    {
+        return _cLookups;
+    }
+
+private:
+    ULONG         _ulAuthPackage;
+    DWORD         _dwLatency;
+    volatile LONG _cLookups;
+};
+
+//
+// A package ID never changes for the life of the process, so it is looked up once.  The first
+// caller runs the lookup under the INIT_ONCE while concurrent callers wait for it; afterwards
+// every read is a single lock-free check of the INIT_ONCE.  A failed lookup is not cached and
+// is retried by the next caller.
+//
+// Initialize with AUTH_PACKAGE_CACHE_INIT(name) so that a cache can live in static storage.
+//
+struct AUTH_PACKAGE_CACHE
+{
+    INIT_ONCE initOnce;
+    PCSTR     pszPackageName;
+    ULONG     ulAuthPackage;
+};
+
+#define AUTH_PACKAGE_CACHE_INIT(pszPackageName) { INIT_ONCE_STATIC_INIT, (pszPackageName), 0 }
+
+HRESULT AuthPackageCacheLookup(
+    _Inout_ AUTH_PACKAGE_CACHE *pcache,
+    _In_ LsaBackend *pbackend,
+    _Out_ ULONG *pulAuthPackage
+    );
+
+//get the authentication package that will be used for our logon attempt
+HRESULT RetrieveNegotiateAuthPackage(
+    _Out_ ULONG *pulAuthPackage
+    );
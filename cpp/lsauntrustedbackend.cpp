@@ -0,0 +1,84 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The backend that looks authentication packages up in the LSA.
+
+#include "lsabackend.h"
+#include <intsafe.h>
+
+#pragma warning(push)
+#pragma warning(disable: 28251)
+#include <ntsecapi.h>
+#pragma warning(pop)
+
+//
+// This function packs the string pszSourceString in pszDestinationString
+// for use with LSA functions including LsaLookupAuthenticationPackage.
+//
+static HRESULT _LsaInitString(
+    __out PSTRING pszDestinationString,
+    __in PCSTR pszSourceString
+    )
+{
+    size_t cchLength = strlen(pszSourceString);
+    USHORT usLength;
+    HRESULT hr = SizeTToUShort(cchLength, &usLength);
+    if (SUCCEEDED(hr))
+    {
+        pszDestinationString->Buffer = (PCHAR)pszSourceString;
+        pszDestinationString->Length = usLength;
+        pszDestinationString->MaximumLength = pszDestinationString->Length+1;
+        hr = S_OK;
+    }
+    return hr;
+}
+
+class LsaUntrustedBackend : public LsaBackend
+{
+public:
+    // Opens an untrusted connection to the LSA, looks the package up and closes the connection.
+    HRESULT LookupAuthenticationPackage(_In_ PCSTR pszPackageName, _Out_ ULONG *pulAuthPackage)
+    {
+        HRESULT hr;
+        HANDLE hLsa;
+
+        NTSTATUS status = LsaConnectUntrusted(&hLsa);
+        if (SUCCEEDED(HRESULT_FROM_NT(status)))
+        {
+            ULONG ulAuthPackage;
+            LSA_STRING lsaszPackageName;
+            hr = _LsaInitString(&lsaszPackageName, pszPackageName);
+            if (SUCCEEDED(hr))
+            {
+                status = LsaLookupAuthenticationPackage(hLsa, &lsaszPackageName, &ulAuthPackage);
+                if (SUCCEEDED(HRESULT_FROM_NT(status)))
+                {
+                    *pulAuthPackage = ulAuthPackage;
+                    hr = S_OK;
+                }
+                else
+                {
+                    hr = HRESULT_FROM_NT(status);
+                }
+            }
+            LsaDeregisterLogonProcess(hLsa);
+        }
+        else
+        {
+            hr = HRESULT_FROM_NT(status);
+        }
+
+        return hr;
+    }
+};
+
+LsaBackend *GetDefaultLsaBackend()
+{
+    static LsaUntrustedBackend s_backend;
+    return &s_backend;
+}
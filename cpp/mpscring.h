@@ -0,0 +1,106 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// MpscRing is a bounded queue that any number of threads can write to and
+// one thread reads from, without locks.  The debug log and the trace each
+// keep one, which the background writer empties into their files.
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+
+//
+// Slot i starts with seq == i.  A producer claims position pos when the slot's seq == pos, by
+// moving _enqueuePos from pos to pos + 1; it fills in the entry, then publishes it by setting
+// seq = pos + 1.  The consumer takes the slot once seq == pos + 1, and hands it back for the
+// next lap around the ring by setting seq = pos + cSlots.  Producers never wait for each other
+// or for the consumer: if the slot they need hasn't been read yet, the ring is full.
+//
+template <typename T, size_t cSlots>
+class MpscRing
+{
+    // A power of two, so a position maps to its slot with a mask.
+    static_assert(cSlots && (cSlots & (cSlots - 1)) == 0, "cSlots must be a power of two");
+
+public:
+    MpscRing() :
+        _enqueuePos(0),
+        _dequeuePos(0)
+    {
+        for (size_t i = 0; i < cSlots; i++)
+        {
+            _rgSlots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Claims the next entry for the calling producer, or returns NULL if the ring is full.  The
+    // entry must be handed to EndEnqueue, with the same pos, once it has been filled in.
+    T *BeginEnqueue(_Out_ size_t *ppos)
+    {
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            SLOT *pslot = &_rgSlots[pos & (cSlots - 1)];
+            size_t seq = pslot->seq.load(std::memory_order_acquire);
+            INT_PTR iDiff = (INT_PTR)seq - (INT_PTR)pos;
+
+            if (iDiff == 0)
+            {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    *ppos = pos;
+                    return &pslot->entry;
+                }
+            }
+            else if (iDiff < 0)
+            {
+                *ppos = 0;
+                return NULL;
+            }
+            else
+            {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void EndEnqueue(_In_ size_t pos)
+    {
+        _rgSlots[pos & (cSlots - 1)].seq.store(pos + 1, std::memory_order_release);
+    }
+
+    // The consumer's side: the oldest published entry, or NULL if there is none.  The entry
+    // must be handed back with EndDequeue before the next BeginDequeue.
+    const T *BeginDequeue() const
+    {
+        const SLOT *pslot = &_rgSlots[_dequeuePos & (cSlots - 1)];
+        return (pslot->seq.load(std::memory_order_acquire) == _dequeuePos + 1) ? &pslot->entry : NULL;
+    }
+
+    void EndDequeue()
+    {
+        _rgSlots[_dequeuePos & (cSlots - 1)].seq.store(_dequeuePos + cSlots, std::memory_order_release);
+        _dequeuePos++;
+    }
+
+private:
+    MpscRing(const MpscRing&);
+    MpscRing& operator=(const MpscRing&);
+
+    struct SLOT
+    {
+        std::atomic<size_t> seq;
+        T                   entry;
+    };
+
+    SLOT                _rgSlots[cSlots];
+    std::atomic<size_t> _enqueuePos;
+    size_t              _dequeuePos;    // only touched by the consumer
+};
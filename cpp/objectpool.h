@@ -0,0 +1,157 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// ObjectPool keeps the memory of freed COM objects of one class on a
+// lock-free list and hands it out again on the next new, so that once a
+// LogonUI session has warmed up, creating class factories, providers and
+// credentials no longer calls the heap.  A class opts in by deriving from
+// PooledObject<itself>.
+
+#pragma once
+
+#include <windows.h>
+#include <malloc.h>
+#include <new>
+
+struct OBJECT_POOL_STATS
+{
+    LONG cHits;         // allocations served from the free list
+    LONG cMisses;       // allocations that had to go to the heap
+    LONG cReturns;      // frees kept on the free list
+    LONG cReleases;     // frees given back to the heap because the list was full
+};
+
+template <typename T>
+class ObjectPool
+{
+public:
+    static const SIZE_T c_cbCacheLine = 64;
+
+    // Every block is a whole number of cache lines, on a cache line boundary, so two objects
+    // never share one.
+    static const SIZE_T c_cbBlock = (sizeof(T) + c_cbCacheLine - 1) & ~(c_cbCacheLine - 1);
+
+    // The most blocks kept on the free list; anything beyond goes back to the heap.
+    static const USHORT c_cMaxFree = 32;
+
+    // The pool for T.  It is created on first use, and its destructor gives the free list back
+    // to the heap when the DLL unloads.
+    static ObjectPool &Get()
+    {
+        static ObjectPool s_pool;
+        return s_pool;
+    }
+
+    void *Alloc(_In_ size_t cb)
+    {
+        if (cb > c_cbBlock)
+        {
+            return NULL;
+        }
+
+        void *pv = InterlockedPopEntrySList(&_head);
+        if (pv)
+        {
+            InterlockedIncrement(&_stats.cHits);
+        }
+        else
+        {
+            InterlockedIncrement(&_stats.cMisses);
+            pv = _aligned_malloc(c_cbBlock, c_cbCacheLine);
+        }
+        return pv;
+    }
+
+    //
+    // The depth check and the push are not one atomic step, so under contention the list can
+    // briefly hold a few more than c_cMaxFree blocks; the limit only has to bound the memory
+    // kept, not be exact.
+    //
+    void Free(_In_opt_ void *pv)
+    {
+        if (pv)
+        {
+            if (QueryDepthSList(&_head) < c_cMaxFree)
+            {
+                InterlockedPushEntrySList(&_head, (PSLIST_ENTRY)pv);
+                InterlockedIncrement(&_stats.cReturns);
+            }
+            else
+            {
+                _aligned_free(pv);
+                InterlockedIncrement(&_stats.cReleases);
+            }
+        }
+    }
+
+    // A snapshot of the counters; each one is read atomically, but not all of them together.
+    // DllCanUnloadNow logs them.
+    void GetStats(_Out_ OBJECT_POOL_STATS *pstats) const
+    {
+        pstats->cHits = _stats.cHits;
+        pstats->cMisses = _stats.cMisses;
+        pstats->cReturns = _stats.cReturns;
+        pstats->cReleases = _stats.cReleases;
+    }
+
+private:
+    ObjectPool()
+    {
+        InitializeSListHead(&_head);
+        ZeroMemory(&_stats, sizeof(_stats));
+    }
+
+    ~ObjectPool()
+    {
+        PSLIST_ENTRY pEntry = InterlockedFlushSList(&_head);
+        while (pEntry)
+        {
+            PSLIST_ENTRY pNext = pEntry->Next;
+            _aligned_free(pEntry);
+            pEntry = pNext;
+        }
+    }
+
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator=(const ObjectPool&);
+
+    //
+    // Every Alloc and Free writes both, but the counters are written after the list operation, so
+    // with the two on one cache line a thread bumping a counter would take the line away from the
+    // next thread's compare-exchange on the list head.  Each gets a cache line of its own.
+    //
+    alignas(c_cbCacheLine) SLIST_HEADER      _head;     // blocks are cache line aligned, which satisfies
+                                                        // MEMORY_ALLOCATION_ALIGNMENT for the list entries
+    alignas(c_cbCacheLine) OBJECT_POOL_STATS _stats;    // only ever updated with Interlocked operations
+};
+
+//
+// Gives T class-specific new (std::nothrow) and delete that use ObjectPool<T>.  Every object in
+// this DLL is created with new (std::nothrow), so that is the only form provided; a plain new
+// of a pooled class does not compile.
+//
+template <typename T>
+class PooledObject
+{
+public:
+    static void *operator new(size_t cb, const std::nothrow_t&) throw()
+    {
+        return ObjectPool<T>::Get().Alloc(cb);
+    }
+
+    static void operator delete(void *pv)
+    {
+        ObjectPool<T>::Get().Free(pv);
+    }
+
+    // Used if the constructor throws after new (std::nothrow) succeeded.
+    static void operator delete(void *pv, const std::nothrow_t&) throw()
+    {
+        ObjectPool<T>::Get().Free(pv);
+    }
+};
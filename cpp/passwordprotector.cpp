@@ -0,0 +1,244 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The password pipeline, and the protector that stands in for CredProtect.
+// Nothing here calls into the Cred* APIs, so it builds for the tests too;
+// the CredProtect protector is in credpasswordprotector.cpp.
+
+#include "passwordprotector.h"
+#include "utf16.h"
+
+//
+// What the password pipeline has learned about a password before writing anything: its length,
+// whether it still needs protecting and how much room the result will (probably) need.
+//
+struct PASSWORD_PLAN
+{
+    PCWSTR pwz;
+    DWORD  cch;
+    bool   fProtect;
+    DWORD  cchEstimate;
+};
+
+//
+// Reads pwzPassword in place to fill in pplan.  Nothing is copied: the scan finds the length and
+// the protector inspects the caller's string directly.
+//
+static HRESULT _PasswordPlan(
+    _In_ PasswordProtector *pprotector,
+    _In_opt_ PCWSTR pwzPassword,
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _Out_ PASSWORD_PLAN *pplan
+    )
+{
+    ZeroMemory(pplan, sizeof(*pplan));
+
+    pplan->pwz = (pwzPassword) ? pwzPassword : L"";
+
+    size_t cch;
+    HRESULT hr = Utf16ScanString(pplan->pwz, UNICODE_STRING_MAX_CHARS, &cch);
+    if (SUCCEEDED(hr))
+    {
+        pplan->cch = (DWORD)cch;
+
+        // Empty passwords do not need to be encrypted.  Passwords should not be encrypted in the
+        // CPUS_CREDUI scenario either; we cannot know if our caller expects or can handle an
+        // encrypted password.
+        if (pplan->cch && CPUS_CREDUI != cpus)
+        {
+            // If the password is already encrypted, we should not encrypt it again.
+            // An encrypted password may be received through SetSerialization in the
+            // CPUS_LOGON scenario during a Terminal Services connection, for instance.
+            bool fProtected;
+            hr = pprotector->IsProtected(pplan->pwz, pplan->cch, &fProtected);
+            if (SUCCEEDED(hr))
+            {
+                pplan->fProtect = !fProtected;
+            }
+        }
+
+        pplan->cchEstimate = (pplan->fProtect) ? pprotector->EstimateProtectedCch(pplan->cch) : pplan->cch + 1;
+    }
+
+    return hr;
+}
+
+//
+// Writes the planned password into pwzOut: the protector's output when it needs protecting,
+// otherwise a straight copy.  Either way this is the only copy of the password that is made.
+//
+static HRESULT _PasswordEmit(
+    _In_ PasswordProtector *pprotector,
+    _In_ const PASSWORD_PLAN &plan,
+    _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+    _In_ DWORD cchOut,
+    _Out_ DWORD *pcchOut
+    )
+{
+    HRESULT hr;
+
+    if (plan.fProtect)
+    {
+        hr = pprotector->Protect(plan.pwz, plan.cch, pwzOut, cchOut, pcchOut);
+    }
+    else
+    {
+        *pcchOut = plan.cch + 1;
+        if (cchOut < plan.cch + 1)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+        }
+        else
+        {
+            CopyMemory(pwzOut, plan.pwz, (plan.cch + 1) * sizeof(wchar_t));
+            hr = S_OK;
+        }
+    }
+
+    return hr;
+}
+
+//
+// If pwzPassword should be encrypted, write it encrypted by pprotector into pwzOut.
+//
+// If not, just copy it there.
+//
+// pwzOut holds cchOut characters.  If that is too small, returns ERROR_INSUFFICIENT_BUFFER with
+// *pcchOut set to the length needed; on success *pcchOut is the length written.  Both counts
+// include the terminator.
+//
+HRESULT ProtectIfNecessaryAndCopyPasswordToBuffer(
+    _In_ PasswordProtector *pprotector,
+    _In_opt_ PCWSTR pwzPassword,
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+    _In_ DWORD cchOut,
+    _Out_ DWORD *pcchOut
+    )
+{
+    *pcchOut = 0;
+
+    PASSWORD_PLAN plan;
+    HRESULT hr = _PasswordPlan(pprotector, pwzPassword, cpus, &plan);
+    if (SUCCEEDED(hr))
+    {
+        hr = _PasswordEmit(pprotector, plan, pwzOut, cchOut, pcchOut);
+    }
+
+    return hr;
+}
+
+//
+// If pwzPassword should be encrypted, return a copy encrypted by pprotector.
+//
+// If not, just return a copy.
+//
+// The copy comes from pallocator.  It is sized from the plan, so the protector is normally
+// called exactly once; should its estimate fall short, the output is reallocated at the size
+// it reports and Protect runs again.
+//
+HRESULT ProtectIfNecessaryAndCopyPassword(
+    _In_ PasswordProtector *pprotector,
+    _In_ PCWSTR pwzPassword,
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _In_ Allocator *pallocator,
+    _Outptr_result_nullonfailure_ PWSTR *ppwzProtectedPassword
+    )
+{
+    *ppwzProtectedPassword = nullptr;
+
+    PASSWORD_PLAN plan;
+    HRESULT hr = _PasswordPlan(pprotector, pwzPassword, cpus, &plan);
+    if (SUCCEEDED(hr))
+    {
+        DWORD cch = plan.cchEstimate;
+        for (int iAttempt = 0; iAttempt < 2; iAttempt++)
+        {
+            void *pv;
+            hr = pallocator->Alloc(cch * sizeof(wchar_t), &pv);
+            if (FAILED(hr))
+            {
+                break;
+            }
+
+            DWORD cchNeeded;
+            hr = _PasswordEmit(pprotector, plan, (PWSTR)pv, cch, &cchNeeded);
+            if (SUCCEEDED(hr))
+            {
+                *ppwzProtectedPassword = (PWSTR)pv;
+                break;
+            }
+
+            pallocator->Free(pv);
+            if (hr != HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER) || cchNeeded <= cch)
+            {
+                break;
+            }
+            cch = cchNeeded;
+        }
+    }
+
+    return hr;
+}
+
+
+#define LOCAL_PROTECTOR_TAG     L"@@L"
+#define LOCAL_PROTECTOR_CCH_TAG 3
+
+HRESULT LocalPasswordProtector::IsProtected(_In_reads_(cch + 1) PCWSTR pwz, _In_ DWORD cch, _Out_ bool *pfProtected)
+{
+    *pfProtected = (cch >= LOCAL_PROTECTOR_CCH_TAG) &&
+                   (0 == memcmp(pwz, LOCAL_PROTECTOR_TAG, LOCAL_PROTECTOR_CCH_TAG * sizeof(wchar_t)));
+    return S_OK;
+}
+
+DWORD LocalPasswordProtector::EstimateProtectedCch(_In_ DWORD cch)
+{
+    return LOCAL_PROTECTOR_CCH_TAG + 4 * cch + 1;
+}
+
+// Tags the password and writes each character, mixed with its index, as four hex digits.
+HRESULT LocalPasswordProtector::Protect(
+    _In_reads_(cch + 1) PCWSTR pwz,
+    _In_ DWORD cch,
+    _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+    _In_ DWORD cchOut,
+    _Out_ DWORD *pcchOut
+    )
+{
+    static const wchar_t c_rgwchHex[] = L"0123456789ABCDEF";
+
+    _cProtectCalls++;
+
+    // The estimate is exact here, but one a derived class makes need not be: size with this one.
+    HRESULT hr;
+    DWORD cchNeeded = LocalPasswordProtector::EstimateProtectedCch(cch);
+    if (cchOut < cchNeeded)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+    }
+    else
+    {
+        CopyMemory(pwzOut, LOCAL_PROTECTOR_TAG, LOCAL_PROTECTOR_CCH_TAG * sizeof(wchar_t));
+
+        PWSTR pwch = pwzOut + LOCAL_PROTECTOR_CCH_TAG;
+        for (DWORD i = 0; i < cch; i++)
+        {
+            WORD w = (WORD)(pwz[i] ^ 0xA5A5 ^ i);
+            *pwch++ = c_rgwchHex[(w >> 12) & 0xF];
+            *pwch++ = c_rgwchHex[(w >> 8) & 0xF];
+            *pwch++ = c_rgwchHex[(w >> 4) & 0xF];
+            *pwch++ = c_rgwchHex[w & 0xF];
+        }
+        *pwch = L'\0';
+        hr = S_OK;
+    }
+    *pcchOut = cchNeeded;
+
+    return hr;
+}
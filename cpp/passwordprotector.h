@@ -0,0 +1,100 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// PasswordProtector abstracts the CredIsProtected/CredProtect pair so the
+// password pipeline can read the caller's password in place and protect it
+// straight into a buffer of known size.
+
+#pragma once
+
+#include <windows.h>
+#include <credentialprovider.h>
+#include "allocator.h"
+
+class PasswordProtector
+{
+public:
+    // Reports whether the cch characters at pwz are already protected.  As with all the methods
+    // here, pwz[cch] must be the terminator and pwz is only read.
+    virtual HRESULT IsProtected(
+        _In_reads_(cch + 1) PCWSTR pwz,
+        _In_ DWORD cch,
+        _Out_ bool *pfProtected
+        ) = 0;
+
+    // Upper estimate of the protected length (including the terminator) of a password of
+    // cch characters.  Sizing the output with it lets Protect succeed on the first call.
+    virtual DWORD EstimateProtectedCch(_In_ DWORD cch) = 0;
+
+    // Protects the cch characters at pwz into pwzOut, which holds cchOut characters.  If that is
+    // too small, returns ERROR_INSUFFICIENT_BUFFER and sets *pcchOut to the length needed.
+    virtual HRESULT Protect(
+        _In_reads_(cch + 1) PCWSTR pwz,
+        _In_ DWORD cch,
+        _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+        _In_ DWORD cchOut,
+        _Out_ DWORD *pcchOut
+        ) = 0;
+
+protected:
+    ~PasswordProtector()
+    {
+    }
+};
+
+// The CredProtect backed protector, the one the helpers use unless told otherwise.
+PasswordProtector *GetDefaultPasswordProtector();
+
+//
+// Deterministic stand-in for CredProtect, for exercising the pipeline without an interactive
+// logon session.  It only tags and scrambles the password; it is NOT protection.
+//
+class LocalPasswordProtector : public PasswordProtector
+{
+public:
+    LocalPasswordProtector() : _cProtectCalls(0)
+    {
+    }
+
+    HRESULT IsProtected(_In_reads_(cch + 1) PCWSTR pwz, _In_ DWORD cch, _Out_ bool *pfProtected);
+    DWORD EstimateProtectedCch(_In_ DWORD cch);
+    HRESULT Protect(
+        _In_reads_(cch + 1) PCWSTR pwz,
+        _In_ DWORD cch,
+        _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+        _In_ DWORD cchOut,
+        _Out_ DWORD *pcchOut
+        );
+
+    DWORD GetProtectCalls() const
+    {
+        return _cProtectCalls;
+    }
+
+private:
+    DWORD _cProtectCalls;
+};
+
+//encrypt a password with pprotector (if necessary) straight into pwzOut; if not, just copy it there
+HRESULT ProtectIfNecessaryAndCopyPasswordToBuffer(
+    _In_ PasswordProtector *pprotector,
+    _In_opt_ PCWSTR pwzPassword,
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+    _In_ DWORD cchOut,
+    _Out_ DWORD *pcchOut
+    );
+
+//encrypt a password with pprotector (if necessary) into a copy from pallocator; if not, just copy it
+HRESULT ProtectIfNecessaryAndCopyPassword(
+    _In_ PasswordProtector *pprotector,
+    _In_ PCWSTR pwzPassword,
+    _In_ CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
+    _In_ Allocator *pallocator,
+    _Outptr_result_nullonfailure_ PWSTR *ppwzProtectedPassword
+    );
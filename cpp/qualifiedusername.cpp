@@ -0,0 +1,162 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Parsing and formatting of qualified user names.
+
+#include "qualifiedusername.h"
+#include "utf16.h"
+
+//
+// Splits pwzQualifiedUserName into views over the string itself; nothing is allocated or copied.
+// One pass over the name finds its length along with the first '\' and the last '@':
+//
+//   DOMAIN\user        Domain = "DOMAIN", UserName = "user" (the user part may contain '@')
+//   user@domain.tld    Domain = "domain.tld", UserName = "user"
+//   user               Domain is empty, UserName = "user"
+//
+// A UPN is split at its last '@', since only the suffix is restricted.  A leading or trailing
+// '@' does not make a UPN, so such names are taken as plain user names.  An empty DOMAIN part is
+// allowed (the logon then uses the default domain), an empty user name is not.
+//
+HRESULT QualifiedUserNameParse(
+    _In_ PCWSTR pwzQualifiedUserName,
+    _Out_ QUALIFIED_USER_NAME_VIEW *pview
+    )
+{
+    ZeroMemory(pview, sizeof(*pview));
+
+    size_t cch;
+    size_t ichWhack;
+    size_t ichAt;
+    HRESULT hr = Utf16ScanStringForChars(pwzQualifiedUserName, UNICODE_STRING_MAX_CHARS, L'\\', L'@', &cch, &ichWhack, &ichAt);
+    if (SUCCEEDED(hr))
+    {
+        // The scan stops at UNICODE_STRING_MAX_CHARS, so every count below fits in a USHORT.
+        if (ichWhack != UTF16_NOT_FOUND)
+        {
+            pview->Form = QUNF_DOMAIN_USERNAME;
+            pview->Domain.pwch = pwzQualifiedUserName;
+            pview->Domain.cch = (USHORT)ichWhack;
+            pview->UserName.pwch = pwzQualifiedUserName + ichWhack + 1;
+            pview->UserName.cch = (USHORT)(cch - ichWhack - 1);
+        }
+        else if (ichAt != UTF16_NOT_FOUND && ichAt != 0 && ichAt != cch - 1)
+        {
+            pview->Form = QUNF_UPN;
+            pview->Domain.pwch = pwzQualifiedUserName + ichAt + 1;
+            pview->Domain.cch = (USHORT)(cch - ichAt - 1);
+            pview->UserName.pwch = pwzQualifiedUserName;
+            pview->UserName.cch = (USHORT)ichAt;
+        }
+        else
+        {
+            pview->Form = QUNF_USERNAME;
+            pview->Domain.pwch = pwzQualifiedUserName + cch;
+            pview->UserName.pwch = pwzQualifiedUserName;
+            pview->UserName.cch = (USHORT)cch;
+        }
+
+        if (0 == pview->UserName.cch)
+        {
+            ZeroMemory(pview, sizeof(*pview));
+            hr = E_INVALIDARG;
+        }
+    }
+
+    return hr;
+}
+
+//
+// Writes pview back out as DOMAIN\user, user@domain.tld or just user, following pview->Form,
+// into pwzOut which holds cchOut characters.  An empty domain always gives just the user name.
+//
+// If pwzOut is too small, returns ERROR_INSUFFICIENT_BUFFER with *pcchOut set to the length
+// needed; on success *pcchOut is the length written.  Both counts include the terminator.
+//
+HRESULT QualifiedUserNameFormat(
+    _In_ const QUALIFIED_USER_NAME_VIEW *pview,
+    _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+    _In_ size_t cchOut,
+    _Out_ size_t *pcchOut
+    )
+{
+    const PACKED_STRING_VIEW *pFirst = &pview->UserName;
+    const PACKED_STRING_VIEW *pSecond = nullptr;
+    wchar_t wchSeparator = L'\0';
+
+    if (pview->Domain.cch && QUNF_USERNAME != pview->Form)
+    {
+        if (QUNF_UPN == pview->Form)
+        {
+            pSecond = &pview->Domain;
+            wchSeparator = L'@';
+        }
+        else
+        {
+            pFirst = &pview->Domain;
+            pSecond = &pview->UserName;
+            wchSeparator = L'\\';
+        }
+    }
+
+    // Both parts are at most USHORT sized, so this cannot overflow.
+    size_t cchNeeded = (size_t)pFirst->cch + 1;
+    if (pSecond)
+    {
+        cchNeeded += 1 + pSecond->cch;
+    }
+    *pcchOut = cchNeeded;
+
+    HRESULT hr;
+    if (cchOut < cchNeeded)
+    {
+        if (cchOut)
+        {
+            pwzOut[0] = L'\0';
+        }
+        hr = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+    }
+    else
+    {
+        PWSTR pwch = pwzOut;
+        CopyMemory(pwch, pFirst->pwch, pFirst->cch * sizeof(wchar_t));
+        pwch += pFirst->cch;
+        if (pSecond)
+        {
+            *pwch++ = wchSeparator;
+            CopyMemory(pwch, pSecond->pwch, pSecond->cch * sizeof(wchar_t));
+            pwch += pSecond->cch;
+        }
+        *pwch = L'\0';
+        hr = S_OK;
+    }
+
+    return hr;
+}
+
+HRESULT QualifiedUserNameFormat(
+    _In_ const QUALIFIED_USER_NAME_VIEW *pview,
+    _Inout_ SecureString *pstr
+    )
+{
+    size_t cchNeeded;
+    HRESULT hr = QualifiedUserNameFormat(pview, nullptr, 0, &cchNeeded);
+    if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER))
+    {
+        PWSTR pwz;
+        hr = pstr->GetBuffer(cchNeeded - 1, &pwz);
+        if (SUCCEEDED(hr))
+        {
+            size_t cchWritten;
+            hr = QualifiedUserNameFormat(pview, pwz, cchNeeded, &cchWritten);
+            pstr->ReleaseBuffer(SUCCEEDED(hr) ? cchWritten - 1 : 0);
+        }
+    }
+
+    return hr;
+}
@@ -0,0 +1,59 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Qualified user names, DOMAIN\user or user@domain.tld: split into views
+// over the name, without copying, and put back together into a caller's
+// buffer.
+
+#pragma once
+
+#include <windows.h>
+#include "securestring.h"
+
+//a counted, read-only string inside a larger buffer (a packed blob, a qualified name); NOT null-terminated
+struct PACKED_STRING_VIEW
+{
+    PCWSTR pwch;
+    USHORT cch;
+};
+
+//how a qualified user name was written
+enum QUALIFIED_USER_NAME_FORM
+{
+    QUNF_USERNAME,          // user
+    QUNF_DOMAIN_USERNAME,   // DOMAIN\user
+    QUNF_UPN,               // user@domain.tld
+};
+
+//a qualified user name split into views over the original string
+struct QUALIFIED_USER_NAME_VIEW
+{
+    QUALIFIED_USER_NAME_FORM Form;
+    PACKED_STRING_VIEW Domain;      // the DOMAIN part or the UPN suffix; empty for QUNF_USERNAME
+    PACKED_STRING_VIEW UserName;
+};
+
+//splits DOMAIN\user or user@domain.tld into views without copying anything
+HRESULT QualifiedUserNameParse(
+    _In_ PCWSTR pwzQualifiedUserName,
+    _Out_ QUALIFIED_USER_NAME_VIEW *pview
+    );
+
+//formats a view back into DOMAIN\user or user@domain.tld in a caller buffer
+HRESULT QualifiedUserNameFormat(
+    _In_ const QUALIFIED_USER_NAME_VIEW *pview,
+    _Out_writes_to_(cchOut, *pcchOut) PWSTR pwzOut,
+    _In_ size_t cchOut,
+    _Out_ size_t *pcchOut
+    );
+
+//same as above, into a SecureString (which stays inline for all but unusually long names)
+HRESULT QualifiedUserNameFormat(
+    _In_ const QUALIFIED_USER_NAME_VIEW *pview,
+    _Inout_ SecureString *pstr
+    );
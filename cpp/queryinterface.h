@@ -0,0 +1,96 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// QueryInterfaceT implements QueryInterface from a list of interfaces
+// given as template arguments, in place of a QITAB and QISearch: the
+// list is unrolled at compile time into a chain of IID compares against
+// constants, with no table to walk and no offsets to apply at run time.
+
+#pragma once
+
+#include <windows.h>
+#include <unknwn.h>
+
+//
+// Compares the first 8 bytes (Data1, Data2 and Data3) with one 64 bit compare, which is
+// enough to tell almost any two IIDs apart, and only then the last 8.
+//
+inline bool QIIsEqualIID(_In_ REFIID riid1, _In_ REFIID riid2)
+{
+    ULONGLONG rgull1[2];
+    ULONGLONG rgull2[2];
+    CopyMemory(rgull1, &riid1, sizeof(rgull1));
+    CopyMemory(rgull2, &riid2, sizeof(rgull2));
+
+    return (rgull1[0] == rgull2[0]) && (rgull1[1] == rgull2[1]);
+}
+
+template <typename TClass, typename... TInterfaces>
+struct _QIList;
+
+template <typename TClass>
+struct _QIList<TClass>
+{
+    static bool Find(_In_ TClass *, _In_ REFIID, _Outptr_ void **)
+    {
+        return false;
+    }
+};
+
+template <typename TClass, typename TInterface, typename... TRest>
+struct _QIList<TClass, TInterface, TRest...>
+{
+    static bool Find(_In_ TClass *pThis, _In_ REFIID riid, _Outptr_ void **ppv)
+    {
+        if (QIIsEqualIID(riid, __uuidof(TInterface)))
+        {
+            *ppv = static_cast<TInterface*>(pThis);
+            return true;
+        }
+        return _QIList<TClass, TRest...>::Find(pThis, riid, ppv);
+    }
+};
+
+//
+// Answers riid if it is one of TFirst, TRest..., which pThis must derive from, or IUnknown;
+// like QISearch, IUnknown is answered with TFirst, so list first the interface that gives the
+// object its identity.  The pointer returned is AddRef'd.
+//
+//     IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
+//     {
+//         return QueryInterfaceT<CFoo, IFoo, IBar>(this, riid, ppv);
+//     }
+//
+template <typename TClass, typename TFirst, typename... TRest>
+HRESULT QueryInterfaceT(
+    _In_ TClass *pThis,
+    _In_ REFIID riid,
+    __deref_out void **ppv
+    )
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+
+    bool bFound = _QIList<TClass, TFirst, TRest...>::Find(pThis, riid, ppv);
+    if (!bFound && QIIsEqualIID(riid, __uuidof(IUnknown)))
+    {
+        *ppv = static_cast<IUnknown*>(static_cast<TFirst*>(pThis));
+        bFound = true;
+    }
+
+    if (!bFound)
+    {
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+
+    static_cast<IUnknown*>(*ppv)->AddRef();
+    return S_OK;
+}
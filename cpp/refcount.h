@@ -0,0 +1,170 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// RefCount is the reference count behind each of our COM objects'
+// AddRef and Release, and ComPtr<T> holds a reference on a COM object
+// for as long as it is in scope.
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+
+//
+// An object starts with one reference, owned by whoever created it.  AddRef only has to make
+// the count go up, so it is relaxed.  Release is a release operation, so everything a thread
+// did with the object happens before its reference is given up; the thread that takes the
+// count to zero then fences with acquire, so it sees all of that before it deletes the object.
+//
+class RefCount
+{
+public:
+    RefCount() :
+        _cRef(1)
+    {
+    }
+
+    ULONG AddRef()
+    {
+        return (ULONG)(_cRef.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    // Returns the new count; at zero the caller deletes the object.
+    ULONG Release()
+    {
+        LONG cRef = _cRef.fetch_sub(1, std::memory_order_release) - 1;
+        if (!cRef)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return (ULONG)cRef;
+    }
+
+private:
+    RefCount(const RefCount&);
+    RefCount& operator=(const RefCount&);
+
+    std::atomic<LONG> _cRef;
+};
+
+//
+// Holds one reference on a T.  Copying AddRefs; moving, Attach and Detach hand the reference
+// over as is, so passing a pointer along (into a member, or out to LogonUI) costs no
+// AddRef/Release pair.
+//
+template <typename T>
+class ComPtr
+{
+public:
+    ComPtr() :
+        _p(NULL)
+    {
+    }
+
+    ComPtr(_In_opt_ T *p) :
+        _p(p)
+    {
+        if (_p)
+        {
+            _p->AddRef();
+        }
+    }
+
+    ComPtr(const ComPtr &other) :
+        _p(other._p)
+    {
+        if (_p)
+        {
+            _p->AddRef();
+        }
+    }
+
+    ComPtr(ComPtr &&other) :
+        _p(other._p)
+    {
+        other._p = NULL;
+    }
+
+    ~ComPtr()
+    {
+        Reset();
+    }
+
+    ComPtr &operator=(_In_opt_ T *p)
+    {
+        if (p)
+        {
+            p->AddRef();
+        }
+        Attach(p);
+        return *this;
+    }
+
+    ComPtr &operator=(const ComPtr &other)
+    {
+        return *this = other._p;
+    }
+
+    ComPtr &operator=(ComPtr &&other)
+    {
+        if (this != &other)
+        {
+            Attach(other.Detach());
+        }
+        return *this;
+    }
+
+    // Takes over the caller's reference on p, releasing the one held until now.
+    void Attach(_In_opt_ T *p)
+    {
+        T *pOld = _p;
+        _p = p;
+        if (pOld)
+        {
+            pOld->Release();
+        }
+    }
+
+    // Gives the caller the reference held until now.
+    T *Detach()
+    {
+        T *p = _p;
+        _p = NULL;
+        return p;
+    }
+
+    void Reset()
+    {
+        Attach(NULL);
+    }
+
+    // For out parameters, such as IID_PPV_ARGS(p.ReleaseAndGetAddressOf()).
+    T **ReleaseAndGetAddressOf()
+    {
+        Reset();
+        return &_p;
+    }
+
+    T *Get() const
+    {
+        return _p;
+    }
+
+    operator T*() const
+    {
+        return _p;
+    }
+
+    T *operator->() const
+    {
+        return _p;
+    }
+
+private:
+    T *_p;
+};
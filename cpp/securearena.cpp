@@ -0,0 +1,134 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Locked, self-wiping bump allocator for credential strings.
+
+#include "securearena.h"
+#include <intsafe.h>
+
+SecureArena::SecureArena() :
+    _pbBase(nullptr),
+    _cbCapacity(0),
+    _cbUsed(0),
+    _fLocked(false)
+{
+}
+
+SecureArena::~SecureArena()
+{
+    WipeAndRelease();
+}
+
+HRESULT SecureArena::Initialize(_In_ SIZE_T cbCapacity)
+{
+    HRESULT hr;
+
+    if (_pbBase)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_ALREADY_INITIALIZED);
+    }
+    else if (0 == cbCapacity)
+    {
+        hr = E_INVALIDARG;
+    }
+    else
+    {
+        // VirtualLock works on whole pages, so round up and let the caller use the slack.
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+
+        SIZE_T cbPage = si.dwPageSize;
+        SIZE_T cbRounded;
+        hr = SizeTAdd(cbCapacity, cbPage - 1, &cbRounded);
+        if (SUCCEEDED(hr))
+        {
+            cbRounded &= ~(cbPage - 1);
+
+            BYTE *pb = (BYTE*)VirtualAlloc(nullptr, cbRounded, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (pb)
+            {
+                _pbBase = pb;
+                _cbCapacity = cbRounded;
+                _cbUsed = 0;
+                _fLocked = VirtualLock(pb, cbRounded) ? true : false;
+            }
+            else
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+        }
+    }
+
+    return hr;
+}
+
+HRESULT SecureArena::Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv)
+{
+    *ppv = nullptr;
+
+    HRESULT hr;
+
+    if (!_pbBase)
+    {
+        hr = E_UNEXPECTED;
+    }
+    else
+    {
+        SIZE_T cbAligned;
+        hr = SizeTAdd(cb, MEMORY_ALLOCATION_ALIGNMENT - 1, &cbAligned);
+        if (SUCCEEDED(hr))
+        {
+            cbAligned &= ~(SIZE_T)(MEMORY_ALLOCATION_ALIGNMENT - 1);
+
+            // _cbUsed is always aligned, so the next block starts aligned as well.
+            if (cbAligned <= _cbCapacity - _cbUsed)
+            {
+                *ppv = _pbBase + _cbUsed;
+                _cbUsed += cbAligned;
+            }
+            else
+            {
+                hr = E_OUTOFMEMORY;
+            }
+        }
+    }
+
+    return hr;
+}
+
+//
+// Only the bytes below the high water mark have ever been handed out, so that is all there is
+// to wipe.  SecureZeroMemory cannot be optimized away and compiles to a single string store
+// over the whole range rather than one wipe per string.
+//
+void SecureArena::Reset()
+{
+    if (_pbBase && _cbUsed)
+    {
+        SecureZeroMemory(_pbBase, _cbUsed);
+    }
+    _cbUsed = 0;
+}
+
+void SecureArena::WipeAndRelease()
+{
+    if (_pbBase)
+    {
+        Reset();
+
+        if (_fLocked)
+        {
+            VirtualUnlock(_pbBase, _cbCapacity);
+        }
+        VirtualFree(_pbBase, 0, MEM_RELEASE);
+
+        _pbBase = nullptr;
+        _cbCapacity = 0;
+        _fLocked = false;
+    }
+}
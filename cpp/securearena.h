@@ -0,0 +1,68 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// SecureArena holds credential strings for the lifetime of a logon session.
+// Its pages are committed once and locked into the working set so the
+// plaintext is never paged out, strings are handed out by bumping an offset,
+// and everything is wiped and released in one go when the session ends.
+//
+// Strings go in through a SecureArenaAllocator (see allocator.h), which
+// takes any helper that copies a secret, such as
+// ProtectIfNecessaryAndCopyPassword.  The wrapper itself never holds a
+// password: it routes the password field straight to the wrapped
+// credential, and the values of its own fields live in SecureStrings.
+
+#pragma once
+
+#include <windows.h>
+
+class SecureArena
+{
+public:
+    SecureArena();
+    ~SecureArena();
+
+    // Reserves, commits and locks at least cbCapacity bytes.  Must be called once before Alloc.
+    HRESULT Initialize(_In_ SIZE_T cbCapacity);
+
+    // Carves cb bytes out of the arena, aligned to MEMORY_ALLOCATION_ALIGNMENT.  There is no
+    // per-allocation free; memory comes back through Reset or WipeAndRelease.
+    HRESULT Alloc(_In_ SIZE_T cb, _Outptr_result_bytebuffer_(cb) void **ppv);
+
+    // Wipes everything handed out so far and makes the whole arena available again.
+    void Reset();
+
+    // Wipes everything handed out so far, then unlocks and releases the pages.
+    void WipeAndRelease();
+
+    // Whether the pages could be locked into the working set.  Locking is best effort: a process
+    // that is over its minimum working set still gets an arena, it is just pageable.
+    bool IsLocked() const
+    {
+        return _fLocked;
+    }
+
+    SIZE_T GetCapacity() const
+    {
+        return _cbCapacity;
+    }
+
+    SIZE_T GetUsed() const
+    {
+        return _cbUsed;
+    }
+
+private:
+    SecureArena(const SecureArena&);
+    SecureArena& operator=(const SecureArena&);
+
+    BYTE   *_pbBase;
+    SIZE_T  _cbCapacity;
+    SIZE_T  _cbUsed;
+    bool    _fLocked;
+};
@@ -0,0 +1,263 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Small-buffer-optimised, self-wiping UTF-16 string.
+
+#include "securestring.h"
+#include "utf16.h"
+#include <intsafe.h>
+#include <strsafe.h>
+
+SecureString::SecureString() :
+    _pwz(_rgwchInline),
+    _cch(0),
+    _cchCapacity(c_cchInline - 1),
+    _cchUsed(0)
+{
+    _rgwchInline[0] = L'\0';
+}
+
+SecureString::~SecureString()
+{
+    Clear();
+}
+
+SecureString::SecureString(SecureString &&other) :
+    _pwz(_rgwchInline),
+    _cch(0),
+    _cchCapacity(c_cchInline - 1),
+    _cchUsed(0)
+{
+    _rgwchInline[0] = L'\0';
+    _MoveFrom(other);
+}
+
+SecureString &SecureString::operator=(SecureString &&other)
+{
+    if (this != &other)
+    {
+        Clear();
+        _MoveFrom(other);
+    }
+    return *this;
+}
+
+//
+// Takes over other's string, leaving other empty.  A heap buffer changes hands without a copy;
+// an inline string has to be copied, and the source is wiped.  Expects this to be empty.
+//
+void SecureString::_MoveFrom(_Inout_ SecureString &other)
+{
+    if (other.IsInline())
+    {
+        CopyMemory(_rgwchInline, other._rgwchInline, (other._cch + 1) * sizeof(wchar_t));
+        _cch = other._cch;
+        _cchUsed = _cch + 1;
+        other.Clear();
+    }
+    else
+    {
+        _pwz = other._pwz;
+        _cch = other._cch;
+        _cchCapacity = other._cchCapacity;
+        _cchUsed = other._cchUsed;
+
+        other._pwz = other._rgwchInline;
+        other._cch = 0;
+        other._cchCapacity = c_cchInline - 1;
+        other._cchUsed = 0;
+        other._rgwchInline[0] = L'\0';
+    }
+}
+
+//
+// Nearly every string fits the storage we already have, so it is copied straight in, in the
+// pass that measures it.  One that doesn't is measured to the end, and goes through GetBuffer.
+// pwz may be part of the current string: the copy only ever moves characters down.
+//
+HRESULT SecureString::Assign(_In_ PCWSTR pwz)
+{
+    size_t cch;
+    HRESULT hr = Utf16CopyString(_pwz, _cchCapacity + 1, pwz, &cch);
+    if (SUCCEEDED(hr))
+    {
+        // Wipe what is left of the old string past the new one.
+        if (_cchUsed > cch + 1)
+        {
+            SecureZeroMemory(_pwz + cch + 1, (_cchUsed - cch - 1) * sizeof(wchar_t));
+        }
+        _cch = cch;
+        _cchUsed = cch + 1;
+    }
+    else if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER))
+    {
+        // The copy may have filled the whole buffer before it ran out.
+        _cchUsed = _cchCapacity + 1;
+
+        hr = Utf16ScanString(pwz, STRSAFE_MAX_CCH - 1, &cch);
+        if (SUCCEEDED(hr))
+        {
+            hr = Assign(pwz, cch);
+        }
+    }
+    return hr;
+}
+
+//
+// pwch may point into this string's own buffer, at a part of the current string say.  GetBuffer
+// would wipe it before it could be copied, so it is moved down in place instead, and what is
+// left of the old string after it is wiped.
+//
+HRESULT SecureString::Assign(_In_reads_(cch) PCWCH pwch, _In_ size_t cch)
+{
+    HRESULT hr;
+
+    ULONG_PTR ulpSrc = (ULONG_PTR)pwch;
+    ULONG_PTR ulpBuffer = (ULONG_PTR)_pwz;
+    if (ulpSrc >= ulpBuffer && ulpSrc < ulpBuffer + (_cchCapacity + 1) * sizeof(wchar_t))
+    {
+        cch = min(cch, _cchCapacity - (ulpSrc - ulpBuffer) / sizeof(wchar_t));
+        MoveMemory(_pwz, pwch, cch * sizeof(wchar_t));
+        if (_cchUsed > cch)
+        {
+            SecureZeroMemory(_pwz + cch, (_cchUsed - cch) * sizeof(wchar_t));
+        }
+        _pwz[cch] = L'\0';
+        _cch = cch;
+        _cchUsed = cch + 1;
+        hr = S_OK;
+    }
+    else
+    {
+        PWSTR pwz;
+        hr = GetBuffer(cch, &pwz);
+        if (SUCCEEDED(hr))
+        {
+            CopyMemory(pwz, pwch, cch * sizeof(wchar_t));
+            ReleaseBuffer(cch);
+        }
+    }
+    return hr;
+}
+
+//
+// The existing storage is reused whenever it is big enough; otherwise the old string is wiped
+// and released first, so at most one buffer is ever live.
+//
+HRESULT SecureString::GetBuffer(_In_ size_t cch, _Outptr_result_buffer_(cch + 1) PWSTR *ppwz)
+{
+    *ppwz = nullptr;
+
+    HRESULT hr = S_OK;
+    if (cch > _cchCapacity)
+    {
+        Clear();
+
+        if (cch > c_cchInline - 1)
+        {
+            size_t cb;
+            hr = SizeTMult(cch + 1, sizeof(wchar_t), &cb);
+            if (SUCCEEDED(hr))
+            {
+                PWSTR pwz = (PWSTR)CoTaskMemAlloc(cb);
+                if (pwz)
+                {
+                    _pwz = pwz;
+                    _cchCapacity = cch;
+                }
+                else
+                {
+                    hr = E_OUTOFMEMORY;
+                }
+            }
+        }
+    }
+    else
+    {
+        // Wipe all the buffer has held, not just _cch characters: a GetBuffer caller may have
+        // written past the length it released.
+        SecureZeroMemory(_pwz, _cchUsed * sizeof(wchar_t));
+        _cch = 0;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        _pwz[0] = L'\0';
+        _cchUsed = cch + 1;
+        *ppwz = _pwz;
+    }
+
+    return hr;
+}
+
+void SecureString::ReleaseBuffer(_In_ size_t cch)
+{
+    _cch = min(cch, _cchCapacity);
+    _pwz[_cch] = L'\0';
+    _cchUsed = max(_cchUsed, _cch + 1);
+}
+
+HRESULT SecureString::CopyToCoTaskMem(_Outptr_result_nullonfailure_ PWSTR *ppwz) const
+{
+    *ppwz = nullptr;
+
+    HRESULT hr = S_OK;
+    PWSTR pwz = (PWSTR)CoTaskMemAlloc((_cch + 1) * sizeof(wchar_t));
+    if (pwz)
+    {
+        CopyMemory(pwz, _pwz, (_cch + 1) * sizeof(wchar_t));
+        *ppwz = pwz;
+    }
+    else
+    {
+        hr = E_OUTOFMEMORY;
+    }
+
+    return hr;
+}
+
+HRESULT SecureString::DetachToCoTaskMem(_Outptr_result_nullonfailure_ PWSTR *ppwz)
+{
+    HRESULT hr;
+
+    if (IsInline())
+    {
+        hr = CopyToCoTaskMem(ppwz);
+        if (SUCCEEDED(hr))
+        {
+            Clear();
+        }
+    }
+    else
+    {
+        *ppwz = _pwz;
+
+        _pwz = _rgwchInline;
+        _cch = 0;
+        _cchCapacity = c_cchInline - 1;
+        _cchUsed = 0;
+        _rgwchInline[0] = L'\0';
+        hr = S_OK;
+    }
+
+    return hr;
+}
+
+void SecureString::Clear()
+{
+    SecureZeroMemory(_pwz, _cchUsed * sizeof(wchar_t));
+    if (!IsInline())
+    {
+        CoTaskMemFree(_pwz);
+        _pwz = _rgwchInline;
+        _cchCapacity = c_cchInline - 1;
+    }
+    _cch = 0;
+    _cchUsed = 0;
+    _rgwchInline[0] = L'\0';
+}
@@ -0,0 +1,84 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// SecureString is an owned, null-terminated UTF-16 string for credential
+// fields.  Strings shorter than c_cchInline characters (nearly every user
+// name, domain and status text) live inside the object; longer ones go to
+// the COM task allocator.  Every byte that held the string is wiped before
+// it is reused or released, and only those: a short string costs a short
+// wipe.
+
+#pragma once
+
+#include <windows.h>
+
+class SecureString
+{
+public:
+    static const size_t c_cchInline = 64;
+
+    SecureString();
+    ~SecureString();
+
+    SecureString(SecureString &&other);
+    SecureString &operator=(SecureString &&other);
+
+    // Replaces the contents with a copy of pwz, which may point into this string.
+    HRESULT Assign(_In_ PCWSTR pwz);
+
+    // Replaces the contents with a copy of the cch characters at pwch, which need no terminator
+    // and may point into this string.
+    HRESULT Assign(_In_reads_(cch) PCWCH pwch, _In_ size_t cch);
+
+    // Makes room for cch characters plus the terminator and returns the buffer to write them
+    // into; the current contents are wiped.  Call ReleaseBuffer with the length written.
+    HRESULT GetBuffer(_In_ size_t cch, _Outptr_result_buffer_(cch + 1) PWSTR *ppwz);
+    void ReleaseBuffer(_In_ size_t cch);
+
+    // Copies the string into a new CoTaskMemAlloc buffer for LogonUI; the string is unchanged.
+    HRESULT CopyToCoTaskMem(_Outptr_result_nullonfailure_ PWSTR *ppwz) const;
+
+    // Hands the string to the caller as a CoTaskMemAlloc buffer and leaves this one empty.  A
+    // heap string is given away as is; an inline one is copied out and the inline copy wiped.
+    HRESULT DetachToCoTaskMem(_Outptr_result_nullonfailure_ PWSTR *ppwz);
+
+    // Wipes the contents and returns to the empty, inline state.
+    void Clear();
+
+    PCWSTR Get() const
+    {
+        return _pwz;
+    }
+
+    size_t GetLength() const
+    {
+        return _cch;
+    }
+
+    bool IsEmpty() const
+    {
+        return 0 == _cch;
+    }
+
+    bool IsInline() const
+    {
+        return _pwz == _rgwchInline;
+    }
+
+private:
+    SecureString(const SecureString&);
+    SecureString &operator=(const SecureString&);
+
+    void _MoveFrom(_Inout_ SecureString &other);
+
+    PWSTR   _pwz;                       // _rgwchInline or a CoTaskMemAlloc buffer
+    size_t  _cch;
+    size_t  _cchCapacity;               // not counting the terminator
+    size_t  _cchUsed;                   // how much of _pwz may hold anything but zeros
+    wchar_t _rgwchInline[c_cchInline];
+};
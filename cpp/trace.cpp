@@ -0,0 +1,254 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Binary trace.
+
+#include "trace.h"
+#include "diagfile.h"
+#include "flightrecorder.h"
+#include "logger.h"
+#include "mpscring.h"
+#include <intrin.h>
+#include <strsafe.h>
+#include <bcrypt.h>
+#include <atomic>
+
+// The writer empties the ring every 200ms (see logger.cpp); this holds a few seconds of a
+// busy logon.
+static const size_t c_cTraceSlots = 2048;
+
+static MpscRing<TRACE_RECORD, c_cTraceSlots>    s_traceRing;
+static std::atomic<LONG>                        s_cTraceDropped;
+
+// The consumer's; see logger.cpp.
+static TRACE_RECORD         s_rgTraceBatch[256];
+static HANDLE               s_hTraceFile = INVALID_HANDLE_VALUE;
+static bool                 s_bTraceFileFailed;
+
+static INIT_ONCE            s_traceConfigInitOnce = INIT_ONCE_STATIC_INIT;
+static bool                 s_bTraceEnabled;
+static WCHAR                s_wszTraceFile[MAX_PATH];
+
+// The random key object IDs are made with; without one, every object is 0.
+static bool                 s_bTraceObjectKey;
+static ULONGLONG            s_rgullTraceObjectKey[2];
+
+static BOOL CALLBACK _TraceReadConfig(
+    _Inout_ PINIT_ONCE pInitOnce,
+    _Inout_opt_ PVOID pvParameter,
+    _Outptr_opt_result_maybenull_ PVOID *ppvContext
+    )
+{
+    UNREFERENCED_PARAMETER(pInitOnce);
+    UNREFERENCED_PARAMETER(pvParameter);
+    UNREFERENCED_PARAMETER(ppvContext);
+
+    DWORD dwEnabled = 0;
+    DWORD cb = sizeof(dwEnabled);
+    if (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, RASPWRAP_CONFIG_KEY, RASPWRAP_TRACE_ENABLED_VALUE,
+                                      RRF_RT_REG_DWORD, NULL, &dwEnabled, &cb))
+    {
+        s_bTraceEnabled = (dwEnabled != 0);
+    }
+
+    s_bTraceObjectKey = BCRYPT_SUCCESS(BCryptGenRandom(NULL, reinterpret_cast<PUCHAR>(s_rgullTraceObjectKey),
+                                                       sizeof(s_rgullTraceObjectKey),
+                                                       BCRYPT_USE_SYSTEM_PREFERRED_RNG));
+
+    //
+    // One file per process, named after the process ID and the time the process started, so a
+    // process that reuses an ID later still gets a file of its own.  A name that doesn't fit
+    // leaves tracing off rather than shared.
+    //
+    WCHAR wszTraceFile[MAX_PATH];
+    FILETIME ftCreation;
+    FILETIME ftUnused;
+    if (!DiagReadPath(RASPWRAP_TRACE_FILE_VALUE, RASPWRAP_TRACE_FILE_DEFAULT, wszTraceFile, ARRAYSIZE(wszTraceFile)) ||
+        !GetProcessTimes(GetCurrentProcess(), &ftCreation, &ftUnused, &ftUnused, &ftUnused) ||
+        FAILED(StringCchPrintfW(s_wszTraceFile, ARRAYSIZE(s_wszTraceFile), L"%s.%lu.%08lx%08lx", wszTraceFile,
+                                GetCurrentProcessId(), ftCreation.dwHighDateTime, ftCreation.dwLowDateTime)))
+    {
+        s_bTraceEnabled = false;
+    }
+
+    return TRUE;
+}
+
+bool TraceIsEnabled()
+{
+    // InitOnceExecuteOnce only fails if our callback does, and it doesn't.
+    (void)InitOnceExecuteOnce(&s_traceConfigInitOnce, _TraceReadConfig, NULL, NULL);
+    return s_bTraceEnabled;
+}
+
+//
+// The address, mixed with the key: the same object always gets the same ID, and different
+// objects different ones, since every step can be undone with the key; without it, the ID
+// tells nothing of where the object is.
+//
+static ULONGLONG _TraceObjectId(_In_opt_ const void *pvObject)
+{
+    if (!pvObject || !s_bTraceObjectKey)
+    {
+        return 0;
+    }
+
+    ULONGLONG ull = ((ULONG_PTR)pvObject ^ s_rgullTraceObjectKey[0]) * (s_rgullTraceObjectKey[1] | 1);
+    ull ^= ull >> 32;
+    ull *= 0xd6e8feb86659fd93ULL;
+    return ull ^ (ull >> 32);
+}
+
+void Trace(
+    _In_ TRACE_EVENT_ID teid,
+    _In_ TRACE_PHASE tph,
+    _In_opt_ const void *pvObject,
+    _In_ DWORD dwFieldID,
+    _In_ HRESULT hr
+    )
+{
+    // Reads the configuration, and makes the key, on the first call.
+    bool fEnabled = TraceIsEnabled();
+    ULONGLONG ullObject = _TraceObjectId(pvObject);
+
+    FlightRecord(teid, tph, ullObject, dwFieldID, hr);
+
+    if (!fEnabled)
+    {
+        return;
+    }
+
+    LogEnsureWriter();
+
+    size_t pos;
+    TRACE_RECORD *prec = s_traceRing.BeginEnqueue(&pos);
+    if (!prec)
+    {
+        s_cTraceDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    prec->usEventID = (uint16_t)teid;
+    prec->usPhase = (uint16_t)tph;
+    prec->dwThreadId = GetCurrentThreadId();
+    prec->ullTimestamp = __rdtsc();
+    prec->ullObject = ullObject;
+    prec->dwFieldID = dwFieldID;
+    prec->hr = hr;
+
+    s_traceRing.EndEnqueue(pos);
+}
+
+// Creates the trace file, and starts this process's session in it, on the first drain with
+// something to write.  If that fails, nothing is written for the life of the process.
+static bool _TraceOpen()
+{
+    if (s_hTraceFile == INVALID_HANDLE_VALUE && !s_bTraceFileFailed)
+    {
+        if (DiagPrepareDirectoryOf(s_wszTraceFile))
+        {
+            s_hTraceFile = DiagCreateFile(s_wszTraceFile, FILE_APPEND_DATA);
+        }
+        s_bTraceFileFailed = (s_hTraceFile == INVALID_HANDLE_VALUE);
+        if (!s_bTraceFileFailed)
+        {
+            LARGE_INTEGER liFrequency;
+            LARGE_INTEGER liQpc;
+            QueryPerformanceFrequency(&liFrequency);
+
+            TRACE_SESSION_HEADER tsh;
+            tsh.usMark = TRACE_SESSION_MARK;
+            tsh.usVersion = TRACE_VERSION;
+            tsh.dwMagic = TRACE_MAGIC;
+            tsh.dwProcessId = GetCurrentProcessId();
+            tsh.cbHeader = sizeof(tsh);
+            tsh.cbRecord = sizeof(TRACE_RECORD);
+            tsh.ullQpcFrequency = (ULONGLONG)liFrequency.QuadPart;
+            tsh.ullTimestamp = __rdtsc();
+            QueryPerformanceCounter(&liQpc);
+            tsh.ullQpc = (ULONGLONG)liQpc.QuadPart;
+
+            DWORD cbWritten;
+            (void)WriteFile(s_hTraceFile, &tsh, sizeof(tsh), &cbWritten, NULL);
+        }
+    }
+
+    return s_hTraceFile != INVALID_HANDLE_VALUE;
+}
+
+static void _TraceWrite(_In_reads_(crec) const TRACE_RECORD *rgrec, _In_ size_t crec)
+{
+    if (_TraceOpen())
+    {
+        DWORD cbWritten;
+        (void)WriteFile(s_hTraceFile, rgrec, (DWORD)(crec * sizeof(*rgrec)), &cbWritten, NULL);
+    }
+}
+
+static void _TraceInitRecord(_In_ TRACE_EVENT_ID teid, _In_ ULONGLONG ullObject, _In_ DWORD dwFieldID, _Out_ TRACE_RECORD *prec)
+{
+    prec->usEventID = (uint16_t)teid;
+    prec->usPhase = TPH_INSTANT;
+    prec->dwThreadId = GetCurrentThreadId();
+    prec->ullTimestamp = __rdtsc();
+    prec->ullObject = ullObject;
+    prec->dwFieldID = dwFieldID;
+    prec->hr = S_OK;
+}
+
+//
+// Records are copied out of the ring in batches, so a drain costs a write per batch rather than
+// per record.  A drain that wrote anything ends with a TEID_CLOCK_SYNC record, which the decoder
+// uses to convert TSC ticks to time.
+//
+void TraceDrain()
+{
+    size_t crec = 0;
+
+    LONG cDropped = s_cTraceDropped.exchange(0, std::memory_order_relaxed);
+    if (cDropped)
+    {
+        _TraceInitRecord(TEID_DROPPED, 0, (DWORD)cDropped, &s_rgTraceBatch[crec++]);
+    }
+
+    for (const TRACE_RECORD *prec = s_traceRing.BeginDequeue(); prec; prec = s_traceRing.BeginDequeue())
+    {
+        if (crec == ARRAYSIZE(s_rgTraceBatch))
+        {
+            _TraceWrite(s_rgTraceBatch, crec);
+            crec = 0;
+        }
+        s_rgTraceBatch[crec++] = *prec;
+
+        s_traceRing.EndDequeue();
+    }
+
+    if (crec)
+    {
+        if (crec == ARRAYSIZE(s_rgTraceBatch))
+        {
+            _TraceWrite(s_rgTraceBatch, crec);
+            crec = 0;
+        }
+
+        LARGE_INTEGER liQpc;
+        QueryPerformanceCounter(&liQpc);
+        _TraceInitRecord(TEID_CLOCK_SYNC, (ULONGLONG)liQpc.QuadPart, TRACE_NO_FIELD, &s_rgTraceBatch[crec++]);
+
+        _TraceWrite(s_rgTraceBatch, crec);
+    }
+}
+
+void TraceClose()
+{
+    if (s_hTraceFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(s_hTraceFile);
+        s_hTraceFile = INVALID_HANDLE_VALUE;
+    }
+}
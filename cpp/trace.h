@@ -0,0 +1,75 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The binary trace.  Trace() stores a fixed-size record (event, object,
+// field, HRESULT, TSC timestamp) in an in-memory ring, without formatting
+// anything; the background writer of the debug log appends the records to
+// the trace file.  tools/tracedecode.cpp turns a trace file into text or
+// into Chrome trace JSON.  The file layout is in traceformat.h.
+//
+// Tracing is off unless the configuration turns it on:
+//
+//   HKLM\SOFTWARE\RaspWrap
+//       TraceEnabled  REG_DWORD  1 to trace
+//       TraceFile     REG_SZ     the file to append to (RASPWRAP_TRACE_FILE_DEFAULT if absent)
+//
+// Each process writes a file of its own, TraceFile with ".<process ID>.<start time>" added, and
+// keeps others from writing to it, so a session's records are never interleaved with another's.
+// The file is made as diagfile.h makes every diagnostics file.
+//
+// Unlike the log, the trace never holds field values, so it is safe to
+// leave on.  Nor does it hold the addresses of our objects: each object
+// is recorded as an ID made from its address with a random per-process
+// key, which tells one object from another within the process and nothing
+// more.
+//
+// Every event also goes to the flight recorder (see flightrecorder.h),
+// whether or not tracing is on.
+
+#pragma once
+
+#include <windows.h>
+#include "diagfile.h"
+#include "traceformat.h"
+
+#define RASPWRAP_TRACE_ENABLED_VALUE    L"TraceEnabled"
+#define RASPWRAP_TRACE_FILE_VALUE       L"TraceFile"
+#define RASPWRAP_TRACE_FILE_DEFAULT     RASPWRAP_DIAG_DIRECTORY_DEFAULT L"\\raspwrap.trace"
+
+// Queues one record, and writes it to the flight recorder; a record that finds the ring full is
+// dropped, and counted, rather than waited for.
+void Trace(
+    _In_ TRACE_EVENT_ID teid,
+    _In_ TRACE_PHASE tph,
+    _In_opt_ const void *pvObject,
+    _In_ DWORD dwFieldID,
+    _In_ HRESULT hr
+    );
+
+inline void TraceBegin(_In_ TRACE_EVENT_ID teid, _In_opt_ const void *pvObject, _In_ DWORD dwFieldID = TRACE_NO_FIELD)
+{
+    Trace(teid, TPH_BEGIN, pvObject, dwFieldID, S_OK);
+}
+
+inline void TraceEnd(_In_ TRACE_EVENT_ID teid, _In_opt_ const void *pvObject, _In_ HRESULT hr, _In_ DWORD dwFieldID = TRACE_NO_FIELD)
+{
+    Trace(teid, TPH_END, pvObject, dwFieldID, hr);
+}
+
+inline void TraceInstant(_In_ TRACE_EVENT_ID teid, _In_opt_ const void *pvObject, _In_ DWORD dwFieldID = TRACE_NO_FIELD)
+{
+    Trace(teid, TPH_INSTANT, pvObject, dwFieldID, S_OK);
+}
+
+// Whether the configuration turns tracing on; read once per process.
+bool TraceIsEnabled();
+
+// For the log's background writer: TraceDrain appends whatever is queued to the trace file,
+// TraceClose closes the file.  Only ever called from the writer.
+void TraceDrain();
+void TraceClose();
@@ -0,0 +1,141 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The layout of the binary trace file, shared by the provider (trace.cpp)
+// and the offline decoder (tools/tracedecode.cpp).  It only uses the
+// fixed-width C types so that the decoder builds on any platform.
+//
+// A trace file is a sequence of sessions, one per process that appended to
+// it, one after the other: a process keeps the file to itself while it
+// writes.  Each session starts with a TRACE_SESSION_HEADER, followed by any
+// number of TRACE_RECORDs, all little-endian.  The two are told apart by
+// their first 16 bits: TRACE_SESSION_MARK for a header, the event ID for a
+// record.
+//
+// Timestamps are CPU time stamp counter ticks.  The header and every
+// TEID_CLOCK_SYNC record pair a TSC reading with a QueryPerformanceCounter
+// reading, from which the decoder works out the TSC frequency.
+
+#pragma once
+
+#include <stdint.h>
+
+#define TRACE_SESSION_MARK      0xFFFF
+#define TRACE_MAGIC             0x52545752      // "RWTR"
+#define TRACE_VERSION           1
+
+// dwFieldID of an event that isn't about a field.
+#define TRACE_NO_FIELD          0xFFFFFFFF
+
+//
+// Every event the provider traces, as X(id, value, category, name).  The values are written to
+// the file, so an event keeps its value for good; new events take new values.  The field ID of
+// an event that has no field carries its one integer argument instead, where it has one (the
+// usage scenario, the credential index, the number of records TEID_DROPPED stands for).
+//
+#define RASPWRAP_TRACE_EVENTS(X) \
+    X(TEID_CLOCK_SYNC,                                  0x0001, "trace",        "ClockSync") \
+    X(TEID_DROPPED,                                     0x0002, "trace",        "Dropped") \
+    \
+    X(TEID_CREDENTIAL_CREATE,                           0x0100, "credential",   "RaspWrapCredential::RaspWrapCredential") \
+    X(TEID_CREDENTIAL_DESTROY,                          0x0101, "credential",   "RaspWrapCredential::~RaspWrapCredential") \
+    X(TEID_CREDENTIAL_INITIALIZE,                       0x0102, "credential",   "RaspWrapCredential::Initialize") \
+    X(TEID_CREDENTIAL_ADVISE,                           0x0103, "credential",   "RaspWrapCredential::Advise") \
+    X(TEID_CREDENTIAL_UNADVISE,                         0x0104, "credential",   "RaspWrapCredential::UnAdvise") \
+    X(TEID_CREDENTIAL_SET_SELECTED,                     0x0105, "credential",   "RaspWrapCredential::SetSelected") \
+    X(TEID_CREDENTIAL_SET_DESELECTED,                   0x0106, "credential",   "RaspWrapCredential::SetDeselected") \
+    X(TEID_CREDENTIAL_GET_FIELD_STATE,                  0x0107, "credential",   "RaspWrapCredential::GetFieldState") \
+    X(TEID_CREDENTIAL_GET_STRING_VALUE,                 0x0108, "credential",   "RaspWrapCredential::GetStringValue") \
+    X(TEID_CREDENTIAL_GET_BITMAP_VALUE,                 0x0109, "credential",   "RaspWrapCredential::GetBitmapValue") \
+    X(TEID_CREDENTIAL_GET_CHECKBOX_VALUE,               0x010A, "credential",   "RaspWrapCredential::GetCheckboxValue") \
+    X(TEID_CREDENTIAL_GET_SUBMIT_BUTTON_VALUE,          0x010B, "credential",   "RaspWrapCredential::GetSubmitButtonValue") \
+    X(TEID_CREDENTIAL_GET_COMBOBOX_VALUE_COUNT,         0x010C, "credential",   "RaspWrapCredential::GetComboBoxValueCount") \
+    X(TEID_CREDENTIAL_GET_COMBOBOX_VALUE_AT,            0x010D, "credential",   "RaspWrapCredential::GetComboBoxValueAt") \
+    X(TEID_CREDENTIAL_SET_STRING_VALUE,                 0x010E, "credential",   "RaspWrapCredential::SetStringValue") \
+    X(TEID_CREDENTIAL_SET_CHECKBOX_VALUE,               0x010F, "credential",   "RaspWrapCredential::SetCheckboxValue") \
+    X(TEID_CREDENTIAL_SET_COMBOBOX_SELECTED_VALUE,      0x0110, "credential",   "RaspWrapCredential::SetComboBoxSelectedValue") \
+    X(TEID_CREDENTIAL_COMMAND_LINK_CLICKED,             0x0111, "credential",   "RaspWrapCredential::CommandLinkClicked") \
+    X(TEID_CREDENTIAL_GET_SERIALIZATION,                0x0112, "credential",   "RaspWrapCredential::GetSerialization") \
+    X(TEID_CREDENTIAL_REPORT_RESULT,                    0x0113, "credential",   "RaspWrapCredential::ReportResult") \
+    X(TEID_CREDENTIAL_CONNECT,                          0x0114, "credential",   "RaspWrapCredential::Connect") \
+    X(TEID_CREDENTIAL_DISCONNECT,                       0x0115, "credential",   "RaspWrapCredential::Disconnect") \
+    \
+    X(TEID_PROVIDER_CREATE,                             0x0200, "provider",     "RaspWrapCredentialProvider::RaspWrapCredentialProvider") \
+    X(TEID_PROVIDER_DESTROY,                            0x0201, "provider",     "RaspWrapCredentialProvider::~RaspWrapCredentialProvider") \
+    X(TEID_PROVIDER_SET_USAGE_SCENARIO,                 0x0202, "provider",     "RaspWrapCredentialProvider::SetUsageScenario") \
+    X(TEID_PROVIDER_SET_SERIALIZATION,                  0x0203, "provider",     "RaspWrapCredentialProvider::SetSerialization") \
+    X(TEID_PROVIDER_ADVISE,                             0x0204, "provider",     "RaspWrapCredentialProvider::Advise") \
+    X(TEID_PROVIDER_UNADVISE,                           0x0205, "provider",     "RaspWrapCredentialProvider::UnAdvise") \
+    X(TEID_PROVIDER_GET_FIELD_DESCRIPTOR_COUNT,         0x0206, "provider",     "RaspWrapCredentialProvider::GetFieldDescriptorCount") \
+    X(TEID_PROVIDER_GET_FIELD_DESCRIPTOR_AT,            0x0207, "provider",     "RaspWrapCredentialProvider::GetFieldDescriptorAt") \
+    X(TEID_PROVIDER_GET_CREDENTIAL_COUNT,               0x0208, "provider",     "RaspWrapCredentialProvider::GetCredentialCount") \
+    X(TEID_PROVIDER_GET_CREDENTIAL_AT,                  0x0209, "provider",     "RaspWrapCredentialProvider::GetCredentialAt") \
+    X(TEID_PROVIDER_FILTER,                             0x020A, "provider",     "RaspWrapCredentialProvider::Filter") \
+    X(TEID_PROVIDER_UPDATE_REMOTE_CREDENTIAL,           0x020B, "provider",     "RaspWrapCredentialProvider::UpdateRemoteCredential") \
+    X(TEID_PROVIDER_CREDENTIAL_CACHED,                  0x020C, "provider",     "GetCredentialAt: cached wrapper") \
+    X(TEID_PROVIDER_CREDENTIAL_WRAPPED,                 0x020D, "provider",     "GetCredentialAt: new wrapper") \
+    X(TEID_PROVIDER_CREDENTIAL_NOT_CONNECTABLE,         0x020E, "provider",     "GetCredentialAt: not connectable") \
+    X(TEID_PROVIDER_CREDENTIAL_NOT_CACHED,              0x020F, "provider",     "GetCredentialAt: wrapper not cached") \
+    X(TEID_PROVIDER_FILTERED_RAS_PROVIDER,              0x0210, "provider",     "Filter: filtered out CLSID_RASProvider") \
+    \
+    X(TEID_EVENTS_CREATE,                               0x0300, "events",       "RaspWrapCredentialEvents::RaspWrapCredentialEvents") \
+    X(TEID_EVENTS_SET_FIELD_STATE,                      0x0301, "events",       "RaspWrapCredentialEvents::SetFieldState") \
+    X(TEID_EVENTS_SET_FIELD_INTERACTIVE_STATE,          0x0302, "events",       "RaspWrapCredentialEvents::SetFieldInteractiveState") \
+    X(TEID_EVENTS_SET_FIELD_STRING,                     0x0303, "events",       "RaspWrapCredentialEvents::SetFieldString") \
+    X(TEID_EVENTS_SET_FIELD_BITMAP,                     0x0304, "events",       "RaspWrapCredentialEvents::SetFieldBitmap") \
+    X(TEID_EVENTS_SET_FIELD_CHECKBOX,                   0x0305, "events",       "RaspWrapCredentialEvents::SetFieldCheckbox") \
+    X(TEID_EVENTS_SET_FIELD_COMBOBOX_SELECTED_ITEM,     0x0306, "events",       "RaspWrapCredentialEvents::SetFieldComboBoxSelectedItem") \
+    X(TEID_EVENTS_DELETE_FIELD_COMBOBOX_ITEM,           0x0307, "events",       "RaspWrapCredentialEvents::DeleteFieldComboBoxItem") \
+    X(TEID_EVENTS_APPEND_FIELD_COMBOBOX_ITEM,           0x0308, "events",       "RaspWrapCredentialEvents::AppendFieldComboBoxItem") \
+    X(TEID_EVENTS_SET_FIELD_SUBMIT_BUTTON,              0x0309, "events",       "RaspWrapCredentialEvents::SetFieldSubmitButton") \
+    X(TEID_EVENTS_ON_CREATING_WINDOW,                   0x030A, "events",       "RaspWrapCredentialEvents::OnCreatingWindow")
+
+enum TRACE_EVENT_ID
+{
+#define TRACE_EVENT_ENUM(id, value, category, name) id = value,
+    RASPWRAP_TRACE_EVENTS(TRACE_EVENT_ENUM)
+#undef TRACE_EVENT_ENUM
+};
+
+enum TRACE_PHASE
+{
+    TPH_INSTANT,    // something that happened at one point in time
+    TPH_BEGIN,      // a method was entered...
+    TPH_END,        // ...and returned hr
+};
+
+#pragma pack(push, 4)
+
+struct TRACE_SESSION_HEADER
+{
+    uint16_t    usMark;             // TRACE_SESSION_MARK
+    uint16_t    usVersion;          // TRACE_VERSION
+    uint32_t    dwMagic;            // TRACE_MAGIC
+    uint32_t    dwProcessId;
+    uint16_t    cbHeader;           // sizeof(TRACE_SESSION_HEADER)
+    uint16_t    cbRecord;           // sizeof(TRACE_RECORD)
+    uint64_t    ullQpcFrequency;    // QueryPerformanceFrequency
+    uint64_t    ullTimestamp;       // TSC...
+    uint64_t    ullQpc;             // ...and QueryPerformanceCounter, read together
+};
+
+struct TRACE_RECORD
+{
+    uint16_t    usEventID;          // TRACE_EVENT_ID
+    uint16_t    usPhase;            // TRACE_PHASE
+    uint32_t    dwThreadId;
+    uint64_t    ullTimestamp;       // TSC
+    uint64_t    ullObject;          // the ID of the object the event is about; the QPC for TEID_CLOCK_SYNC
+    uint32_t    dwFieldID;          // or TRACE_NO_FIELD
+    int32_t     hr;                 // for TPH_END; S_OK otherwise
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(TRACE_SESSION_HEADER) == 40, "the trace file layout changed");
+static_assert(sizeof(TRACE_RECORD) == 32, "the trace file layout changed");
@@ -0,0 +1,406 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// UTF-16 string kernels used by the helpers.
+
+#include "utf16.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#define UTF16_USE_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#define UTF16_TARGET_AVX2
+#else
+#define UTF16_TARGET_AVX2           __attribute__((target("avx2")))
+#endif
+#endif
+
+// The vector loads read whole aligned blocks, which can go past the end of the allocation the
+// string is in (see _Utf16Walk); AddressSanitizer would report that, so they aren't checked.
+#if defined(__SANITIZE_ADDRESS__) && defined(_MSC_VER)
+#define UTF16_NO_SANITIZE_ADDRESS   __declspec(no_sanitize_address)
+#elif defined(__SANITIZE_ADDRESS__)
+#define UTF16_NO_SANITIZE_ADDRESS   __attribute__((no_sanitize_address))
+#else
+#define UTF16_NO_SANITIZE_ADDRESS
+#endif
+
+#define UTF16_IS_HIGH_SURROGATE(ch) ((ch) >= 0xD800 && (ch) <= 0xDBFF)
+#define UTF16_IS_LOW_SURROGATE(ch)  ((ch) >= 0xDC00 && (ch) <= 0xDFFF)
+
+// What makes a character need the scalar loop, besides the terminator and the surrogates.
+struct UTF16_SPECIALS
+{
+    bool        fFind;
+    char16_t    chFirst;
+    char16_t    chLast;
+};
+
+//
+// Skips the characters from i on that the scalar loop has no need to look at, copying them to
+// pchDest if it isn't NULL, and returns the index of the first one it has to, or of the first
+// it hasn't got to.  pchSrc + i is 16-byte aligned; the characters are read 8 (SSE2) or 16
+// (AVX2) at a time, in aligned blocks that end at or before cchMax.  Only the characters
+// skipped are copied.
+//
+typedef size_t (*PFN_UTF16_SKIP)(
+    _In_ const char16_t *pchSrc,
+    _Out_writes_opt_(cchMax + 1) char16_t *pchDest,
+    _In_ size_t i,
+    _In_ size_t cchMax,
+    _In_ const UTF16_SPECIALS &specials
+    );
+
+#ifdef UTF16_USE_SSE2
+
+// The index of the lowest bit set in a movemask result, which isn't zero.
+inline ULONG _Utf16LowestBit(_In_ ULONG ulMask)
+{
+#ifdef _MSC_VER
+    unsigned long ulIndex;
+    _BitScanForward(&ulIndex, ulMask);
+    return ulIndex;
+#else
+    return (ULONG)__builtin_ctz(ulMask);
+#endif
+}
+
+// Copies the ordinary characters at the start of a block that has something else further on.
+inline size_t _Utf16SkipPartialBlock(
+    _In_ const char16_t *pchSrc,
+    _Out_writes_opt_(cchMax + 1) char16_t *pchDest,
+    _In_ size_t i,
+    _In_ ULONG ulMask
+    )
+{
+    size_t cch = _Utf16LowestBit(ulMask) / sizeof(char16_t);
+    if (pchDest)
+    {
+        for (size_t ich = 0; ich < cch; ich++)
+        {
+            pchDest[i + ich] = pchSrc[i + ich];
+        }
+    }
+    return i + cch;
+}
+
+UTF16_NO_SANITIZE_ADDRESS
+static size_t _Utf16SkipSse2(
+    _In_ const char16_t *pchSrc,
+    _Out_writes_opt_(cchMax + 1) char16_t *pchDest,
+    _In_ size_t i,
+    _In_ size_t cchMax,
+    _In_ const UTF16_SPECIALS &specials
+    )
+{
+    const __m128i vZero = _mm_setzero_si128();
+    const __m128i vSurrogateMask = _mm_set1_epi16(-0x0800);     // 0xF800
+    const __m128i vSurrogateBits = _mm_set1_epi16(-0x2800);     // 0xD800
+    const __m128i vFirst = _mm_set1_epi16((short)specials.chFirst);
+    const __m128i vLast = _mm_set1_epi16((short)specials.chLast);
+
+    while (cchMax - i >= 8)
+    {
+        __m128i v = _mm_load_si128((const __m128i *)(pchSrc + i));
+        __m128i vSpecial = _mm_or_si128(_mm_cmpeq_epi16(v, vZero),
+                                        _mm_cmpeq_epi16(_mm_and_si128(v, vSurrogateMask), vSurrogateBits));
+        if (specials.fFind)
+        {
+            vSpecial = _mm_or_si128(vSpecial, _mm_or_si128(_mm_cmpeq_epi16(v, vFirst), _mm_cmpeq_epi16(v, vLast)));
+        }
+
+        ULONG ulMask = (ULONG)_mm_movemask_epi8(vSpecial);
+        if (ulMask != 0)
+        {
+            return _Utf16SkipPartialBlock(pchSrc, pchDest, i, ulMask);
+        }
+
+        if (pchDest)
+        {
+            _mm_storeu_si128((__m128i *)(pchDest + i), v);
+        }
+        i += 8;
+    }
+
+    return i;
+}
+
+//
+// The same on 32-byte blocks.  A block that is only 16-byte aligned, and the last few
+// characters before cchMax, go through the SSE2 version.
+//
+UTF16_NO_SANITIZE_ADDRESS UTF16_TARGET_AVX2
+static size_t _Utf16SkipAvx2(
+    _In_ const char16_t *pchSrc,
+    _Out_writes_opt_(cchMax + 1) char16_t *pchDest,
+    _In_ size_t i,
+    _In_ size_t cchMax,
+    _In_ const UTF16_SPECIALS &specials
+    )
+{
+    if (((ULONG_PTR)(pchSrc + i) & 31) != 0)
+    {
+        size_t iNext = _Utf16SkipSse2(pchSrc, pchDest, i, (cchMax - i >= 8) ? i + 8 : cchMax, specials);
+        if (iNext != i + 8)
+        {
+            return iNext;
+        }
+        i = iNext;
+    }
+
+    const __m256i vZero = _mm256_setzero_si256();
+    const __m256i vSurrogateMask = _mm256_set1_epi16(-0x0800);
+    const __m256i vSurrogateBits = _mm256_set1_epi16(-0x2800);
+    const __m256i vFirst = _mm256_set1_epi16((short)specials.chFirst);
+    const __m256i vLast = _mm256_set1_epi16((short)specials.chLast);
+
+    while (cchMax - i >= 16)
+    {
+        __m256i v = _mm256_load_si256((const __m256i *)(pchSrc + i));
+        __m256i vSpecial = _mm256_or_si256(_mm256_cmpeq_epi16(v, vZero),
+                                           _mm256_cmpeq_epi16(_mm256_and_si256(v, vSurrogateMask), vSurrogateBits));
+        if (specials.fFind)
+        {
+            vSpecial = _mm256_or_si256(vSpecial,
+                                       _mm256_or_si256(_mm256_cmpeq_epi16(v, vFirst), _mm256_cmpeq_epi16(v, vLast)));
+        }
+
+        ULONG ulMask = (ULONG)_mm256_movemask_epi8(vSpecial);
+        if (ulMask != 0)
+        {
+            _mm256_zeroupper();
+            return _Utf16SkipPartialBlock(pchSrc, pchDest, i, ulMask);
+        }
+
+        if (pchDest)
+        {
+            _mm256_storeu_si256((__m256i *)(pchDest + i), v);
+        }
+        i += 16;
+    }
+
+    _mm256_zeroupper();
+    return _Utf16SkipSse2(pchSrc, pchDest, i, cchMax, specials);
+}
+
+// Whether the processor has AVX2, and the OS saves the YMM registers.
+static bool _Utf16CpuHasAvx2()
+{
+#ifdef _MSC_VER
+    int rgiInfo[4];
+    __cpuid(rgiInfo, 0);
+    if (rgiInfo[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(rgiInfo, 1);
+    const int c_fOsxsaveAndAvx = (1 << 27) | (1 << 28);
+    if ((rgiInfo[2] & c_fOsxsaveAndAvx) != c_fOsxsaveAndAvx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+
+    __cpuidex(rgiInfo, 7, 0);
+    return (rgiInfo[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif
+
+static UTF16_KERNEL s_ukMax = UK_AVX2;
+
+static UTF16_KERNEL _Utf16GetKernel()
+{
+#ifdef UTF16_USE_SSE2
+    static const UTF16_KERNEL s_ukCpu = _Utf16CpuHasAvx2() ? UK_AVX2 : UK_SSE2;
+    return (s_ukMax < s_ukCpu) ? s_ukMax : s_ukCpu;
+#else
+    return UK_SCALAR;
+#endif
+}
+
+UTF16_KERNEL Utf16SelectKernel(_In_ UTF16_KERNEL ukMax)
+{
+    s_ukMax = ukMax;
+    return _Utf16GetKernel();
+}
+
+//
+// Walks pchSrc up to and including its terminator, which must be found within the first
+// cchMax + 1 characters.  With fCopy, every character read is also written to pchDest, so the
+// caller gets length, surrogate check and copy from a single pass.
+//
+// With fFind, the same pass also records the first specials.chFirst and the last
+// specials.chLast it reads in *pichFirst and *pichLast (UTF16_NOT_FOUND when there is none).
+//
+// With SSE2, or AVX2 where the processor has it, aligned blocks with nothing for the scalar
+// loop to look at take one load (and one store when copying).  An aligned load never crosses a
+// page boundary, so reading a block that extends past the terminator can't fault, though it
+// can read past the end of the allocation the string is in.  Any other block goes through the
+// scalar loop, which is all there is on other targets.
+//
+template <bool fCopy, bool fFind>
+static HRESULT _Utf16Walk(
+    _In_ const char16_t *pchSrc,
+    _Out_writes_opt_(cchMax + 1) char16_t *pchDest,
+    _In_ size_t cchMax,
+    _In_ const UTF16_SPECIALS &specials,
+    _Out_ size_t *pcch,
+    _Out_opt_ bool *pfWellFormed,
+    _Out_opt_ size_t *pichFirst,
+    _Out_opt_ size_t *pichLast
+    )
+{
+    const UTF16_KERNEL uk = _Utf16GetKernel();
+
+    bool fPendingHighSurrogate = false;
+    bool fWellFormed = true;
+    size_t i = 0;
+
+    *pcch = 0;
+    if (fFind)
+    {
+        *pichFirst = UTF16_NOT_FOUND;
+        *pichLast = UTF16_NOT_FOUND;
+    }
+
+    while (i <= cchMax)
+    {
+#ifdef UTF16_USE_SSE2
+        // A high surrogate's partner is checked by the scalar loop.
+        if (uk != UK_SCALAR && !fPendingHighSurrogate && ((ULONG_PTR)(pchSrc + i) & 15) == 0)
+        {
+            i = (uk == UK_AVX2) ? _Utf16SkipAvx2(pchSrc, pchDest, i, cchMax, specials)
+                                : _Utf16SkipSse2(pchSrc, pchDest, i, cchMax, specials);
+        }
+#endif
+
+        char16_t ch = pchSrc[i];
+        if (fCopy)
+        {
+            pchDest[i] = ch;
+        }
+
+        if (ch == 0)
+        {
+            if (pfWellFormed)
+            {
+                *pfWellFormed = fWellFormed && !fPendingHighSurrogate;
+            }
+            *pcch = i;
+            return S_OK;
+        }
+
+        if ((ch & 0xF800) == 0xD800)
+        {
+            if (UTF16_IS_HIGH_SURROGATE(ch))
+            {
+                fWellFormed = fWellFormed && !fPendingHighSurrogate;
+                fPendingHighSurrogate = true;
+            }
+            else
+            {
+                fWellFormed = fWellFormed && fPendingHighSurrogate;
+                fPendingHighSurrogate = false;
+            }
+        }
+        else if (fPendingHighSurrogate)
+        {
+            fWellFormed = false;
+            fPendingHighSurrogate = false;
+        }
+
+        if (fFind)
+        {
+            if (ch == specials.chFirst && *pichFirst == UTF16_NOT_FOUND)
+            {
+                *pichFirst = i;
+            }
+            if (ch == specials.chLast)
+            {
+                *pichLast = i;
+            }
+        }
+
+        i++;
+    }
+
+    return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+}
+
+//
+// Returns in *pcch the number of characters in pch, not including the terminator, and in
+// *pfWellFormed whether every surrogate in it is paired.  Fails if pch is longer than cchMax
+// characters.
+//
+HRESULT Utf16Scan(
+    _In_ const char16_t *pch,
+    _In_ size_t cchMax,
+    _Out_ size_t *pcch,
+    _Out_opt_ bool *pfWellFormed
+    )
+{
+    const UTF16_SPECIALS specials = { false, 0, 0 };
+    return _Utf16Walk<false, false>(pch, nullptr, cchMax, specials, pcch, pfWellFormed, nullptr, nullptr);
+}
+
+//
+// Utf16Scan that also reports where the first chFirst and the last chLast are, in the same
+// single pass.  Neither may be the terminator.
+//
+HRESULT Utf16ScanForChars(
+    _In_ const char16_t *pch,
+    _In_ size_t cchMax,
+    _In_ char16_t chFirst,
+    _In_ char16_t chLast,
+    _Out_ size_t *pcch,
+    _Out_ size_t *pichFirst,
+    _Out_ size_t *pichLast
+    )
+{
+    const UTF16_SPECIALS specials = { true, chFirst, chLast };
+    return _Utf16Walk<false, true>(pch, nullptr, cchMax, specials, pcch, nullptr, pichFirst, pichLast);
+}
+
+//
+// Copies pchSrc, including the terminator, into pchDest which holds cchDest characters, and
+// returns the length of the copy (without the terminator) in *pcch.  pchDest may be pchSrc, or
+// any other place before it in the same buffer.  If pchSrc doesn't fit, fails with
+// ERROR_INSUFFICIENT_BUFFER, having written as many characters as fit but for the first,
+// which is set to the terminator.
+//
+HRESULT Utf16Copy(
+    _Out_writes_(cchDest) char16_t *pchDest,
+    _In_ size_t cchDest,
+    _In_ const char16_t *pchSrc,
+    _Out_ size_t *pcch,
+    _Out_opt_ bool *pfWellFormed
+    )
+{
+    *pcch = 0;
+
+    if (cchDest == 0)
+    {
+        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+    }
+
+    const UTF16_SPECIALS specials = { false, 0, 0 };
+    HRESULT hr = _Utf16Walk<true, false>(pchSrc, pchDest, cchDest - 1, specials, pcch, pfWellFormed, nullptr, nullptr);
+    if (FAILED(hr))
+    {
+        pchDest[0] = 0;
+        hr = HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+    }
+
+    return hr;
+}
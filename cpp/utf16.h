@@ -0,0 +1,103 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// UTF-16 string kernels used by the helpers.  Each kernel finds the
+// terminator, reports whether the surrogates are paired and, for the copy,
+// copies the string, all in a single pass over the source.  Like
+// StringCchLengthW, they accept any UTF-16, paired surrogates or not: a
+// Windows password may hold any sequence of 16-bit units.  Whether it was
+// well formed is for the caller to judge.
+//
+// The kernels work on char16_t, so they mean the same with any compiler,
+// including those whose wchar_t is 32 bits.  The wchar_t versions the rest
+// of the code calls are thin wrappers, for where wchar_t is UTF-16.
+
+#pragma once
+
+#include <windows.h>
+#include <stdint.h>
+
+//finds the length of pch (at most cchMax characters), and whether its surrogates are paired
+HRESULT Utf16Scan(
+    _In_ const char16_t *pch,
+    _In_ size_t cchMax,
+    _Out_ size_t *pcch,
+    _Out_opt_ bool *pfWellFormed
+    );
+
+//index reported by Utf16ScanForChars for a character that does not occur
+#define UTF16_NOT_FOUND ((size_t)-1)
+
+//Utf16Scan that also finds the first chFirst and the last chLast in the same pass
+HRESULT Utf16ScanForChars(
+    _In_ const char16_t *pch,
+    _In_ size_t cchMax,
+    _In_ char16_t chFirst,
+    _In_ char16_t chLast,
+    _Out_ size_t *pcch,
+    _Out_ size_t *pichFirst,
+    _Out_ size_t *pichLast
+    );
+
+//copies pchSrc into pchDest (including the terminator) in the pass that finds its length
+HRESULT Utf16Copy(
+    _Out_writes_(cchDest) char16_t *pchDest,
+    _In_ size_t cchDest,
+    _In_ const char16_t *pchSrc,
+    _Out_ size_t *pcch,
+    _Out_opt_ bool *pfWellFormed
+    );
+
+//the vector code the kernels may use, from least to most capable
+enum UTF16_KERNEL
+{
+    UK_SCALAR,
+    UK_SSE2,
+    UK_AVX2,
+};
+
+//keeps the kernels to ukMax at most, for tests and benchmarks; returns what they now use
+UTF16_KERNEL Utf16SelectKernel(_In_ UTF16_KERNEL ukMax);
+
+#if WCHAR_MAX == 0xFFFF
+
+inline HRESULT Utf16ScanString(
+    _In_ PCWSTR pwz,
+    _In_ size_t cchMax,
+    _Out_ size_t *pcch
+    )
+{
+    return Utf16Scan(reinterpret_cast<const char16_t *>(pwz), cchMax, pcch, nullptr);
+}
+
+inline HRESULT Utf16ScanStringForChars(
+    _In_ PCWSTR pwz,
+    _In_ size_t cchMax,
+    _In_ wchar_t wchFirst,
+    _In_ wchar_t wchLast,
+    _Out_ size_t *pcch,
+    _Out_ size_t *pichFirst,
+    _Out_ size_t *pichLast
+    )
+{
+    return Utf16ScanForChars(reinterpret_cast<const char16_t *>(pwz), cchMax, (char16_t)wchFirst, (char16_t)wchLast,
+                             pcch, pichFirst, pichLast);
+}
+
+inline HRESULT Utf16CopyString(
+    _Out_writes_(cchDest) PWSTR pwzDest,
+    _In_ size_t cchDest,
+    _In_ PCWSTR pwzSrc,
+    _Out_ size_t *pcch
+    )
+{
+    return Utf16Copy(reinterpret_cast<char16_t *>(pwzDest), cchDest, reinterpret_cast<const char16_t *>(pwzSrc),
+                     pcch, nullptr);
+}
+
+#endif
@@ -0,0 +1,18 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The wrapper's own tile fields.
+
+#include "wrapperfields.h"
+
+const WRAPPER_FIELD g_rgWrapperFields[] =
+{
+    { { WFI_USE_SSO, CPFT_CHECKBOX, L"Use SSO", {0} }, CPFS_DISPLAY_IN_SELECTED_TILE, CPFIS_NONE },
+};
+
+static_assert(ARRAYSIZE(g_rgWrapperFields) == WFI_NUM_FIELDS, "g_rgWrapperFields needs one entry per WRAPPER_FIELD_INDEX");
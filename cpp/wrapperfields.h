@@ -0,0 +1,68 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The fields the wrapper adds to each tile, after all of the wrapped
+// credential's own.  A tile field ID below the wrapped descriptor count
+// belongs to the wrapped credential and keeps its ID; the ones above it
+// index g_rgWrapperFields.
+
+#pragma once
+
+#pragma warning(push)
+#pragma warning(disable: 28251)
+#include <credentialprovider.h>
+#pragma warning(pop)
+
+#include <windows.h>
+
+// Add new wrapper fields here, and a matching entry to g_rgWrapperFields and to the
+// credential's handler table.
+enum WRAPPER_FIELD_INDEX
+{
+    WFI_USE_SSO,
+    WFI_NUM_FIELDS
+};
+
+struct WRAPPER_FIELD
+{
+    CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR        cpfd;   // dwFieldID is the WRAPPER_FIELD_INDEX
+    CREDENTIAL_PROVIDER_FIELD_STATE             cpfs;
+    CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis;
+};
+
+extern const WRAPPER_FIELD g_rgWrapperFields[WFI_NUM_FIELDS];
+
+enum FIELD_ROUTE
+{
+    FR_WRAPPED,     // *pdwRoutedID is the wrapped credential's field ID
+    FR_WRAPPER,     // *pdwRoutedID is a WRAPPER_FIELD_INDEX
+    FR_NONE,        // not a field of this tile
+};
+
+// Maps a tile field ID to its owner with one compare and one subtraction.
+inline FIELD_ROUTE RouteFieldID(
+    _In_ DWORD dwFieldID,
+    _In_ DWORD dwWrappedDescriptorCount,
+    _Out_ DWORD *pdwRoutedID
+    )
+{
+    if (dwFieldID < dwWrappedDescriptorCount)
+    {
+        *pdwRoutedID = dwFieldID;
+        return FR_WRAPPED;
+    }
+
+    *pdwRoutedID = dwFieldID - dwWrappedDescriptorCount;
+    return (*pdwRoutedID < WFI_NUM_FIELDS) ? FR_WRAPPER : FR_NONE;
+}
+
+// The tile field ID of a wrapper field.
+inline DWORD WrapperFieldID(_In_ DWORD dwWrappedDescriptorCount, _In_ WRAPPER_FIELD_INDEX wfi)
+{
+    return dwWrappedDescriptorCount + wfi;
+}
@@ -0,0 +1,152 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// authpackagecachetest calls RetrieveNegotiateAuthPackage in
+// cpp/lsabackend.cpp from many threads at once, with LocalLsaBackend in
+// place of the LSA, and checks that the backend is asked only once, and
+// that a lookup that fails is retried rather than remembered.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -pthread
+//       -I tests/win32 -I cpp -o authpackagecachetest tests/authpackagecachetest.cpp cpp/lsabackend.cpp
+
+#include "lsabackend.h"
+#include "testutil.h"
+
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const ULONG c_ulAuthPackage = 42;
+static const DWORD c_dwLatency = 50;
+static const int c_cThreads = 8;
+static const int c_cCallsPerThread = 1000;
+static const int c_cFailingCallsPerThread = 20;
+
+// Fails every lookup, as the LSA does when it cannot be reached.
+class FailingLsaBackend : public LsaBackend
+{
+public:
+    FailingLsaBackend() : _cLookups(0)
+    {
+    }
+
+    HRESULT LookupAuthenticationPackage(_In_ PCSTR pszPackageName, _Out_ ULONG *pulAuthPackage)
+    {
+        TEST_CHECK(0 == strcmp(pszPackageName, "Negotiate"));
+        _cLookups++;
+        Sleep(1);
+        *pulAuthPackage = 0xBAD;
+        return E_UNEXPECTED;
+    }
+
+    LONG GetLookups() const
+    {
+        return _cLookups;
+    }
+
+private:
+    std::atomic<LONG> _cLookups;
+};
+
+// Stands in for the LSA backend in lsauntrustedbackend.cpp, which the DLL links instead.
+static LsaBackend *s_pbackend;
+
+LsaBackend *GetDefaultLsaBackend()
+{
+    return s_pbackend;
+}
+
+//
+// Runs cCalls calls on each of c_cThreads threads, all released at once so the first
+// lookup is still sleeping in the backend while the others arrive.  Returns how many succeeded;
+// every call that failed must have failed with hrExpected and left the ID zeroed.
+//
+static int _CallFromThreads(int cCalls, HRESULT hrExpected)
+{
+    std::atomic<bool> fGo(false);
+    std::atomic<int> cSucceeded(0);
+    std::vector<std::thread> vthreads;
+
+    for (int iThread = 0; iThread < c_cThreads; iThread++)
+    {
+        vthreads.emplace_back([&]()
+        {
+            while (!fGo)
+            {
+                std::this_thread::yield();
+            }
+
+            for (int iCall = 0; iCall < cCalls; iCall++)
+            {
+                ULONG ulAuthPackage = 0xFFFFFFFF;
+                HRESULT hr = RetrieveNegotiateAuthPackage(&ulAuthPackage);
+                if (SUCCEEDED(hr))
+                {
+                    TEST_CHECK(ulAuthPackage == c_ulAuthPackage);
+                    cSucceeded++;
+                }
+                else
+                {
+                    TEST_CHECK(hr == hrExpected);
+                    TEST_CHECK(ulAuthPackage == 0);
+                }
+            }
+        });
+    }
+
+    fGo = true;
+    for (std::thread &rthread : vthreads)
+    {
+        rthread.join();
+    }
+
+    return cSucceeded;
+}
+
+int main()
+{
+    // While the LSA cannot be reached, every call fails and goes back to it: none is answered
+    // from the cache, whether with the failure or with whatever the backend left behind.
+    FailingLsaBackend failing;
+    s_pbackend = &failing;
+
+    ULONG ulAuthPackage = 0xFFFFFFFF;
+    TEST_CHECK(RetrieveNegotiateAuthPackage(&ulAuthPackage) == E_UNEXPECTED);
+    TEST_CHECK(ulAuthPackage == 0);
+    TEST_CHECK(failing.GetLookups() == 1);
+
+    TEST_CHECK(_CallFromThreads(c_cFailingCallsPerThread, E_UNEXPECTED) == 0);
+    TEST_CHECK(failing.GetLookups() == 1 + c_cThreads * c_cFailingCallsPerThread);
+
+    // Once it can, the first lookup to succeed is the last one made, however many threads ask.
+    LocalLsaBackend local(c_ulAuthPackage, c_dwLatency);
+    s_pbackend = &local;
+
+    TEST_CHECK(_CallFromThreads(c_cCallsPerThread, S_OK) == c_cThreads * c_cCallsPerThread);
+    TEST_CHECK(local.GetLookups() == 1);
+
+    // Even should the backend start failing again.
+    s_pbackend = &failing;
+    LONG cFailingLookups = failing.GetLookups();
+    TEST_CHECK(SUCCEEDED(RetrieveNegotiateAuthPackage(&ulAuthPackage)));
+    TEST_CHECK(ulAuthPackage == c_ulAuthPackage);
+    TEST_CHECK(failing.GetLookups() == cFailingLookups);
+
+    // A cache of its own looks its own package up, once.
+    AUTH_PACKAGE_CACHE cache = AUTH_PACKAGE_CACHE_INIT("Kerberos");
+    LocalLsaBackend other(7, 0);
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_CHECK(SUCCEEDED(AuthPackageCacheLookup(&cache, &other, &ulAuthPackage)));
+        TEST_CHECK(ulAuthPackage == 7);
+    }
+    TEST_CHECK(other.GetLookups() == 1);
+
+    return TestFinish("authpackagecachetest");
+}
@@ -0,0 +1,146 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// credentialcachetest plays LogonUI against cpp/credentialcache.cpp: it
+// enumerates a wrapped provider's tiles the way GetCredentialCount and
+// GetCredentialAt drive the cache, again after tiles come and go, and
+// checks which wrappers are reused and which are released.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o credentialcachetest tests/credentialcachetest.cpp cpp/credentialcache.cpp
+
+#include "credentialcache.h"
+#include "testutil.h"
+
+#include <vector>
+
+// Stands in for both the wrapped credentials and the wrappers; only the references matter.
+class TestCredential : public ICredentialProviderCredential
+{
+public:
+    TestCredential() : _cRef(1)
+    {
+    }
+
+    ULONG AddRef()
+    {
+        return ++_cRef;
+    }
+
+    ULONG Release()
+    {
+        return --_cRef;
+    }
+
+    ULONG GetRefs() const
+    {
+        return _cRef;
+    }
+
+private:
+    ULONG _cRef;
+};
+
+// The wrapped provider's tiles, and the wrapper made for each.
+struct TILE
+{
+    TestCredential  credential;
+    TestCredential  wrapper;
+};
+
+//
+// One enumeration by LogonUI: the count, then every tile.  A tile the cache has no wrapper for
+// gets its own, as GetCredentialAt makes them.  LogonUI's references are released straight
+// away, so what remains is the cache's.  Returns the number of wrappers the cache found.
+//
+static DWORD _Enumerate(CredentialCache *pcache, const std::vector<TILE*> &rgpTiles)
+{
+    pcache->BeginEnumeration();
+
+    DWORD cFound = 0;
+    for (TILE *ptile : rgpTiles)
+    {
+        ICredentialProviderCredential *pcpcWrapper;
+        if (pcache->Find(&ptile->credential, &pcpcWrapper))
+        {
+            TEST_CHECK(pcpcWrapper == &ptile->wrapper);
+            cFound++;
+        }
+        else
+        {
+            TEST_CHECK(pcpcWrapper == NULL);
+            TEST_CHECK(SUCCEEDED(pcache->Add(&ptile->credential, &ptile->wrapper)));
+            pcpcWrapper = &ptile->wrapper;
+            pcpcWrapper->AddRef();
+        }
+        pcpcWrapper->Release();
+    }
+
+    return cFound;
+}
+
+// Whether the cache holds a reference on the tile, and on its wrapper.
+static bool _IsCached(const TILE &rtile)
+{
+    TEST_CHECK(rtile.credential.GetRefs() == rtile.wrapper.GetRefs());
+    return rtile.wrapper.GetRefs() == 2;
+}
+
+int main()
+{
+    TILE rgTiles[8];
+    CredentialCache cache;
+
+    // The first enumeration wraps every tile, the second finds them all.
+    std::vector<TILE*> rgpTiles = { &rgTiles[0], &rgTiles[1], &rgTiles[2] };
+    TEST_CHECK(_Enumerate(&cache, rgpTiles) == 0);
+    TEST_CHECK(cache.GetCount() == 3);
+    TEST_CHECK(_Enumerate(&cache, rgpTiles) == 3);
+    TEST_CHECK(cache.GetCount() == 3);
+
+    // A connection goes away: its wrapper is released when LogonUI next enumerates, and only
+    // then, since until that enumeration is over there is no telling it from a tile not yet
+    // asked for.
+    rgpTiles = { &rgTiles[0], &rgTiles[2] };
+    TEST_CHECK(_Enumerate(&cache, rgpTiles) == 2);
+    TEST_CHECK(_IsCached(rgTiles[1]));
+    TEST_CHECK(_Enumerate(&cache, rgpTiles) == 2);
+    TEST_CHECK(!_IsCached(rgTiles[1]));
+    TEST_CHECK(_IsCached(rgTiles[0]) && _IsCached(rgTiles[2]));
+    TEST_CHECK(cache.GetCount() == 2);
+
+    // A tile coming back after it was swept gets wrapped again.
+    rgpTiles = { &rgTiles[1], &rgTiles[2] };
+    TEST_CHECK(_Enumerate(&cache, rgpTiles) == 1);
+    TEST_CHECK(_Enumerate(&cache, rgpTiles) == 2);
+    TEST_CHECK(!_IsCached(rgTiles[0]));
+    TEST_CHECK(cache.GetCount() == 2);
+
+    // Tiles churning through many enumerations never grow the cache past the ones shown.
+    for (DWORD i = 0; i < 1000; i++)
+    {
+        rgpTiles = { &rgTiles[3 + i % 5], &rgTiles[3 + (i + 1) % 5] };
+        _Enumerate(&cache, rgpTiles);
+        TEST_CHECK(cache.GetCount() <= 4);
+    }
+
+    // An enumeration that LogonUI abandons after the count releases everything on the next.
+    cache.BeginEnumeration();
+    cache.BeginEnumeration();
+    TEST_CHECK(cache.GetCount() == 0);
+
+    TEST_CHECK(_Enumerate(&cache, rgpTiles) == 0);
+    cache.Clear();
+    TEST_CHECK(cache.GetCount() == 0);
+    for (const TILE &rtile : rgTiles)
+    {
+        TEST_CHECK(!_IsCached(rtile));
+    }
+
+    return TestFinish("credentialcachetest");
+}
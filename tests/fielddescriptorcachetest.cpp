@@ -0,0 +1,310 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// fielddescriptorcachetest fills cpp/fielddescriptorcache.cpp from a fake
+// wrapped provider that counts the calls it is forwarded, and with a
+// counting allocator of its own: what a fill asks the provider for and
+// allocates, that a new usage scenario replaces the set, that our own
+// fields are renumbered after the wrapped ones, and that a provider
+// failing partway leaves the cache empty.  LeakSanitizer checks that
+// every descriptor the provider handed out is freed.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o fielddescriptorcachetest tests/fielddescriptorcachetest.cpp
+//       cpp/fielddescriptorcache.cpp cpp/allocator.cpp cpp/securearena.cpp cpp/utf16.cpp
+
+#include "fielddescriptorcache.h"
+#include "testutil.h"
+
+#include <vector>
+
+// A wrapped provider with a different set of fields for each usage scenario.
+class FakeProvider : public ICredentialProvider
+{
+public:
+    FakeProvider() :
+        _cpus(CPUS_INVALID),
+        _cCountCalls(0),
+        _cAtCalls(0),
+        _dwFailAt(c_dwNever),
+        _fReturnNull(false)
+    {
+    }
+
+    ULONG AddRef()
+    {
+        return 1;
+    }
+
+    ULONG Release()
+    {
+        return 1;
+    }
+
+    HRESULT SetUsageScenario(CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus, DWORD dwFlags)
+    {
+        UNREFERENCED_PARAMETER(dwFlags);
+        _cpus = cpus;
+        return S_OK;
+    }
+
+    HRESULT GetFieldDescriptorCount(DWORD *pdwCount)
+    {
+        _cCountCalls++;
+        *pdwCount = _GetCount();
+        return S_OK;
+    }
+
+    // As LogonUI expects: the struct and its label in two CoTaskMemAlloc allocations.
+    HRESULT GetFieldDescriptorAt(DWORD dwIndex, CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd)
+    {
+        _cAtCalls++;
+        *ppcpfd = nullptr;
+        if (dwIndex >= _GetCount())
+        {
+            return E_INVALIDARG;
+        }
+        if (dwIndex == _dwFailAt)
+        {
+            return _fReturnNull ? S_OK : E_OUTOFMEMORY;
+        }
+
+        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR cpfd = {};
+        cpfd.dwFieldID = dwIndex;
+        cpfd.cpft = (dwIndex == 0) ? CPFT_TILE_IMAGE : CPFT_EDIT_TEXT;
+        cpfd.guidFieldType.Data1 = 0x1000 + dwIndex;
+
+        std::vector<wchar_t> vwchLabel = GetLabel(dwIndex);
+        cpfd.pszLabel = vwchLabel.data();
+        TEST_CHECK(SUCCEEDED(FieldDescriptorCoAllocCopy(cpfd, ppcpfd)));
+        return S_OK;
+    }
+
+    // The label of the wrapped field at dwIndex in the current scenario.
+    std::vector<wchar_t> GetLabel(DWORD dwIndex) const
+    {
+        std::vector<wchar_t> vwch;
+        for (const wchar_t *pwch = (_cpus == CPUS_CREDUI) ? L"CredUI " : L"Logon "; *pwch; pwch++)
+        {
+            vwch.push_back(*pwch);
+        }
+        vwch.push_back((wchar_t)(L'A' + dwIndex));
+        vwch.push_back(L'\0');
+        return vwch;
+    }
+
+    void FailAt(DWORD dwIndex, bool fReturnNull)
+    {
+        _dwFailAt = dwIndex;
+        _fReturnNull = fReturnNull;
+    }
+
+    int GetCountCalls() const
+    {
+        return _cCountCalls;
+    }
+
+    int GetAtCalls() const
+    {
+        return _cAtCalls;
+    }
+
+    void ResetCalls()
+    {
+        _cCountCalls = 0;
+        _cAtCalls = 0;
+    }
+
+private:
+    static const DWORD c_dwNever = 0xFFFFFFFF;
+
+    DWORD _GetCount() const
+    {
+        return (_cpus == CPUS_CREDUI) ? 3 : 5;
+    }
+
+    CREDENTIAL_PROVIDER_USAGE_SCENARIO  _cpus;
+    int                                 _cCountCalls;
+    int                                 _cAtCalls;
+    DWORD                               _dwFailAt;
+    bool                                _fReturnNull;
+};
+
+// The fields the wrapper adds, numbered as in wrapperfields.h before the cache renumbers them.
+static PWSTR const c_pwzSso = const_cast<PWSTR>(L"Sign in with SSO");
+
+static const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR c_rgcpfdExtra[] =
+{
+    { 0, CPFT_CHECKBOX, c_pwzSso, { 0x2000 } },
+    { 1, CPFT_SMALL_TEXT, nullptr, { 0x2001 } },
+};
+
+static size_t _Length(PCWSTR pwz)
+{
+    size_t cch = 0;
+    while (pwz[cch])
+    {
+        cch++;
+    }
+    return cch;
+}
+
+static bool _Equal(PCWSTR pwz1, PCWSTR pwz2)
+{
+    size_t cch = _Length(pwz1);
+    return cch == _Length(pwz2) && 0 == memcmp(pwz1, pwz2, cch * sizeof(wchar_t));
+}
+
+// The cache holds the provider's fields for its current scenario, then the extras renumbered.
+static void _CheckContents(const FieldDescriptorCache &cache, const FakeProvider &provider, DWORD ccpfdWrapped)
+{
+    TEST_CHECK(cache.IsFilled());
+    TEST_CHECK(cache.GetWrappedCount() == ccpfdWrapped);
+    TEST_CHECK(cache.GetCount() == ccpfdWrapped + ARRAYSIZE(c_rgcpfdExtra));
+
+    for (DWORD i = 0; i < ccpfdWrapped; i++)
+    {
+        const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd = cache.GetAt(i);
+        TEST_CHECK(pcpfd && pcpfd->dwFieldID == i && pcpfd->guidFieldType.Data1 == 0x1000 + i);
+        TEST_CHECK(pcpfd && _Equal(pcpfd->pszLabel, provider.GetLabel(i).data()));
+    }
+
+    for (DWORD i = 0; i < ARRAYSIZE(c_rgcpfdExtra); i++)
+    {
+        const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd = cache.GetAt(ccpfdWrapped + i);
+        TEST_CHECK(pcpfd && pcpfd->dwFieldID == ccpfdWrapped + i);
+        TEST_CHECK(pcpfd && pcpfd->cpft == c_rgcpfdExtra[i].cpft);
+        TEST_CHECK(pcpfd && pcpfd->guidFieldType.Data1 == c_rgcpfdExtra[i].guidFieldType.Data1);
+        if (c_rgcpfdExtra[i].pszLabel)
+        {
+            // A copy, not the caller's string.
+            TEST_CHECK(pcpfd && pcpfd->pszLabel != c_rgcpfdExtra[i].pszLabel);
+            TEST_CHECK(pcpfd && _Equal(pcpfd->pszLabel, c_rgcpfdExtra[i].pszLabel));
+        }
+        else
+        {
+            TEST_CHECK(pcpfd && pcpfd->pszLabel == nullptr);
+        }
+    }
+
+    TEST_CHECK(cache.GetAt(cache.GetCount()) == nullptr);
+}
+
+//
+// A fill asks the provider for the count and each field once, frees every descriptor it was
+// handed, and allocates twice of its own (the scratch array and the block), freeing only the
+// scratch array.  Setting another scenario and filling again replaces the whole set.
+//
+static void _CheckFillAndRefill()
+{
+    FakeProvider provider;
+    CountingAllocator allocator(GetCoTaskMemAllocator());
+    FieldDescriptorCache cache(&allocator);
+    TEST_CHECK(!cache.IsFilled() && cache.GetCount() == 0);
+
+    TEST_CHECK(SUCCEEDED(provider.SetUsageScenario(CPUS_LOGON, 0)));
+    TEST_CHECK(SUCCEEDED(cache.Fill(&provider, c_rgcpfdExtra, ARRAYSIZE(c_rgcpfdExtra))));
+    TEST_CHECK(provider.GetCountCalls() == 1 && provider.GetAtCalls() == 5);
+    TEST_CHECK(allocator.GetAllocs() == 2 && allocator.GetFrees() == 1);
+    _CheckContents(cache, provider, 5);
+
+    // LogonUI laying out the tile again is answered from the cache.
+    provider.ResetCalls();
+    for (int iLayout = 0; iLayout < 10; iLayout++)
+    {
+        for (DWORD i = 0; i < cache.GetCount(); i++)
+        {
+            CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd;
+            TEST_CHECK(SUCCEEDED(cache.CopyAt(i, &pcpfd)));
+            TEST_CHECK(pcpfd && pcpfd->dwFieldID == i);
+            TEST_CHECK(pcpfd && (!pcpfd->pszLabel || pcpfd->pszLabel != cache.GetAt(i)->pszLabel));
+            if (pcpfd)
+            {
+                CoTaskMemFree(pcpfd->pszLabel);
+                CoTaskMemFree(pcpfd);
+            }
+        }
+    }
+    TEST_CHECK(provider.GetCountCalls() == 0 && provider.GetAtCalls() == 0);
+    TEST_CHECK(allocator.GetAllocs() == 2 && allocator.GetFrees() == 1);
+
+    CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *pcpfd;
+    TEST_CHECK(cache.CopyAt(cache.GetCount(), &pcpfd) == E_INVALIDARG && pcpfd == nullptr);
+
+    // A new scenario: the old block goes, and the SSO field moves down to follow fewer fields.
+    TEST_CHECK(SUCCEEDED(provider.SetUsageScenario(CPUS_CREDUI, 0)));
+    TEST_CHECK(SUCCEEDED(cache.Fill(&provider, c_rgcpfdExtra, ARRAYSIZE(c_rgcpfdExtra))));
+    TEST_CHECK(provider.GetCountCalls() == 1 && provider.GetAtCalls() == 3);
+    TEST_CHECK(allocator.GetAllocs() == 4 && allocator.GetFrees() == 3);
+    _CheckContents(cache, provider, 3);
+    TEST_CHECK(cache.GetAt(3)->cpft == CPFT_CHECKBOX && cache.GetAt(3)->dwFieldID == 3);
+
+    cache.Clear();
+    TEST_CHECK(!cache.IsFilled() && cache.GetCount() == 0 && cache.GetWrappedCount() == 0);
+    TEST_CHECK(allocator.GetFrees() == 4);
+    TEST_CHECK(cache.CopyAt(0, &pcpfd) == E_UNEXPECTED && pcpfd == nullptr);
+}
+
+//
+// A provider that fails partway, or succeeds without a descriptor, fails the fill: the cache is
+// left empty, what it held before is gone, and every descriptor already handed out is freed
+// (LeakSanitizer checks that last).
+//
+static void _CheckFailurePartway(DWORD dwFailAt, bool fReturnNull)
+{
+    FakeProvider provider;
+    CountingAllocator allocator(GetCoTaskMemAllocator());
+    FieldDescriptorCache cache(&allocator);
+
+    TEST_CHECK(SUCCEEDED(provider.SetUsageScenario(CPUS_LOGON, 0)));
+    TEST_CHECK(SUCCEEDED(cache.Fill(&provider, c_rgcpfdExtra, ARRAYSIZE(c_rgcpfdExtra))));
+
+    provider.ResetCalls();
+    provider.FailAt(dwFailAt, fReturnNull);
+    HRESULT hr = cache.Fill(&provider, c_rgcpfdExtra, ARRAYSIZE(c_rgcpfdExtra));
+    TEST_CHECK(hr == (fReturnNull ? E_UNEXPECTED : E_OUTOFMEMORY));
+
+    // Nothing asked for past the failure, and of ours only the scratch array, freed again.
+    TEST_CHECK(provider.GetAtCalls() == (int)dwFailAt + 1);
+    TEST_CHECK(allocator.GetAllocs() == 3 && allocator.GetFrees() == 3);
+    TEST_CHECK(!cache.IsFilled() && cache.GetCount() == 0 && cache.GetAt(0) == nullptr);
+}
+
+// Without wrapped fields there is no scratch array, and the extras are numbered from zero.
+static void _CheckNoWrappedFields()
+{
+    class EmptyProvider : public FakeProvider
+    {
+    public:
+        HRESULT GetFieldDescriptorCount(DWORD *pdwCount)
+        {
+            *pdwCount = 0;
+            return S_OK;
+        }
+    };
+
+    EmptyProvider provider;
+    CountingAllocator allocator(GetCoTaskMemAllocator());
+    FieldDescriptorCache cache(&allocator);
+
+    TEST_CHECK(SUCCEEDED(cache.Fill(&provider, c_rgcpfdExtra, ARRAYSIZE(c_rgcpfdExtra))));
+    TEST_CHECK(provider.GetAtCalls() == 0);
+    TEST_CHECK(allocator.GetAllocs() == 1 && allocator.GetFrees() == 0);
+    _CheckContents(cache, provider, 0);
+}
+
+int main()
+{
+    _CheckFillAndRefill();
+    _CheckFailurePartway(0, false);
+    _CheckFailurePartway(2, false);
+    _CheckFailurePartway(4, true);
+    _CheckNoWrappedFields();
+
+    return TestFinish("fielddescriptorcachetest");
+}
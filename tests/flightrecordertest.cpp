@@ -0,0 +1,277 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// flightrecordertest records into the ring in cpp/flightrecorder.cpp, over
+// a file mapped with mmap in place of flightrecorderfile.cpp, and reads the
+// file back with cpp/flightreader.h, as tools/flightdump.cpp does.  It
+// checks that a process killed while recording leaves its ring in the
+// file, that the ring keeps the newest events once it has wrapped, from
+// many threads, and that slots a writer never finished, or that a newer
+// event has taken, are told apart from complete ones.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -pthread
+//       -I tests/win32 -I cpp -o flightrecordertest tests/flightrecordertest.cpp cpp/flightrecorder.cpp
+
+#include "flightrecorder.h"
+#include "flightreader.h"
+#include "testutil.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+static const DWORD c_cSlots = 256;
+
+// The file FlightMapFile makes, and its mapping.
+static char                 s_szPath[64];
+static int                  s_fd = -1;
+static FLIGHT_FILE_HEADER   *s_pffhMapped;
+
+static size_t _GetFileSize()
+{
+    return sizeof(FLIGHT_FILE_HEADER) + c_cSlots * sizeof(FLIGHT_SLOT);
+}
+
+// As in flightrecorderfile.cpp: a new file, all zero, shared with whoever reads it.
+FLIGHT_FILE_HEADER *FlightMapFile(_Out_ DWORD *pcEvents)
+{
+    *pcEvents = 0;
+
+    s_fd = open(s_szPath, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (s_fd < 0 || ftruncate(s_fd, _GetFileSize()) != 0)
+    {
+        return NULL;
+    }
+
+    void *pv = mmap(NULL, _GetFileSize(), PROT_READ | PROT_WRITE, MAP_SHARED, s_fd, 0);
+    if (pv == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    s_pffhMapped = static_cast<FLIGHT_FILE_HEADER *>(pv);
+    *pcEvents = c_cSlots;
+    return s_pffhMapped;
+}
+
+void FlightUnmapFile(_In_ FLIGHT_FILE_HEADER *pffh)
+{
+    TEST_CHECK(pffh == s_pffhMapped);
+    munmap(pffh, _GetFileSize());
+    close(s_fd);
+    s_pffhMapped = NULL;
+    s_fd = -1;
+}
+
+// Reads the file from disk, as flightdump does once the process is gone.
+static bool _ReadRing(std::vector<uint8_t> *pvb, FLIGHT_RING *pring)
+{
+    FILE *pf = fopen(s_szPath, "rb");
+    if (!pf)
+    {
+        return false;
+    }
+
+    uint8_t rgb[4096];
+    size_t cb;
+    while ((cb = fread(rgb, 1, sizeof(rgb), pf)) > 0)
+    {
+        pvb->insert(pvb->end(), rgb, rgb + cb);
+    }
+    fclose(pf);
+
+    const char *pszError;
+    bool fOk = FlightRingOpen(pvb->data(), pvb->size(), pring, &pszError);
+    if (!fOk)
+    {
+        fprintf(stderr, "flightrecordertest: %s\n", pszError);
+    }
+    return fOk;
+}
+
+static void _Record(ULONGLONG ullObject, DWORD dwFieldID)
+{
+    FlightRecord(TEID_CREDENTIAL_GET_STRING_VALUE, (dwFieldID & 1) ? TPH_END : TPH_BEGIN, ullObject, dwFieldID,
+                 (HRESULT)dwFieldID);
+}
+
+//
+// A child process records past the end of the ring twice over and is killed without closing
+// anything.  What it recorded is in the file: the newest c_cSlots events, every one complete.
+//
+static void _CheckKilled()
+{
+    const DWORD cEvents = c_cSlots * 2 + 77;
+
+    FILETIME ftStart;
+    GetSystemTimeAsFileTime(&ftStart);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        for (DWORD i = 0; i < cEvents; i++)
+        {
+            _Record(i, i);
+        }
+        raise(SIGKILL);
+    }
+
+    int iStatus;
+    TEST_CHECK(pid > 0 && waitpid(pid, &iStatus, 0) == pid);
+    TEST_CHECK(WIFSIGNALED(iStatus) && WTERMSIG(iStatus) == SIGKILL);
+
+    FILETIME ftEnd;
+    GetSystemTimeAsFileTime(&ftEnd);
+    ULONGLONG ullStart = ((ULONGLONG)ftStart.dwHighDateTime << 32) | ftStart.dwLowDateTime;
+    ULONGLONG ullEnd = ((ULONGLONG)ftEnd.dwHighDateTime << 32) | ftEnd.dwLowDateTime;
+
+    std::vector<uint8_t> vb;
+    FLIGHT_RING ring;
+    TEST_CHECK(_ReadRing(&vb, &ring));
+    if (vb.empty())
+    {
+        return;
+    }
+
+    TEST_CHECK(ring.ffh.dwProcessId == (DWORD)pid);
+    TEST_CHECK(ring.ffh.cSlots == c_cSlots && ring.ffh.ullNext == cEvents);
+    TEST_CHECK(ring.ullFirst == cEvents - c_cSlots);
+
+    uint64_t ullTimestamp = 0;
+    for (uint64_t ullEvent = ring.ullFirst; ullEvent < ring.ffh.ullNext; ullEvent++)
+    {
+        FLIGHT_SLOT slot;
+        TEST_CHECK(FlightRingRead(ring, ullEvent, &slot) == FES_COMPLETE);
+        TEST_CHECK(slot.rec.ullObject == ullEvent && slot.rec.dwFieldID == ullEvent && slot.rec.hr == (int32_t)ullEvent);
+        TEST_CHECK(slot.rec.usEventID == TEID_CREDENTIAL_GET_STRING_VALUE);
+        TEST_CHECK(slot.rec.usPhase == ((ullEvent & 1) ? TPH_END : TPH_BEGIN));
+        TEST_CHECK(slot.rec.ullTimestamp >= ullTimestamp);
+        ullTimestamp = slot.rec.ullTimestamp;
+
+        uint64_t ullTime = FlightRingGetTime(ring, slot.rec);
+        TEST_CHECK(ullTime + 10000 >= ullStart && ullTime <= ullEnd + 10000);
+    }
+
+    unlink(s_szPath);
+}
+
+//
+// Threads record many times round the ring; then a writer is made to look as if it died
+// before publishing, and another as if it overtook the reader.  The newest events are kept,
+// each thread's in the order it recorded them, and only the damaged slots are not complete.
+//
+static void _CheckWrap()
+{
+    const int cThreads = 4;
+    const DWORD cEventsPerThread = c_cSlots * 4 + 13;
+
+    std::vector<std::thread> vthreads;
+    for (int iThread = 0; iThread < cThreads; iThread++)
+    {
+        vthreads.emplace_back([iThread, cEventsPerThread]()
+        {
+            for (DWORD i = 0; i < cEventsPerThread; i++)
+            {
+                _Record((ULONGLONG)iThread << 32 | i, i);
+            }
+        });
+    }
+    for (std::thread &rthread : vthreads)
+    {
+        rthread.join();
+    }
+
+    FLIGHT_FILE_HEADER *pffh = s_pffhMapped;
+    TEST_CHECK(pffh && pffh->ullNext == (ULONGLONG)cThreads * cEventsPerThread);
+    if (!pffh)
+    {
+        return;
+    }
+
+    //
+    // A writer that took the next event number and died: its slot still holds the event from
+    // one lap before.  One that died after writing half a record into a slot: the same.  And
+    // a slot a newer event has taken, as a reader copying the file while recording goes on sees.
+    //
+    FLIGHT_SLOT *rgslots = reinterpret_cast<FLIGHT_SLOT *>(pffh + 1);
+    uint64_t ullDied = pffh->ullNext++;
+    uint64_t ullTorn = pffh->ullNext - 10;
+    uint64_t ullOvertaken = pffh->ullNext - 20;
+    rgslots[ullTorn % c_cSlots].ullSequence = ullTorn + 1 - c_cSlots;
+    rgslots[ullTorn % c_cSlots].rec.dwFieldID = 0xFFFFFFF0;
+    rgslots[ullOvertaken % c_cSlots].ullSequence = ullOvertaken + 1 + c_cSlots;
+
+    FlightClose();
+    TEST_CHECK(s_pffhMapped == NULL && s_fd == -1);
+
+    // Closed, the recorder records nothing.
+    _Record(0, 0);
+
+    std::vector<uint8_t> vb;
+    FLIGHT_RING ring;
+    TEST_CHECK(_ReadRing(&vb, &ring));
+    if (vb.empty())
+    {
+        return;
+    }
+
+    TEST_CHECK(ring.ffh.dwProcessId == GetCurrentProcessId());
+    TEST_CHECK(ring.ffh.ullNext == (ULONGLONG)cThreads * cEventsPerThread + 1);
+    TEST_CHECK(ring.ullFirst == ring.ffh.ullNext - c_cSlots);
+
+    DWORD rgdwNext[cThreads] = {};
+    DWORD cComplete = 0;
+    for (uint64_t ullEvent = ring.ullFirst; ullEvent < ring.ffh.ullNext; ullEvent++)
+    {
+        FLIGHT_SLOT slot;
+        FLIGHT_EVENT_STATE fes = FlightRingRead(ring, ullEvent, &slot);
+        if (ullEvent == ullDied || ullEvent == ullTorn)
+        {
+            TEST_CHECK(fes == FES_INCOMPLETE);
+        }
+        else if (ullEvent == ullOvertaken)
+        {
+            TEST_CHECK(fes == FES_OVERWRITTEN);
+        }
+        else
+        {
+            TEST_CHECK(fes == FES_COMPLETE);
+            int iThread = (int)(slot.rec.ullObject >> 32);
+            DWORD i = (DWORD)slot.rec.ullObject;
+            TEST_CHECK(iThread >= 0 && iThread < cThreads);
+            if (iThread >= 0 && iThread < cThreads)
+            {
+                TEST_CHECK(i >= rgdwNext[iThread] && i < cEventsPerThread && slot.rec.dwFieldID == i);
+                rgdwNext[iThread] = i + 1;
+            }
+            cComplete++;
+        }
+    }
+    TEST_CHECK(cComplete == c_cSlots - 3);
+
+    // The newest event is the last one some thread recorded.
+    FLIGHT_SLOT slot;
+    TEST_CHECK(FlightRingRead(ring, ullDied - 1, &slot) == FES_COMPLETE);
+    TEST_CHECK((DWORD)slot.rec.ullObject == cEventsPerThread - 1);
+
+    unlink(s_szPath);
+}
+
+int main()
+{
+    snprintf(s_szPath, sizeof(s_szPath), "/tmp/flightrecordertest.%d.flight", (int)getpid());
+
+    // First, while this process hasn't opened the recorder, so the child opens its own.
+    _CheckKilled();
+    _CheckWrap();
+
+    return TestFinish("flightrecordertest");
+}
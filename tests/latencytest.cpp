@@ -0,0 +1,249 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// latencytest records calls into the per-thread histograms of
+// cpp/latency.cpp from many threads and checks that LatencyGetSnapshot
+// adds them up: counts, totals, maxima and buckets, from threads still
+// running and from threads that are gone, and that a snapshot taken while
+// threads record never goes backwards or counts a call that wasn't made.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -pthread
+//       -I tests/win32 -I cpp -o latencytest tests/latencytest.cpp cpp/latency.cpp
+
+#include "latency.h"
+#include "logger.h"
+#include "testutil.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static const int c_cThreads = 8;
+static const int c_cCallsPerThread = 20000;
+
+// The configuration turns the histograms on, and nothing else.
+LONG RegGetValueW(HKEY hkey, PCWSTR pwzSubKey, PCWSTR pwzValue, DWORD dwFlags, DWORD *pdwType, PVOID pvData,
+                  DWORD *pcbData)
+{
+    UNREFERENCED_PARAMETER(hkey);
+    UNREFERENCED_PARAMETER(pwzSubKey);
+    UNREFERENCED_PARAMETER(pdwType);
+
+    static const WCHAR c_wzEnabled[] = RASPWRAP_LATENCY_ENABLED_VALUE;
+    if (dwFlags == RRF_RT_REG_DWORD && *pcbData == sizeof(DWORD) &&
+        0 == memcmp(pwzValue, c_wzEnabled, sizeof(c_wzEnabled)))
+    {
+        *(DWORD *)pvData = 1;
+        return ERROR_SUCCESS;
+    }
+    return ERROR_FILE_NOT_FOUND;
+}
+
+// Stands in for the log's writer, which the DLL starts to dump the histograms.
+void LogEnsureWriter()
+{
+}
+
+// The ticks thread iThread records for its iCall'th call: spread over many buckets, and
+// different on every thread, so a histogram counted twice or not at all shows.
+static ULONGLONG _SelfTicks(int iThread, int iCall)
+{
+    return (ULONGLONG)(iCall % 97) * (iCall % 13 + 1) * (iThread + 1) + (ULONGLONG)iThread;
+}
+
+static ULONGLONG _WrappedTicks(int iThread, int iCall)
+{
+    return (ULONGLONG)1 << ((iCall + iThread) % 40);
+}
+
+// Every third call makes a call into the wrapped provider.
+static bool _IsWrapped(int iCall)
+{
+    return iCall % 3 == 0;
+}
+
+static void _Add(_Inout_ LATENCY_HISTOGRAM *phist, _In_ ULONGLONG ullTicks)
+{
+    phist->cCalls++;
+    phist->ullTotalTicks += ullTicks;
+    phist->ullMaxTicks = max(phist->ullMaxTicks, ullTicks);
+    phist->rgcBuckets[LatencyBucketFromTicks(ullTicks)]++;
+}
+
+static bool _Equal(const LATENCY_HISTOGRAM &hist1, const LATENCY_HISTOGRAM &hist2)
+{
+    return 0 == memcmp(&hist1, &hist2, sizeof(hist1));
+}
+
+static std::unique_ptr<LATENCY_SNAPSHOT> _Snapshot()
+{
+    std::unique_ptr<LATENCY_SNAPSHOT> psnap(new LATENCY_SNAPSHOT);
+    TEST_CHECK(LatencyGetSnapshot(psnap.get()) == S_OK);
+    return psnap;
+}
+
+// One thread's calls, against the same calls added up by hand.
+static void _CheckOneThread()
+{
+    const LATENCY_METHOD lm = LM_CREDENTIAL_CONNECT;
+    LATENCY_HISTOGRAM histSelf = {};
+    LATENCY_HISTOGRAM histWrapped = {};
+
+    std::thread thread([&]()
+    {
+        for (int iCall = 0; iCall < 1000; iCall++)
+        {
+            LatencyRecord(lm, _SelfTicks(0, iCall), _IsWrapped(iCall), _WrappedTicks(0, iCall));
+            _Add(&histSelf, _SelfTicks(0, iCall));
+            if (_IsWrapped(iCall))
+            {
+                _Add(&histWrapped, _WrappedTicks(0, iCall));
+            }
+        }
+    });
+    thread.join();
+
+    std::unique_ptr<LATENCY_SNAPSHOT> psnap = _Snapshot();
+    TEST_CHECK(_Equal(psnap->rghist[lm][LK_SELF], histSelf));
+    TEST_CHECK(_Equal(psnap->rghist[lm][LK_WRAPPED], histWrapped));
+    TEST_CHECK(histWrapped.cCalls == 334);
+
+    // Nothing else was called.
+    LATENCY_HISTOGRAM histEmpty = {};
+    TEST_CHECK(_Equal(psnap->rghist[LM_CREDENTIAL_DISCONNECT][LK_SELF], histEmpty));
+}
+
+//
+// Threads record while the snapshots are taken.  Each thread's counts only grow, so neither
+// may the sums: a snapshot never goes back on one before it, nor has more calls than were made
+// in all.  Once the threads are gone, their histograms are still in the snapshot, and add up
+// to exactly what each recorded.
+//
+static void _CheckMerge()
+{
+    const LATENCY_METHOD lm = LM_PROVIDER_GET_CREDENTIAL_AT;
+    std::vector<LATENCY_HISTOGRAM> vhistSelf(c_cThreads, LATENCY_HISTOGRAM());
+    std::vector<LATENCY_HISTOGRAM> vhistWrapped(c_cThreads, LATENCY_HISTOGRAM());
+
+    std::atomic<bool> fGo(false);
+    std::atomic<int> cRunning(c_cThreads);
+    std::vector<std::thread> vthreads;
+    for (int iThread = 0; iThread < c_cThreads; iThread++)
+    {
+        vthreads.emplace_back([&, iThread]()
+        {
+            while (!fGo)
+            {
+                std::this_thread::yield();
+            }
+
+            for (int iCall = 0; iCall < c_cCallsPerThread; iCall++)
+            {
+                LatencyRecord(lm, _SelfTicks(iThread, iCall), _IsWrapped(iCall), _WrappedTicks(iThread, iCall));
+                _Add(&vhistSelf[iThread], _SelfTicks(iThread, iCall));
+                if (_IsWrapped(iCall))
+                {
+                    _Add(&vhistWrapped[iThread], _WrappedTicks(iThread, iCall));
+                }
+            }
+            cRunning--;
+        });
+    }
+
+    fGo = true;
+    LATENCY_HISTOGRAM histLast = {};
+    int cSnapshots = 0;
+    do
+    {
+        std::unique_ptr<LATENCY_SNAPSHOT> psnap = _Snapshot();
+        const LATENCY_HISTOGRAM &hist = psnap->rghist[lm][LK_SELF];
+
+        ULONGLONG cBucketed = 0;
+        for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++)
+        {
+            TEST_CHECK(hist.rgcBuckets[i] >= histLast.rgcBuckets[i]);
+            cBucketed += hist.rgcBuckets[i];
+        }
+        TEST_CHECK(hist.cCalls >= histLast.cCalls);
+        TEST_CHECK(hist.ullTotalTicks >= histLast.ullTotalTicks);
+        TEST_CHECK(hist.ullMaxTicks >= histLast.ullMaxTicks);
+        TEST_CHECK(hist.cCalls <= (ULONGLONG)c_cThreads * c_cCallsPerThread);
+        TEST_CHECK(cBucketed <= (ULONGLONG)c_cThreads * c_cCallsPerThread);
+
+        histLast = hist;
+        cSnapshots++;
+    } while (cRunning);
+
+    for (std::thread &rthread : vthreads)
+    {
+        rthread.join();
+    }
+
+    LATENCY_HISTOGRAM histSelf = {};
+    LATENCY_HISTOGRAM histWrapped = {};
+    for (int iThread = 0; iThread < c_cThreads; iThread++)
+    {
+        for (const auto &rpair : { std::make_pair(&histSelf, &vhistSelf[iThread]),
+                                   std::make_pair(&histWrapped, &vhistWrapped[iThread]) })
+        {
+            rpair.first->cCalls += rpair.second->cCalls;
+            rpair.first->ullTotalTicks += rpair.second->ullTotalTicks;
+            rpair.first->ullMaxTicks = max(rpair.first->ullMaxTicks, rpair.second->ullMaxTicks);
+            for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++)
+            {
+                rpair.first->rgcBuckets[i] += rpair.second->rgcBuckets[i];
+            }
+        }
+    }
+
+    std::unique_ptr<LATENCY_SNAPSHOT> psnap = _Snapshot();
+    TEST_CHECK(histSelf.cCalls == (ULONGLONG)c_cThreads * c_cCallsPerThread);
+    TEST_CHECK(_Equal(psnap->rghist[lm][LK_SELF], histSelf));
+    TEST_CHECK(_Equal(psnap->rghist[lm][LK_WRAPPED], histWrapped));
+    TEST_CHECK(cSnapshots > 0);
+}
+
+// LatencyScope counts the call once, and the wrapped part only if there was one.
+static void _CheckScope()
+{
+    std::thread thread([]()
+    {
+        {
+            LatencyScope latency(LM_PROVIDER_ADVISE);
+        }
+        {
+            LatencyScope latency(LM_PROVIDER_UNADVISE);
+            latency.EnterWrapped();
+            latency.LeaveWrapped();
+            latency.EnterWrapped();
+            latency.LeaveWrapped();
+        }
+    });
+    thread.join();
+
+    std::unique_ptr<LATENCY_SNAPSHOT> psnap = _Snapshot();
+    TEST_CHECK(psnap->rghist[LM_PROVIDER_ADVISE][LK_SELF].cCalls == 1);
+    TEST_CHECK(psnap->rghist[LM_PROVIDER_ADVISE][LK_WRAPPED].cCalls == 0);
+    TEST_CHECK(psnap->rghist[LM_PROVIDER_UNADVISE][LK_SELF].cCalls == 1);
+    TEST_CHECK(psnap->rghist[LM_PROVIDER_UNADVISE][LK_WRAPPED].cCalls == 1);
+}
+
+int main()
+{
+    TEST_CHECK(LatencyIsEnabled());
+
+    _CheckOneThread();
+    _CheckMerge();
+    _CheckScope();
+
+    // Frees the blocks of every thread, gone or not; the sanitizer reports any left behind.
+    LatencyUnload();
+
+    return TestFinish("latencytest");
+}
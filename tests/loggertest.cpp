@@ -0,0 +1,376 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// loggertest logs through cpp/logger.cpp, with the registry, file, thread
+// pool timer and bcrypt calls in tests/win32 in place of Windows', and
+// reads the log file back.  It checks that what is logged reaches the file,
+// from the background writer or from LogShutdown, in order from every
+// thread, with secrets redacted, and that a full ring drops messages and
+// says how many.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -pthread
+//       -I tests/win32 -I cpp -o loggertest tests/loggertest.cpp cpp/logger.cpp
+//
+// Usage: loggertest [--bench]
+//
+// --bench times each call on the caller's thread, from one thread and from
+// several, against the logger it replaced, which opened, appended to and
+// closed the file on every call.
+
+#include "logger.h"
+#include "testutil.h"
+
+#include <stdarg.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The ring in logger.cpp.
+static const int c_cLogSlots = 256;
+
+// The log file the configuration names, and the one the old logger appends to.
+static char     s_szPath[64];
+static WCHAR    s_wszPath[64];
+static char     s_szOldPath[64];
+
+// The configuration turns the log on, into s_wszPath.
+LONG RegGetValueW(HKEY hkey, PCWSTR pwzSubKey, PCWSTR pwzValue, DWORD dwFlags, DWORD *pdwType, PVOID pvData,
+                  DWORD *pcbData)
+{
+    UNREFERENCED_PARAMETER(hkey);
+    UNREFERENCED_PARAMETER(pwzSubKey);
+    UNREFERENCED_PARAMETER(pdwType);
+
+    static const WCHAR c_wzEnabled[] = RASPWRAP_LOG_ENABLED_VALUE;
+    static const WCHAR c_wzFile[] = RASPWRAP_LOG_FILE_VALUE;
+    if (dwFlags == RRF_RT_REG_DWORD && *pcbData == sizeof(DWORD) &&
+        0 == memcmp(pwzValue, c_wzEnabled, sizeof(c_wzEnabled)))
+    {
+        *(DWORD *)pvData = 1;
+        return ERROR_SUCCESS;
+    }
+    if (dwFlags == RRF_RT_REG_SZ && *pcbData >= sizeof(s_wszPath) &&
+        0 == memcmp(pwzValue, c_wzFile, sizeof(c_wzFile)))
+    {
+        memcpy(pvData, s_wszPath, sizeof(s_wszPath));
+        return ERROR_SUCCESS;
+    }
+    return ERROR_FILE_NOT_FOUND;
+}
+
+HINSTANCE g_hinst;
+
+// Stand in for the trace and the latency histograms, which the writer also empties.
+static std::atomic<int> s_cTraceDrains(0);
+
+void TraceDrain()
+{
+    s_cTraceDrains++;
+}
+
+void TraceClose()
+{
+}
+
+void LatencyDump()
+{
+}
+
+void LatencyClose()
+{
+}
+
+// The logger Log() replaced, as it was in helpers.cpp, with the file open each call.
+static void _OldLog(const char *fmt, ...)
+{
+    FILE *f = fopen(s_szOldPath, "a+");
+    if (f == NULL)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(f, fmt, args);
+    va_end(args);
+
+    fclose(f);
+}
+
+static std::vector<std::string> _ReadLines(const char *pszPath)
+{
+    std::vector<std::string> vstr;
+    FILE *pf = fopen(pszPath, "rb");
+    if (!pf)
+    {
+        return vstr;
+    }
+
+    std::string str;
+    int ch;
+    while ((ch = fgetc(pf)) != EOF)
+    {
+        str.push_back((char)ch);
+        if (ch == '\n')
+        {
+            vstr.push_back(str);
+            str.clear();
+        }
+    }
+    if (!str.empty())
+    {
+        vstr.push_back(str);
+    }
+    fclose(pf);
+    return vstr;
+}
+
+static std::string _Format(const char *fmt, ...)
+{
+    char sz[600];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(sz, sizeof(sz), fmt, args);
+    va_end(args);
+    return sz;
+}
+
+//
+// What is logged is written as it was formatted, each line tagged with its level and category,
+// and secrets are redacted: LogShutdown writes out what the writer hadn't yet.
+//
+static void _CheckShutdownWrites()
+{
+    unlink(s_szPath);
+
+    Log<LL_ERROR, LC_PROVIDER>("GetCredentialAt: %lu hr=%08x\n", 3ul, (unsigned int)E_INVALIDARG);
+    Log<LL_WARNING, LC_CREDENTIAL>("user %s, password %s\n", LogSecret(L"alice"), LogSecret(L"hunter2"));
+    Log<LL_WARNING, LC_EVENTS>("%d %s\n", -7, LogSecret(NULL));
+    LogShutdown();
+
+    std::vector<std::string> vstr = _ReadLines(s_szPath);
+    TEST_CHECK(vstr.size() == 3);
+    if (vstr.size() == 3)
+    {
+        TEST_CHECK(vstr[0] == "[E provider] GetCredentialAt: 3 hr=80070057\n");
+        TEST_CHECK(vstr[1] == "[W credential] user <secret>, password <secret>\n");
+        TEST_CHECK(vstr[2] == "[W events] -7 (null)\n");
+    }
+
+    // A message longer than its slot is cut short.
+    unlink(s_szPath);
+    std::string strLong(1000, 'x');
+    Log<LL_ERROR, LC_DLL>("%s\n", strLong.c_str());
+    LogShutdown();
+
+    vstr = _ReadLines(s_szPath);
+    TEST_CHECK(vstr.size() == 1 && vstr[0].size() == 499 && vstr[0].compare(0, 6, "[E dll") == 0);
+}
+
+// Without LogShutdown, the background writer gets there by itself.
+static void _CheckWriterWrites()
+{
+    unlink(s_szPath);
+    int cTraceDrains = s_cTraceDrains;
+
+    Log<LL_ERROR, LC_DLL>("by the writer\n");
+
+    std::vector<std::string> vstr;
+    for (int i = 0; i < 50 && vstr.empty(); i++)
+    {
+        Sleep(20);
+        vstr = _ReadLines(s_szPath);
+    }
+    TEST_CHECK(vstr.size() == 1 && vstr[0] == "[E dll] by the writer\n");
+    TEST_CHECK(s_cTraceDrains > cTraceDrains);
+
+    LogShutdown();
+}
+
+//
+// Threads log at once, as many messages as the ring holds: each is written once, and each
+// thread's in the order it logged them.
+//
+static void _CheckThreads()
+{
+    const int cThreads = 4;
+    const int cPerThread = c_cLogSlots / cThreads;
+
+    unlink(s_szPath);
+    LogShutdown();
+
+    std::atomic<bool> fGo(false);
+    std::vector<std::thread> vthreads;
+    for (int iThread = 0; iThread < cThreads; iThread++)
+    {
+        vthreads.emplace_back([&, iThread]()
+        {
+            while (!fGo)
+            {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < cPerThread; i++)
+            {
+                Log<LL_WARNING, LC_PROVIDER>("thread %d message %d\n", iThread, i);
+            }
+        });
+    }
+    fGo = true;
+    for (std::thread &rthread : vthreads)
+    {
+        rthread.join();
+    }
+    LogShutdown();
+
+    std::vector<std::string> vstr = _ReadLines(s_szPath);
+    TEST_CHECK(vstr.size() == (size_t)cThreads * cPerThread);
+
+    int rgiNext[cThreads] = {};
+    for (const std::string &rstr : vstr)
+    {
+        int iThread = -1;
+        int i = -1;
+        TEST_CHECK(sscanf(rstr.c_str(), "[W provider] thread %d message %d\n", &iThread, &i) == 2);
+        TEST_CHECK(iThread >= 0 && iThread < cThreads);
+        if (iThread >= 0 && iThread < cThreads)
+        {
+            TEST_CHECK(i == rgiNext[iThread]);
+            rgiNext[iThread] = i + 1;
+        }
+    }
+}
+
+// Once the ring is full, messages are dropped rather than waited for, and the log says so.
+static void _CheckDropped()
+{
+    const int cExtra = 10;
+
+    unlink(s_szPath);
+    LogShutdown();
+
+    // Well within the writer's first 200ms.
+    for (int i = 0; i < c_cLogSlots + cExtra; i++)
+    {
+        Log<LL_WARNING, LC_PROVIDER>("message %d\n", i);
+    }
+    LogShutdown();
+
+    std::vector<std::string> vstr = _ReadLines(s_szPath);
+    TEST_CHECK(vstr.size() == c_cLogSlots + 1);
+    if (vstr.size() == c_cLogSlots + 1)
+    {
+        TEST_CHECK(vstr[0] == _Format("[%d log messages dropped]\r\n", cExtra));
+        TEST_CHECK(vstr[1] == "[W provider] message 0\n");
+        TEST_CHECK(vstr[c_cLogSlots] == _Format("[W provider] message %d\n", c_cLogSlots - 1));
+    }
+}
+
+//
+// Each call is timed on the thread that makes it, in rounds the ring can hold, with the log
+// written out between rounds; every message must reach the file, so none is dropped.
+//
+template <typename TLog>
+static void _TimeCalls(const char *pszName, const char *pszPath, int cThreads, TLog log)
+{
+    const int cRounds = 100;
+    const int cPerRound = 200 / cThreads;
+
+    unlink(pszPath);
+    LogShutdown();
+
+    std::vector<std::vector<double> > vvdNs(cThreads);
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        std::vector<std::thread> vthreads;
+        for (int iThread = 0; iThread < cThreads; iThread++)
+        {
+            vthreads.emplace_back([&, iThread]()
+            {
+                for (int i = 0; i < cPerRound; i++)
+                {
+                    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+                    log(iThread, i);
+                    vvdNs[iThread].push_back(
+                        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tStart).count());
+                }
+            });
+        }
+        for (std::thread &rthread : vthreads)
+        {
+            rthread.join();
+        }
+        LogShutdown();
+    }
+
+    std::vector<double> vdNs;
+    for (const std::vector<double> &rvd : vvdNs)
+    {
+        vdNs.insert(vdNs.end(), rvd.begin(), rvd.end());
+    }
+    std::sort(vdNs.begin(), vdNs.end());
+
+    double dTotal = 0;
+    for (double d : vdNs)
+    {
+        dTotal += d;
+    }
+    printf("%s, %d thread(s): mean %8.0f ns, median %8.0f ns, 99th %8.0f ns, max %8.0f ns\n", pszName, cThreads,
+           dTotal / vdNs.size(), vdNs[vdNs.size() / 2], vdNs[vdNs.size() * 99 / 100], vdNs.back());
+
+    TEST_CHECK(_ReadLines(pszPath).size() == (size_t)cRounds * cPerRound * cThreads);
+    unlink(pszPath);
+}
+
+static void _Bench()
+{
+    const int rgcThreads[] = { 1, 4 };
+    for (int cThreads : rgcThreads)
+    {
+        _TimeCalls("old log()", s_szOldPath, cThreads, [](int iThread, int i)
+        {
+            _OldLog("GetStringValue: thread %d field %d hr=%08x\n", iThread, i, (unsigned int)S_OK);
+        });
+        _TimeCalls("Log<>()  ", s_szPath, cThreads, [](int iThread, int i)
+        {
+            Log<LL_WARNING, LC_CREDENTIAL>("GetStringValue: thread %d field %d hr=%08x\n", iThread, i,
+                                           (unsigned int)S_OK);
+        });
+    }
+}
+
+int main(int argc, char **argv)
+{
+    snprintf(s_szPath, sizeof(s_szPath), "/tmp/loggertest.%d.log", (int)getpid());
+    snprintf(s_szOldPath, sizeof(s_szOldPath), "/tmp/loggertest.%d.old.log", (int)getpid());
+    for (size_t i = 0; i < sizeof(s_szPath); i++)
+    {
+        s_wszPath[i] = (WCHAR)(unsigned char)s_szPath[i];
+    }
+
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("loggertest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: loggertest [--bench]\n");
+        return 2;
+    }
+
+    _CheckShutdownWrites();
+    _CheckWriterWrites();
+    _CheckThreads();
+    _CheckDropped();
+
+    unlink(s_szPath);
+    return TestFinish("loggertest");
+}
@@ -0,0 +1,128 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// logleveltest builds cpp/logger.h with the warning level and without the
+// events category, and checks that a Log() call that is not compiled in
+// neither reaches LogWrite nor formats its arguments, and that its format
+// string is not in the executable at all.  The last part needs the
+// optimizer, so build with at least -O1:
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o logleveltest tests/logleveltest.cpp
+
+#define RASPWRAP_LOG_LEVEL          LL_WARNING
+#define RASPWRAP_LOG_CATEGORIES     (~LOG_CATEGORY_MASK(LC_EVENTS))
+
+#include "logger.h"
+#include "testutil.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Without the optimizer the empty calls, and their strings, stay.
+#if defined(__GNUC__) && !defined(__OPTIMIZE__)
+static const bool c_fOptimized = false;
+#else
+static const bool c_fOptimized = true;
+#endif
+
+static int s_cLogWrites;
+static int s_cLogFormatStrings;
+
+void LogWrite(_In_ LOG_LEVEL, _In_ LOG_CATEGORY, _In_ const char *, ...)
+{
+    s_cLogWrites++;
+}
+
+void LogFormatString(_In_ const LOG_STRING &, _Out_writes_(cch) char *psz, _In_ size_t cch)
+{
+    s_cLogFormatStrings++;
+    snprintf(psz, cch, "<secret>");
+}
+
+// The markers are spelled out only in the Log() calls; the copies the scan looks for are put
+// together at run time, so they never show up in the executable themselves.
+static std::string _Marker(const char *pszWhat)
+{
+    return std::string("logleveltest-") + pszWhat + "-marker";
+}
+
+static bool _ReadFile(const char *pszPath, std::vector<char> *pvch)
+{
+    FILE *pf = fopen(pszPath, "rb");
+    if (!pf)
+    {
+        return false;
+    }
+
+    char rgch[65536];
+    size_t cch;
+    while ((cch = fread(rgch, 1, sizeof(rgch), pf)) > 0)
+    {
+        pvch->insert(pvch->end(), rgch, rgch + cch);
+    }
+
+    bool fOk = !ferror(pf);
+    fclose(pf);
+    return fOk;
+}
+
+static bool _Contains(const std::vector<char> &vch, const std::string &str)
+{
+    return std::search(vch.begin(), vch.end(), str.begin(), str.end()) != vch.end();
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+
+    static WCHAR s_wszPassword[] = L"pw";
+
+    // Compiled in: the level is kept, and so is the category.
+    Log<LL_ERROR, LC_PROVIDER>("logleveltest-enabled-marker %d %s\n", 1, LogSecret(s_wszPassword));
+    TEST_CHECK(s_cLogWrites == 1);
+    TEST_CHECK(s_cLogFormatStrings == 1);
+
+    // Not compiled in: too verbose, in a kept category...
+    Log<LL_VERBOSE, LC_PROVIDER>("logleveltest-verbose-marker %d %s\n", 2, LogSecret(s_wszPassword));
+    Log<LL_INFO, LC_CREDENTIAL>("logleveltest-info-marker %d %s\n", 3, LogPublic(s_wszPassword));
+
+    // ...or at a kept level, in a category that isn't.
+    Log<LL_ERROR, LC_EVENTS>("logleveltest-category-marker %d %s\n", 4, LogSecret(s_wszPassword));
+
+    // Never a level.
+    Log<LL_NONE, LC_DLL>("logleveltest-none-marker\n");
+
+    TEST_CHECK(s_cLogWrites == 1);
+    TEST_CHECK(s_cLogFormatStrings == 1);
+
+    static_assert(LogIsCompiledIn<LL_WARNING, LC_DLL>::value, "warnings are kept");
+    static_assert(!LogIsCompiledIn<LL_INFO, LC_DLL>::value, "info is not");
+    static_assert(!LogIsCompiledIn<LL_ERROR, LC_EVENTS>::value, "nor is the events category");
+
+    if (!c_fOptimized)
+    {
+        printf("logleveltest: not optimized, the executable is not scanned\n");
+    }
+    else
+    {
+        std::vector<char> vchImage;
+        TEST_CHECK(_ReadFile(argv[0], &vchImage));
+
+        // The scan only means something if it finds the string that is compiled in.
+        TEST_CHECK(_Contains(vchImage, _Marker("enabled")));
+        TEST_CHECK(!_Contains(vchImage, _Marker("verbose")));
+        TEST_CHECK(!_Contains(vchImage, _Marker("info")));
+        TEST_CHECK(!_Contains(vchImage, _Marker("category")));
+        TEST_CHECK(!_Contains(vchImage, _Marker("none")));
+    }
+
+    return TestFinish("logleveltest");
+}
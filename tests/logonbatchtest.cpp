@@ -0,0 +1,267 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// logonbatchtest packs credentials with KerbInteractiveUnlockLogonPackBatch,
+// in cpp/logonpack.cpp, on one thread and on several, and checks every blob
+// in the arena is the one KerbInteractiveUnlockLogonInit and
+// KerbInteractiveUnlockLogonPack make for the same credential.  It also
+// checks the arena size query, and that a bad entry, a short arena or a
+// misaligned one fails the batch.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -pthread
+//       -I tests/win32 -I cpp -o logonbatchtest tests/logonbatchtest.cpp cpp/logonpack.cpp cpp/allocator.cpp
+//       cpp/securearena.cpp cpp/utf16.cpp
+//
+// Usage: logonbatchtest [--bench]
+//
+// --bench reports the blobs per second of the batch, on one thread and on
+// several, against packing each credential with its own allocation.
+
+#include "logonpack.h"
+#include "testutil.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// The credentials of a batch, and the entries that point at them.
+struct Batch
+{
+    std::vector<std::vector<WCHAR>>     vvwchStrings;
+    std::vector<KERB_LOGON_BATCH_ENTRY> ventries;
+};
+
+// cEntries credentials of varied lengths, the first scenarios LogonUI and CredUI use in turn.
+static void _MakeBatch(DWORD cEntries, Batch *pbatch)
+{
+    static const CREDENTIAL_PROVIDER_USAGE_SCENARIO c_rgcpus[] = { CPUS_LOGON, CPUS_UNLOCK_WORKSTATION, CPUS_CREDUI };
+
+    pbatch->vvwchStrings.clear();
+    pbatch->vvwchStrings.reserve(cEntries * 3);
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        // Built from narrow strings: with -fshort-wchar neither the C library's wide string functions
+        // nor std::wstring can be used.
+        char szIndex[16];
+        snprintf(szIndex, sizeof(szIndex), "%u", i);
+        std::string strDomain = (i % 4) ? "CONTOSO" : "corp.contoso.com";
+        std::string strUsername = std::string("user") + szIndex;
+        std::string strPassword = std::string(i % 7, '*') + "password" + szIndex;
+
+        for (const std::string *pstr : { &strDomain, &strUsername, &strPassword })
+        {
+            std::vector<WCHAR> vwch(pstr->begin(), pstr->end());
+            vwch.push_back(L'\0');
+            pbatch->vvwchStrings.push_back(std::move(vwch));
+        }
+    }
+
+    pbatch->ventries.resize(cEntries);
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        KERB_LOGON_BATCH_ENTRY &rentry = pbatch->ventries[i];
+        rentry.pwzDomain = pbatch->vvwchStrings[i * 3].data();
+        rentry.pwzUsername = pbatch->vvwchStrings[i * 3 + 1].data();
+        rentry.pwzPassword = pbatch->vvwchStrings[i * 3 + 2].data();
+        rentry.cpus = c_rgcpus[i % ARRAYSIZE(c_rgcpus)];
+    }
+}
+
+// Packs the batch into *pvArena, growing it first if the batch doesn't fit.
+static HRESULT _PackBatch(const Batch &rbatch, DWORD cThreads, std::vector<KERB_INTERACTIVE_UNLOCK_LOGON> *pvArena,
+                          std::vector<KERB_LOGON_BATCH_BLOB> *pvblobs, DWORD *pcbArena)
+{
+    DWORD cEntries = (DWORD)rbatch.ventries.size();
+    pvblobs->resize(cEntries);
+
+    // The arena is made of KERB_INTERACTIVE_UNLOCK_LOGONs to have their alignment.
+    HRESULT hr = KerbInteractiveUnlockLogonPackBatch(rbatch.ventries.data(), cEntries, cThreads,
+                                                     reinterpret_cast<BYTE *>(pvArena->data()),
+                                                     (DWORD)(pvArena->size() * sizeof(KERB_INTERACTIVE_UNLOCK_LOGON)),
+                                                     pvblobs->data(), pcbArena);
+    if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER))
+    {
+        pvArena->resize(*pcbArena / sizeof(KERB_INTERACTIVE_UNLOCK_LOGON) + 1);
+        hr = KerbInteractiveUnlockLogonPackBatch(rbatch.ventries.data(), cEntries, cThreads,
+                                                 reinterpret_cast<BYTE *>(pvArena->data()), *pcbArena,
+                                                 pvblobs->data(), pcbArena);
+    }
+    return hr;
+}
+
+static void _CheckBatch(DWORD cEntries, DWORD cThreads)
+{
+    Batch batch;
+    _MakeBatch(cEntries, &batch);
+
+    std::vector<KERB_INTERACTIVE_UNLOCK_LOGON> vArena;
+    std::vector<KERB_LOGON_BATCH_BLOB> vblobs;
+    DWORD cbArena;
+    TEST_CHECK(SUCCEEDED(_PackBatch(batch, cThreads, &vArena, &vblobs, &cbArena)));
+    const BYTE *pbArena = reinterpret_cast<const BYTE *>(vArena.data());
+
+    // Each blob is where the table says, aligned, after the one before, and as the per-call path packs it.
+    DWORD dwEnd = 0;
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        const KERB_LOGON_BATCH_ENTRY &rentry = batch.ventries[i];
+        const KERB_LOGON_BATCH_BLOB &rblob = vblobs[i];
+        TEST_CHECK(rblob.dwOffset % TYPE_ALIGNMENT(KERB_INTERACTIVE_UNLOCK_LOGON) == 0);
+        TEST_CHECK(rblob.dwOffset >= dwEnd && rblob.dwOffset + rblob.cb <= cbArena);
+        dwEnd = rblob.dwOffset + rblob.cb;
+
+        KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+        TEST_CHECK(SUCCEEDED(KerbInteractiveUnlockLogonInit(rentry.pwzDomain, rentry.pwzUsername, rentry.pwzPassword,
+                                                            rentry.cpus, &kiul)));
+        TEST_CHECK(rblob.cbDomain == kiul.Logon.LogonDomainName.Length);
+        TEST_CHECK(rblob.cbUsername == kiul.Logon.UserName.Length);
+        TEST_CHECK(rblob.cbPassword == kiul.Logon.Password.Length);
+
+        BYTE *rgb;
+        DWORD cb;
+        TEST_CHECK(SUCCEEDED(KerbInteractiveUnlockLogonPack(kiul, &rgb, &cb)));
+        TEST_CHECK_BYTES(pbArena + rblob.dwOffset, rblob.cb, rgb, cb);
+        CoTaskMemFree(rgb);
+    }
+    TEST_CHECK(dwEnd <= cbArena && cbArena - dwEnd < TYPE_ALIGNMENT(KERB_INTERACTIVE_UNLOCK_LOGON));
+}
+
+static void _CheckFailures()
+{
+    Batch batch;
+    _MakeBatch(300, &batch);
+
+    std::vector<KERB_INTERACTIVE_UNLOCK_LOGON> vArena;
+    std::vector<KERB_LOGON_BATCH_BLOB> vblobs;
+    DWORD cbArena;
+    TEST_CHECK(SUCCEEDED(_PackBatch(batch, 1, &vArena, &vblobs, &cbArena)));
+    BYTE *pbArena = reinterpret_cast<BYTE *>(vArena.data());
+
+    // An empty batch needs no arena.
+    DWORD cbEmpty;
+    TEST_CHECK(SUCCEEDED(KerbInteractiveUnlockLogonPackBatch(nullptr, 0, 4, pbArena, cbArena, nullptr, &cbEmpty)));
+    TEST_CHECK(cbEmpty == 0);
+
+    // One byte short, and the arena is not touched.
+    DWORD cbNeeded;
+    memset(pbArena, 0xcc, cbArena);
+    TEST_CHECK(KerbInteractiveUnlockLogonPackBatch(batch.ventries.data(), 300, 4, pbArena, cbArena - 1, vblobs.data(),
+                                                   &cbNeeded) == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+    TEST_CHECK(cbNeeded == cbArena && pbArena[0] == 0xcc && pbArena[cbArena - 1] == 0xcc);
+
+    // A misaligned arena is refused rather than handed back with misaligned blobs.
+    TEST_CHECK(KerbInteractiveUnlockLogonPackBatch(batch.ventries.data(), 300, 4, pbArena + 1, cbArena,
+                                                   vblobs.data(), &cbNeeded) == E_INVALIDARG);
+
+    // A scenario the wrapper doesn't pack for fails the batch, whichever entry it is.
+    for (DWORD iBad : { 0u, 150u, 299u })
+    {
+        CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus = batch.ventries[iBad].cpus;
+        batch.ventries[iBad].cpus = CPUS_CHANGE_PASSWORD;
+        TEST_CHECK(KerbInteractiveUnlockLogonPackBatch(batch.ventries.data(), 300, 4, pbArena, cbArena, vblobs.data(),
+                                                       &cbNeeded) == E_FAIL);
+        TEST_CHECK(cbNeeded == 0);
+        batch.ventries[iBad].cpus = cpus;
+    }
+
+    // As does a missing string.
+    PWSTR pwzUsername = batch.ventries[42].pwzUsername;
+    batch.ventries[42].pwzUsername = nullptr;
+    TEST_CHECK(KerbInteractiveUnlockLogonPackBatch(batch.ventries.data(), 300, 4, pbArena, cbArena, vblobs.data(),
+                                                   &cbNeeded) == E_INVALIDARG);
+    batch.ventries[42].pwzUsername = pwzUsername;
+}
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+static void _Bench()
+{
+    const DWORD cEntries = 100000;
+    const int cRounds = 20;
+    DWORD cThreads = (DWORD)std::thread::hardware_concurrency();
+    cThreads = (cThreads < 2) ? 2 : cThreads;
+
+    Batch batch;
+    _MakeBatch(cEntries, &batch);
+    size_t cbTotal = 0;
+
+    // The per-call path: KerbInteractiveUnlockLogonInit, then KerbInteractiveUnlockLogonPack into a
+    // CoTaskMemAlloc buffer of its own, for each credential.
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        for (const KERB_LOGON_BATCH_ENTRY &rentry : batch.ventries)
+        {
+            KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+            BYTE *rgb;
+            DWORD cb;
+            if (SUCCEEDED(KerbInteractiveUnlockLogonInit(rentry.pwzDomain, rentry.pwzUsername, rentry.pwzPassword,
+                                                         rentry.cpus, &kiul)) &&
+                SUCCEEDED(KerbInteractiveUnlockLogonPack(kiul, &rgb, &cb)))
+            {
+                cbTotal += cb + rgb[cb - 1];
+                CoTaskMemFree(rgb);
+            }
+        }
+    }
+    double dPerCall = _Seconds(tStart);
+
+    // The batch, sized and packed each round into one arena, which the tooling keeps from one
+    // batch to the next.
+    std::vector<KERB_INTERACTIVE_UNLOCK_LOGON> vArena;
+    std::vector<KERB_LOGON_BATCH_BLOB> vblobs;
+    double rgdBatch[2];
+    const DWORD rgcThreads[2] = { 1, cThreads };
+    for (int iRun = 0; iRun < 2; iRun++)
+    {
+        tStart = std::chrono::steady_clock::now();
+        for (int iRound = 0; iRound < cRounds; iRound++)
+        {
+            DWORD cbArena;
+            if (SUCCEEDED(_PackBatch(batch, rgcThreads[iRun], &vArena, &vblobs, &cbArena)))
+            {
+                cbTotal += cbArena + reinterpret_cast<const BYTE *>(vArena.data())[cbArena - 1];
+            }
+        }
+        rgdBatch[iRun] = _Seconds(tStart);
+    }
+
+    double cBlobs = (double)cEntries * cRounds;
+    printf("per call (Init + Pack):  %10.0f blobs/s\n", cBlobs / dPerCall);
+    printf("batch, 1 thread:         %10.0f blobs/s\n", cBlobs / rgdBatch[0]);
+    printf("batch, %2u threads:       %10.0f blobs/s\n", cThreads, cBlobs / rgdBatch[1]);
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(cbTotal != 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("logonbatchtest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: logonbatchtest [--bench]\n");
+        return 2;
+    }
+
+    // Fewer entries than a chunk, a chunk and a bit, and enough for every thread to take some.
+    _CheckBatch(1, 1);
+    _CheckBatch(65, 4);
+    _CheckBatch(5000, 1);
+    _CheckBatch(5000, 8);
+    _CheckFailures();
+
+    return TestFinish("logonbatchtest");
+}
@@ -0,0 +1,400 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// logonlayouttest packs KERB_INTERACTIVE_UNLOCK_LOGON, KERB_CERTIFICATE_LOGON
+// and MSV1_0_INTERACTIVE_LOGON structures with the engine in
+// cpp/logonlayout.h, for both bitnesses whatever the target's, and checks
+// the blobs against golden ones written out byte by byte; then it unpacks
+// them again.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o logonlayouttest tests/logonlayouttest.cpp
+//
+// Usage: logonlayouttest [--bench]
+//
+// --bench packs KERB_INTERACTIVE_UNLOCK_LOGONs back to back, as a logon storm
+// does, into a new allocation each time and into one reused caller buffer,
+// and reports the time and the allocations per pack of each.
+
+#include "logonlayout.h"
+#include "testutil.h"
+
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+
+static WCHAR s_wszDomain[] = L"DOM";
+static WCHAR s_wszUser[] = L"bob";
+static WCHAR s_wszPassword[] = L"secret";
+static WCHAR s_wszPin[] = L"1234";
+static BYTE s_rgbCspData[] = { 0xde, 0xad, 0xbe, 0xef };
+
+// DOM\bob, password "secret", interactive logon with LogonId 1:0x3e7.
+static const BYTE c_rgbKerb32[] =
+{
+    0x02, 0x00, 0x00, 0x00,                                 // MessageType = KerbInteractiveLogon
+    0x06, 0x00, 0x06, 0x00, 0x24, 0x00, 0x00, 0x00,         // LogonDomainName at 36
+    0x06, 0x00, 0x06, 0x00, 0x2a, 0x00, 0x00, 0x00,         // UserName at 42
+    0x0c, 0x00, 0x0c, 0x00, 0x30, 0x00, 0x00, 0x00,         // Password at 48
+    0xe7, 0x03, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,         // LogonId
+    'D', 0, 'O', 0, 'M', 0,
+    'b', 0, 'o', 0, 'b', 0,
+    's', 0, 'e', 0, 'c', 0, 'r', 0, 'e', 0, 't', 0,
+};
+
+static const BYTE c_rgbKerb64[] =
+{
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // MessageType, padding
+    0x06, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonDomainName...
+    0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 64
+    0x06, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,         // UserName...
+    0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 70
+    0x0c, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00,         // Password...
+    0x4c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 76
+    0xe7, 0x03, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,         // LogonId
+    'D', 0, 'O', 0, 'M', 0,
+    'b', 0, 'o', 0, 'b', 0,
+    's', 0, 'e', 0, 'c', 0, 'r', 0, 'e', 0, 't', 0,
+};
+
+// DOM\bob, PIN "1234", certificate logon with flag 1 and four bytes of CSP data.
+static const BYTE c_rgbCertificate32[] =
+{
+    0x0d, 0x00, 0x00, 0x00,                                 // MessageType = KerbCertificateLogon
+    0x06, 0x00, 0x06, 0x00, 0x28, 0x00, 0x00, 0x00,         // DomainName at 40
+    0x06, 0x00, 0x06, 0x00, 0x2e, 0x00, 0x00, 0x00,         // UserName at 46
+    0x08, 0x00, 0x08, 0x00, 0x34, 0x00, 0x00, 0x00,         // Pin at 52
+    0x01, 0x00, 0x00, 0x00,                                 // Flags
+    0x04, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00,         // CspData at 60
+    'D', 0, 'O', 0, 'M', 0,
+    'b', 0, 'o', 0, 'b', 0,
+    '1', 0, '2', 0, '3', 0, '4', 0,
+    0xde, 0xad, 0xbe, 0xef,
+};
+
+static const BYTE c_rgbCertificate64[] =
+{
+    0x0d, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // MessageType, padding
+    0x06, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,         // DomainName...
+    0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 72
+    0x06, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,         // UserName...
+    0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 78
+    0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,         // Pin...
+    0x54, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 84
+    0x01, 0x00, 0x00, 0x00,                                 // Flags
+    0x04, 0x00, 0x00, 0x00,                                 // CspDataLength...
+    0x5c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...CspData at 92
+    'D', 0, 'O', 0, 'M', 0,
+    'b', 0, 'o', 0, 'b', 0,
+    '1', 0, '2', 0, '3', 0, '4', 0,
+    0xde, 0xad, 0xbe, 0xef,
+};
+
+// The same without CSP data: both the count and the offset are 0.
+static const BYTE c_rgbCertificateNoCsp32[] =
+{
+    0x0d, 0x00, 0x00, 0x00,
+    0x06, 0x00, 0x06, 0x00, 0x28, 0x00, 0x00, 0x00,
+    0x06, 0x00, 0x06, 0x00, 0x2e, 0x00, 0x00, 0x00,
+    0x08, 0x00, 0x08, 0x00, 0x34, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    'D', 0, 'O', 0, 'M', 0,
+    'b', 0, 'o', 0, 'b', 0,
+    '1', 0, '2', 0, '3', 0, '4', 0,
+};
+
+// DOM\bob, password "secret", MSV1_0 interactive logon.
+static const BYTE c_rgbMsv1_0_32[] =
+{
+    0x02, 0x00, 0x00, 0x00,                                 // MessageType = MsV1_0InteractiveLogon
+    0x06, 0x00, 0x06, 0x00, 0x1c, 0x00, 0x00, 0x00,         // LogonDomainName at 28
+    0x06, 0x00, 0x06, 0x00, 0x22, 0x00, 0x00, 0x00,         // UserName at 34
+    0x0c, 0x00, 0x0c, 0x00, 0x28, 0x00, 0x00, 0x00,         // Password at 40
+    'D', 0, 'O', 0, 'M', 0,
+    'b', 0, 'o', 0, 'b', 0,
+    's', 0, 'e', 0, 'c', 0, 'r', 0, 'e', 0, 't', 0,
+};
+
+static const BYTE c_rgbMsv1_0_64[] =
+{
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // MessageType, padding
+    0x06, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonDomainName...
+    0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 56
+    0x06, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,         // UserName...
+    0x3e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 62
+    0x0c, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00,         // Password...
+    0x44, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 68
+    'D', 0, 'O', 0, 'M', 0,
+    'b', 0, 'o', 0, 'b', 0,
+    's', 0, 'e', 0, 'c', 0, 'r', 0, 'e', 0, 't', 0,
+};
+
+// Hands out malloc memory and counts the calls, to show a pack makes exactly one allocation.
+class TestAllocator : public Allocator
+{
+public:
+    TestAllocator() : cAllocs(0), cFrees(0), cbLast(0)
+    {
+    }
+
+    HRESULT Alloc(SIZE_T cb, void **ppv)
+    {
+        cAllocs++;
+        cbLast = cb;
+        *ppv = malloc(cb);
+        return (*ppv) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    void Free(void *pv)
+    {
+        if (pv)
+        {
+            cFrees++;
+        }
+        free(pv);
+    }
+
+    int     cAllocs;
+    int     cFrees;
+    SIZE_T  cbLast;
+};
+
+static void _InitString(UNICODE_STRING *pus, PWSTR pwz, size_t cch)
+{
+    pus->Length = (USHORT)(cch * sizeof(WCHAR));
+    pus->MaximumLength = pus->Length;
+    pus->Buffer = pwz;
+}
+
+static bool _StringEquals(const UNICODE_STRING &rus, PCWSTR pwz, size_t cch)
+{
+    return rus.Length == cch * sizeof(WCHAR) && !memcmp(rus.Buffer, pwz, rus.Length);
+}
+
+//
+// Packs rNative in the TLayout format every way the engine offers (into a buffer, into a
+// misaligned buffer, and through an Allocator) and checks each result against the golden blob.
+//
+template <typename TLayout>
+static void _CheckPack(const typename TLayout::Native &rNative, const BYTE *pbGolden, size_t cbGolden)
+{
+    DWORD cb;
+    TEST_CHECK(SUCCEEDED(PackedLogonGetPackedSizeT<TLayout>(rNative, &cb)) && cb == cbGolden);
+
+    std::vector<BYTE> vb(cbGolden + 1);
+    DWORD cbWritten;
+    TEST_CHECK(SUCCEEDED(PackedLogonPackToBufferT<TLayout>(rNative, vb.data(), (DWORD)cbGolden, &cbWritten)));
+    TEST_CHECK_BYTES(vb.data(), cbWritten, pbGolden, cbGolden);
+
+    // The output needs no alignment.
+    TEST_CHECK(SUCCEEDED(PackedLogonPackToBufferT<TLayout>(rNative, vb.data() + 1, (DWORD)cbGolden, &cbWritten)));
+    TEST_CHECK_BYTES(vb.data() + 1, cbWritten, pbGolden, cbGolden);
+
+    // One byte short is too small, and nothing is written.
+    vb.assign(vb.size(), 0xcc);
+    TEST_CHECK(PackedLogonPackToBufferT<TLayout>(rNative, vb.data(), (DWORD)cbGolden - 1, &cbWritten) ==
+               HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+    TEST_CHECK(vb[0] == 0xcc);
+
+    TestAllocator allocator;
+    BYTE *rgb;
+    TEST_CHECK(SUCCEEDED(PackedLogonPackT<TLayout>(rNative, &allocator, &rgb, &cbWritten)));
+    TEST_CHECK(allocator.cAllocs == 1 && allocator.cbLast == cbGolden);
+    TEST_CHECK_BYTES(rgb, cbWritten, pbGolden, cbGolden);
+    allocator.Free(rgb);
+}
+
+// Unpacks a golden blob and returns the native structure, whose strings point into *pvb.
+template <typename TLayout>
+static typename TLayout::Native _Unpack(const BYTE *pbGolden, size_t cbGolden, std::vector<BYTE> *pvb)
+{
+    pvb->assign(pbGolden, pbGolden + cbGolden);
+
+    typename TLayout::Native native;
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<TLayout>(pvb->data(), (DWORD)pvb->size(), &native)));
+    return native;
+}
+
+static void _TestKerbInteractiveUnlockLogon()
+{
+    KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+    memset(&kiul, 0, sizeof(kiul));
+    kiul.Logon.MessageType = KerbInteractiveLogon;
+    _InitString(&kiul.Logon.LogonDomainName, s_wszDomain, 3);
+    _InitString(&kiul.Logon.UserName, s_wszUser, 3);
+    _InitString(&kiul.Logon.Password, s_wszPassword, 6);
+    kiul.LogonId.LowPart = 0x3e7;
+    kiul.LogonId.HighPart = 1;
+
+    _CheckPack<KerbLayout32>(kiul, c_rgbKerb32, sizeof(c_rgbKerb32));
+    _CheckPack<KerbLayout64>(kiul, c_rgbKerb64, sizeof(c_rgbKerb64));
+
+    std::vector<BYTE> vb;
+    KERB_INTERACTIVE_UNLOCK_LOGON kiulOut = _Unpack<KerbLayout32>(c_rgbKerb32, sizeof(c_rgbKerb32), &vb);
+    TEST_CHECK(kiulOut.Logon.MessageType == KerbInteractiveLogon);
+    TEST_CHECK(_StringEquals(kiulOut.Logon.LogonDomainName, s_wszDomain, 3));
+    TEST_CHECK(_StringEquals(kiulOut.Logon.UserName, s_wszUser, 3));
+    TEST_CHECK(_StringEquals(kiulOut.Logon.Password, s_wszPassword, 6));
+    TEST_CHECK(kiulOut.LogonId.LowPart == 0x3e7 && kiulOut.LogonId.HighPart == 1);
+    TEST_CHECK((const BYTE*)kiulOut.Logon.Password.Buffer == vb.data() + 48);
+
+    kiulOut = _Unpack<KerbLayout64>(c_rgbKerb64, sizeof(c_rgbKerb64), &vb);
+    TEST_CHECK(_StringEquals(kiulOut.Logon.Password, s_wszPassword, 6));
+    TEST_CHECK((const BYTE*)kiulOut.Logon.Password.Buffer == vb.data() + 76);
+
+    // A length without a buffer cannot be packed.
+    kiul.Logon.UserName.Buffer = nullptr;
+    DWORD cb;
+    TEST_CHECK(PackedLogonGetPackedSizeT<KerbLayout64>(kiul, &cb) == E_INVALIDARG && cb == 0);
+}
+
+static void _TestKerbCertificateLogon()
+{
+    KERB_CERTIFICATE_LOGON kcl;
+    memset(&kcl, 0, sizeof(kcl));
+    kcl.MessageType = KerbCertificateLogon;
+    _InitString(&kcl.DomainName, s_wszDomain, 3);
+    _InitString(&kcl.UserName, s_wszUser, 3);
+    _InitString(&kcl.Pin, s_wszPin, 4);
+    kcl.Flags = 1;
+    kcl.CspDataLength = sizeof(s_rgbCspData);
+    kcl.CspData = s_rgbCspData;
+
+    _CheckPack<KerbCertificateLayout32>(kcl, c_rgbCertificate32, sizeof(c_rgbCertificate32));
+    _CheckPack<KerbCertificateLayout64>(kcl, c_rgbCertificate64, sizeof(c_rgbCertificate64));
+
+    std::vector<BYTE> vb;
+    KERB_CERTIFICATE_LOGON kclOut = _Unpack<KerbCertificateLayout64>(c_rgbCertificate64, sizeof(c_rgbCertificate64), &vb);
+    TEST_CHECK(kclOut.MessageType == KerbCertificateLogon && kclOut.Flags == 1);
+    TEST_CHECK(_StringEquals(kclOut.Pin, s_wszPin, 4));
+    TEST_CHECK(kclOut.CspDataLength == sizeof(s_rgbCspData) && kclOut.CspData == vb.data() + 92);
+    TEST_CHECK(!memcmp(kclOut.CspData, s_rgbCspData, sizeof(s_rgbCspData)));
+
+    kcl.CspDataLength = 0;
+    kcl.CspData = nullptr;
+    _CheckPack<KerbCertificateLayout32>(kcl, c_rgbCertificateNoCsp32, sizeof(c_rgbCertificateNoCsp32));
+
+    kclOut = _Unpack<KerbCertificateLayout32>(c_rgbCertificateNoCsp32, sizeof(c_rgbCertificateNoCsp32), &vb);
+    TEST_CHECK(kclOut.CspDataLength == 0 && kclOut.CspData == nullptr);
+
+    // A byte count without bytes cannot be packed.
+    kcl.CspDataLength = 4;
+    DWORD cb;
+    TEST_CHECK(PackedLogonGetPackedSizeT<KerbCertificateLayout32>(kcl, &cb) == E_INVALIDARG);
+}
+
+static void _TestMsv1_0InteractiveLogon()
+{
+    MSV1_0_INTERACTIVE_LOGON mil;
+    memset(&mil, 0, sizeof(mil));
+    mil.MessageType = MsV1_0InteractiveLogon;
+    _InitString(&mil.LogonDomainName, s_wszDomain, 3);
+    _InitString(&mil.UserName, s_wszUser, 3);
+    _InitString(&mil.Password, s_wszPassword, 6);
+
+    _CheckPack<Msv1_0Layout32>(mil, c_rgbMsv1_0_32, sizeof(c_rgbMsv1_0_32));
+    _CheckPack<Msv1_0Layout64>(mil, c_rgbMsv1_0_64, sizeof(c_rgbMsv1_0_64));
+
+    std::vector<BYTE> vb;
+    MSV1_0_INTERACTIVE_LOGON milOut = _Unpack<Msv1_0Layout32>(c_rgbMsv1_0_32, sizeof(c_rgbMsv1_0_32), &vb);
+    TEST_CHECK(milOut.MessageType == MsV1_0InteractiveLogon);
+    TEST_CHECK(_StringEquals(milOut.UserName, s_wszUser, 3));
+    TEST_CHECK(_StringEquals(milOut.Password, s_wszPassword, 6));
+}
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+static void _Bench()
+{
+    const int cPacks = 5000000;
+
+    static WCHAR s_wszBenchDomain[] = L"corp.contoso.com";
+    static WCHAR s_wszBenchUser[] = L"firstname.lastname";
+    static WCHAR s_wszBenchPassword[] = L"correct horse battery staple";
+
+    KERB_INTERACTIVE_UNLOCK_LOGON kiul = {};
+    kiul.Logon.MessageType = KerbInteractiveLogon;
+    _InitString(&kiul.Logon.LogonDomainName, s_wszBenchDomain, ARRAYSIZE(s_wszBenchDomain) - 1);
+    _InitString(&kiul.Logon.UserName, s_wszBenchUser, ARRAYSIZE(s_wszBenchUser) - 1);
+    _InitString(&kiul.Logon.Password, s_wszBenchPassword, ARRAYSIZE(s_wszBenchPassword) - 1);
+    size_t cbTotal = 0;
+
+    // A buffer of its own for every pack, as KerbInteractiveUnlockLogonPack hands out...
+    TestAllocator allocator;
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int iPack = 0; iPack < cPacks; iPack++)
+    {
+        BYTE *rgb;
+        DWORD cb;
+        if (SUCCEEDED(PackedLogonPackT<KerbLayoutNative>(kiul, &allocator, &rgb, &cb)))
+        {
+            cbTotal += cb + rgb[cb - 1];
+            allocator.Free(rgb);
+        }
+    }
+    double dAlloc = _Seconds(tStart);
+
+    // ...against sizing each credential and packing it into the same caller buffer, which
+    // only allocates when it has to grow.
+    std::vector<BYTE> vb;
+    int cGrows = 0;
+    tStart = std::chrono::steady_clock::now();
+    for (int iPack = 0; iPack < cPacks; iPack++)
+    {
+        DWORD cb;
+        if (SUCCEEDED(PackedLogonGetPackedSizeT<KerbLayoutNative>(kiul, &cb)))
+        {
+            if (vb.size() < cb)
+            {
+                vb.resize(cb);
+                cGrows++;
+            }
+            DWORD cbWritten;
+            if (SUCCEEDED(PackedLogonPackToBufferT<KerbLayoutNative>(kiul, vb.data(), cb, &cbWritten)))
+            {
+                cbTotal += cbWritten + vb[cbWritten - 1];
+            }
+        }
+    }
+    double dBuffer = _Seconds(tStart);
+
+    printf("new allocation per pack: %6.1f ns, %.2f allocations per pack\n",
+           dAlloc * 1e9 / cPacks, (double)allocator.cAllocs / cPacks);
+    printf("caller buffer:           %6.1f ns, %.2f allocations per pack\n",
+           dBuffer * 1e9 / cPacks, (double)cGrows / cPacks);
+
+    TEST_CHECK(allocator.cAllocs == cPacks && allocator.cFrees == cPacks);
+    TEST_CHECK(cGrows == 1);
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(cbTotal != 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("logonlayouttest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: logonlayouttest [--bench]\n");
+        return 2;
+    }
+
+    _TestKerbInteractiveUnlockLogon();
+    _TestKerbCertificateLogon();
+    _TestMsv1_0InteractiveLogon();
+
+    return TestFinish("logonlayouttest");
+}
@@ -0,0 +1,386 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// objectpooltest creates and releases mock COM objects that derive from
+// PooledObject, as the class factory, provider and credentials do, and
+// checks cpp/objectpool.h: a warm pool makes no heap calls, the free list
+// stays within its cap, and under many threads handing objects to each
+// other no block is ever handed out twice and the counters add up.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -pthread
+//       -I tests/win32 -I cpp -o objectpooltest tests/objectpooltest.cpp
+//
+// Usage: objectpooltest [--bench]
+//
+// --bench times creating and releasing a pooled object against the same
+// object on the heap, from one thread and from many.
+
+#include "objectpool.h"
+#include "refcount.h"
+#include "credentialprovider.h"
+#include "testutil.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static const int c_cThreads = 8;
+
+//
+// A COM object about the size of a credential.  Its payload is filled with a cookie when it
+// is created and checked when the last reference goes, so two live objects sharing a block
+// show up.
+//
+template <bool fPooled>
+class MockObjectBase : public IUnknown
+{
+public:
+    explicit MockObjectBase(ULONGLONG ullCookie) :
+        _ullCookie(ullCookie)
+    {
+        for (size_t i = 0; i < ARRAYSIZE(_rgullPayload); i++)
+        {
+            _rgullPayload[i] = ullCookie + i;
+        }
+    }
+
+    ULONG AddRef()
+    {
+        return _cRef.AddRef();
+    }
+
+    ULONG Release()
+    {
+        ULONG cRef = _cRef.Release();
+        if (!cRef)
+        {
+            TEST_CHECK(IsIntact());
+            delete this;
+        }
+        return cRef;
+    }
+
+    bool IsIntact() const
+    {
+        for (size_t i = 0; i < ARRAYSIZE(_rgullPayload); i++)
+        {
+            if (_rgullPayload[i] != _ullCookie + i)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    virtual ~MockObjectBase()
+    {
+    }
+
+private:
+    RefCount    _cRef;
+    ULONGLONG   _ullCookie;
+    ULONGLONG   _rgullPayload[24];
+};
+
+class PooledMock : public MockObjectBase<true>, public PooledObject<PooledMock>
+{
+public:
+    explicit PooledMock(ULONGLONG ullCookie) :
+        MockObjectBase<true>(ullCookie)
+    {
+    }
+};
+
+// The same object, from the heap, for --bench.
+class HeapMock : public MockObjectBase<false>
+{
+public:
+    explicit HeapMock(ULONGLONG ullCookie) :
+        MockObjectBase<false>(ullCookie)
+    {
+    }
+};
+
+// A second class, so the stress test runs two pools side by side, as the DLL does.
+class PooledFactoryMock : public MockObjectBase<true>, public PooledObject<PooledFactoryMock>
+{
+public:
+    explicit PooledFactoryMock(ULONGLONG ullCookie) :
+        MockObjectBase<true>(ullCookie)
+    {
+    }
+};
+
+template <typename T>
+static OBJECT_POOL_STATS _GetStats()
+{
+    OBJECT_POOL_STATS stats;
+    ObjectPool<T>::Get().GetStats(&stats);
+    return stats;
+}
+
+// Every block came back to the pool: kept on the list, or given to the heap.  The list holds
+// what was returned and not since handed out again.
+template <typename T>
+static LONG _CheckBalanced()
+{
+    OBJECT_POOL_STATS stats = _GetStats<T>();
+    TEST_CHECK(stats.cHits + stats.cMisses == stats.cReturns + stats.cReleases);
+    return stats.cReturns - stats.cHits;
+}
+
+// Blocks are whole cache lines, objects are on a cache line boundary, and too big is refused.
+static void _CheckBlocks()
+{
+    TEST_CHECK(ObjectPool<PooledMock>::c_cbBlock % ObjectPool<PooledMock>::c_cbCacheLine == 0);
+    TEST_CHECK(ObjectPool<PooledMock>::c_cbBlock >= sizeof(PooledMock));
+    TEST_CHECK(ObjectPool<PooledMock>::c_cbBlock < sizeof(PooledMock) + ObjectPool<PooledMock>::c_cbCacheLine);
+
+    PooledMock *pmock = new (std::nothrow) PooledMock(1);
+    TEST_CHECK(pmock && (ULONG_PTR)pmock % ObjectPool<PooledMock>::c_cbCacheLine == 0);
+    pmock->Release();
+
+    TEST_CHECK(ObjectPool<PooledMock>::Get().Alloc(ObjectPool<PooledMock>::c_cbBlock + 1) == NULL);
+}
+
+//
+// Freeing more objects than the cap keeps c_cMaxFree on the list and gives the rest to the heap;
+// after that, creating and releasing up to c_cMaxFree objects at a time never misses.
+//
+static void _CheckWarmPool()
+{
+    const USHORT cMaxFree = ObjectPool<PooledMock>::c_cMaxFree;
+    const int cObjects = cMaxFree * 3;
+
+    LONG cFree = _CheckBalanced<PooledMock>();
+    OBJECT_POOL_STATS statsBefore = _GetStats<PooledMock>();
+
+    std::vector<PooledMock*> vpmock;
+    for (int i = 0; i < cObjects; i++)
+    {
+        vpmock.push_back(new (std::nothrow) PooledMock(i * 100));
+        TEST_CHECK(vpmock.back() != nullptr);
+    }
+    for (PooledMock *pmock : vpmock)
+    {
+        pmock->Release();
+    }
+
+    OBJECT_POOL_STATS stats = _GetStats<PooledMock>();
+    TEST_CHECK(stats.cHits - statsBefore.cHits == cFree);
+    TEST_CHECK(stats.cMisses - statsBefore.cMisses == cObjects - cFree);
+    TEST_CHECK(stats.cReturns - statsBefore.cReturns == cMaxFree);
+    TEST_CHECK(stats.cReleases - statsBefore.cReleases == cObjects - cMaxFree);
+    TEST_CHECK(_CheckBalanced<PooledMock>() == cMaxFree);
+
+    statsBefore = stats;
+    for (int iRound = 0; iRound < 1000; iRound++)
+    {
+        vpmock.clear();
+        for (int i = 0; i < 1 + iRound % cMaxFree; i++)
+        {
+            vpmock.push_back(new (std::nothrow) PooledMock(iRound));
+        }
+        for (PooledMock *pmock : vpmock)
+        {
+            pmock->Release();
+        }
+    }
+
+    stats = _GetStats<PooledMock>();
+    TEST_CHECK(stats.cMisses == statsBefore.cMisses);
+    TEST_CHECK(stats.cReleases == statsBefore.cReleases);
+    TEST_CHECK(stats.cHits > statsBefore.cHits);
+}
+
+//
+// Each thread creates a few objects at a time, and swaps some of them into shared slots, where
+// another thread may take a reference, drop it, or be the one to release the object last.  So
+// objects are created on one thread and returned to the pool on another, all the time.
+//
+template <typename T>
+static void _Stress(int cRounds)
+{
+    static const int c_cSlots = 16;
+    std::atomic<T*> rgpSlots[c_cSlots];
+    for (std::atomic<T*> &rp : rgpSlots)
+    {
+        rp = nullptr;
+    }
+
+    std::atomic<bool> fGo(false);
+    std::atomic<LONG> cCreated(0);
+    std::vector<std::thread> vthreads;
+
+    for (int iThread = 0; iThread < c_cThreads; iThread++)
+    {
+        vthreads.emplace_back([&, iThread]()
+        {
+            while (!fGo)
+            {
+                std::this_thread::yield();
+            }
+
+            T *rgp[40];
+            unsigned int uSeed = iThread + 1;
+            for (int iRound = 0; iRound < cRounds; iRound++)
+            {
+                uSeed = uSeed * 1103515245 + 12345;
+                int cObjects = 1 + (uSeed >> 16) % ARRAYSIZE(rgp);
+
+                for (int i = 0; i < cObjects; i++)
+                {
+                    ULONGLONG ullCookie = ((ULONGLONG)iThread << 48) | ((ULONGLONG)iRound << 8) | (ULONGLONG)i;
+                    rgp[i] = new (std::nothrow) T(ullCookie);
+                    TEST_CHECK(rgp[i] != nullptr);
+                    TEST_CHECK((ULONG_PTR)rgp[i] % ObjectPool<T>::c_cbCacheLine == 0);
+                }
+                cCreated += cObjects;
+
+                for (int i = 0; i < cObjects; i++)
+                {
+                    if (i % 4 == 0)
+                    {
+                        T *pOld = rgpSlots[(uSeed >> 8) % c_cSlots].exchange(rgp[i]);
+                        if (pOld)
+                        {
+                            TEST_CHECK(pOld->IsIntact());
+                            pOld->Release();
+                        }
+                    }
+                    else
+                    {
+                        rgp[i]->AddRef();
+                        TEST_CHECK(rgp[i]->IsIntact());
+                        rgp[i]->Release();
+                        rgp[i]->Release();
+                    }
+                }
+            }
+        });
+    }
+
+    OBJECT_POOL_STATS statsBefore = _GetStats<T>();
+    fGo = true;
+    for (std::thread &rthread : vthreads)
+    {
+        rthread.join();
+    }
+    for (std::atomic<T*> &rp : rgpSlots)
+    {
+        T *p = rp.exchange(nullptr);
+        if (p)
+        {
+            p->Release();
+        }
+    }
+
+    OBJECT_POOL_STATS stats = _GetStats<T>();
+    TEST_CHECK((stats.cHits - statsBefore.cHits) + (stats.cMisses - statsBefore.cMisses) == cCreated);
+    TEST_CHECK((stats.cReturns - statsBefore.cReturns) + (stats.cReleases - statsBefore.cReleases) == cCreated);
+
+    // The cap is only checked before each push, so every thread can overshoot it by one.
+    LONG cFree = _CheckBalanced<T>();
+    TEST_CHECK(cFree >= 0 && cFree < ObjectPool<T>::c_cMaxFree + c_cThreads);
+}
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+// Creates and releases a burst of cBurst objects, cRounds times, on each of cThreads threads.
+template <typename T>
+static double _TimeCreateRelease(int cThreads, int cRounds, int cBurst)
+{
+    std::atomic<bool> fGo(false);
+    std::vector<std::thread> vthreads;
+    for (int iThread = 0; iThread < cThreads; iThread++)
+    {
+        vthreads.emplace_back([&]()
+        {
+            while (!fGo)
+            {
+                std::this_thread::yield();
+            }
+
+            std::vector<T*> vp(cBurst);
+            for (int iRound = 0; iRound < cRounds; iRound++)
+            {
+                for (int i = 0; i < cBurst; i++)
+                {
+                    vp[i] = new (std::nothrow) T(iRound);
+                }
+                for (int i = 0; i < cBurst; i++)
+                {
+                    vp[i]->Release();
+                }
+            }
+        });
+    }
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    fGo = true;
+    for (std::thread &rthread : vthreads)
+    {
+        rthread.join();
+    }
+    return _Seconds(tStart) * 1e9 / ((double)cRounds * cBurst);
+}
+
+static void _Bench()
+{
+    static const int c_rgcThreads[] = { 1, 4, c_cThreads };
+    const int cRounds = 200000;
+    const int cBurst = 4;
+
+    for (int cThreads : c_rgcThreads)
+    {
+        OBJECT_POOL_STATS statsBefore = _GetStats<PooledMock>();
+        double dPooled = _TimeCreateRelease<PooledMock>(cThreads, cRounds, cBurst);
+        double dHeap = _TimeCreateRelease<HeapMock>(cThreads, cRounds, cBurst);
+        OBJECT_POOL_STATS stats = _GetStats<PooledMock>();
+
+        printf("%d thread(s): pooled %6.1f ns, heap %6.1f ns per object per thread; pool misses %ld of %ld\n",
+               cThreads, dPooled, dHeap, (long)(stats.cMisses - statsBefore.cMisses),
+               (long)((stats.cHits - statsBefore.cHits) + (stats.cMisses - statsBefore.cMisses)));
+    }
+
+    TEST_CHECK(_CheckBalanced<PooledMock>() >= 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("objectpooltest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: objectpooltest [--bench]\n");
+        return 2;
+    }
+
+    _CheckBlocks();
+    _CheckWarmPool();
+
+    // Two pools at once, as the provider and its credentials are.
+    std::thread threadFactory([]()
+    {
+        _Stress<PooledFactoryMock>(2000);
+    });
+    _Stress<PooledMock>(2000);
+    threadFactory.join();
+
+    _CheckWarmPool();
+
+    return TestFinish("objectpooltest");
+}
@@ -0,0 +1,417 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// packedlogonfuzz feeds untrusted bytes to the bounds-checked parser of
+// packed logons (PackedLogonUnpackT in cpp/logonlayout.h, which
+// KerbInteractiveUnlockLogonGetView is built on), for every layout of
+// either bitness.  Whatever the parser accepts must lie inside the input,
+// and must pack and parse again to the same fields; whatever it rejects
+// must leave its output zeroed.
+//
+// On its own, it mutates a few valid blobs, deterministically:
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o packedlogonfuzz tests/packedlogonfuzz.cpp
+//
+// Usage: packedlogonfuzz [--bench | -n <iterations> | <input file>...]
+//
+// --bench times the parser over valid blobs instead.  It is also a
+// libFuzzer target:
+//
+//   clang++ -std=c++14 -g -fshort-wchar -fsanitize=fuzzer,address -DRASPWRAP_LIBFUZZER
+//       -I tests/win32 -I cpp -o packedlogonfuzz tests/packedlogonfuzz.cpp
+
+#include "logonlayout.h"
+#include "testutil.h"
+
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+//
+// Every string and byte range of rNative lies inside rgb, after the header.  Reading them all
+// lets AddressSanitizer catch a range the checks would have missed.
+//
+template <typename TLayout>
+static void _CheckRanges(const typename TLayout::Native &rNative, const BYTE *rgb, DWORD cb)
+{
+    const BYTE *pbNative = (const BYTE*)&rNative;
+    unsigned uSum = 0;
+
+    for (size_t i = 0; i < ARRAYSIZE(TLayout::rgFields); i++)
+    {
+        const PACKED_FIELD &rpf = TLayout::rgFields[i];
+        const BYTE *pb = nullptr;
+        DWORD cbRange = 0;
+
+        if (rpf.pft == PFT_UNICODE_STRING)
+        {
+            const UNICODE_STRING *pus = (const UNICODE_STRING*)(pbNative + rpf.offNative);
+            TEST_CHECK(pus->Length <= pus->MaximumLength && pus->Length % sizeof(wchar_t) == 0);
+            pb = (const BYTE*)pus->Buffer;
+            cbRange = pus->MaximumLength;
+        }
+        else if (rpf.pft == PFT_BYTES)
+        {
+            pb = *(const BYTE* const*)(pbNative + rpf.offNative);
+            cbRange = *(const ULONG*)(pbNative + rpf.offNativeLength);
+        }
+
+        if (pb)
+        {
+            TEST_CHECK(pb >= rgb + TLayout::cbHeader && pb <= rgb + cb && cbRange <= (DWORD)(rgb + cb - pb));
+            for (DWORD ib = 0; ib < cbRange; ib++)
+            {
+                uSum += pb[ib];
+            }
+        }
+        else
+        {
+            TEST_CHECK(cbRange == 0);
+        }
+    }
+
+    // Keeps the reads.
+    volatile unsigned uSink = uSum;
+    (void)uSink;
+}
+
+// The fields of two native structures are the same: scalars, and string and byte contents.
+template <typename TLayout>
+static bool _FieldsEqual(const typename TLayout::Native &rA, const typename TLayout::Native &rB)
+{
+    const BYTE *pbA = (const BYTE*)&rA;
+    const BYTE *pbB = (const BYTE*)&rB;
+
+    for (size_t i = 0; i < ARRAYSIZE(TLayout::rgFields); i++)
+    {
+        const PACKED_FIELD &rpf = TLayout::rgFields[i];
+
+        if (rpf.pft == PFT_SCALAR)
+        {
+            if (memcmp(pbA + rpf.offNative, pbB + rpf.offNative, rpf.cbScalar))
+            {
+                return false;
+            }
+        }
+        else if (rpf.pft == PFT_UNICODE_STRING)
+        {
+            const UNICODE_STRING *pusA = (const UNICODE_STRING*)(pbA + rpf.offNative);
+            const UNICODE_STRING *pusB = (const UNICODE_STRING*)(pbB + rpf.offNative);
+            if (pusA->Length != pusB->Length || (pusA->Length && memcmp(pusA->Buffer, pusB->Buffer, pusA->Length)))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            ULONG cbA = *(const ULONG*)(pbA + rpf.offNativeLength);
+            ULONG cbB = *(const ULONG*)(pbB + rpf.offNativeLength);
+            const BYTE *pA = *(const BYTE* const*)(pbA + rpf.offNative);
+            const BYTE *pB = *(const BYTE* const*)(pbB + rpf.offNative);
+            if (cbA != cbB || (cbA && memcmp(pA, pB, cbA)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template <typename TLayout>
+static void _CheckLayout(const BYTE *rgb, DWORD cb)
+{
+    typedef typename TLayout::Native Native;
+
+    Native native;
+    HRESULT hr = PackedLogonUnpackT<TLayout>(rgb, cb, &native);
+    if (FAILED(hr))
+    {
+        Native zero;
+        memset(&zero, 0, sizeof(zero));
+        TEST_CHECK(hr == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+        TEST_CHECK(memcmp(&native, &zero, sizeof(native)) == 0);
+        return;
+    }
+
+    _CheckRanges<TLayout>(native, rgb, cb);
+
+    // The strings may overlap in the input, so the packed copy can be larger than it was.
+    DWORD cbPacked;
+    TEST_CHECK(SUCCEEDED(PackedLogonGetPackedSizeT<TLayout>(native, &cbPacked)));
+
+    std::vector<BYTE> vb(cbPacked);
+    DWORD cbWritten;
+    TEST_CHECK(SUCCEEDED(PackedLogonPackToBufferT<TLayout>(native, vb.data(), cbPacked, &cbWritten)) &&
+               cbWritten == cbPacked);
+
+    Native nativeAgain;
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<TLayout>(vb.data(), cbPacked, &nativeAgain)));
+    TEST_CHECK(_FieldsEqual<TLayout>(native, nativeAgain));
+}
+
+// Runs one input through every layout, from a buffer of exactly its size.
+static void _CheckInput(const BYTE *pbInput, size_t cbInput)
+{
+    if (cbInput > 0xFFFF)
+    {
+        return;
+    }
+
+    BYTE *rgb = (BYTE*)malloc(cbInput ? cbInput : 1);
+    if (!rgb)
+    {
+        return;
+    }
+    memcpy(rgb, pbInput, cbInput);
+
+    _CheckLayout<KerbLayout32>(rgb, (DWORD)cbInput);
+    _CheckLayout<KerbLayout64>(rgb, (DWORD)cbInput);
+    _CheckLayout<KerbCertificateLayout32>(rgb, (DWORD)cbInput);
+    _CheckLayout<KerbCertificateLayout64>(rgb, (DWORD)cbInput);
+    _CheckLayout<Msv1_0Layout32>(rgb, (DWORD)cbInput);
+    _CheckLayout<Msv1_0Layout64>(rgb, (DWORD)cbInput);
+
+    free(rgb);
+}
+
+#ifdef RASPWRAP_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *pb, size_t cb)
+{
+    _CheckInput(pb, cb);
+    if (s_cTestFailures)
+    {
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+static WCHAR s_wszDomain[] = L"CONTOSO";
+static WCHAR s_wszUser[] = L"alice@contoso.com";
+static WCHAR s_wszPassword[] = L"correct horse battery staple";
+static BYTE s_rgbCspData[] = { 0x01, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x4b, 0x00, 0x53, 0x00 };
+
+static void _InitString(UNICODE_STRING *pus, PWSTR pwz, size_t cch)
+{
+    pus->Length = (USHORT)(cch * sizeof(WCHAR));
+    pus->MaximumLength = pus->Length;
+    pus->Buffer = pwz;
+}
+
+template <typename TLayout>
+static void _AddSeed(const typename TLayout::Native &rNative, std::vector<std::vector<BYTE> > *pvSeeds)
+{
+    DWORD cb;
+    if (SUCCEEDED(PackedLogonGetPackedSizeT<TLayout>(rNative, &cb)))
+    {
+        std::vector<BYTE> vb(cb);
+        DWORD cbWritten;
+        if (SUCCEEDED(PackedLogonPackToBufferT<TLayout>(rNative, vb.data(), cb, &cbWritten)))
+        {
+            pvSeeds->push_back(vb);
+        }
+    }
+}
+
+// One valid blob for every layout.
+static void _BuildSeeds(std::vector<std::vector<BYTE> > *pvSeeds)
+{
+    KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+    memset(&kiul, 0, sizeof(kiul));
+    kiul.Logon.MessageType = KerbWorkstationUnlockLogon;
+    _InitString(&kiul.Logon.LogonDomainName, s_wszDomain, ARRAYSIZE(s_wszDomain) - 1);
+    _InitString(&kiul.Logon.UserName, s_wszUser, ARRAYSIZE(s_wszUser) - 1);
+    _InitString(&kiul.Logon.Password, s_wszPassword, ARRAYSIZE(s_wszPassword) - 1);
+    kiul.LogonId.LowPart = 0x3e7;
+    _AddSeed<KerbLayout32>(kiul, pvSeeds);
+    _AddSeed<KerbLayout64>(kiul, pvSeeds);
+
+    KERB_CERTIFICATE_LOGON kcl;
+    memset(&kcl, 0, sizeof(kcl));
+    kcl.MessageType = KerbCertificateLogon;
+    _InitString(&kcl.DomainName, s_wszDomain, ARRAYSIZE(s_wszDomain) - 1);
+    _InitString(&kcl.UserName, s_wszUser, ARRAYSIZE(s_wszUser) - 1);
+    _InitString(&kcl.Pin, s_wszPassword, 6);
+    kcl.CspDataLength = sizeof(s_rgbCspData);
+    kcl.CspData = s_rgbCspData;
+    _AddSeed<KerbCertificateLayout32>(kcl, pvSeeds);
+    _AddSeed<KerbCertificateLayout64>(kcl, pvSeeds);
+
+    MSV1_0_INTERACTIVE_LOGON mil;
+    memset(&mil, 0, sizeof(mil));
+    mil.MessageType = MsV1_0InteractiveLogon;
+    _InitString(&mil.LogonDomainName, s_wszDomain, ARRAYSIZE(s_wszDomain) - 1);
+    _InitString(&mil.UserName, s_wszUser, 5);
+    _InitString(&mil.Password, s_wszPassword, ARRAYSIZE(s_wszPassword) - 1);
+    _AddSeed<Msv1_0Layout32>(mil, pvSeeds);
+    _AddSeed<Msv1_0Layout64>(mil, pvSeeds);
+}
+
+static uint32_t s_uRandom = 0x2545F491;
+
+static uint32_t _Random()
+{
+    s_uRandom ^= s_uRandom << 13;
+    s_uRandom ^= s_uRandom >> 17;
+    s_uRandom ^= s_uRandom << 5;
+    return s_uRandom;
+}
+
+// Damages vb the way a hostile or truncated blob would: mostly in the header's lengths and offsets.
+static void _Mutate(std::vector<BYTE> *pvb)
+{
+    static const BYTE c_rgbInteresting[] = { 0x00, 0x01, 0x02, 0x7f, 0x80, 0xfe, 0xff };
+
+    int cMutations = 1 + (int)(_Random() % 4);
+    for (int i = 0; i < cMutations; i++)
+    {
+        size_t cb = pvb->size();
+        size_t ib = (cb && _Random() % 4) ? _Random() % ((cb < 72) ? cb : 72) : (cb ? _Random() % cb : 0);
+
+        switch (_Random() % 6)
+        {
+        case 0:
+            if (cb)
+            {
+                (*pvb)[ib] ^= (BYTE)(1 << (_Random() % 8));
+            }
+            break;
+        case 1:
+            if (cb)
+            {
+                (*pvb)[ib] = c_rgbInteresting[_Random() % ARRAYSIZE(c_rgbInteresting)];
+            }
+            break;
+        case 2:
+            if (cb)
+            {
+                (*pvb)[ib] = (BYTE)(cb - _Random() % 8);
+            }
+            break;
+        case 3:
+            pvb->resize(cb ? _Random() % cb : 0);
+            break;
+        case 4:
+            pvb->resize(cb + 1 + _Random() % 16, (BYTE)_Random());
+            break;
+        default:
+            if (cb)
+            {
+                (*pvb)[ib] = (BYTE)_Random();
+            }
+            break;
+        }
+    }
+}
+
+static bool _ReadFile(const char *pszPath, std::vector<BYTE> *pvb)
+{
+    FILE *pf = fopen(pszPath, "rb");
+    if (!pf)
+    {
+        return false;
+    }
+
+    BYTE rgb[4096];
+    size_t cb;
+    while ((cb = fread(rgb, 1, sizeof(rgb), pf)) > 0)
+    {
+        pvb->insert(pvb->end(), rgb, rgb + cb);
+    }
+
+    bool fOk = !ferror(pf);
+    fclose(pf);
+    return fOk;
+}
+
+// Validates the seeds over and over, and reports how many blobs, and bytes, a second that is.
+static void _Bench(const std::vector<std::vector<BYTE> > &vSeeds)
+{
+    const int cRounds = 1000000;
+    size_t cbTotal = 0;
+    unsigned cAccepted = 0;
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        const std::vector<BYTE> &vb = vSeeds[iRound % 2];      // the two KERB_INTERACTIVE_UNLOCK_LOGONs
+        KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+        HRESULT hr = (iRound % 2) ? PackedLogonUnpackT<KerbLayout64>(vb.data(), (DWORD)vb.size(), &kiul)
+                                  : PackedLogonUnpackT<KerbLayout32>(vb.data(), (DWORD)vb.size(), &kiul);
+        cAccepted += SUCCEEDED(hr);
+        cbTotal += vb.size();
+    }
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+    TEST_CHECK(cAccepted == (unsigned)cRounds);
+    printf("%d blobs in %.3fs: %.1f M blobs/s, %.1f MB/s\n", cRounds, dSeconds, cRounds / dSeconds / 1e6,
+           cbTotal / dSeconds / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::vector<BYTE> > vSeeds;
+    _BuildSeeds(&vSeeds);
+    TEST_CHECK(vSeeds.size() == 6);
+
+    long cIterations = 200000;
+
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench(vSeeds);
+        return TestFinish("packedlogonfuzz --bench");
+    }
+    else if (argc == 3 && !strcmp(argv[1], "-n"))
+    {
+        cIterations = atol(argv[2]);
+    }
+    else if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::vector<BYTE> vb;
+            if (argv[i][0] == '-' || !_ReadFile(argv[i], &vb))
+            {
+                fprintf(stderr, "usage: packedlogonfuzz [--bench | -n <iterations> | <input file>...]\n");
+                return 2;
+            }
+            _CheckInput(vb.data(), vb.size());
+        }
+        return TestFinish("packedlogonfuzz");
+    }
+
+    // The seeds themselves must be accepted, by the layout they were packed for.
+    KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+    KERB_CERTIFICATE_LOGON kcl;
+    MSV1_0_INTERACTIVE_LOGON mil;
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<KerbLayout32>(vSeeds[0].data(), (DWORD)vSeeds[0].size(), &kiul)));
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<KerbLayout64>(vSeeds[1].data(), (DWORD)vSeeds[1].size(), &kiul)));
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<KerbCertificateLayout32>(vSeeds[2].data(), (DWORD)vSeeds[2].size(), &kcl)));
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<KerbCertificateLayout64>(vSeeds[3].data(), (DWORD)vSeeds[3].size(), &kcl)));
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<Msv1_0Layout32>(vSeeds[4].data(), (DWORD)vSeeds[4].size(), &mil)));
+    TEST_CHECK(SUCCEEDED(PackedLogonUnpackT<Msv1_0Layout64>(vSeeds[5].data(), (DWORD)vSeeds[5].size(), &mil)));
+    for (size_t i = 0; i < vSeeds.size(); i++)
+    {
+        _CheckInput(vSeeds[i].data(), vSeeds[i].size());
+    }
+
+    for (long iIteration = 0; iIteration < cIterations && !s_cTestFailures; iIteration++)
+    {
+        std::vector<BYTE> vb = vSeeds[_Random() % vSeeds.size()];
+        _Mutate(&vb);
+        _CheckInput(vb.data(), vb.size());
+    }
+
+    return TestFinish("packedlogonfuzz");
+}
+
+#endif
@@ -0,0 +1,225 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// passwordprotectortest runs the password pipeline in
+// cpp/passwordprotector.cpp with LocalPasswordProtector standing in for
+// CredProtect: which passwords are protected and which are only copied,
+// what happens at the size limits, and how many allocations each takes.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o passwordprotectortest tests/passwordprotectortest.cpp
+//       cpp/passwordprotector.cpp cpp/allocator.cpp cpp/securearena.cpp cpp/utf16.cpp
+
+#include "passwordprotector.h"
+#include "testutil.h"
+
+#include <vector>
+
+// A protector whose estimate falls short by one character, as CredProtect's might.
+class ShortEstimateProtector : public LocalPasswordProtector
+{
+public:
+    DWORD EstimateProtectedCch(_In_ DWORD cch)
+    {
+        return LocalPasswordProtector::EstimateProtectedCch(cch) - 1;
+    }
+};
+
+static size_t _Length(PCWSTR pwz)
+{
+    size_t cch = 0;
+    while (pwz[cch])
+    {
+        cch++;
+    }
+    return cch;
+}
+
+static bool _Equal(PCWSTR pwz1, PCWSTR pwz2)
+{
+    size_t cch = _Length(pwz1);
+    return cch == _Length(pwz2) && 0 == memcmp(pwz1, pwz2, cch * sizeof(wchar_t));
+}
+
+// The password LocalPasswordProtector makes of pwz.
+static std::vector<wchar_t> _Protected(PCWSTR pwz)
+{
+    LocalPasswordProtector protector;
+    DWORD cch = (DWORD)_Length(pwz);
+    std::vector<wchar_t> vwch(protector.EstimateProtectedCch(cch));
+    DWORD cchOut;
+    TEST_CHECK(SUCCEEDED(protector.Protect(pwz, cch, vwch.data(), (DWORD)vwch.size(), &cchOut)));
+    TEST_CHECK(cchOut == vwch.size());
+    return vwch;
+}
+
+// Passwords that are copied as they are: the empty one, one already protected and any in CredUI.
+static void _CheckNotProtected()
+{
+    std::vector<wchar_t> vwchProtected = _Protected(L"secret");
+
+    struct
+    {
+        PCWSTR                              pwz;
+        CREDENTIAL_PROVIDER_USAGE_SCENARIO  cpus;
+    } rgCases[] =
+    {
+        { L"",                      CPUS_LOGON },
+        { vwchProtected.data(),     CPUS_LOGON },
+        { vwchProtected.data(),     CPUS_UNLOCK_WORKSTATION },
+        { L"secret",                CPUS_CREDUI },
+        { L"",                      CPUS_CREDUI },
+    };
+
+    for (auto &rcase : rgCases)
+    {
+        LocalPasswordProtector protector;
+        CountingAllocator allocator(GetCoTaskMemAllocator());
+
+        PWSTR pwz;
+        TEST_CHECK(SUCCEEDED(ProtectIfNecessaryAndCopyPassword(&protector, rcase.pwz, rcase.cpus, &allocator, &pwz)));
+        TEST_CHECK(pwz && pwz != rcase.pwz && _Equal(pwz, rcase.pwz));
+        TEST_CHECK(protector.GetProtectCalls() == 0);
+        TEST_CHECK(allocator.GetAllocs() == 1);
+        TEST_CHECK(allocator.GetBytesAllocated() == (LONGLONG)((_Length(rcase.pwz) + 1) * sizeof(wchar_t)));
+        TEST_CHECK(allocator.GetFrees() == 0);
+        allocator.Free(pwz);
+    }
+
+    // No password at all is the empty one.
+    LocalPasswordProtector protector;
+    wchar_t rgwch[4] = { L'x', L'x', L'x', L'x' };
+    DWORD cchOut;
+    TEST_CHECK(SUCCEEDED(ProtectIfNecessaryAndCopyPasswordToBuffer(&protector, nullptr, CPUS_LOGON, rgwch,
+                                                                   ARRAYSIZE(rgwch), &cchOut)));
+    TEST_CHECK(cchOut == 1 && rgwch[0] == L'\0' && rgwch[1] == L'x');
+    TEST_CHECK(protector.GetProtectCalls() == 0);
+}
+
+// Passwords that need protecting are protected once, straight into an allocation of the right size.
+static void _CheckProtected()
+{
+    static const CREDENTIAL_PROVIDER_USAGE_SCENARIO c_rgcpus[] =
+    {
+        CPUS_LOGON, CPUS_UNLOCK_WORKSTATION, CPUS_CHANGE_PASSWORD,
+    };
+
+    for (CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus : c_rgcpus)
+    {
+        LocalPasswordProtector protector;
+        CountingAllocator allocator(GetCoTaskMemAllocator());
+
+        PWSTR pwz;
+        TEST_CHECK(SUCCEEDED(ProtectIfNecessaryAndCopyPassword(&protector, L"secret", cpus, &allocator, &pwz)));
+        std::vector<wchar_t> vwchExpected = _Protected(L"secret");
+        TEST_CHECK(pwz && _Equal(pwz, vwchExpected.data()));
+        TEST_CHECK(protector.GetProtectCalls() == 1);
+        TEST_CHECK(allocator.GetAllocs() == 1);
+        TEST_CHECK(allocator.GetBytesAllocated() == (LONGLONG)(vwchExpected.size() * sizeof(wchar_t)));
+        TEST_CHECK(allocator.GetFrees() == 0);
+        allocator.Free(pwz);
+    }
+
+    // An estimate that falls short costs one more allocation and one more call, and no more.
+    ShortEstimateProtector protector;
+    CountingAllocator allocator(GetCoTaskMemAllocator());
+    PWSTR pwz;
+    TEST_CHECK(SUCCEEDED(ProtectIfNecessaryAndCopyPassword(&protector, L"secret", CPUS_LOGON, &allocator, &pwz)));
+    TEST_CHECK(pwz && _Equal(pwz, _Protected(L"secret").data()));
+    TEST_CHECK(protector.GetProtectCalls() == 2);
+    TEST_CHECK(allocator.GetAllocs() == 2);
+    TEST_CHECK(allocator.GetFrees() == 1);
+    allocator.Free(pwz);
+}
+
+//
+// The output buffer: one character short is ERROR_INSUFFICIENT_BUFFER with the length needed,
+// and nothing is written past what the caller gave.
+//
+static void _CheckBufferSize(PCWSTR pwz, CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus, DWORD cchExpected)
+{
+    LocalPasswordProtector protector;
+    std::vector<wchar_t> vwch(cchExpected + 1, L'~');
+
+    DWORD cchOut;
+    TEST_CHECK(ProtectIfNecessaryAndCopyPasswordToBuffer(&protector, pwz, cpus, vwch.data(), cchExpected - 1, &cchOut) ==
+               HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+    TEST_CHECK(cchOut == cchExpected);
+    TEST_CHECK(vwch[cchExpected - 1] == L'~');
+
+    TEST_CHECK(SUCCEEDED(ProtectIfNecessaryAndCopyPasswordToBuffer(&protector, pwz, cpus, vwch.data(), cchExpected,
+                                                                   &cchOut)));
+    TEST_CHECK(cchOut == cchExpected);
+    TEST_CHECK(vwch[cchExpected - 1] == L'\0' && vwch[cchExpected] == L'~');
+}
+
+// The longest password a UNICODE_STRING holds is taken; one character more is refused before
+// anything is allocated or protected.
+static void _CheckLengthLimit()
+{
+    std::vector<wchar_t> vwch(UNICODE_STRING_MAX_CHARS + 2, L'p');
+
+    vwch[UNICODE_STRING_MAX_CHARS] = L'\0';
+    {
+        LocalPasswordProtector protector;
+        CountingAllocator allocator(GetCoTaskMemAllocator());
+        PWSTR pwz;
+        TEST_CHECK(SUCCEEDED(ProtectIfNecessaryAndCopyPassword(&protector, vwch.data(), CPUS_LOGON, &allocator, &pwz)));
+        TEST_CHECK(pwz && _Length(pwz) == protector.EstimateProtectedCch(UNICODE_STRING_MAX_CHARS) - 1);
+        TEST_CHECK(allocator.GetAllocs() == 1);
+        allocator.Free(pwz);
+    }
+
+    vwch[UNICODE_STRING_MAX_CHARS] = L'p';
+    vwch[UNICODE_STRING_MAX_CHARS + 1] = L'\0';
+    {
+        LocalPasswordProtector protector;
+        CountingAllocator allocator(GetCoTaskMemAllocator());
+        PWSTR pwz;
+        TEST_CHECK(FAILED(ProtectIfNecessaryAndCopyPassword(&protector, vwch.data(), CPUS_LOGON, &allocator, &pwz)));
+        TEST_CHECK(pwz == nullptr);
+        TEST_CHECK(protector.GetProtectCalls() == 0);
+        TEST_CHECK(allocator.GetAllocs() == 0 && allocator.GetFailures() == 0);
+
+        wchar_t rgwch[8];
+        DWORD cchOut;
+        TEST_CHECK(FAILED(ProtectIfNecessaryAndCopyPasswordToBuffer(&protector, vwch.data(), CPUS_LOGON, rgwch,
+                                                                    ARRAYSIZE(rgwch), &cchOut)));
+        TEST_CHECK(cchOut == 0);
+    }
+}
+
+// An allocation that fails is reported as it is, before the protector runs.
+static void _CheckAllocationFailure()
+{
+    BYTE rgb[16];
+    BumpAllocator bump(rgb, sizeof(rgb));
+    CountingAllocator allocator(&bump);
+    LocalPasswordProtector protector;
+
+    PWSTR pwz;
+    TEST_CHECK(ProtectIfNecessaryAndCopyPassword(&protector, L"secret", CPUS_LOGON, &allocator, &pwz) == E_OUTOFMEMORY);
+    TEST_CHECK(pwz == nullptr);
+    TEST_CHECK(protector.GetProtectCalls() == 0);
+    TEST_CHECK(allocator.GetAllocs() == 0 && allocator.GetFailures() == 1);
+}
+
+int main()
+{
+    _CheckNotProtected();
+    _CheckProtected();
+
+    _CheckBufferSize(L"secret", CPUS_LOGON, (DWORD)_Protected(L"secret").size());
+    _CheckBufferSize(L"secret", CPUS_CREDUI, 7);
+    _CheckBufferSize(L"", CPUS_LOGON, 1);
+
+    _CheckLengthLimit();
+    _CheckAllocationFailure();
+
+    return TestFinish("passwordprotectortest");
+}
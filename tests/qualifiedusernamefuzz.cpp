@@ -0,0 +1,588 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// qualifiedusernamefuzz feeds untrusted UTF-16 to QualifiedUserNameParse,
+// in cpp/qualifiedusername.cpp, with each UTF-16 kernel the processor has.
+// Every kernel must split a name as a plain loop does, into views inside
+// the name; QualifiedUserNameFormat must put it back together, into a
+// buffer of exactly the size it asks for and into a SecureString; and a
+// name that is rejected must leave the view zeroed.
+//
+// On its own, it mutates a few user names, deterministically:
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o qualifiedusernamefuzz tests/qualifiedusernamefuzz.cpp cpp/qualifiedusername.cpp
+//       cpp/securestring.cpp cpp/utf16.cpp
+//
+// Usage: qualifiedusernamefuzz [--bench | -n <iterations> | <input file>...]
+//
+// --bench times parsing and formatting over a corpus of user names as they
+// are typed at a logon, against the copies the old helpers made.  It is
+// also a libFuzzer target:
+//
+//   clang++ -std=c++14 -g -fshort-wchar -fsanitize=fuzzer,address -DRASPWRAP_LIBFUZZER
+//       -I tests/win32 -I cpp -o qualifiedusernamefuzz tests/qualifiedusernamefuzz.cpp cpp/qualifiedusername.cpp
+//       cpp/securestring.cpp cpp/utf16.cpp
+
+#include "qualifiedusername.h"
+#include "utf16.h"
+#include "testutil.h"
+
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// What the parser should make of pwz: the plain loop.
+static HRESULT _ExpectParse(PCWSTR pwz, QUALIFIED_USER_NAME_FORM *pForm, size_t *pcchDomain, size_t *pcchUserName)
+{
+    size_t cch = 0;
+    size_t ichWhack = UTF16_NOT_FOUND;
+    size_t ichAt = UTF16_NOT_FOUND;
+    for (; pwz[cch]; cch++)
+    {
+        if (cch == UNICODE_STRING_MAX_CHARS)
+        {
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+        }
+        if (pwz[cch] == L'\\' && ichWhack == UTF16_NOT_FOUND)
+        {
+            ichWhack = cch;
+        }
+        if (pwz[cch] == L'@')
+        {
+            ichAt = cch;
+        }
+    }
+
+    if (ichWhack != UTF16_NOT_FOUND)
+    {
+        *pForm = QUNF_DOMAIN_USERNAME;
+        *pcchDomain = ichWhack;
+        *pcchUserName = cch - ichWhack - 1;
+    }
+    else if (ichAt != UTF16_NOT_FOUND && ichAt != 0 && ichAt != cch - 1)
+    {
+        *pForm = QUNF_UPN;
+        *pcchDomain = cch - ichAt - 1;
+        *pcchUserName = ichAt;
+    }
+    else
+    {
+        *pForm = QUNF_USERNAME;
+        *pcchDomain = 0;
+        *pcchUserName = cch;
+    }
+
+    return (*pcchUserName) ? S_OK : E_INVALIDARG;
+}
+
+static bool _IsZero(const QUALIFIED_USER_NAME_VIEW &rview)
+{
+    QUALIFIED_USER_NAME_VIEW zero;
+    memset(&zero, 0, sizeof(zero));
+    return !memcmp(&rview, &zero, sizeof(zero));
+}
+
+static bool _ViewInside(const PACKED_STRING_VIEW &rpsv, PCWSTR pwz, size_t cch)
+{
+    return rpsv.pwch >= pwz && rpsv.pwch + rpsv.cch <= pwz + cch;
+}
+
+// Formats rview both ways, and checks both give the name back.
+static void _CheckFormat(const QUALIFIED_USER_NAME_VIEW &rview, PCWSTR pwz, size_t cch)
+{
+    // A DOMAIN\user with an empty domain is formatted as the user name alone.
+    PCWSTR pwzExpected = pwz;
+    size_t cchExpected = cch;
+    if (rview.Form == QUNF_DOMAIN_USERNAME && rview.Domain.cch == 0)
+    {
+        pwzExpected = rview.UserName.pwch;
+        cchExpected = rview.UserName.cch;
+    }
+
+    size_t cchNeeded;
+    TEST_CHECK(QualifiedUserNameFormat(&rview, nullptr, 0, &cchNeeded) == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+    TEST_CHECK(cchNeeded == cchExpected + 1);
+
+    // Exactly the size asked for, so AddressSanitizer sees a write past it; then one short.
+    std::vector<WCHAR> vwch(cchNeeded);
+    size_t cchWritten;
+    TEST_CHECK(SUCCEEDED(QualifiedUserNameFormat(&rview, vwch.data(), vwch.size(), &cchWritten)));
+    TEST_CHECK(cchWritten == cchNeeded && vwch[cchExpected] == L'\0');
+    TEST_CHECK_BYTES(vwch.data(), cchExpected * sizeof(WCHAR), pwzExpected, cchExpected * sizeof(WCHAR));
+
+    TEST_CHECK(QualifiedUserNameFormat(&rview, vwch.data(), cchNeeded - 1, &cchWritten) ==
+               HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+    TEST_CHECK(vwch[0] == L'\0');
+
+    SecureString str;
+    TEST_CHECK(SUCCEEDED(QualifiedUserNameFormat(&rview, &str)));
+    TEST_CHECK(str.GetLength() == cchExpected);
+    TEST_CHECK_BYTES(str.Get(), str.GetLength() * sizeof(WCHAR), pwzExpected, cchExpected * sizeof(WCHAR));
+}
+
+// Parses pwz with every kernel, and formats what the first one made of it.
+static void _CheckName(PCWSTR pwz)
+{
+    QUALIFIED_USER_NAME_FORM formExpected = QUNF_USERNAME;
+    size_t cchDomain = 0;
+    size_t cchUserName = 0;
+    HRESULT hrExpected = _ExpectParse(pwz, &formExpected, &cchDomain, &cchUserName);
+
+    size_t cch = 0;
+    while (pwz[cch] && cch <= UNICODE_STRING_MAX_CHARS)
+    {
+        cch++;
+    }
+
+    for (int uk = UK_SCALAR; uk <= UK_AVX2; uk++)
+    {
+        if (Utf16SelectKernel((UTF16_KERNEL)uk) != uk)
+        {
+            continue;
+        }
+
+        QUALIFIED_USER_NAME_VIEW view;
+        memset(&view, 0xcc, sizeof(view));
+        HRESULT hr = QualifiedUserNameParse(pwz, &view);
+        TEST_CHECK(hr == hrExpected);
+        if (FAILED(hr))
+        {
+            TEST_CHECK(_IsZero(view));
+            continue;
+        }
+
+        TEST_CHECK(view.Form == formExpected);
+        TEST_CHECK(view.Domain.cch == cchDomain && view.UserName.cch == cchUserName);
+        TEST_CHECK(_ViewInside(view.Domain, pwz, cch) && _ViewInside(view.UserName, pwz, cch));
+        if (view.Form == QUNF_DOMAIN_USERNAME)
+        {
+            TEST_CHECK(view.Domain.pwch == pwz && view.UserName.pwch == pwz + cchDomain + 1);
+        }
+        else if (view.Form == QUNF_UPN)
+        {
+            TEST_CHECK(view.UserName.pwch == pwz && view.Domain.pwch == pwz + cchUserName + 1);
+        }
+        else
+        {
+            TEST_CHECK(view.UserName.pwch == pwz && view.Domain.pwch == pwz + cch);
+        }
+
+        if (uk == UK_SCALAR)
+        {
+            _CheckFormat(view, pwz, cch);
+        }
+    }
+
+    Utf16SelectKernel(UK_AVX2);
+}
+
+// Runs one input, taken as UTF-16, through the parser, from a buffer of exactly its size.
+static void _CheckInput(const BYTE *pbInput, size_t cbInput)
+{
+    size_t cch = cbInput / sizeof(WCHAR);
+    if (cch > UNICODE_STRING_MAX_CHARS + 16)
+    {
+        return;
+    }
+
+    WCHAR *pwz = (WCHAR *)malloc((cch + 1) * sizeof(WCHAR));
+    if (!pwz)
+    {
+        return;
+    }
+    memcpy(pwz, pbInput, cch * sizeof(WCHAR));
+    pwz[cch] = L'\0';
+
+    _CheckName(pwz);
+
+    free(pwz);
+}
+
+#ifdef RASPWRAP_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *pb, size_t cb)
+{
+    _CheckInput(pb, cb);
+    if (s_cTestFailures)
+    {
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+// With -fshort-wchar, std::wstring and the C library's wide string functions don't apply.
+typedef std::vector<WCHAR> NAME;
+
+static NAME _Widen(const char *psz)
+{
+    NAME name;
+    for (; *psz; psz++)
+    {
+        name.push_back((WCHAR)(unsigned char)*psz);
+    }
+    name.push_back(L'\0');
+    return name;
+}
+
+// The user names people type at a logon: plain, DOMAIN\user and UPNs, local and service accounts.
+static void _BuildCorpus(std::vector<NAME> *pvnames)
+{
+    static const char *const c_rgpszUsers[] =
+    {
+        "jdoe", "administrator", "Administrator", "firstname.lastname", "a.b", "svc-sql01$", "kiosk", "alice",
+        "bob.smith-jones", "x",
+    };
+    static const char *const c_rgpszDomains[] =
+    {
+        "CONTOSO", "corp", ".", "NT AUTHORITY", "FABRIKAM-EU",
+    };
+    static const char *const c_rgpszSuffixes[] =
+    {
+        "contoso.com", "corp.contoso.com", "contoso.onmicrosoft.com", "fabrikam.co.uk",
+    };
+
+    for (const char *pszUser : c_rgpszUsers)
+    {
+        pvnames->push_back(_Widen(pszUser));
+        for (const char *pszDomain : c_rgpszDomains)
+        {
+            pvnames->push_back(_Widen((std::string(pszDomain) + "\\" + pszUser).c_str()));
+        }
+        for (const char *pszSuffix : c_rgpszSuffixes)
+        {
+            pvnames->push_back(_Widen((std::string(pszUser) + "@" + pszSuffix).c_str()));
+        }
+    }
+
+    // And a few the parser has to get right: a UPN typed after a domain, '@'s at the ends, and
+    // characters outside ASCII.
+    pvnames->push_back(_Widen("CONTOSO\\jdoe@contoso.com"));
+    pvnames->push_back(_Widen("\\jdoe"));
+    pvnames->push_back(_Widen("@jdoe"));
+    pvnames->push_back(_Widen("jdoe@"));
+    pvnames->push_back(_Widen("jdoe@@contoso.com"));
+    NAME nameAccents = _Widen("j\xe9r\xf4me@contoso.fr");
+    nameAccents[0] = 0x0416;
+    pvnames->push_back(nameAccents);
+}
+
+static uint32_t s_uRandom = 0x2545F491;
+
+static uint32_t _Random()
+{
+    s_uRandom ^= s_uRandom << 13;
+    s_uRandom ^= s_uRandom >> 17;
+    s_uRandom ^= s_uRandom << 5;
+    return s_uRandom;
+}
+
+// Damages name the way a mistyped or hostile one would: mostly separators and terminators.
+static void _Mutate(NAME *pname)
+{
+    static const WCHAR c_rgwchInteresting[] = { L'\\', L'@', L'\0', L'.', 0xD800, 0xDC00, 0xFFFF, L'a' };
+
+    pname->pop_back();
+    int cMutations = 1 + (int)(_Random() % 4);
+    for (int i = 0; i < cMutations; i++)
+    {
+        size_t cch = pname->size();
+        size_t ich = cch ? _Random() % cch : 0;
+
+        switch (_Random() % 6)
+        {
+        case 0:
+            if (cch)
+            {
+                (*pname)[ich] = c_rgwchInteresting[_Random() % ARRAYSIZE(c_rgwchInteresting)];
+            }
+            break;
+        case 1:
+            pname->insert(pname->begin() + ich, c_rgwchInteresting[_Random() % ARRAYSIZE(c_rgwchInteresting)]);
+            break;
+        case 2:
+            if (cch)
+            {
+                pname->erase(pname->begin() + ich);
+            }
+            break;
+        case 3:
+            // Lengths around the vector blocks, and now and then around the longest name there can be.
+            pname->resize((_Random() % 16) ? cch + _Random() % 40 : UNICODE_STRING_MAX_CHARS - 2 + _Random() % 4,
+                          (WCHAR)(L'a' + _Random() % 26));
+            break;
+        case 4:
+            pname->resize(cch ? _Random() % cch : 0);
+            break;
+        default:
+            if (cch)
+            {
+                (*pname)[ich] = (WCHAR)_Random();
+            }
+            break;
+        }
+    }
+    pname->push_back(L'\0');
+}
+
+static bool _ReadFile(const char *pszPath, std::vector<BYTE> *pvb)
+{
+    FILE *pf = fopen(pszPath, "rb");
+    if (!pf)
+    {
+        return false;
+    }
+
+    BYTE rgb[4096];
+    size_t cb;
+    while ((cb = fread(rgb, 1, sizeof(rgb), pf)) > 0)
+    {
+        pvb->insert(pvb->end(), rgb, rgb + cb);
+    }
+
+    bool fOk = !ferror(pf);
+    fclose(pf);
+    return fOk;
+}
+
+//
+// What the parser and formatter replace.  SplitDomainAndUsername looked for the '\' and then
+// the length, each in a pass of its own, and copied both parts into CoTaskMemAlloc buffers;
+// DomainUsernameStringAlloc measured both parts and joined them in a heap buffer.
+//
+static HRESULT _OldSplit(PCWSTR pwz, PWSTR *ppwzDomain, PWSTR *ppwzUserName)
+{
+    *ppwzDomain = nullptr;
+    *ppwzUserName = nullptr;
+
+    PCWSTR pwchWhack = pwz;
+    while (*pwchWhack && *pwchWhack != L'\\')
+    {
+        pwchWhack++;
+    }
+    size_t cch = 0;
+    while (pwz[cch])
+    {
+        cch++;
+    }
+    if (!*pwchWhack)
+    {
+        return E_UNEXPECTED;
+    }
+
+    size_t cchDomain = pwchWhack - pwz;
+    size_t cchUserName = cch - cchDomain - 1;
+    PWSTR pwzDomain = (PWSTR)CoTaskMemAlloc((cchDomain + 1) * sizeof(WCHAR));
+    PWSTR pwzUserName = (PWSTR)CoTaskMemAlloc((cchUserName + 1) * sizeof(WCHAR));
+    if (!pwzDomain || !pwzUserName)
+    {
+        CoTaskMemFree(pwzDomain);
+        CoTaskMemFree(pwzUserName);
+        return E_OUTOFMEMORY;
+    }
+    memcpy(pwzDomain, pwz, cchDomain * sizeof(WCHAR));
+    pwzDomain[cchDomain] = L'\0';
+    memcpy(pwzUserName, pwchWhack + 1, (cchUserName + 1) * sizeof(WCHAR));
+
+    *ppwzDomain = pwzDomain;
+    *ppwzUserName = pwzUserName;
+    return S_OK;
+}
+
+static HRESULT _OldJoin(PCWSTR pwzDomain, PCWSTR pwzUserName, PWSTR *ppwzJoined)
+{
+    size_t cchDomain = 0;
+    while (pwzDomain[cchDomain])
+    {
+        cchDomain++;
+    }
+    size_t cchUserName = 0;
+    while (pwzUserName[cchUserName])
+    {
+        cchUserName++;
+    }
+
+    PWSTR pwz = (PWSTR)malloc((cchDomain + 1 + cchUserName + 1) * sizeof(WCHAR));
+    if (!pwz)
+    {
+        return E_OUTOFMEMORY;
+    }
+    memcpy(pwz, pwzDomain, cchDomain * sizeof(WCHAR));
+    pwz[cchDomain] = L'\\';
+    memcpy(pwz + cchDomain + 1, pwzUserName, (cchUserName + 1) * sizeof(WCHAR));
+    *ppwzJoined = pwz;
+    return S_OK;
+}
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+// Splits every name of the corpus and puts it back together, over and over, the old way and the new.
+static void _Bench(const std::vector<NAME> &vnames)
+{
+    const int cRounds = 100000;
+    size_t cchTotal = 0;
+
+    // The old helpers only knew DOMAIN\user.
+    std::vector<const NAME *> vpnameDomain;
+    for (const NAME &rname : vnames)
+    {
+        QUALIFIED_USER_NAME_VIEW view;
+        if (SUCCEEDED(QualifiedUserNameParse(rname.data(), &view)) && view.Form == QUNF_DOMAIN_USERNAME)
+        {
+            vpnameDomain.push_back(&rname);
+        }
+    }
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        for (const NAME *pname : vpnameDomain)
+        {
+            PWSTR pwzDomain;
+            PWSTR pwzUserName;
+            if (SUCCEEDED(_OldSplit(pname->data(), &pwzDomain, &pwzUserName)))
+            {
+                PWSTR pwzJoined;
+                if (SUCCEEDED(_OldJoin(pwzDomain, pwzUserName, &pwzJoined)))
+                {
+                    cchTotal += pwzJoined[0];
+                    free(pwzJoined);
+                }
+                CoTaskMemFree(pwzDomain);
+                CoTaskMemFree(pwzUserName);
+            }
+        }
+    }
+    double dOld = _Seconds(tStart);
+
+    double rgdNew[UK_AVX2 + 1] = {};
+    for (int uk = UK_SCALAR; uk <= UK_AVX2; uk++)
+    {
+        if (Utf16SelectKernel((UTF16_KERNEL)uk) != uk)
+        {
+            continue;
+        }
+
+        WCHAR wszJoined[UNICODE_STRING_MAX_CHARS + 1];
+        tStart = std::chrono::steady_clock::now();
+        for (int iRound = 0; iRound < cRounds; iRound++)
+        {
+            for (const NAME *pname : vpnameDomain)
+            {
+                QUALIFIED_USER_NAME_VIEW view;
+                size_t cchWritten;
+                if (SUCCEEDED(QualifiedUserNameParse(pname->data(), &view)) &&
+                    SUCCEEDED(QualifiedUserNameFormat(&view, wszJoined, ARRAYSIZE(wszJoined), &cchWritten)))
+                {
+                    cchTotal += wszJoined[0];
+                }
+            }
+        }
+        rgdNew[uk] = _Seconds(tStart);
+    }
+
+    // Every form, which the old helpers couldn't do, with the best kernel there is.
+    Utf16SelectKernel(UK_AVX2);
+    WCHAR wszJoined[UNICODE_STRING_MAX_CHARS + 1];
+    tStart = std::chrono::steady_clock::now();
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        for (const NAME &rname : vnames)
+        {
+            QUALIFIED_USER_NAME_VIEW view;
+            size_t cchWritten;
+            if (SUCCEEDED(QualifiedUserNameParse(rname.data(), &view)) &&
+                SUCCEEDED(QualifiedUserNameFormat(&view, wszJoined, ARRAYSIZE(wszJoined), &cchWritten)))
+            {
+                cchTotal += wszJoined[0];
+            }
+        }
+    }
+    double dAll = _Seconds(tStart);
+
+    double cNames = (double)vpnameDomain.size() * cRounds;
+    printf("DOMAIN\\user, %zu names: split and join with copies %6.1f ns\n", vpnameDomain.size(), dOld * 1e9 / cNames);
+    for (int uk = UK_SCALAR; uk <= UK_AVX2; uk++)
+    {
+        if (rgdNew[uk])
+        {
+            static const char *const c_rgpszKernel[] = { "scalar", "sse2", "avx2" };
+            printf("DOMAIN\\user, %zu names: parse and format, %-6s    %6.1f ns\n", vpnameDomain.size(),
+                   c_rgpszKernel[uk], rgdNew[uk] * 1e9 / cNames);
+        }
+    }
+    printf("all %zu names:          parse and format              %6.1f ns\n", vnames.size(),
+           dAll * 1e9 / ((double)vnames.size() * cRounds));
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(cchTotal != 0);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<NAME> vnames;
+    _BuildCorpus(&vnames);
+
+    long cIterations = 100000;
+
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench(vnames);
+        return TestFinish("qualifiedusernamefuzz --bench");
+    }
+    else if (argc == 3 && !strcmp(argv[1], "-n"))
+    {
+        cIterations = atol(argv[2]);
+    }
+    else if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::vector<BYTE> vb;
+            if (argv[i][0] == '-' || !_ReadFile(argv[i], &vb))
+            {
+                fprintf(stderr, "usage: qualifiedusernamefuzz [--bench | -n <iterations> | <input file>...]\n");
+                return 2;
+            }
+            _CheckInput(vb.data(), vb.size());
+        }
+        return TestFinish("qualifiedusernamefuzz");
+    }
+
+    // The corpus itself, and the names whose form is known.
+    for (const NAME &rname : vnames)
+    {
+        _CheckName(rname.data());
+    }
+
+    QUALIFIED_USER_NAME_VIEW view;
+    TEST_CHECK(SUCCEEDED(QualifiedUserNameParse(L"CONTOSO\\jdoe@contoso.com", &view)));
+    TEST_CHECK(view.Form == QUNF_DOMAIN_USERNAME && view.Domain.cch == 7 && view.UserName.cch == 16);
+    TEST_CHECK(SUCCEEDED(QualifiedUserNameParse(L"jdoe@@contoso.com", &view)));
+    TEST_CHECK(view.Form == QUNF_UPN && view.UserName.cch == 5 && view.Domain.cch == 11);
+    TEST_CHECK(SUCCEEDED(QualifiedUserNameParse(L"jdoe@", &view)) && view.Form == QUNF_USERNAME);
+    TEST_CHECK(QualifiedUserNameParse(L"CONTOSO\\", &view) == E_INVALIDARG && _IsZero(view));
+    TEST_CHECK(QualifiedUserNameParse(L"", &view) == E_INVALIDARG && _IsZero(view));
+
+    for (long iIteration = 0; iIteration < cIterations && !s_cTestFailures; iIteration++)
+    {
+        NAME name = vnames[_Random() % vnames.size()];
+        _Mutate(&name);
+        _CheckName(name.data());
+    }
+
+    return TestFinish("qualifiedusernamefuzz");
+}
+
+#endif
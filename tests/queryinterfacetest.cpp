@@ -0,0 +1,385 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// queryinterfacetest checks QueryInterfaceT, in cpp/queryinterface.h, on a
+// mock object with several interfaces: that it hands back the right part
+// of the object for each, answers IUnknown with the first, AddRefs what it
+// hands back and nothing else, and fails as QISearch does.  It also checks
+// QIIsEqualIID against a compare of the whole IID.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o queryinterfacetest tests/queryinterfacetest.cpp
+//
+// Usage: queryinterfacetest [--bench]
+//
+// --bench times QueryInterface with QueryInterfaceT against a QITAB walked
+// as QISearch walks it, for the first and the last interface of four, for
+// IUnknown, and for an interface the object doesn't have.
+
+#include "queryinterface.h"
+#include "testutil.h"
+
+#include <chrono>
+
+//
+// Four interfaces, each saying which it is, so a test can tell that the pointer it was handed
+// is the right part of the object.
+//
+#define DECLARE_MOCK_INTERFACE(IName, iWhich)   \
+    struct IName : public IUnknown              \
+    {                                           \
+        virtual int Which##IName()              \
+        {                                       \
+            return iWhich;                      \
+        }                                       \
+    protected:                                  \
+        ~IName()                                \
+        {                                       \
+        }                                       \
+    };
+
+DECLARE_MOCK_INTERFACE(IMockA, 1)
+DECLARE_MOCK_INTERFACE(IMockB, 2)
+DECLARE_MOCK_INTERFACE(IMockC, 3)
+DECLARE_MOCK_INTERFACE(IMockD, 4)
+DECLARE_MOCK_INTERFACE(IMockMissing, 5)
+
+TESTS_DECLARE_UUID(IMockA, 0x3c5ad1e2, 0x4f09, 0x4b8e, 0x9a, 0x41, 0x0d, 0x6e, 0x2b, 0x77, 0xc1, 0x10)
+TESTS_DECLARE_UUID(IMockB, 0x3c5ad1e2, 0x4f09, 0x4b8e, 0x9a, 0x41, 0x0d, 0x6e, 0x2b, 0x77, 0xc1, 0x11)
+TESTS_DECLARE_UUID(IMockC, 0x8d1f03a7, 0x2e6b, 0x4c55, 0xb3, 0x0c, 0x5a, 0x92, 0xe4, 0x18, 0x6f, 0x3d)
+TESTS_DECLARE_UUID(IMockD, 0xe0472b9c, 0x91d4, 0x4f3a, 0x86, 0x2e, 0x7b, 0x05, 0xc9, 0x3a, 0xd8, 0x54)
+TESTS_DECLARE_UUID(IMockMissing, 0x5b96e4d0, 0x0a73, 0x4e21, 0xa8, 0xf7, 0x14, 0x3c, 0x6d, 0x29, 0xbe, 0x82)
+
+static const IID *s_rgpiidMock[] =
+{
+    &__uuidof(IMockA), &__uuidof(IMockB), &__uuidof(IMockC), &__uuidof(IMockD),
+};
+
+//
+// The object, reference counted by hand so a test can see every AddRef.  TAnswer gives its
+// QueryInterface.
+//
+template <typename TAnswer>
+class MockObject : public IMockA, public IMockB, public IMockC, public IMockD
+{
+public:
+    MockObject() : _cRef(1)
+    {
+    }
+
+    ~MockObject()
+    {
+    }
+
+    HRESULT QueryInterface(REFIID riid, void **ppv)
+    {
+        return TAnswer::QueryInterface(this, riid, ppv);
+    }
+
+    ULONG AddRef()
+    {
+        return ++_cRef;
+    }
+
+    ULONG Release()
+    {
+        return --_cRef;
+    }
+
+    ULONG GetRefs() const
+    {
+        return _cRef;
+    }
+
+private:
+    ULONG _cRef;
+};
+
+struct AnswerT
+{
+    template <typename TClass>
+    static HRESULT QueryInterface(TClass *pThis, REFIID riid, void **ppv)
+    {
+        return QueryInterfaceT<TClass, IMockA, IMockB, IMockC, IMockD>(pThis, riid, ppv);
+    }
+};
+
+// The same object with its interfaces listed in another order, so IUnknown is answered with B.
+struct AnswerTFromB
+{
+    template <typename TClass>
+    static HRESULT QueryInterface(TClass *pThis, REFIID riid, void **ppv)
+    {
+        return QueryInterfaceT<TClass, IMockB, IMockA, IMockD, IMockC>(pThis, riid, ppv);
+    }
+};
+
+//
+// As shlwapi.h's QITAB and QISearch, which QueryInterfaceT replaced: a table of IIDs and
+// offsets into the object, walked in order, each entry compared in full.
+//
+struct QITAB
+{
+    const IID   *piid;
+    int         dwOffset;
+};
+
+#define OFFSETOFCLASS(TBase, TDerived)   ((int)((ULONG_PTR)(static_cast<TBase*>((TDerived*)8)) - 8))
+#define QITABENT(TClass, TInterface)    { &__uuidof(TInterface), OFFSETOFCLASS(TInterface, TClass) }
+
+static HRESULT _QISearch(void *pThis, const QITAB *pqit, REFIID riid, void **ppv)
+{
+    if (ppv == NULL)
+    {
+        return E_POINTER;
+    }
+
+    const QITAB *pqitFound = NULL;
+    if (IsEqualIID(riid, __uuidof(IUnknown)))
+    {
+        pqitFound = pqit;
+    }
+    else
+    {
+        for (; pqit->piid; pqit++)
+        {
+            if (IsEqualIID(riid, *pqit->piid))
+            {
+                pqitFound = pqit;
+                break;
+            }
+        }
+    }
+
+    if (pqitFound == NULL)
+    {
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+
+    IUnknown *punk = reinterpret_cast<IUnknown*>(static_cast<BYTE*>(pThis) + pqitFound->dwOffset);
+    punk->AddRef();
+    *ppv = punk;
+    return S_OK;
+}
+
+struct AnswerQISearch
+{
+    template <typename TClass>
+    static HRESULT QueryInterface(TClass *pThis, REFIID riid, void **ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(TClass, IMockA),
+            QITABENT(TClass, IMockB),
+            QITABENT(TClass, IMockC),
+            QITABENT(TClass, IMockD),
+            { 0 },
+        };
+        return _QISearch(pThis, qit, riid, ppv);
+    }
+};
+
+static const int c_iWhichUnknownA = 1;
+static const int c_iWhichUnknownB = 2;
+
+// Queries pobj for riid and checks it is handed the interface iWhich says, AddRef'd once.
+template <typename TAnswer>
+static void _ExpectInterface(MockObject<TAnswer> *pobj, IUnknown *punkFrom, REFIID riid, int iWhich)
+{
+    ULONG cRef = pobj->GetRefs();
+    void *pv = NULL;
+    TEST_CHECK(punkFrom->QueryInterface(riid, &pv) == S_OK);
+    TEST_CHECK(pobj->GetRefs() == cRef + 1);
+
+    void *pvExpected;
+    int iWhichGot = 0;
+    switch (iWhich)
+    {
+    case 1:
+        pvExpected = static_cast<IMockA*>(pobj);
+        iWhichGot = pv ? static_cast<IMockA*>(pv)->WhichIMockA() : 0;
+        break;
+    case 2:
+        pvExpected = static_cast<IMockB*>(pobj);
+        iWhichGot = pv ? static_cast<IMockB*>(pv)->WhichIMockB() : 0;
+        break;
+    case 3:
+        pvExpected = static_cast<IMockC*>(pobj);
+        iWhichGot = pv ? static_cast<IMockC*>(pv)->WhichIMockC() : 0;
+        break;
+    default:
+        pvExpected = static_cast<IMockD*>(pobj);
+        iWhichGot = pv ? static_cast<IMockD*>(pv)->WhichIMockD() : 0;
+        break;
+    }
+    TEST_CHECK(pv == pvExpected && iWhichGot == iWhich);
+
+    if (pv)
+    {
+        static_cast<IUnknown*>(pv)->Release();
+    }
+}
+
+// Queries pobj for riid and checks it fails with *ppv NULL, having AddRef'd nothing.
+template <typename TAnswer>
+static void _ExpectNoInterface(MockObject<TAnswer> *pobj, REFIID riid)
+{
+    ULONG cRef = pobj->GetRefs();
+    void *pv = pobj;
+    TEST_CHECK(pobj->QueryInterface(riid, &pv) == E_NOINTERFACE);
+    TEST_CHECK(pv == NULL && pobj->GetRefs() == cRef);
+}
+
+template <typename TAnswer>
+static void _CheckObject(int iWhichUnknown)
+{
+    MockObject<TAnswer> obj;
+    IUnknown *rgpunkFrom[] =
+    {
+        static_cast<IMockA*>(&obj), static_cast<IMockB*>(&obj),
+        static_cast<IMockC*>(&obj), static_cast<IMockD*>(&obj),
+    };
+
+    // Every interface, asked of every other: the object is the same whichever part is asked.
+    for (IUnknown *punkFrom : rgpunkFrom)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            _ExpectInterface(&obj, punkFrom, *s_rgpiidMock[i], i + 1);
+        }
+        _ExpectInterface(&obj, punkFrom, __uuidof(IUnknown), iWhichUnknown);
+    }
+
+    _ExpectNoInterface(&obj, __uuidof(IMockMissing));
+
+    // IIDs a bit off one of the object's, in the first half and in the last.  IMockA and IMockB
+    // differ only in the last bit, so this never makes one of the other.
+    for (int i = 0; i < 4; i++)
+    {
+        for (size_t ib = 0; ib < sizeof(IID); ib++)
+        {
+            IID iid = *s_rgpiidMock[i];
+            reinterpret_cast<BYTE*>(&iid)[ib] ^= 0x80;
+            _ExpectNoInterface(&obj, iid);
+        }
+    }
+
+    ULONG cRef = obj.GetRefs();
+    TEST_CHECK(obj.QueryInterface(__uuidof(IMockA), NULL) == E_POINTER);
+    TEST_CHECK(obj.GetRefs() == cRef && cRef == 1);
+}
+
+static void _CheckIsEqualIID()
+{
+    IID iid = *s_rgpiidMock[2];
+    TEST_CHECK(QIIsEqualIID(iid, __uuidof(IMockC)));
+    TEST_CHECK(!QIIsEqualIID(__uuidof(IMockA), __uuidof(IMockB)));
+    TEST_CHECK(!QIIsEqualIID(__uuidof(IUnknown), __uuidof(IMockA)));
+
+    // Each bit of each byte, in both halves.
+    for (size_t ib = 0; ib < sizeof(IID); ib++)
+    {
+        for (int iBit = 0; iBit < 8; iBit++)
+        {
+            IID iidFlipped = iid;
+            reinterpret_cast<BYTE*>(&iidFlipped)[ib] ^= (BYTE)(1 << iBit);
+            TEST_CHECK(!QIIsEqualIID(iid, iidFlipped) && !QIIsEqualIID(iidFlipped, iid));
+            TEST_CHECK(!IsEqualIID(iid, iidFlipped));
+        }
+    }
+}
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+// Read through a volatile, so each QueryInterface is called through the vtable, as COM calls it.
+static IUnknown *volatile s_punkBench;
+
+static double _TimeQueryInterface(IUnknown *punk, REFIID riid, int cCalls, ULONG_PTR *pSum)
+{
+    s_punkBench = punk;
+    IUnknown *punkBench = s_punkBench;
+    ULONG_PTR sum = 0;
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < cCalls; i++)
+    {
+        void *pv;
+        HRESULT hr = punkBench->QueryInterface(riid, &pv);
+        if (SUCCEEDED(hr))
+        {
+            static_cast<IUnknown*>(pv)->Release();
+        }
+        sum += (ULONG_PTR)pv + hr;
+    }
+    double dSeconds = _Seconds(tStart);
+
+    *pSum += sum;
+    return dSeconds * 1e9 / cCalls;
+}
+
+static void _Bench()
+{
+    const int cCalls = 20000000;
+    ULONG_PTR sum = 0;
+
+    MockObject<AnswerQISearch> objOld;
+    MockObject<AnswerT> objNew;
+    IUnknown *punkOld = static_cast<IMockA*>(&objOld);
+    IUnknown *punkNew = static_cast<IMockA*>(&objNew);
+
+    static const struct
+    {
+        const char  *pszName;
+        const IID   *piid;
+    } c_rgCases[] =
+    {
+        { "first interface", &__uuidof(IMockA) },
+        { "last interface ", &__uuidof(IMockD) },
+        { "IUnknown       ", &__uuidof(IUnknown) },
+        { "no interface   ", &__uuidof(IMockMissing) },
+    };
+
+    for (const auto &rcase : c_rgCases)
+    {
+        double dOld = _TimeQueryInterface(punkOld, *rcase.piid, cCalls, &sum);
+        double dNew = _TimeQueryInterface(punkNew, *rcase.piid, cCalls, &sum);
+        printf("QueryInterface, %s: QISearch %5.2f ns, QueryInterfaceT %5.2f ns\n", rcase.pszName, dOld, dNew);
+    }
+
+    TEST_CHECK(objOld.GetRefs() == 1 && objNew.GetRefs() == 1);
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(sum != 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("queryinterfacetest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: queryinterfacetest [--bench]\n");
+        return 2;
+    }
+
+    _CheckIsEqualIID();
+
+    // The table QueryInterfaceT replaced has to pass the same checks.
+    _CheckObject<AnswerQISearch>(c_iWhichUnknownA);
+    _CheckObject<AnswerT>(c_iWhichUnknownA);
+    _CheckObject<AnswerTFromB>(c_iWhichUnknownB);
+
+    return TestFinish("queryinterfacetest");
+}
@@ -0,0 +1,419 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// refcounttest checks cpp/refcount.h: that ComPtr takes, shares and hands
+// over references as it says, and that under many threads sharing objects,
+// copying, moving and releasing them, each object is deleted exactly once,
+// after every thread is done with it and seeing all they wrote to it.
+// -fsanitize=thread doesn't model the fence in RefCount::Release, and so
+// reports races on the delete that aren't there; build with ASan instead.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -pthread
+//       -I tests/win32 -I cpp -o refcounttest tests/refcounttest.cpp
+//
+// Usage: refcounttest [--bench]
+//
+// --bench times an AddRef and Release pair with RefCount against the plain
+// increment and the interlocked one it replaced, from one thread and from
+// several on the same object, and handing a ComPtr over by copy and by move.
+
+#include "refcount.h"
+#include "credentialprovider.h"
+#include "testutil.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static const int c_cThreads = 8;
+
+static std::atomic<long> s_cCreated(0);
+static std::atomic<long> s_cDeleted(0);
+
+//
+// A COM object whose AddRef and Release are RefCount's.  Each thread writes its own slot of the
+// object before giving up its reference; the thread that deletes it must see every write.
+//
+class MockObject : public IUnknown
+{
+public:
+    MockObject()
+    {
+        s_cCreated++;
+        for (DWORD &rdw : _rgdwWrites)
+        {
+            rdw = 0;
+        }
+    }
+
+    ULONG AddRef()
+    {
+        return _cRef.AddRef();
+    }
+
+    ULONG Release()
+    {
+        ULONG cRef = _cRef.Release();
+        if (!cRef)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+
+    void Write(int iThread)
+    {
+        _rgdwWrites[iThread]++;
+    }
+
+    DWORD GetWrites() const
+    {
+        DWORD cWrites = 0;
+        for (DWORD dw : _rgdwWrites)
+        {
+            cWrites += dw;
+        }
+        return cWrites;
+    }
+
+    static DWORD s_cWritesExpected;
+
+private:
+    ~MockObject()
+    {
+        TEST_CHECK(GetWrites() == s_cWritesExpected);
+        s_cDeleted++;
+    }
+
+    RefCount    _cRef;
+    DWORD       _rgdwWrites[c_cThreads];
+};
+
+DWORD MockObject::s_cWritesExpected;
+
+// The reference count, read by taking and giving back a reference.
+static ULONG _GetRefs(IUnknown *punk)
+{
+    punk->AddRef();
+    return punk->Release();
+}
+
+static void _CheckComPtr()
+{
+    MockObject::s_cWritesExpected = 0;
+    long cDeleted = s_cDeleted;
+
+    MockObject *pobj = new MockObject();
+    {
+        // Taking a raw pointer adds a reference; Attach takes over the caller's.
+        ComPtr<MockObject> sp(pobj);
+        TEST_CHECK(_GetRefs(pobj) == 2);
+        pobj->Release();
+        TEST_CHECK(_GetRefs(pobj) == 1);
+
+        // A copy adds one, a move hands it over.
+        ComPtr<MockObject> spCopy(sp);
+        TEST_CHECK(_GetRefs(pobj) == 2 && spCopy.Get() == pobj);
+        ComPtr<MockObject> spMoved(std::move(spCopy));
+        TEST_CHECK(_GetRefs(pobj) == 2 && spMoved.Get() == pobj && spCopy.Get() == NULL);
+
+        spCopy = sp;
+        TEST_CHECK(_GetRefs(pobj) == 3);
+        spCopy = std::move(spMoved);
+        TEST_CHECK(_GetRefs(pobj) == 2 && spMoved.Get() == NULL);
+
+        // Assigning an object its own pointer, or a ComPtr itself, changes nothing.
+        spCopy = pobj;
+        TEST_CHECK(_GetRefs(pobj) == 2);
+        ComPtr<MockObject> &rspSelf = spCopy;
+        spCopy = std::move(rspSelf);
+        spCopy = rspSelf;
+        TEST_CHECK(_GetRefs(pobj) == 2 && spCopy.Get() == pobj);
+
+        MockObject *pDetached = spCopy.Detach();
+        TEST_CHECK(pDetached == pobj && spCopy.Get() == NULL && _GetRefs(pobj) == 2);
+        spCopy.Attach(pDetached);
+        TEST_CHECK(_GetRefs(pobj) == 2);
+
+        // An out parameter gives up what was held, and takes over what it is given.
+        MockObject **ppobj = spCopy.ReleaseAndGetAddressOf();
+        TEST_CHECK(*ppobj == NULL && _GetRefs(pobj) == 1);
+        pobj->AddRef();
+        *ppobj = pobj;
+        TEST_CHECK(_GetRefs(pobj) == 2);
+
+        spCopy.Reset();
+        TEST_CHECK(_GetRefs(pobj) == 1 && s_cDeleted == cDeleted);
+    }
+    TEST_CHECK(s_cDeleted == cDeleted + 1);
+}
+
+//
+// Threads are each given a reference on every object of a round.  Each writes to the object
+// and then gives its reference up: by releasing it, by moving it along first, or by putting it
+// in a shared slot, from which another thread takes it over and releases it.  Every object
+// must be deleted exactly once, having been written by every thread.
+//
+static void _Stress(int cRounds, int cObjects)
+{
+    static const int c_cSlots = 16;
+    std::atomic<MockObject*> rgpSlots[c_cSlots];
+    for (std::atomic<MockObject*> &rp : rgpSlots)
+    {
+        rp = nullptr;
+    }
+
+    MockObject::s_cWritesExpected = c_cThreads;
+    long cCreated = s_cCreated;
+    long cDeleted = s_cDeleted;
+
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        std::vector<std::vector<ComPtr<MockObject> > > vvsp(c_cThreads);
+        {
+            std::vector<ComPtr<MockObject> > vsp;
+            for (int i = 0; i < cObjects; i++)
+            {
+                ComPtr<MockObject> sp;
+                sp.Attach(new MockObject());
+                for (std::vector<ComPtr<MockObject> > &rvsp : vvsp)
+                {
+                    rvsp.push_back(sp);
+                }
+            }
+        }
+
+        std::atomic<bool> fGo(false);
+        std::vector<std::thread> vthreads;
+        for (int iThread = 0; iThread < c_cThreads; iThread++)
+        {
+            vthreads.emplace_back([&, iThread]()
+            {
+                while (!fGo)
+                {
+                    std::this_thread::yield();
+                }
+
+                unsigned int uSeed = iThread * 7919 + iRound + 1;
+                for (ComPtr<MockObject> &rsp : vvsp[iThread])
+                {
+                    rsp->Write(iThread);
+
+                    uSeed = uSeed * 1103515245 + 12345;
+                    switch ((uSeed >> 16) % 3)
+                    {
+                    case 0:
+                        rsp.Reset();
+                        break;
+                    case 1:
+                    {
+                        ComPtr<MockObject> spMoved(std::move(rsp));
+                        ComPtr<MockObject> spCopy(spMoved);
+                        break;
+                    }
+                    default:
+                    {
+                        MockObject *pOld = rgpSlots[(uSeed >> 8) % c_cSlots].exchange(rsp.Detach());
+                        ComPtr<MockObject> spOld;
+                        spOld.Attach(pOld);
+                        break;
+                    }
+                    }
+                }
+            });
+        }
+
+        fGo = true;
+        for (std::thread &rthread : vthreads)
+        {
+            rthread.join();
+        }
+
+        for (std::atomic<MockObject*> &rp : rgpSlots)
+        {
+            MockObject *p = rp.exchange(nullptr);
+            if (p)
+            {
+                p->Release();
+            }
+        }
+
+        TEST_CHECK(s_cCreated - cCreated == (long)cObjects * (iRound + 1));
+        TEST_CHECK(s_cDeleted - cDeleted == s_cCreated - cCreated);
+    }
+}
+
+// The counts RefCount replaced: the provider's plain one, and the class factory's interlocked one.
+class PlainObject : public IUnknown
+{
+public:
+    PlainObject() : _cRef(1)
+    {
+    }
+
+    ULONG AddRef()
+    {
+        return ++_cRef;
+    }
+
+    ULONG Release()
+    {
+        return --_cRef;
+    }
+
+private:
+    LONG _cRef;
+};
+
+class InterlockedObject : public IUnknown
+{
+public:
+    InterlockedObject() : _cRef(1)
+    {
+    }
+
+    ULONG AddRef()
+    {
+        return InterlockedIncrement(&_cRef);
+    }
+
+    ULONG Release()
+    {
+        return (ULONG)__atomic_sub_fetch(&_cRef, 1, __ATOMIC_SEQ_CST);
+    }
+
+private:
+    volatile LONG _cRef;
+};
+
+class RefCountObject : public IUnknown
+{
+public:
+    ULONG AddRef()
+    {
+        return _cRef.AddRef();
+    }
+
+    ULONG Release()
+    {
+        return _cRef.Release();
+    }
+
+private:
+    RefCount _cRef;
+};
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+// Read through a volatile, so the calls are made through the vtable, as COM callers make them.
+static IUnknown *volatile s_punkBench;
+
+// AddRef and Release pairs on punk, from cThreads threads at once; returns ns per pair.
+static double _TimePairs(IUnknown *punk, int cThreads, int cPairs, ULONG *pcSum)
+{
+    s_punkBench = punk;
+    std::atomic<ULONG> cSum(0);
+    std::vector<std::thread> vthreads;
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int iThread = 0; iThread < cThreads; iThread++)
+    {
+        vthreads.emplace_back([&]()
+        {
+            IUnknown *punkThread = s_punkBench;
+            ULONG c = 0;
+            for (int i = 0; i < cPairs; i++)
+            {
+                c += punkThread->AddRef();
+                c += punkThread->Release();
+            }
+            cSum += c;
+        });
+    }
+    for (std::thread &rthread : vthreads)
+    {
+        rthread.join();
+    }
+    double dSeconds = _Seconds(tStart);
+
+    *pcSum += cSum;
+    return dSeconds * 1e9 / cPairs;
+}
+
+static void _Bench()
+{
+    const int cPairs = 20000000;
+    const int cThreadsContended = 4;
+    ULONG cSum = 0;
+
+    PlainObject objPlain;
+    InterlockedObject objInterlocked;
+    RefCountObject objRefCount;
+
+    printf("AddRef + Release, 1 thread:     plain %5.2f ns, interlocked %5.2f ns, RefCount %5.2f ns\n",
+           _TimePairs(&objPlain, 1, cPairs, &cSum), _TimePairs(&objInterlocked, 1, cPairs, &cSum),
+           _TimePairs(&objRefCount, 1, cPairs, &cSum));
+
+    // The plain count isn't safe to share, which is why it went.
+    printf("AddRef + Release, %d threads:    interlocked %5.2f ns, RefCount %5.2f ns (per pair per thread)\n",
+           cThreadsContended, _TimePairs(&objInterlocked, cThreadsContended, cPairs / 4, &cSum),
+           _TimePairs(&objRefCount, cThreadsContended, cPairs / 4, &cSum));
+
+    // Handing a reference along: a copy and a release, as the code did by hand, or a move.
+    MockObject::s_cWritesExpected = 0;
+    ComPtr<MockObject> sp;
+    sp.Attach(new MockObject());
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < cPairs; i++)
+    {
+        ComPtr<MockObject> spNext(sp);
+        sp.Reset();
+        sp = std::move(spNext);
+    }
+    double dCopy = _Seconds(tStart);
+
+    tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < cPairs; i++)
+    {
+        ComPtr<MockObject> spNext(std::move(sp));
+        sp = std::move(spNext);
+    }
+    double dMove = _Seconds(tStart);
+
+    printf("handing a ComPtr over:          copy and release %5.2f ns, move %5.2f ns\n",
+           dCopy * 1e9 / cPairs, dMove * 1e9 / cPairs);
+
+    TEST_CHECK(_GetRefs(sp.Get()) == 1);
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(cSum != 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("refcounttest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: refcounttest [--bench]\n");
+        return 2;
+    }
+
+    _CheckComPtr();
+    _Stress(20, 2000);
+
+    return TestFinish("refcounttest");
+}
@@ -0,0 +1,249 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// securearenatest checks cpp/securearena.cpp against VirtualAlloc,
+// VirtualLock, VirtualUnlock and VirtualFree of its own, which record what
+// is done with the pages: that everything handed out is wiped by Reset,
+// and by WipeAndRelease before the pages are unlocked and released, and
+// that an arena whose pages can't be locked still works.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined -DTESTS_OWN_VIRTUAL_MEMORY
+//       -I tests/win32 -I cpp -o securearenatest tests/securearenatest.cpp
+//       cpp/securearena.cpp cpp/allocator.cpp cpp/utf16.cpp
+
+#include "allocator.h"
+#include "securearena.h"
+#include "testutil.h"
+
+#include <vector>
+
+static const SIZE_T c_cbPage = 4096;
+
+// The one region the arena has; the stubs check that every call is about it.
+static BYTE     *s_pbRegion;
+static SIZE_T   s_cbRegion;
+static bool     s_fLocked;
+static bool     s_fFailAlloc;
+static bool     s_fFailLock;
+static int      s_cUnlocks;
+static int      s_cFrees;
+
+// How much the test handed out, and whether it was all wiped when the pages were unlocked, and
+// when they were released.
+static SIZE_T   s_cbHandedOut;
+static bool     s_fWipedWhenUnlocked;
+static bool     s_fWipedWhenFreed;
+
+static bool _IsZero(const BYTE *pb, SIZE_T cb)
+{
+    for (SIZE_T i = 0; i < cb; i++)
+    {
+        if (pb[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void *VirtualAlloc(void *pv, SIZE_T cb, DWORD flAllocationType, DWORD flProtect)
+{
+    TEST_CHECK(pv == nullptr && !s_pbRegion);
+    TEST_CHECK(flAllocationType == (MEM_RESERVE | MEM_COMMIT) && flProtect == PAGE_READWRITE);
+    TEST_CHECK(cb % c_cbPage == 0);
+    if (s_fFailAlloc)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    // Committed pages start out zeroed; these start out anything but, so a wipe that misses a
+    // byte shows.
+    s_pbRegion = (BYTE *)aligned_alloc(c_cbPage, cb);
+    memset(s_pbRegion, 0xCC, cb);
+    s_cbRegion = cb;
+    return s_pbRegion;
+}
+
+BOOL VirtualLock(void *pv, SIZE_T cb)
+{
+    TEST_CHECK(pv == s_pbRegion && cb == s_cbRegion && !s_fLocked);
+    s_fLocked = !s_fFailLock;
+    return s_fLocked;
+}
+
+BOOL VirtualUnlock(void *pv, SIZE_T cb)
+{
+    TEST_CHECK(pv == s_pbRegion && cb == s_cbRegion && s_fLocked);
+    s_cUnlocks++;
+    s_fWipedWhenUnlocked = _IsZero(s_pbRegion, s_cbHandedOut);
+    s_fLocked = false;
+    return 1;
+}
+
+BOOL VirtualFree(void *pv, SIZE_T cb, DWORD dwFreeType)
+{
+    TEST_CHECK(pv == s_pbRegion && cb == 0 && dwFreeType == MEM_RELEASE);
+    TEST_CHECK(!s_fLocked);
+    s_cFrees++;
+    s_fWipedWhenFreed = _IsZero(s_pbRegion, s_cbHandedOut);
+    free(s_pbRegion);
+    s_pbRegion = nullptr;
+    s_cbRegion = 0;
+    return 1;
+}
+
+static size_t _Length(PCWSTR pwz)
+{
+    size_t cch = 0;
+    while (pwz[cch])
+    {
+        cch++;
+    }
+    return cch;
+}
+
+//
+// Fills the arena with strings through SecureArenaAllocator, as a helper copying passwords
+// would, and returns how many bytes were handed out.  What lies past them was never handed
+// out, so it still holds the 0xCC the stub filled it with.
+//
+static SIZE_T _Fill(_Inout_ SecureArena *parena)
+{
+    static PCWSTR const c_rgpwz[] = { L"hunter2", L"", L"correct horse battery staple", L"x" };
+
+    SecureArenaAllocator allocator(parena);
+    for (PCWSTR pwz : c_rgpwz)
+    {
+        PWSTR pwzCopy;
+        TEST_CHECK(SUCCEEDED(allocator.StrDup(pwz, &pwzCopy)));
+        TEST_CHECK(((ULONG_PTR)pwzCopy & (MEMORY_ALLOCATION_ALIGNMENT - 1)) == 0);
+        TEST_CHECK(0 == memcmp(pwzCopy, pwz, (_Length(pwz) + 1) * sizeof(wchar_t)));
+
+        // Free gives nothing back, and wipes nothing either; that is Reset's job.
+        allocator.Free(pwzCopy);
+        TEST_CHECK(pwzCopy[0] == pwz[0]);
+    }
+
+    SIZE_T cbUsed = parena->GetUsed();
+    TEST_CHECK(cbUsed > 0 && cbUsed % MEMORY_ALLOCATION_ALIGNMENT == 0);
+    TEST_CHECK(!_IsZero(s_pbRegion, cbUsed));
+    TEST_CHECK(s_pbRegion[cbUsed] == 0xCC);
+    return cbUsed;
+}
+
+static void _CheckInitialize()
+{
+    SecureArena arena;
+    void *pv;
+    TEST_CHECK(arena.Alloc(1, &pv) == E_UNEXPECTED && pv == nullptr);
+    TEST_CHECK(arena.Initialize(0) == E_INVALIDARG);
+
+    // Locking is by page, so the capacity is rounded up to one.
+    TEST_CHECK(SUCCEEDED(arena.Initialize(100)));
+    TEST_CHECK(arena.GetCapacity() == c_cbPage && s_cbRegion == c_cbPage);
+    TEST_CHECK(arena.IsLocked() && s_fLocked);
+    TEST_CHECK(arena.Initialize(100) == HRESULT_FROM_WIN32(ERROR_ALREADY_INITIALIZED));
+
+    // The whole capacity can be handed out, and not a byte more.
+    TEST_CHECK(SUCCEEDED(arena.Alloc(c_cbPage - MEMORY_ALLOCATION_ALIGNMENT, &pv)));
+    TEST_CHECK(pv == s_pbRegion);
+    TEST_CHECK(arena.Alloc(MEMORY_ALLOCATION_ALIGNMENT + 1, &pv) == E_OUTOFMEMORY && pv == nullptr);
+    TEST_CHECK(SUCCEEDED(arena.Alloc(1, &pv)));
+    TEST_CHECK(arena.GetUsed() == c_cbPage);
+    TEST_CHECK(arena.Alloc(1, &pv) == E_OUTOFMEMORY);
+    TEST_CHECK(arena.Alloc((SIZE_T)-1, &pv) != S_OK);
+}
+
+// Reset wipes what was handed out, touches nothing past it, and hands the same memory out again.
+static void _CheckReset()
+{
+    s_cFrees = 0;
+    SecureArena arena;
+    TEST_CHECK(SUCCEEDED(arena.Initialize(3 * c_cbPage)));
+
+    for (int iRound = 0; iRound < 3; iRound++)
+    {
+        SIZE_T cbUsed = _Fill(&arena);
+        arena.Reset();
+        TEST_CHECK(arena.GetUsed() == 0);
+        TEST_CHECK(_IsZero(s_pbRegion, cbUsed));
+        TEST_CHECK(s_pbRegion[cbUsed] == 0xCC);
+
+        void *pv;
+        TEST_CHECK(SUCCEEDED(arena.Alloc(1, &pv)) && pv == s_pbRegion);
+        arena.Reset();
+    }
+    TEST_CHECK(s_cFrees == 0);
+}
+
+//
+// WipeAndRelease wipes what was handed out before the pages are unlocked, and so before they
+// could be paged out or handed to anyone else.  The destructor does the same, and an arena
+// whose pages could not be locked is wiped all the same before it is released.
+//
+static void _CheckWipeAndRelease(bool fExplicit, bool fFailLock)
+{
+    s_fFailLock = fFailLock;
+    s_cUnlocks = 0;
+    s_cFrees = 0;
+    s_fWipedWhenUnlocked = false;
+    s_fWipedWhenFreed = false;
+    {
+        SecureArena arena;
+        TEST_CHECK(SUCCEEDED(arena.Initialize(2 * c_cbPage)));
+        TEST_CHECK(arena.IsLocked() == !fFailLock);
+        s_cbHandedOut = _Fill(&arena);
+
+        if (fExplicit)
+        {
+            arena.WipeAndRelease();
+            TEST_CHECK(s_cFrees == 1);
+            TEST_CHECK(arena.GetCapacity() == 0 && arena.GetUsed() == 0 && !arena.IsLocked());
+
+            // Once released, the arena hands out nothing, and releasing it again does nothing.
+            void *pv;
+            TEST_CHECK(arena.Alloc(1, &pv) == E_UNEXPECTED);
+            arena.WipeAndRelease();
+        }
+    }
+    TEST_CHECK(s_cFrees == 1);
+    TEST_CHECK(s_fWipedWhenFreed);
+    TEST_CHECK(s_cUnlocks == (fFailLock ? 0 : 1));
+    TEST_CHECK(s_fWipedWhenUnlocked == !fFailLock);
+    TEST_CHECK(s_pbRegion == nullptr);
+    s_fFailLock = false;
+}
+
+// Without pages, there is no arena, and the failure is reported as it is.
+static void _CheckAllocFailure()
+{
+    s_fFailAlloc = true;
+    SecureArena arena;
+    TEST_CHECK(arena.Initialize(c_cbPage) == HRESULT_FROM_WIN32(ENOMEM));
+    TEST_CHECK(arena.GetCapacity() == 0);
+    void *pv;
+    TEST_CHECK(arena.Alloc(1, &pv) == E_UNEXPECTED);
+    s_fFailAlloc = false;
+}
+
+int main()
+{
+    _CheckInitialize();
+    TEST_CHECK(s_pbRegion == nullptr);
+    _CheckReset();
+    TEST_CHECK(s_pbRegion == nullptr);
+
+    _CheckWipeAndRelease(true, false);
+    _CheckWipeAndRelease(false, false);
+    _CheckWipeAndRelease(true, true);
+    _CheckWipeAndRelease(false, true);
+    _CheckAllocFailure();
+
+    return TestFinish("securearenatest");
+}
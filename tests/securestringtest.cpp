@@ -0,0 +1,302 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// securestringtest checks cpp/securestring.cpp: inline and heap strings,
+// moving from one to the other, handing them to COM, assigning a string
+// part of itself, and that what a string held is wiped when it changes.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o securestringtest tests/securestringtest.cpp cpp/securestring.cpp cpp/utf16.cpp
+//
+// Usage: securestringtest [--bench]
+//
+// --bench times SecureString against the heap copy per string it replaces
+// (SHStrDupW and CoTaskMemFree), over user names and domains.
+
+#include "securestring.h"
+#include "testutil.h"
+
+#include <chrono>
+#include <vector>
+
+static const size_t c_cchInlineMax = SecureString::c_cchInline - 1;
+
+// cch characters, each different from its neighbours, so a copy from the wrong place shows.
+static std::vector<wchar_t> _MakeString(size_t cch)
+{
+    std::vector<wchar_t> vwch(cch + 1);
+    for (size_t i = 0; i < cch; i++)
+    {
+        vwch[i] = (wchar_t)(L'A' + i % 26 + (i / 26) * 0x100);
+    }
+    vwch[cch] = L'\0';
+    return vwch;
+}
+
+static bool _Holds(const SecureString &str, const wchar_t *pwch, size_t cch)
+{
+    return str.GetLength() == cch && 0 == memcmp(str.Get(), pwch, cch * sizeof(wchar_t)) && str.Get()[cch] == L'\0';
+}
+
+// Whatever a string of cchOld characters left past the current one has been wiped.
+static bool _IsWipedTo(const SecureString &str, size_t cchOld)
+{
+    for (size_t i = str.GetLength(); i <= cchOld; i++)
+    {
+        if (str.Get()[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void _CheckAssign()
+{
+    static const size_t c_rgcch[] = { 0, 1, c_cchInlineMax - 1, c_cchInlineMax, c_cchInlineMax + 1, 300 };
+
+    for (size_t cch : c_rgcch)
+    {
+        std::vector<wchar_t> vwch = _MakeString(cch);
+
+        SecureString str;
+        TEST_CHECK(str.IsEmpty() && str.IsInline() && str.Get()[0] == L'\0');
+
+        TEST_CHECK(SUCCEEDED(str.Assign(vwch.data())));
+        TEST_CHECK(_Holds(str, vwch.data(), cch));
+        TEST_CHECK(str.IsInline() == (cch <= c_cchInlineMax));
+
+        TEST_CHECK(SUCCEEDED(str.Assign(vwch.data(), cch)));
+        TEST_CHECK(_Holds(str, vwch.data(), cch));
+
+        // Going shorter keeps the buffer, and wipes what the longer string left in it.
+        bool fInline = str.IsInline();
+        TEST_CHECK(SUCCEEDED(str.Assign(L"ab")));
+        TEST_CHECK(_Holds(str, L"ab", 2));
+        TEST_CHECK(str.IsInline() == fInline);
+        TEST_CHECK(_IsWipedTo(str, cch));
+    }
+}
+
+// A string assigned from part of itself, at every offset, by both overloads, inline and not.
+static void _CheckAssignFromSelf()
+{
+    static const size_t c_rgcch[] = { 1, 10, c_cchInlineMax, c_cchInlineMax + 1, 100, 300 };
+
+    for (size_t cch : c_rgcch)
+    {
+        std::vector<wchar_t> vwch = _MakeString(cch);
+
+        for (size_t ich = 0; ich <= cch; ich++)
+        {
+            SecureString str;
+            TEST_CHECK(SUCCEEDED(str.Assign(vwch.data())));
+            bool fInline = str.IsInline();
+            TEST_CHECK(SUCCEEDED(str.Assign(str.Get() + ich)));
+            TEST_CHECK(_Holds(str, vwch.data() + ich, cch - ich));
+            TEST_CHECK(str.IsInline() == fInline);
+            TEST_CHECK(_IsWipedTo(str, cch));
+
+            for (size_t cchPart = 0; ich + cchPart <= cch; cchPart += 7)
+            {
+                TEST_CHECK(SUCCEEDED(str.Assign(vwch.data())));
+                TEST_CHECK(SUCCEEDED(str.Assign(str.Get() + ich, cchPart)));
+                TEST_CHECK(_Holds(str, vwch.data() + ich, cchPart));
+                TEST_CHECK(_IsWipedTo(str, cch));
+            }
+        }
+    }
+}
+
+static void _CheckMove()
+{
+    std::vector<wchar_t> vwchLong = _MakeString(200);
+
+    // An inline string is copied, and the source wiped.
+    SecureString strShort;
+    TEST_CHECK(SUCCEEDED(strShort.Assign(L"jdoe")));
+    SecureString strMoved(std::move(strShort));
+    TEST_CHECK(_Holds(strMoved, L"jdoe", 4) && strMoved.IsInline());
+    TEST_CHECK(strShort.IsEmpty() && strShort.IsInline() && _IsWipedTo(strShort, 4));
+
+    // A heap string changes hands as it is.
+    SecureString strLong;
+    TEST_CHECK(SUCCEEDED(strLong.Assign(vwchLong.data())));
+    PCWSTR pwzHeap = strLong.Get();
+    strMoved = std::move(strLong);
+    TEST_CHECK(strMoved.Get() == pwzHeap && _Holds(strMoved, vwchLong.data(), 200));
+    TEST_CHECK(strLong.IsEmpty() && strLong.IsInline());
+
+    // Moving to itself changes nothing.
+    SecureString &rstrSelf = strMoved;
+    strMoved = std::move(rstrSelf);
+    TEST_CHECK(_Holds(strMoved, vwchLong.data(), 200));
+}
+
+static void _CheckCoTaskMem()
+{
+    std::vector<wchar_t> vwchLong = _MakeString(200);
+
+    SecureString str;
+    TEST_CHECK(SUCCEEDED(str.Assign(L"CONTOSO")));
+
+    PWSTR pwz;
+    TEST_CHECK(SUCCEEDED(str.CopyToCoTaskMem(&pwz)));
+    TEST_CHECK(pwz != str.Get() && 0 == memcmp(pwz, L"CONTOSO", 8 * sizeof(wchar_t)));
+    TEST_CHECK(_Holds(str, L"CONTOSO", 7));
+    CoTaskMemFree(pwz);
+
+    // An inline string is copied out and wiped; a heap one is given away without a copy.
+    TEST_CHECK(SUCCEEDED(str.DetachToCoTaskMem(&pwz)));
+    TEST_CHECK(0 == memcmp(pwz, L"CONTOSO", 8 * sizeof(wchar_t)));
+    TEST_CHECK(str.IsEmpty() && _IsWipedTo(str, 7));
+    CoTaskMemFree(pwz);
+
+    TEST_CHECK(SUCCEEDED(str.Assign(vwchLong.data())));
+    PCWSTR pwzHeap = str.Get();
+    TEST_CHECK(SUCCEEDED(str.DetachToCoTaskMem(&pwz)));
+    TEST_CHECK(pwz == pwzHeap && 0 == memcmp(pwz, vwchLong.data(), 201 * sizeof(wchar_t)));
+    TEST_CHECK(str.IsEmpty() && str.IsInline());
+    CoTaskMemFree(pwz);
+}
+
+static void _CheckBuffer()
+{
+    SecureString str;
+    TEST_CHECK(SUCCEEDED(str.Assign(L"password")));
+
+    // GetBuffer wipes the whole buffer, and ReleaseBuffer never lets the length past it.
+    PWSTR pwz;
+    TEST_CHECK(SUCCEEDED(str.GetBuffer(4, &pwz)));
+    TEST_CHECK(pwz == str.Get() && _IsWipedTo(str, 8));
+    memcpy(pwz, L"user", 4 * sizeof(wchar_t));
+    str.ReleaseBuffer(4);
+    TEST_CHECK(_Holds(str, L"user", 4));
+
+    TEST_CHECK(SUCCEEDED(str.GetBuffer(2, &pwz)));
+    str.ReleaseBuffer(1000);
+    TEST_CHECK(str.GetLength() == c_cchInlineMax && str.Get()[c_cchInlineMax] == L'\0');
+
+    str.Clear();
+    TEST_CHECK(str.IsEmpty() && _IsWipedTo(str, c_cchInlineMax));
+}
+
+// The names a logon carries, at their usual lengths.
+static PCWSTR const c_rgpwzBench[] =
+{
+    L"CONTOSO",
+    L"corp.contoso.com",
+    L"jdoe",
+    L"administrator",
+    L"firstname.lastname",
+    L"jdoe@corp.contoso.com",
+};
+
+// What SecureString replaces: a heap copy per string, as SHStrDupW makes.
+static PWSTR _HeapDup(PCWSTR pwz)
+{
+    size_t cch = 0;
+    while (pwz[cch])
+    {
+        cch++;
+    }
+
+    size_t cb = (cch + 1) * sizeof(wchar_t);
+    PWSTR pwzCopy = (PWSTR)CoTaskMemAlloc(cb);
+    if (pwzCopy)
+    {
+        memcpy(pwzCopy, pwz, cb);
+    }
+    return pwzCopy;
+}
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+static void _Bench()
+{
+    const int cRounds = 20000000;
+    const size_t cStrings = ARRAYSIZE(c_rgpwzBench);
+    size_t cchTotal = 0;
+
+    // Keeping a copy of a field value: one heap copy per value...
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    PWSTR pwzKept = nullptr;
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        CoTaskMemFree(pwzKept);
+        pwzKept = _HeapDup(c_rgpwzBench[iRound % cStrings]);
+        cchTotal += pwzKept[0];
+    }
+    CoTaskMemFree(pwzKept);
+    double dHeapKeep = _Seconds(tStart);
+
+    // ...against assigning a SecureString, which also wipes the value it replaces.
+    tStart = std::chrono::steady_clock::now();
+    SecureString strKept;
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        (void)strKept.Assign(c_rgpwzBench[iRound % cStrings]);
+        cchTotal += strKept.Get()[0];
+    }
+    double dSecureKeep = _Seconds(tStart);
+
+    // Building a value for LogonUI, which always ends up in a CoTaskMemAlloc buffer.
+    tStart = std::chrono::steady_clock::now();
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        PWSTR pwz = _HeapDup(c_rgpwzBench[iRound % cStrings]);
+        cchTotal += pwz[0];
+        CoTaskMemFree(pwz);
+    }
+    double dHeapOut = _Seconds(tStart);
+
+    tStart = std::chrono::steady_clock::now();
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        SecureString str;
+        (void)str.Assign(c_rgpwzBench[iRound % cStrings]);
+        PWSTR pwz;
+        (void)str.DetachToCoTaskMem(&pwz);
+        cchTotal += pwz[0];
+        CoTaskMemFree(pwz);
+    }
+    double dSecureOut = _Seconds(tStart);
+
+    printf("keeping a value:  heap copy %6.1f ns, SecureString::Assign %6.1f ns\n",
+           dHeapKeep * 1e9 / cRounds, dSecureKeep * 1e9 / cRounds);
+    printf("handing one out:  heap copy %6.1f ns, SecureString + DetachToCoTaskMem %6.1f ns\n",
+           dHeapOut * 1e9 / cRounds, dSecureOut * 1e9 / cRounds);
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(cchTotal != 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("securestringtest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: securestringtest [--bench]\n");
+        return 2;
+    }
+
+    _CheckAssign();
+    _CheckAssignFromSelf();
+    _CheckMove();
+    _CheckCoTaskMem();
+    _CheckBuffer();
+
+    return TestFinish("securestringtest");
+}
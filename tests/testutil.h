@@ -0,0 +1,64 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The checks the tests share.  A failed check is reported and counted, and
+// the test carries on; TestFinish() gives main() its exit code.
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+static int s_cTestFailures;
+
+inline void TestFail(const char *pszFile, int iLine, const char *pszCheck)
+{
+    fprintf(stderr, "%s(%d): check failed: %s\n", pszFile, iLine, pszCheck);
+    s_cTestFailures++;
+}
+
+#define TEST_CHECK(f)   ((f) ? (void)0 : TestFail(__FILE__, __LINE__, #f))
+
+// Compares cb bytes at pb with the expected ones, and reports the first difference.
+#define TEST_CHECK_BYTES(pb, cb, pbExpected, cbExpected) \
+    TestCheckBytes(__FILE__, __LINE__, #pb, (const unsigned char *)(pb), (cb), \
+                   (const unsigned char *)(pbExpected), (cbExpected))
+
+inline void TestCheckBytes(const char *pszFile, int iLine, const char *pszWhat, const unsigned char *pb, size_t cb,
+                           const unsigned char *pbExpected, size_t cbExpected)
+{
+    if (cb != cbExpected)
+    {
+        fprintf(stderr, "%s(%d): %s is %zu bytes, expected %zu\n", pszFile, iLine, pszWhat, cb, cbExpected);
+        s_cTestFailures++;
+        return;
+    }
+
+    for (size_t i = 0; i < cb; i++)
+    {
+        if (pb[i] != pbExpected[i])
+        {
+            fprintf(stderr, "%s(%d): %s differs at byte %zu: 0x%02x, expected 0x%02x\n", pszFile, iLine, pszWhat,
+                    i, pb[i], pbExpected[i]);
+            s_cTestFailures++;
+            return;
+        }
+    }
+}
+
+inline int TestFinish(const char *pszTest)
+{
+    if (s_cTestFailures)
+    {
+        fprintf(stderr, "%s: %d check(s) failed\n", pszTest, s_cTestFailures);
+        return 1;
+    }
+
+    printf("%s: ok\n", pszTest);
+    return 0;
+}
@@ -0,0 +1,381 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// utf16test checks the kernels of cpp/utf16.cpp against a plain loop, with
+// each kernel the processor has: every alignment and every length around
+// the 16 and 32-byte blocks, surrogates and wanted characters at every
+// position, limits one short and exactly long enough, strings at the very
+// end of a heap block (for AddressSanitizer) and of a page followed by an
+// inaccessible one.  It builds with the compiler's own wchar_t, which the
+// kernels don't use:
+//
+//   g++ -std=c++14 -O1 -g -DTESTS_ANY_WCHAR -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o utf16test tests/utf16test.cpp cpp/utf16.cpp
+//
+// Usage: utf16test [--bench]
+//
+// --bench times the kernels against a length loop and memcpy over user
+// names, domains and passwords of the usual lengths.
+
+#include "utf16.h"
+#include "testutil.h"
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+static const char *const c_rgpszKernel[] = { "scalar", "sse2", "avx2" };     // by UTF16_KERNEL
+
+// What the kernels should find in pch: the plain loop.
+struct EXPECTED
+{
+    size_t  cch;
+    bool    fWellFormed;
+    size_t  ichFirst;
+    size_t  ichLast;
+};
+
+static EXPECTED _Expect(const char16_t *pch, char16_t chFirst, char16_t chLast)
+{
+    EXPECTED expected = { 0, true, UTF16_NOT_FOUND, UTF16_NOT_FOUND };
+    bool fPendingHigh = false;
+
+    for (; pch[expected.cch]; expected.cch++)
+    {
+        char16_t ch = pch[expected.cch];
+        bool fHigh = (ch >= 0xD800 && ch <= 0xDBFF);
+        bool fLow = (ch >= 0xDC00 && ch <= 0xDFFF);
+        if ((fHigh && fPendingHigh) || (fLow != fPendingHigh))
+        {
+            expected.fWellFormed = false;
+        }
+        fPendingHigh = fHigh;
+
+        if (ch == chFirst && expected.ichFirst == UTF16_NOT_FOUND)
+        {
+            expected.ichFirst = expected.cch;
+        }
+        if (ch == chLast)
+        {
+            expected.ichLast = expected.cch;
+        }
+    }
+    expected.fWellFormed = expected.fWellFormed && !fPendingHigh;
+    return expected;
+}
+
+// A limit well past every string the tests make.
+static const size_t c_cchFar = 128;
+
+//
+// Runs every kernel entry point on the string at pch, which the caller has terminated, and
+// compares with the plain loop.  The limits tried are the length itself, which must do, one
+// less, which must not, and one far beyond.
+//
+static void _CheckString(const char16_t *pch)
+{
+    const char16_t chFirst = u'\\';
+    const char16_t chLast = u'@';
+    EXPECTED expected = _Expect(pch, chFirst, chLast);
+
+    size_t cch = 12345;
+    bool fWellFormed = !expected.fWellFormed;
+    TEST_CHECK(SUCCEEDED(Utf16Scan(pch, expected.cch, &cch, &fWellFormed)));
+    TEST_CHECK(cch == expected.cch);
+    TEST_CHECK(fWellFormed == expected.fWellFormed);
+
+    size_t ichFirst, ichLast;
+    TEST_CHECK(SUCCEEDED(Utf16ScanForChars(pch, expected.cch, chFirst, chLast, &cch, &ichFirst, &ichLast)));
+    TEST_CHECK(cch == expected.cch);
+    TEST_CHECK(ichFirst == expected.ichFirst);
+    TEST_CHECK(ichLast == expected.ichLast);
+
+    std::vector<char16_t> vchDest(expected.cch + 1, u'~');
+    TEST_CHECK(SUCCEEDED(Utf16Copy(vchDest.data(), vchDest.size(), pch, &cch, &fWellFormed)));
+    TEST_CHECK(cch == expected.cch);
+    TEST_CHECK(fWellFormed == expected.fWellFormed);
+    TEST_CHECK_BYTES(vchDest.data(), vchDest.size() * sizeof(char16_t), pch, (expected.cch + 1) * sizeof(char16_t));
+
+    // As the helpers call them, with a limit far beyond the string: the vector loads then
+    // read the aligned blocks the terminator is in, to their end.
+    TEST_CHECK(SUCCEEDED(Utf16Scan(pch, c_cchFar, &cch, &fWellFormed)));
+    TEST_CHECK(cch == expected.cch);
+    TEST_CHECK(fWellFormed == expected.fWellFormed);
+    TEST_CHECK(SUCCEEDED(Utf16ScanForChars(pch, c_cchFar, chFirst, chLast, &cch, &ichFirst, &ichLast)));
+    TEST_CHECK(cch == expected.cch && ichFirst == expected.ichFirst && ichLast == expected.ichLast);
+
+    std::vector<char16_t> vchFar(c_cchFar, u'~');
+    TEST_CHECK(SUCCEEDED(Utf16Copy(vchFar.data(), vchFar.size(), pch, &cch, nullptr)));
+    TEST_CHECK(cch == expected.cch);
+    TEST_CHECK_BYTES(vchFar.data(), (expected.cch + 1) * sizeof(char16_t), pch, (expected.cch + 1) * sizeof(char16_t));
+    TEST_CHECK(vchFar[expected.cch + 1] == u'~');
+
+    if (expected.cch > 0)
+    {
+        TEST_CHECK(Utf16Scan(pch, expected.cch - 1, &cch, nullptr) == HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW));
+        TEST_CHECK(cch == 0);
+        TEST_CHECK(Utf16ScanForChars(pch, expected.cch - 1, chFirst, chLast, &cch, &ichFirst, &ichLast) ==
+                   HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW));
+
+        // Exactly the length of the copy, so AddressSanitizer sees a write past it.
+        std::vector<char16_t> vchShort(expected.cch, u'~');
+        TEST_CHECK(Utf16Copy(vchShort.data(), vchShort.size(), pch, &cch, nullptr) ==
+                   HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+        TEST_CHECK(cch == 0);
+        TEST_CHECK(vchShort[0] == 0);
+    }
+}
+
+// A string of cch characters, with ch put at ich if ich is less than cch.
+static std::vector<char16_t> _MakeString(size_t cch, size_t ich, char16_t ch)
+{
+    std::vector<char16_t> vch;
+    for (size_t i = 0; i < cch; i++)
+    {
+        vch.push_back((i == ich) ? ch : (char16_t)(u'a' + i % 26));
+    }
+    vch.push_back(0);
+    return vch;
+}
+
+//
+// Copies vch into a heap block that ends with its terminator, ichAlign characters into the
+// block, which is 32-byte aligned: the string is at every alignment a vector load cares about.
+// The kernels read whole aligned blocks past the terminator, beyond the end of the heap block,
+// which must be neither reported nor acted upon.
+//
+static void _CheckAtAlignment(const std::vector<char16_t> &vch, size_t ichAlign)
+{
+    void *pvBlock;
+    TEST_CHECK(posix_memalign(&pvBlock, 32, (ichAlign + vch.size()) * sizeof(char16_t)) == 0);
+    char16_t *pch = (char16_t *)pvBlock + ichAlign;
+    memcpy(pch, vch.data(), vch.size() * sizeof(char16_t));
+    _CheckString(pch);
+    free(pvBlock);
+}
+
+static void _CheckAlignmentsAndLengths()
+{
+    // The alphabet is ordinary; each length is also tried with each special at every position.
+    const char16_t rgchSpecial[] = { 0xD800, 0xDBFF, 0xDC00, 0xDFFF, u'\\', u'@', 0xFFFF, 0x7FFF };
+
+    for (size_t ichAlign = 0; ichAlign < 16; ichAlign++)
+    {
+        for (size_t cch = 0; cch <= 40; cch++)
+        {
+            _CheckAtAlignment(_MakeString(cch, cch, 0), ichAlign);
+            for (char16_t ch : rgchSpecial)
+            {
+                for (size_t ich = 0; ich < cch; ich++)
+                {
+                    _CheckAtAlignment(_MakeString(cch, ich, ch), ichAlign);
+                }
+            }
+        }
+    }
+}
+
+static void _CheckSurrogates()
+{
+    const struct
+    {
+        const char16_t *pch;
+        bool            fWellFormed;
+    }
+    rgCases[] =
+    {
+        { u"",                                      true  },
+        { u"pa\U0001F511ss",                        true  },        // a pair
+        { u"\U0001F511\U0001F511",                  true  },
+        { u"pass\xD83D",                            false },        // a high one at the end
+        { u"\xDD11pass",                            false },        // a low one at the start
+        { u"pa\xD83D\xD83Dss",                      false },        // two high ones
+        { u"pa\xDD11\xD83Dss",                      false },        // the wrong way round
+        { u"0123456\xD83D\xDD11" u"789abcdefg",     true  },        // a pair across an 8-character block
+        { u"0123456789abcde\xD83D\xDD11" u"fg",     true  },        // and across a 16-character one
+        { u"0123456789abcde\xD83D" u"fghijk",       false },
+    };
+
+    for (const auto &rcase : rgCases)
+    {
+        std::vector<char16_t> vch(rcase.pch, rcase.pch + _Expect(rcase.pch, 0, 0).cch + 1);
+        TEST_CHECK(_Expect(vch.data(), 0, 0).fWellFormed == rcase.fWellFormed);
+        for (size_t ichAlign = 0; ichAlign < 16; ichAlign++)
+        {
+            _CheckAtAlignment(vch, ichAlign);
+        }
+    }
+}
+
+//
+// Strings that end exactly at the end of a page, which is followed by one that can't be read:
+// a kernel that read past the terminator across the page boundary would fault.
+//
+static void _CheckPageEnd()
+{
+    size_t cbPage = (size_t)sysconf(_SC_PAGESIZE);
+    BYTE *pbPages = (BYTE *)mmap(nullptr, 2 * cbPage, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    TEST_CHECK(pbPages != MAP_FAILED);
+    if (pbPages == MAP_FAILED)
+    {
+        return;
+    }
+    TEST_CHECK(mprotect(pbPages + cbPage, cbPage, PROT_NONE) == 0);
+
+    char16_t *pchPageEnd = (char16_t *)(pbPages + cbPage);
+    for (size_t cch = 0; cch <= 40; cch++)
+    {
+        std::vector<char16_t> vch = _MakeString(cch, cch, 0);
+        char16_t *pch = pchPageEnd - vch.size();
+        memcpy(pch, vch.data(), vch.size() * sizeof(char16_t));
+        _CheckString(pch);
+    }
+
+    munmap(pbPages, 2 * cbPage);
+}
+
+// The names and secrets a logon carries, at their usual lengths.
+static const char16_t *const c_rgpchBench[] =
+{
+    u"CONTOSO",
+    u"corp.contoso.com",
+    u"jdoe",
+    u"administrator",
+    u"firstname.lastname",
+    u"jdoe@corp.contoso.com",
+    u"Winter2024!",
+    u"correct horse battery staple",
+    u"Pa55w0rd",
+    u"x7#Lq9!vRt2$Wm4&Zp",
+};
+
+// What the kernels replace: a length loop, and a separate copy.
+static size_t _PlainLength(const char16_t *pch)
+{
+    size_t cch = 0;
+    while (pch[cch])
+    {
+        cch++;
+    }
+    return cch;
+}
+
+// Times the plain loop and each kernel over the strings in vpch, cRounds strings each.
+static void _BenchStrings(const char *pszWhat, const std::vector<char16_t *> &vpch, int cRounds)
+{
+    char16_t rgchDest[512];
+    size_t cchTotal = 0;
+
+    printf("%s:\n", pszWhat);
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int iRound = 0; iRound < cRounds; iRound++)
+    {
+        const char16_t *pch = vpch[iRound % vpch.size()];
+        size_t cch = _PlainLength(pch);
+        memcpy(rgchDest, pch, (cch + 1) * sizeof(char16_t));
+        cchTotal += cch + rgchDest[0];
+    }
+    double dPlain = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+    printf("  %-8s length + memcpy: %6.1f ns/string\n", "plain", dPlain * 1e9 / cRounds);
+
+    for (int uk = UK_SCALAR; uk <= UK_AVX2; uk++)
+    {
+        if (Utf16SelectKernel((UTF16_KERNEL)uk) != uk)
+        {
+            continue;
+        }
+
+        tStart = std::chrono::steady_clock::now();
+        for (int iRound = 0; iRound < cRounds; iRound++)
+        {
+            size_t cch;
+            bool fWellFormed;
+            (void)Utf16Scan(vpch[iRound % vpch.size()], ARRAYSIZE(rgchDest), &cch, &fWellFormed);
+            cchTotal += cch + fWellFormed;
+        }
+        double dScan = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+        tStart = std::chrono::steady_clock::now();
+        for (int iRound = 0; iRound < cRounds; iRound++)
+        {
+            size_t cch;
+            bool fWellFormed;
+            (void)Utf16Copy(rgchDest, ARRAYSIZE(rgchDest), vpch[iRound % vpch.size()], &cch, &fWellFormed);
+            cchTotal += cch + fWellFormed + rgchDest[0];
+        }
+        double dCopy = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+        printf("  %-8s scan: %6.1f ns/string, copy: %6.1f ns/string\n", c_rgpszKernel[uk],
+               dScan * 1e9 / cRounds, dCopy * 1e9 / cRounds);
+    }
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(cchTotal != 0);
+}
+
+// A 32-byte aligned copy of pch, as the heap would give it.
+static char16_t *_AlignedCopy(const char16_t *pch)
+{
+    size_t cb = (_PlainLength(pch) + 1) * sizeof(char16_t);
+    void *pvCopy;
+    TEST_CHECK(posix_memalign(&pvCopy, 32, cb) == 0);
+    memcpy(pvCopy, pch, cb);
+    return (char16_t *)pvCopy;
+}
+
+static void _Bench()
+{
+    std::vector<char16_t *> vpchLogon;
+    for (const char16_t *pch : c_rgpchBench)
+    {
+        vpchLogon.push_back(_AlignedCopy(pch));
+    }
+    _BenchStrings("user names, domains and passwords", vpchLogon, 20000000);
+
+    std::vector<char16_t> vchLong = _MakeString(200, 200, 0);
+    std::vector<char16_t *> vpchLong(1, _AlignedCopy(vchLong.data()));
+    _BenchStrings("200 characters", vpchLong, 5000000);
+
+    for (char16_t *pch : vpchLogon)
+    {
+        free(pch);
+    }
+    free(vpchLong[0]);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("utf16test --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: utf16test [--bench]\n");
+        return 2;
+    }
+
+    for (int uk = UK_SCALAR; uk <= UK_AVX2; uk++)
+    {
+        if (Utf16SelectKernel((UTF16_KERNEL)uk) != uk)
+        {
+            printf("utf16test: no %s on this processor\n", c_rgpszKernel[uk]);
+            continue;
+        }
+
+        _CheckAlignmentsAndLengths();
+        _CheckSurrogates();
+        _CheckPageEnd();
+    }
+
+    return TestFinish("utf16test");
+}
@@ -0,0 +1,83 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The bcrypt.h calls the code under test makes; see windows.h.  There is
+// no cryptography here: every call fails, as on a system without the
+// algorithm, so the code under test takes its fallback.
+
+#pragma once
+
+#include <windows.h>
+
+typedef LONG            NTSTATUS;
+typedef BYTE            *PUCHAR;
+typedef PVOID           BCRYPT_ALG_HANDLE;
+typedef PVOID           BCRYPT_HASH_HANDLE;
+
+#define BCRYPT_SUCCESS(status)              (((NTSTATUS)(status)) >= 0)
+#define STATUS_NOT_SUPPORTED                ((NTSTATUS)0xC00000BBL)
+
+#define BCRYPT_SHA256_ALGORITHM             L"SHA256"
+#define BCRYPT_ALG_HANDLE_HMAC_FLAG         0x00000008
+#define BCRYPT_USE_SYSTEM_PREFERRED_RNG     0x00000002
+
+inline NTSTATUS BCryptGenRandom(BCRYPT_ALG_HANDLE hAlgorithm, PUCHAR pbBuffer, ULONG cbBuffer, ULONG dwFlags)
+{
+    (void)hAlgorithm;
+    (void)pbBuffer;
+    (void)cbBuffer;
+    (void)dwFlags;
+    return STATUS_NOT_SUPPORTED;
+}
+
+inline NTSTATUS BCryptOpenAlgorithmProvider(BCRYPT_ALG_HANDLE *phAlgorithm, PCWSTR pwzAlgId, PCWSTR pwzImplementation,
+                                            ULONG dwFlags)
+{
+    (void)pwzAlgId;
+    (void)pwzImplementation;
+    (void)dwFlags;
+    *phAlgorithm = NULL;
+    return STATUS_NOT_SUPPORTED;
+}
+
+inline NTSTATUS BCryptCreateHash(BCRYPT_ALG_HANDLE hAlgorithm, BCRYPT_HASH_HANDLE *phHash, PUCHAR pbHashObject,
+                                 ULONG cbHashObject, PUCHAR pbSecret, ULONG cbSecret, ULONG dwFlags)
+{
+    (void)hAlgorithm;
+    (void)pbHashObject;
+    (void)cbHashObject;
+    (void)pbSecret;
+    (void)cbSecret;
+    (void)dwFlags;
+    *phHash = NULL;
+    return STATUS_NOT_SUPPORTED;
+}
+
+inline NTSTATUS BCryptHashData(BCRYPT_HASH_HANDLE hHash, PUCHAR pbInput, ULONG cbInput, ULONG dwFlags)
+{
+    (void)hHash;
+    (void)pbInput;
+    (void)cbInput;
+    (void)dwFlags;
+    return STATUS_NOT_SUPPORTED;
+}
+
+inline NTSTATUS BCryptFinishHash(BCRYPT_HASH_HANDLE hHash, PUCHAR pbOutput, ULONG cbOutput, ULONG dwFlags)
+{
+    (void)hHash;
+    (void)pbOutput;
+    (void)cbOutput;
+    (void)dwFlags;
+    return STATUS_NOT_SUPPORTED;
+}
+
+inline NTSTATUS BCryptDestroyHash(BCRYPT_HASH_HANDLE hHash)
+{
+    (void)hHash;
+    return 0;
+}
@@ -0,0 +1,85 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The credentialprovider.h interfaces the code under test uses; see
+// windows.h.  Only the usage scenarios, the field types and states, and
+// the field descriptor calls the field descriptor cache makes are here;
+// IUnknown is in unknwn.h.
+
+#pragma once
+
+#include <windows.h>
+#include <unknwn.h>
+
+typedef enum _CREDENTIAL_PROVIDER_USAGE_SCENARIO
+{
+    CPUS_INVALID = 0,
+    CPUS_LOGON,
+    CPUS_UNLOCK_WORKSTATION,
+    CPUS_CHANGE_PASSWORD,
+    CPUS_CREDUI,
+    CPUS_PLAP,
+} CREDENTIAL_PROVIDER_USAGE_SCENARIO;
+
+typedef enum _CREDENTIAL_PROVIDER_FIELD_TYPE
+{
+    CPFT_INVALID = 0,
+    CPFT_LARGE_TEXT,
+    CPFT_SMALL_TEXT,
+    CPFT_COMMAND_LINK,
+    CPFT_EDIT_TEXT,
+    CPFT_PASSWORD_TEXT,
+    CPFT_TILE_IMAGE,
+    CPFT_CHECKBOX,
+    CPFT_COMBOBOX,
+    CPFT_SUBMIT_BUTTON,
+} CREDENTIAL_PROVIDER_FIELD_TYPE;
+
+typedef enum _CREDENTIAL_PROVIDER_FIELD_STATE
+{
+    CPFS_HIDDEN = 0,
+    CPFS_DISPLAY_IN_SELECTED_TILE,
+    CPFS_DISPLAY_IN_DESELECTED_TILE,
+    CPFS_DISPLAY_IN_BOTH,
+} CREDENTIAL_PROVIDER_FIELD_STATE;
+
+typedef enum _CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE
+{
+    CPFIS_NONE = 0,
+    CPFIS_READONLY,
+    CPFIS_DISABLED,
+    CPFIS_FOCUSED,
+} CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE;
+
+typedef struct _CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR
+{
+    DWORD                           dwFieldID;
+    CREDENTIAL_PROVIDER_FIELD_TYPE  cpft;
+    PWSTR                           pszLabel;
+    GUID                            guidFieldType;
+} CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR;
+
+struct ICredentialProviderCredential : public IUnknown
+{
+protected:
+    ~ICredentialProviderCredential()
+    {
+    }
+};
+
+struct ICredentialProvider : public IUnknown
+{
+    virtual HRESULT SetUsageScenario(CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus, DWORD dwFlags) = 0;
+    virtual HRESULT GetFieldDescriptorCount(DWORD *pdwCount) = 0;
+    virtual HRESULT GetFieldDescriptorAt(DWORD dwIndex, CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd) = 0;
+
+protected:
+    ~ICredentialProvider()
+    {
+    }
+};
@@ -0,0 +1,25 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The intrin.h intrinsics the code under test uses; see windows.h.  Where
+// there is no TSC, __rdtsc is the performance counter.
+
+#pragma once
+
+#include <windows.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+inline ULONGLONG __rdtsc()
+{
+    LARGE_INTEGER liCount;
+    QueryPerformanceCounter(&liCount);
+    return (ULONGLONG)liCount.QuadPart;
+}
+#endif
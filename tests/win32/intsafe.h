@@ -0,0 +1,46 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The intsafe.h functions the headers under test use; see windows.h.
+
+#pragma once
+
+#include <windows.h>
+
+inline HRESULT DWordAdd(DWORD dwAugend, DWORD dwAddend, DWORD *pdwResult)
+{
+    if (dwAugend + dwAddend < dwAugend)
+    {
+        *pdwResult = 0xFFFFFFFF;
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+    }
+    *pdwResult = dwAugend + dwAddend;
+    return S_OK;
+}
+
+inline HRESULT SizeTAdd(SIZE_T cbAugend, SIZE_T cbAddend, SIZE_T *pcbResult)
+{
+    if (cbAugend + cbAddend < cbAugend)
+    {
+        *pcbResult = (SIZE_T)-1;
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+    }
+    *pcbResult = cbAugend + cbAddend;
+    return S_OK;
+}
+
+inline HRESULT SizeTMult(SIZE_T cbMultiplicand, SIZE_T cbMultiplier, SIZE_T *pcbResult)
+{
+    if (cbMultiplier && cbMultiplicand > (SIZE_T)-1 / cbMultiplier)
+    {
+        *pcbResult = (SIZE_T)-1;
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+    }
+    *pcbResult = cbMultiplicand * cbMultiplier;
+    return S_OK;
+}
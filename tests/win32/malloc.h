@@ -0,0 +1,24 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The CRT's aligned heap, on the C heap; see windows.h.
+
+#pragma once
+
+#include <stdlib.h>
+
+inline void *_aligned_malloc(size_t cb, size_t cbAlignment)
+{
+    void *pv;
+    return (posix_memalign(&pv, cbAlignment, cb) == 0) ? pv : NULL;
+}
+
+inline void _aligned_free(void *pv)
+{
+    free(pv);
+}
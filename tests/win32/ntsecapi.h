@@ -0,0 +1,83 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The logon structures from the SDK's ntsecapi.h, declared the same way,
+// so their native layout on a Linux target of either bitness is the one
+// Windows has; see windows.h.
+
+#pragma once
+
+#include <windows.h>
+
+typedef struct _UNICODE_STRING
+{
+    USHORT  Length;
+    USHORT  MaximumLength;
+    PWSTR   Buffer;
+} UNICODE_STRING;
+
+typedef enum _KERB_LOGON_SUBMIT_TYPE
+{
+    KerbInteractiveLogon = 2,
+    KerbSmartCardLogon = 6,
+    KerbWorkstationUnlockLogon = 7,
+    KerbSmartCardUnlockLogon = 8,
+    KerbProxyLogon = 9,
+    KerbTicketLogon = 10,
+    KerbTicketUnlockLogon = 11,
+    KerbS4ULogon = 12,
+    KerbCertificateLogon = 13,
+    KerbCertificateS4ULogon = 14,
+    KerbCertificateUnlockLogon = 15,
+} KERB_LOGON_SUBMIT_TYPE;
+
+typedef struct _KERB_INTERACTIVE_LOGON
+{
+    KERB_LOGON_SUBMIT_TYPE  MessageType;
+    UNICODE_STRING          LogonDomainName;
+    UNICODE_STRING          UserName;
+    UNICODE_STRING          Password;
+} KERB_INTERACTIVE_LOGON;
+
+typedef struct _KERB_INTERACTIVE_UNLOCK_LOGON
+{
+    KERB_INTERACTIVE_LOGON  Logon;
+    LUID                    LogonId;
+} KERB_INTERACTIVE_UNLOCK_LOGON;
+
+typedef struct _KERB_CERTIFICATE_LOGON
+{
+    KERB_LOGON_SUBMIT_TYPE  MessageType;
+    UNICODE_STRING          DomainName;
+    UNICODE_STRING          UserName;
+    UNICODE_STRING          Pin;
+    ULONG                   Flags;
+    ULONG                   CspDataLength;
+    BYTE                    *CspData;
+} KERB_CERTIFICATE_LOGON;
+
+typedef enum _MSV1_0_LOGON_SUBMIT_TYPE
+{
+    MsV1_0InteractiveLogon = 2,
+    MsV1_0Lm20Logon,
+    MsV1_0NetworkLogon,
+    MsV1_0SubAuthLogon,
+    MsV1_0WorkstationUnlockLogon = 7,
+    MsV1_0S4ULogon = 12,
+    MsV1_0VirtualLogon = 82,
+    MsV1_0NoElevationLogon = 83,
+    MsV1_0LuidLogon = 84,
+} MSV1_0_LOGON_SUBMIT_TYPE;
+
+typedef struct _MSV1_0_INTERACTIVE_LOGON
+{
+    MSV1_0_LOGON_SUBMIT_TYPE    MessageType;
+    UNICODE_STRING              LogonDomainName;
+    UNICODE_STRING              UserName;
+    UNICODE_STRING              Password;
+} MSV1_0_INTERACTIVE_LOGON;
@@ -0,0 +1,83 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The strsafe.h limits and functions the code under test uses; see windows.h.
+
+#pragma once
+
+#include <windows.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#define STRSAFE_MAX_CCH                 2147483647
+#define STRSAFE_E_INSUFFICIENT_BUFFER   ((HRESULT)0x8007007AL)
+
+//
+// The narrow printf and copy functions, which always terminate, and report a string that didn't
+// fit.  vsnprintf's %S takes a 32 bit wchar_t, so -fshort-wchar strings can't be passed for it.
+//
+inline HRESULT StringCchVPrintfA(char *psz, size_t cch, const char *fmt, va_list args)
+{
+    if (cch == 0 || cch > STRSAFE_MAX_CCH)
+    {
+        return E_INVALIDARG;
+    }
+
+    int cchWritten = vsnprintf(psz, cch, fmt, args);
+    if (cchWritten < 0)
+    {
+        psz[0] = 0;
+        return E_INVALIDARG;
+    }
+    return ((size_t)cchWritten < cch) ? S_OK : STRSAFE_E_INSUFFICIENT_BUFFER;
+}
+
+inline HRESULT StringCchPrintfA(char *psz, size_t cch, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    HRESULT hr = StringCchVPrintfA(psz, cch, fmt, args);
+    va_end(args);
+    return hr;
+}
+
+inline HRESULT StringCchPrintfExA(char *psz, size_t cch, char **ppszDestEnd, size_t *pcchRemaining, DWORD dwFlags,
+                                  const char *fmt, ...)
+{
+    (void)dwFlags;
+    va_list args;
+    va_start(args, fmt);
+    HRESULT hr = StringCchVPrintfA(psz, cch, fmt, args);
+    va_end(args);
+
+    size_t cchLength = (hr == E_INVALIDARG) ? 0 : strlen(psz);
+    *ppszDestEnd = psz + cchLength;
+    *pcchRemaining = cch - cchLength;
+    return hr;
+}
+
+inline HRESULT StringCchCopyA(char *psz, size_t cch, const char *pszSrc)
+{
+    return StringCchPrintfA(psz, cch, "%s", pszSrc);
+}
+
+inline HRESULT StringCchCopyW(WCHAR *pwz, size_t cch, PCWSTR pwzSrc)
+{
+    if (cch == 0 || cch > STRSAFE_MAX_CCH)
+    {
+        return E_INVALIDARG;
+    }
+
+    size_t i = 0;
+    for (; pwzSrc[i] && i < cch - 1; i++)
+    {
+        pwz[i] = pwzSrc[i];
+    }
+    pwz[i] = 0;
+    return pwzSrc[i] ? STRSAFE_E_INSUFFICIENT_BUFFER : S_OK;
+}
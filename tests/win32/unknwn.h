@@ -0,0 +1,63 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// IUnknown and the IIDs that name interfaces; see windows.h.  __uuidof is
+// MSVC's, so an interface is given its IID here with TESTS_DECLARE_UUID,
+// where the SDK's headers give it with MIDL_INTERFACE.
+
+#pragma once
+
+#include <windows.h>
+
+typedef GUID IID;
+typedef const IID &REFIID;
+
+template <typename TInterface>
+struct _UuidOf;
+
+#define __uuidof(TInterface) (_UuidOf<TInterface>::Get())
+
+#define TESTS_DECLARE_UUID(TInterface, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8)   \
+    template <>                                                                     \
+    struct _UuidOf<TInterface>                                                      \
+    {                                                                               \
+        static REFIID Get()                                                         \
+        {                                                                           \
+            static const IID s_iid = { l, w1, w2, { b1, b2, b3, b4, b5, b6, b7, b8 } }; \
+            return s_iid;                                                           \
+        }                                                                           \
+    };
+
+inline bool IsEqualIID(REFIID riid1, REFIID riid2)
+{
+    return memcmp(&riid1, &riid2, sizeof(IID)) == 0;
+}
+
+//
+// Unlike the real one, QueryInterface has a body, answering nothing, so the mocks that are only
+// reference counted needn't write one.
+//
+struct IUnknown
+{
+    virtual HRESULT QueryInterface(REFIID riid, void **ppv)
+    {
+        UNREFERENCED_PARAMETER(riid);
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+
+    virtual ULONG AddRef() = 0;
+    virtual ULONG Release() = 0;
+
+protected:
+    ~IUnknown()
+    {
+    }
+};
+
+TESTS_DECLARE_UUID(IUnknown, 0x00000000, 0x0000, 0x0000, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46)
@@ -0,0 +1,667 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The few Windows SDK definitions that the headers under test use, so the
+// tests build with any C++14 compiler.  Only what the tests need is here;
+// a header that needs more does not belong in a test.
+//
+// WCHAR has to be 16 bits, as on Windows: build with -fshort-wchar.  A test
+// of code that has no use for WCHAR can define TESTS_ANY_WCHAR instead, and
+// build with the compiler's own wchar_t.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <fcntl.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef TESTS_ANY_WCHAR
+static_assert(sizeof(wchar_t) == 2, "build the tests with -fshort-wchar");
+#endif
+
+#if defined(__LP64__) && !defined(_WIN64)
+#define _WIN64
+#endif
+
+typedef uint8_t         BYTE;
+typedef uint16_t        WORD;
+typedef uint16_t        USHORT;
+typedef uint32_t        ULONG;
+typedef uint32_t        DWORD;
+typedef int32_t         LONG;
+typedef int64_t         LONGLONG;
+typedef uint64_t        ULONGLONG;
+typedef uint64_t        ULONG64;
+typedef int64_t         LONG64;
+typedef uintptr_t       ULONG_PTR;
+typedef intptr_t        INT_PTR;
+typedef size_t          SIZE_T;
+typedef int             BOOL;
+typedef LONG            HRESULT;
+typedef wchar_t         WCHAR;
+typedef WCHAR           *PWSTR;
+typedef const WCHAR     *PCWSTR;
+typedef const WCHAR     *PCWCH;
+typedef const char      *PCSTR;
+typedef void            VOID;
+typedef void            *PVOID;
+typedef void            *LPVOID;
+typedef void            *HANDLE;
+typedef void            *HINSTANCE;
+
+#define CALLBACK
+#define TRUE                            1
+#define FALSE                           0
+
+typedef struct _LUID
+{
+    DWORD   LowPart;
+    LONG    HighPart;
+} LUID;
+
+typedef struct _GUID
+{
+    DWORD   Data1;
+    WORD    Data2;
+    WORD    Data3;
+    BYTE    Data4[8];
+} GUID;
+
+#define S_OK                            ((HRESULT)0)
+#define S_FALSE                         ((HRESULT)1)
+#define E_NOINTERFACE                   ((HRESULT)0x80004002L)
+#define E_POINTER                       ((HRESULT)0x80004003L)
+#define E_FAIL                          ((HRESULT)0x80004005L)
+#define E_UNEXPECTED                    ((HRESULT)0x8000FFFFL)
+#define E_INVALIDARG                    ((HRESULT)0x80070057L)
+#define E_OUTOFMEMORY                   ((HRESULT)0x8007000EL)
+
+#define ERROR_SUCCESS                   0L
+#define ERROR_FILE_NOT_FOUND            2L
+#define ERROR_INSUFFICIENT_BUFFER       122L
+#define ERROR_INVALID_DATA              13L
+#define ERROR_ARITHMETIC_OVERFLOW       534L
+#define ERROR_ALREADY_INITIALIZED       1247L
+
+#define SUCCEEDED(hr)                   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)                      (((HRESULT)(hr)) < 0)
+#define HRESULT_FROM_WIN32(x)           ((HRESULT)(x) <= 0 ? ((HRESULT)(x)) : ((HRESULT)(((x) & 0x0000FFFF) | (7 << 16) | 0x80000000)))
+
+#define ARRAYSIZE(a)                    (sizeof(a) / sizeof((a)[0]))
+#define TYPE_ALIGNMENT(t)               alignof(t)
+#define UNREFERENCED_PARAMETER(p)       ((void)(p))
+#define CopyMemory(d, s, cb)            memcpy((d), (s), (cb))
+#define MoveMemory(d, s, cb)            memmove((d), (s), (cb))
+#define ZeroMemory(d, cb)               memset((d), 0, (cb))
+
+#define UNICODE_STRING_MAX_CHARS        (32767)
+#define MAX_PATH                        260
+
+#ifdef _WIN64
+#define MEMORY_ALLOCATION_ALIGNMENT     16
+#else
+#define MEMORY_ALLOCATION_ALIGNMENT     8
+#endif
+
+// windef.h's min and max are macros, which would break <algorithm>; functions do for the code
+// under test.
+template <class T>
+inline T min(T a, T b)
+{
+    return (a < b) ? a : b;
+}
+
+template <class T>
+inline T max(T a, T b)
+{
+    return (a < b) ? b : a;
+}
+
+// Like the real one, a memset the compiler may not drop.
+inline void *SecureZeroMemory(void *pv, size_t cb)
+{
+    explicit_bzero(pv, cb);
+    return pv;
+}
+
+inline LONG InterlockedIncrement(volatile LONG *pl)
+{
+    return __atomic_add_fetch(pl, 1, __ATOMIC_SEQ_CST);
+}
+
+inline LONGLONG InterlockedExchangeAdd64(volatile LONGLONG *pll, LONGLONG ll)
+{
+    return __atomic_fetch_add(pll, ll, __ATOMIC_SEQ_CST);
+}
+
+inline LONG64 InterlockedIncrement64(volatile LONG64 *pll)
+{
+    return __atomic_add_fetch(pll, 1, __ATOMIC_SEQ_CST);
+}
+
+inline LONG64 InterlockedExchange64(volatile LONG64 *pll, LONG64 ll)
+{
+    return __atomic_exchange_n(pll, ll, __ATOMIC_SEQ_CST);
+}
+
+inline LONG InterlockedCompareExchange(volatile LONG *pl, LONG lExchange, LONG lComparand)
+{
+    __atomic_compare_exchange_n(pl, &lComparand, lExchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return lComparand;
+}
+
+inline void Sleep(DWORD dwMilliseconds)
+{
+    usleep(dwMilliseconds * 1000);
+}
+
+// The performance counter is CLOCK_MONOTONIC, in nanoseconds.
+typedef union _LARGE_INTEGER
+{
+    LONGLONG    QuadPart;
+} LARGE_INTEGER;
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER *pliFrequency)
+{
+    pliFrequency->QuadPart = 1000000000;
+    return 1;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER *pliCount)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    pliCount->QuadPart = (LONGLONG)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return 1;
+}
+
+typedef union _ULARGE_INTEGER
+{
+    struct
+    {
+        DWORD   LowPart;
+        DWORD   HighPart;
+    };
+    ULONGLONG   QuadPart;
+} ULARGE_INTEGER;
+
+typedef struct _FILETIME
+{
+    DWORD   dwLowDateTime;
+    DWORD   dwHighDateTime;
+} FILETIME;
+
+// CLOCK_REALTIME, in 100ns units since 1601.
+inline void GetSystemTimeAsFileTime(FILETIME *pft)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ULONGLONG ull = 116444736000000000ULL + (ULONGLONG)ts.tv_sec * 10000000 + ts.tv_nsec / 100;
+    pft->dwLowDateTime = (DWORD)ull;
+    pft->dwHighDateTime = (DWORD)(ull >> 32);
+}
+
+inline DWORD GetCurrentProcessId()
+{
+    return (DWORD)getpid();
+}
+
+inline DWORD GetCurrentThreadId()
+{
+    return (DWORD)gettid();
+}
+
+// The configuration.  There is no registry: a test of code that reads it defines RegGetValueW.
+typedef struct HKEY__ *HKEY;
+
+#define HKEY_LOCAL_MACHINE              ((HKEY)(ULONG_PTR)0x80000002)
+#define RRF_RT_REG_SZ                   0x00000002
+#define RRF_RT_REG_DWORD                0x00000018
+
+LONG RegGetValueW(HKEY hkey, PCWSTR pwzSubKey, PCWSTR pwzValue, DWORD dwFlags, DWORD *pdwType, PVOID pvData,
+                  DWORD *pcbData);
+
+//
+// Files, opened only to append, as the log opens its file.  A handle is the descriptor; the
+// path is narrowed by dropping the high byte of each character, so keep it ASCII.
+//
+#define INVALID_HANDLE_VALUE            ((HANDLE)(intptr_t)-1)
+#define FILE_APPEND_DATA                0x00000004
+#define FILE_SHARE_READ                 0x00000001
+#define FILE_SHARE_WRITE                0x00000002
+#define OPEN_ALWAYS                     4
+#define FILE_ATTRIBUTE_NORMAL           0x00000080
+
+inline HANDLE CreateFileW(PCWSTR pwzFileName, DWORD dwDesiredAccess, DWORD dwShareMode, PVOID psa,
+                          DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile)
+{
+    (void)dwShareMode;
+    (void)psa;
+    (void)dwFlagsAndAttributes;
+    (void)hTemplateFile;
+    if (dwDesiredAccess != FILE_APPEND_DATA || dwCreationDisposition != OPEN_ALWAYS)
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    char szPath[MAX_PATH];
+    size_t i = 0;
+    for (; pwzFileName[i] && i < MAX_PATH - 1; i++)
+    {
+        szPath[i] = (char)pwzFileName[i];
+    }
+    szPath[i] = 0;
+
+    int fd = open(szPath, O_WRONLY | O_CREAT | O_APPEND, 0600);
+    return (fd < 0) ? INVALID_HANDLE_VALUE : (HANDLE)(intptr_t)fd;
+}
+
+inline BOOL WriteFile(HANDLE hFile, const void *pvBuffer, DWORD cbToWrite, DWORD *pcbWritten, PVOID pOverlapped)
+{
+    (void)pOverlapped;
+    ssize_t cb = write((int)(intptr_t)hFile, pvBuffer, cbToWrite);
+    *pcbWritten = (cb < 0) ? 0 : (DWORD)cb;
+    return cb == (ssize_t)cbToWrite;
+}
+
+inline BOOL CloseHandle(HANDLE h)
+{
+    return close((int)(intptr_t)h) == 0;
+}
+
+//
+// One-time initialization, with the semantics the code under test relies on: callers wait while
+// the callback runs, a callback that succeeds is never run again, and one that fails leaves the
+// INIT_ONCE to the next caller.
+//
+typedef struct _INIT_ONCE
+{
+    volatile LONG   lState;
+} INIT_ONCE, *PINIT_ONCE;
+
+#define INIT_ONCE_STATIC_INIT           { 0 }
+
+typedef BOOL (CALLBACK *PINIT_ONCE_FN)(PINIT_ONCE pInitOnce, PVOID pvParameter, PVOID *ppvContext);
+
+inline BOOL InitOnceExecuteOnce(PINIT_ONCE pInitOnce, PINIT_ONCE_FN pfnInit, PVOID pvParameter, LPVOID *ppvContext)
+{
+    enum { c_lNew, c_lRunning, c_lDone };
+
+    for (;;)
+    {
+        LONG lState = InterlockedCompareExchange(&pInitOnce->lState, c_lRunning, c_lNew);
+        if (lState == c_lDone)
+        {
+            return 1;
+        }
+        if (lState == c_lNew)
+        {
+            BOOL fOk = pfnInit(pInitOnce, pvParameter, ppvContext);
+            __atomic_store_n(&pInitOnce->lState, fOk ? c_lDone : c_lNew, __ATOMIC_SEQ_CST);
+            return fOk;
+        }
+        sched_yield();
+    }
+}
+
+//
+// The interlocked singly linked list, with the depth kept alongside.  This one takes a spin lock
+// rather than the 16 byte compare-exchange the real one is built on; the code under test only
+// relies on each operation being atomic.
+//
+typedef struct _SLIST_ENTRY
+{
+    struct _SLIST_ENTRY *Next;
+} SLIST_ENTRY, *PSLIST_ENTRY;
+
+typedef struct _SLIST_HEADER
+{
+    PSLIST_ENTRY    First;
+    USHORT          Depth;
+    volatile LONG   lLock;
+} SLIST_HEADER, *PSLIST_HEADER;
+
+inline void _SListLock(PSLIST_HEADER pHead)
+{
+    while (InterlockedCompareExchange(&pHead->lLock, 1, 0) != 0)
+    {
+        sched_yield();
+    }
+}
+
+inline void _SListUnlock(PSLIST_HEADER pHead)
+{
+    __atomic_store_n(&pHead->lLock, 0, __ATOMIC_RELEASE);
+}
+
+inline void InitializeSListHead(PSLIST_HEADER pHead)
+{
+    pHead->First = NULL;
+    pHead->Depth = 0;
+    pHead->lLock = 0;
+}
+
+inline PSLIST_ENTRY InterlockedPushEntrySList(PSLIST_HEADER pHead, PSLIST_ENTRY pEntry)
+{
+    _SListLock(pHead);
+    PSLIST_ENTRY pFirst = pHead->First;
+    pEntry->Next = pFirst;
+    pHead->First = pEntry;
+    __atomic_store_n(&pHead->Depth, (USHORT)(pHead->Depth + 1), __ATOMIC_RELAXED);
+    _SListUnlock(pHead);
+    return pFirst;
+}
+
+inline PSLIST_ENTRY InterlockedPopEntrySList(PSLIST_HEADER pHead)
+{
+    _SListLock(pHead);
+    PSLIST_ENTRY pFirst = pHead->First;
+    if (pFirst)
+    {
+        pHead->First = pFirst->Next;
+        __atomic_store_n(&pHead->Depth, (USHORT)(pHead->Depth - 1), __ATOMIC_RELAXED);
+    }
+    _SListUnlock(pHead);
+    return pFirst;
+}
+
+inline PSLIST_ENTRY InterlockedFlushSList(PSLIST_HEADER pHead)
+{
+    _SListLock(pHead);
+    PSLIST_ENTRY pFirst = pHead->First;
+    pHead->First = NULL;
+    __atomic_store_n(&pHead->Depth, (USHORT)0, __ATOMIC_RELAXED);
+    _SListUnlock(pHead);
+    return pFirst;
+}
+
+// Like the real one, read without the lock.
+inline USHORT QueryDepthSList(PSLIST_HEADER pHead)
+{
+    return __atomic_load_n(&pHead->Depth, __ATOMIC_RELAXED);
+}
+
+//
+// Thread pool work.  Each submission runs on a thread of its own, and waiting joins them; the
+// code under test only relies on the callbacks running concurrently, and on the wait.
+//
+typedef struct _TP_CALLBACK_INSTANCE TP_CALLBACK_INSTANCE, *PTP_CALLBACK_INSTANCE;
+typedef struct _TP_CALLBACK_ENVIRON TP_CALLBACK_ENVIRON, *PTP_CALLBACK_ENVIRON;
+typedef struct _TP_WORK TP_WORK, *PTP_WORK;
+
+typedef VOID (CALLBACK *PTP_WORK_CALLBACK)(PTP_CALLBACK_INSTANCE pInstance, PVOID pvContext, PTP_WORK pWork);
+
+struct _TP_WORK
+{
+    PTP_WORK_CALLBACK           pfnCallback;
+    PVOID                       pvContext;
+    std::vector<std::thread>    vthreads;
+};
+
+inline PTP_WORK CreateThreadpoolWork(PTP_WORK_CALLBACK pfnCallback, PVOID pvContext, PTP_CALLBACK_ENVIRON pcbe)
+{
+    (void)pcbe;
+    return new TP_WORK{ pfnCallback, pvContext, {} };
+}
+
+inline void SubmitThreadpoolWork(PTP_WORK pWork)
+{
+    pWork->vthreads.emplace_back([pWork]() { pWork->pfnCallback(NULL, pWork->pvContext, pWork); });
+}
+
+inline void WaitForThreadpoolWorkCallbacks(PTP_WORK pWork, BOOL fCancelPendingCallbacks)
+{
+    (void)fCancelPendingCallbacks;
+    for (std::thread &rthread : pWork->vthreads)
+    {
+        rthread.join();
+    }
+    pWork->vthreads.clear();
+}
+
+inline void CloseThreadpoolWork(PTP_WORK pWork)
+{
+    delete pWork;
+}
+
+//
+// Thread pool timers.  Each timer has a thread of its own, which runs the callback when the
+// timer is due; only one-shot timers, due a relative time from now, are supported.  The
+// callback environment is only noted, as there is no DLL to keep loaded.
+//
+struct _TP_CALLBACK_ENVIRON
+{
+    HINSTANCE   hinst;
+};
+
+inline void InitializeThreadpoolEnvironment(PTP_CALLBACK_ENVIRON pcbe)
+{
+    pcbe->hinst = NULL;
+}
+
+inline void SetThreadpoolCallbackLibrary(PTP_CALLBACK_ENVIRON pcbe, PVOID hinst)
+{
+    pcbe->hinst = (HINSTANCE)hinst;
+}
+
+inline void DestroyThreadpoolEnvironment(PTP_CALLBACK_ENVIRON pcbe)
+{
+    (void)pcbe;
+}
+
+typedef struct _TP_TIMER TP_TIMER, *PTP_TIMER;
+
+typedef VOID (CALLBACK *PTP_TIMER_CALLBACK)(PTP_CALLBACK_INSTANCE pInstance, PVOID pvContext, PTP_TIMER pTimer);
+
+struct _TP_TIMER
+{
+    PTP_TIMER_CALLBACK                      pfnCallback;
+    PVOID                                   pvContext;
+    std::mutex                              mutex;
+    std::condition_variable                 cv;
+    bool                                    fArmed;
+    bool                                    fRunning;
+    bool                                    fClosing;
+    std::chrono::steady_clock::time_point   tDue;
+    std::thread                             thread;
+};
+
+inline void _TimerThread(PTP_TIMER pTimer)
+{
+    std::unique_lock<std::mutex> lock(pTimer->mutex);
+    while (!pTimer->fClosing)
+    {
+        if (!pTimer->fArmed)
+        {
+            pTimer->cv.wait(lock);
+        }
+        else if (pTimer->cv.wait_until(lock, pTimer->tDue) == std::cv_status::timeout && pTimer->fArmed &&
+                 !pTimer->fClosing)
+        {
+            pTimer->fArmed = false;
+            pTimer->fRunning = true;
+            lock.unlock();
+            pTimer->pfnCallback(NULL, pTimer->pvContext, pTimer);
+            lock.lock();
+            pTimer->fRunning = false;
+            pTimer->cv.notify_all();
+        }
+    }
+}
+
+inline PTP_TIMER CreateThreadpoolTimer(PTP_TIMER_CALLBACK pfnCallback, PVOID pvContext, PTP_CALLBACK_ENVIRON pcbe)
+{
+    (void)pcbe;
+    PTP_TIMER pTimer = new TP_TIMER();
+    pTimer->pfnCallback = pfnCallback;
+    pTimer->pvContext = pvContext;
+    pTimer->thread = std::thread(_TimerThread, pTimer);
+    return pTimer;
+}
+
+// A NULL due time cancels the timer; otherwise the due time must be negative: relative, in 100ns.
+inline void SetThreadpoolTimer(PTP_TIMER pTimer, FILETIME *pftDueTime, DWORD msPeriod, DWORD msWindowLength)
+{
+    (void)msPeriod;
+    (void)msWindowLength;
+    std::lock_guard<std::mutex> lock(pTimer->mutex);
+    pTimer->fArmed = (pftDueTime != NULL);
+    if (pftDueTime)
+    {
+        LONGLONG ll = (LONGLONG)(((ULONGLONG)pftDueTime->dwHighDateTime << 32) | pftDueTime->dwLowDateTime);
+        pTimer->tDue = std::chrono::steady_clock::now() + std::chrono::nanoseconds(-ll * 100);
+    }
+    pTimer->cv.notify_all();
+}
+
+inline void WaitForThreadpoolTimerCallbacks(PTP_TIMER pTimer, BOOL fCancelPendingCallbacks)
+{
+    std::unique_lock<std::mutex> lock(pTimer->mutex);
+    if (fCancelPendingCallbacks)
+    {
+        pTimer->fArmed = false;
+    }
+    pTimer->cv.wait(lock, [pTimer]() { return !pTimer->fRunning; });
+}
+
+inline void CloseThreadpoolTimer(PTP_TIMER pTimer)
+{
+    {
+        std::lock_guard<std::mutex> lock(pTimer->mutex);
+        pTimer->fClosing = true;
+        pTimer->cv.notify_all();
+    }
+    pTimer->thread.join();
+    delete pTimer;
+}
+
+// The COM task allocator and the local heap are both the C heap.
+inline void *CoTaskMemAlloc(SIZE_T cb)
+{
+    return malloc(cb);
+}
+
+inline void CoTaskMemFree(void *pv)
+{
+    free(pv);
+}
+
+inline void *LocalAlloc(DWORD dwFlags, SIZE_T cb)
+{
+    (void)dwFlags;
+    return malloc(cb);
+}
+
+inline void *LocalFree(void *pv)
+{
+    free(pv);
+    return NULL;
+}
+
+// Virtual memory is mmap, and VirtualLock is mlock: like VirtualLock, it can fail for want of quota.
+#define MEM_COMMIT                      0x00001000
+#define MEM_RESERVE                     0x00002000
+#define MEM_RELEASE                     0x00008000
+#define PAGE_READWRITE                  0x04
+
+typedef struct _SYSTEM_INFO
+{
+    DWORD   dwPageSize;
+} SYSTEM_INFO;
+
+inline void GetSystemInfo(SYSTEM_INFO *psi)
+{
+    psi->dwPageSize = (DWORD)sysconf(_SC_PAGESIZE);
+}
+
+inline DWORD GetLastError()
+{
+    return (DWORD)errno;
+}
+
+//
+// A test that needs to see what is done with the pages defines TESTS_OWN_VIRTUAL_MEMORY, and
+// the four functions below.
+//
+#ifdef TESTS_OWN_VIRTUAL_MEMORY
+void *VirtualAlloc(void *pv, SIZE_T cb, DWORD flAllocationType, DWORD flProtect);
+BOOL VirtualFree(void *pv, SIZE_T cb, DWORD dwFreeType);
+BOOL VirtualLock(void *pv, SIZE_T cb);
+BOOL VirtualUnlock(void *pv, SIZE_T cb);
+#else
+// VirtualFree releases a whole region given only its base, so each region is mapped with a page
+// in front of it that records its size.
+inline void *VirtualAlloc(void *pv, SIZE_T cb, DWORD flAllocationType, DWORD flProtect)
+{
+    (void)pv;
+    (void)flAllocationType;
+    (void)flProtect;
+    SIZE_T cbPage = (SIZE_T)sysconf(_SC_PAGESIZE);
+    BYTE *pb = (BYTE *)mmap(NULL, cbPage + cb, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pb == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *(SIZE_T *)pb = cbPage + cb;
+    return pb + cbPage;
+}
+
+inline BOOL VirtualFree(void *pv, SIZE_T cb, DWORD dwFreeType)
+{
+    (void)cb;
+    (void)dwFreeType;
+    BYTE *pb = (BYTE *)pv - sysconf(_SC_PAGESIZE);
+    return munmap(pb, *(SIZE_T *)pb) == 0;
+}
+
+inline BOOL VirtualLock(void *pv, SIZE_T cb)
+{
+    return mlock(pv, cb) == 0;
+}
+
+inline BOOL VirtualUnlock(void *pv, SIZE_T cb)
+{
+    return munlock(pv, cb) == 0;
+}
+#endif
+
+// SAL annotations.
+#define _In_
+#define _In_opt_
+#define _Inout_
+#define _Inout_opt_
+#define _In_reads_(c)
+#define _In_reads_bytes_(cb)
+#define _Inout_updates_bytes_(cb)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(c)
+#define _Out_writes_opt_(c)
+#define _Out_writes_to_(c, n)
+#define _Out_writes_bytes_opt_(cb)
+#define _Out_writes_bytes_to_(cb, c)
+#define _Out_writes_bytes_to_opt_(cb, c)
+#define _Outptr_
+#define _Outptr_result_buffer_(c)
+#define _Outptr_result_bytebuffer_(cb)
+#define _Outptr_result_maybenull_
+#define _Outptr_opt_result_maybenull_
+#define _Outptr_result_nullonfailure_
+#define __deref_out
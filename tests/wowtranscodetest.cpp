@@ -0,0 +1,145 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// wowtranscodetest checks the transcoder that turns a packed 32 bit (WOW)
+// KERB_INTERACTIVE_UNLOCK_LOGON into the 64 bit layout, and the reverse,
+// against golden blobs written out byte by byte.  On a 64 bit target the
+// 32-to-native direction is exactly what
+// KerbInteractiveUnlockLogonRepackNative does.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o wowtranscodetest tests/wowtranscodetest.cpp
+
+#include "logonlayout.h"
+#include "testutil.h"
+
+#include <vector>
+
+// CORP\alice, password "pw1!", workstation unlock of logon session 0x1234.
+static const BYTE c_rgbUnlock32[] =
+{
+    0x07, 0x00, 0x00, 0x00,                                 // MessageType = KerbWorkstationUnlockLogon
+    0x08, 0x00, 0x08, 0x00, 0x24, 0x00, 0x00, 0x00,         // LogonDomainName at 36
+    0x0a, 0x00, 0x0a, 0x00, 0x2c, 0x00, 0x00, 0x00,         // UserName at 44
+    0x08, 0x00, 0x08, 0x00, 0x36, 0x00, 0x00, 0x00,         // Password at 54
+    0x34, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonId
+    'C', 0, 'O', 0, 'R', 0, 'P', 0,
+    'a', 0, 'l', 0, 'i', 0, 'c', 0, 'e', 0,
+    'p', 0, 'w', 0, '1', 0, '!', 0,
+};
+
+static const BYTE c_rgbUnlock64[] =
+{
+    0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // MessageType, padding
+    0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonDomainName...
+    0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 64
+    0x0a, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00,         // UserName...
+    0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 72
+    0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,         // Password...
+    0x52, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 82
+    0x34, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonId
+    'C', 0, 'O', 0, 'R', 0, 'P', 0,
+    'a', 0, 'l', 0, 'i', 0, 'c', 0, 'e', 0,
+    'p', 0, 'w', 0, '1', 0, '!', 0,
+};
+
+// The same credential as a 32 bit blob that CredPack might produce: strings in another order,
+// with slack after them, and an empty domain.
+static const BYTE c_rgbLooseLogon32[] =
+{
+    0x02, 0x00, 0x00, 0x00,                                 // MessageType = KerbInteractiveLogon
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonDomainName empty
+    0x0a, 0x00, 0x0c, 0x00, 0x30, 0x00, 0x00, 0x00,         // UserName at 48, two bytes of slack
+    0x08, 0x00, 0x0c, 0x00, 0x24, 0x00, 0x00, 0x00,         // Password at 36, four bytes of slack
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonId
+    'p', 0, 'w', 0, '1', 0, '!', 0, 0, 0, 0, 0,
+    'a', 0, 'l', 0, 'i', 0, 'c', 0, 'e', 0, 0, 0,
+};
+
+static const BYTE c_rgbLooseLogon64[] =
+{
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // LogonDomainName empty...
+    0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at the end of the header
+    0x0a, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00,         // UserName...
+    0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 64
+    0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,         // Password...
+    0x4a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,         // ...at 74
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    'a', 0, 'l', 0, 'i', 0, 'c', 0, 'e', 0,
+    'p', 0, 'w', 0, '1', 0, '!', 0,
+};
+
+// Copies a golden blob into wchar_t aligned memory, as the transcoder requires.
+static std::vector<BYTE> _Aligned(const BYTE *pb, size_t cb)
+{
+    return std::vector<BYTE>(pb, pb + cb);
+}
+
+template <typename TLayoutIn, typename TLayoutOut>
+static std::vector<BYTE> _Transcode(const BYTE *pbIn, size_t cbIn)
+{
+    std::vector<BYTE> vbIn = _Aligned(pbIn, cbIn);
+
+    // A size query first, as KerbInteractiveUnlockLogonRepackNative makes.
+    DWORD cbOut;
+    HRESULT hr = PackedLogonTranscodeT<TLayoutIn, TLayoutOut>(vbIn.data(), (DWORD)vbIn.size(), nullptr, 0, &cbOut);
+    TEST_CHECK(hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER));
+
+    std::vector<BYTE> vbOut(cbOut);
+    DWORD cbWritten;
+    hr = PackedLogonTranscodeT<TLayoutIn, TLayoutOut>(vbIn.data(), (DWORD)vbIn.size(), vbOut.data(), cbOut, &cbWritten);
+    TEST_CHECK(SUCCEEDED(hr) && cbWritten == cbOut);
+
+    return vbOut;
+}
+
+int main()
+{
+    std::vector<BYTE> vb;
+
+    vb = _Transcode<KerbLayout32, KerbLayout64>(c_rgbUnlock32, sizeof(c_rgbUnlock32));
+    TEST_CHECK_BYTES(vb.data(), vb.size(), c_rgbUnlock64, sizeof(c_rgbUnlock64));
+
+    vb = _Transcode<KerbLayout64, KerbLayout32>(c_rgbUnlock64, sizeof(c_rgbUnlock64));
+    TEST_CHECK_BYTES(vb.data(), vb.size(), c_rgbUnlock32, sizeof(c_rgbUnlock32));
+
+    // What RepackNative does, on this target.
+    vb = _Transcode<KerbLayout32, KerbLayoutNative>(c_rgbUnlock32, sizeof(c_rgbUnlock32));
+    TEST_CHECK_BYTES(vb.data(), vb.size(), (sizeof(void*) == 8) ? c_rgbUnlock64 : c_rgbUnlock32,
+                     (sizeof(void*) == 8) ? sizeof(c_rgbUnlock64) : sizeof(c_rgbUnlock32));
+
+    // The output is always in canonical order, without slack, and keeps the MessageType.
+    vb = _Transcode<KerbLayout32, KerbLayout64>(c_rgbLooseLogon32, sizeof(c_rgbLooseLogon32));
+    TEST_CHECK_BYTES(vb.data(), vb.size(), c_rgbLooseLogon64, sizeof(c_rgbLooseLogon64));
+
+    // Output that is too small is not written.
+    std::vector<BYTE> vbIn = _Aligned(c_rgbUnlock32, sizeof(c_rgbUnlock32));
+    std::vector<BYTE> vbOut(sizeof(c_rgbUnlock64) - 1, 0xcc);
+    DWORD cbOut;
+    HRESULT hr = PackedLogonTranscodeT<KerbLayout32, KerbLayout64>(vbIn.data(), (DWORD)vbIn.size(), vbOut.data(),
+                                                                   (DWORD)vbOut.size(), &cbOut);
+    TEST_CHECK(hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER) && cbOut == sizeof(c_rgbUnlock64));
+    TEST_CHECK(vbOut[0] == 0xcc);
+
+    // A blob one byte short, or a string running past the end, is invalid.
+    hr = PackedLogonTranscodeT<KerbLayout32, KerbLayout64>(vbIn.data(), (DWORD)vbIn.size() - 1, nullptr, 0, &cbOut);
+    TEST_CHECK(hr == HRESULT_FROM_WIN32(ERROR_INVALID_DATA) && cbOut == 0);
+
+    vbIn[20] = 0x0a;        // Password.Length
+    vbIn[22] = 0x0a;        // Password.MaximumLength
+    hr = PackedLogonTranscodeT<KerbLayout32, KerbLayout64>(vbIn.data(), (DWORD)vbIn.size(), nullptr, 0, &cbOut);
+    TEST_CHECK(hr == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    // A 64 bit blob is not a valid 32 bit one: its first Buffer offset lands in the header.
+    vbIn = _Aligned(c_rgbUnlock64, sizeof(c_rgbUnlock64));
+    hr = PackedLogonTranscodeT<KerbLayout32, KerbLayout64>(vbIn.data(), (DWORD)vbIn.size(), nullptr, 0, &cbOut);
+    TEST_CHECK(hr == HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+    return TestFinish("wowtranscodetest");
+}
@@ -0,0 +1,352 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// wrapperfieldstest checks the field table and router of cpp/wrapperfields.h:
+// which tile field IDs go to the wrapped credential, unchanged, which to
+// our own fields, and which to neither.  A mock tile dispatches through them
+// the way RaspWrapCredential does, over a mock wrapped credential.
+//
+//   g++ -std=c++14 -O1 -g -fshort-wchar -fsanitize=address,undefined
+//       -I tests/win32 -I cpp -o wrapperfieldstest tests/wrapperfieldstest.cpp cpp/wrapperfields.cpp
+//
+// Usage: wrapperfieldstest [--bench]
+//
+// --bench times a field call through the router and handler table against
+// the single-field compare it replaced, and against calling the wrapped
+// credential directly.
+
+#include "wrapperfields.h"
+#include "testutil.h"
+
+#include <chrono>
+
+// Stands in for the wrapped credential: the two field calls LogonUI makes the most.
+class MockCredentialBase
+{
+public:
+    virtual HRESULT GetFieldState(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE *pcpfs,
+                                  CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE *pcpfis) = 0;
+    virtual HRESULT GetCheckboxValue(DWORD dwFieldID, BOOL *pbChecked, PWSTR *ppwszLabel) = 0;
+};
+
+class MockWrappedCredential : public MockCredentialBase
+{
+public:
+    explicit MockWrappedCredential(DWORD cFields) : cFields(cFields), cCalls(0), dwLastFieldID((DWORD)-1)
+    {
+    }
+
+    HRESULT GetFieldState(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE *pcpfs,
+                          CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE *pcpfis)
+    {
+        cCalls++;
+        dwLastFieldID = dwFieldID;
+        *pcpfs = (CREDENTIAL_PROVIDER_FIELD_STATE)(dwFieldID % 4);
+        *pcpfis = CPFIS_READONLY;
+        return (dwFieldID < cFields) ? S_OK : E_INVALIDARG;
+    }
+
+    HRESULT GetCheckboxValue(DWORD dwFieldID, BOOL *pbChecked, PWSTR *ppwszLabel)
+    {
+        cCalls++;
+        dwLastFieldID = dwFieldID;
+        *pbChecked = FALSE;
+        *ppwszLabel = NULL;
+        return (dwFieldID < cFields) ? S_OK : E_INVALIDARG;
+    }
+
+    DWORD   cFields;
+    DWORD   cCalls;
+    DWORD   dwLastFieldID;
+};
+
+//
+// A tile as RaspWrapCredential is one: _RouteField, the handler table, and the two calls made
+// the way its methods make them.  The calls named Old make them as it did before the table,
+// with its one field at _dwWrappedDescriptorCount.
+//
+class MockTile
+{
+public:
+    MockTile(MockCredentialBase *pWrapped, DWORD dwWrappedDescriptorCount) :
+        _pWrapped(pWrapped),
+        _dwWrappedDescriptorCount(dwWrappedDescriptorCount),
+        _bUseSSO(TRUE)
+    {
+    }
+
+    HRESULT GetFieldState(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE *pcpfs,
+                          CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE *pcpfis)
+    {
+        const FIELD_HANDLERS *pHandlers;
+        DWORD dwRoutedID;
+        HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+        if (SUCCEEDED(hr))
+        {
+            if (pHandlers != NULL)
+            {
+                *pcpfs = g_rgWrapperFields[dwRoutedID].cpfs;
+                *pcpfis = g_rgWrapperFields[dwRoutedID].cpfis;
+            }
+            else
+            {
+                hr = _pWrapped->GetFieldState(dwRoutedID, pcpfs, pcpfis);
+            }
+        }
+        return hr;
+    }
+
+    HRESULT GetCheckboxValue(DWORD dwFieldID, BOOL *pbChecked, PWSTR *ppwszLabel)
+    {
+        const FIELD_HANDLERS *pHandlers;
+        DWORD dwRoutedID;
+        HRESULT hr = _RouteField(dwFieldID, &pHandlers, &dwRoutedID);
+        if (SUCCEEDED(hr))
+        {
+            if (pHandlers != NULL)
+            {
+                hr = pHandlers->pfnGetCheckboxValue ? pHandlers->pfnGetCheckboxValue(this, pbChecked, ppwszLabel)
+                                                    : E_UNEXPECTED;
+            }
+            else
+            {
+                hr = _pWrapped->GetCheckboxValue(dwRoutedID, pbChecked, ppwszLabel);
+            }
+        }
+        return hr;
+    }
+
+    HRESULT GetFieldStateOld(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE *pcpfs,
+                             CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE *pcpfis)
+    {
+        HRESULT hr = E_UNEXPECTED;
+        if (dwFieldID == _dwWrappedDescriptorCount)
+        {
+            *pcpfs = CPFS_DISPLAY_IN_SELECTED_TILE;
+            *pcpfis = CPFIS_NONE;
+            hr = S_OK;
+        }
+        else if (_pWrapped != NULL)
+        {
+            hr = _pWrapped->GetFieldState(dwFieldID, pcpfs, pcpfis);
+        }
+        return hr;
+    }
+
+private:
+    struct FIELD_HANDLERS
+    {
+        HRESULT (*pfnGetCheckboxValue)(MockTile *pThis, BOOL *pbChecked, PWSTR *ppwszLabel);
+    };
+
+    static const FIELD_HANDLERS s_rgFieldHandlers[WFI_NUM_FIELDS];
+
+    HRESULT _RouteField(DWORD dwFieldID, const FIELD_HANDLERS **ppHandlers, DWORD *pdwRoutedID)
+    {
+        HRESULT hr = E_UNEXPECTED;
+
+        *ppHandlers = NULL;
+
+        switch (RouteFieldID(dwFieldID, _dwWrappedDescriptorCount, pdwRoutedID))
+        {
+        case FR_WRAPPER:
+            *ppHandlers = &s_rgFieldHandlers[*pdwRoutedID];
+            hr = S_OK;
+            break;
+
+        case FR_WRAPPED:
+            if (_pWrapped != NULL)
+            {
+                hr = S_OK;
+            }
+            break;
+
+        default:
+            hr = E_INVALIDARG;
+            break;
+        }
+
+        return hr;
+    }
+
+    static HRESULT _GetUseSSOCheckbox(MockTile *pThis, BOOL *pbChecked, PWSTR *ppwszLabel)
+    {
+        *pbChecked = pThis->_bUseSSO;
+        *ppwszLabel = g_rgWrapperFields[WFI_USE_SSO].cpfd.pszLabel;
+        return S_OK;
+    }
+
+    MockCredentialBase  *_pWrapped;
+    DWORD               _dwWrappedDescriptorCount;
+    BOOL                _bUseSSO;
+};
+
+const MockTile::FIELD_HANDLERS MockTile::s_rgFieldHandlers[WFI_NUM_FIELDS] =
+{
+    // WFI_USE_SSO
+    { &MockTile::_GetUseSSOCheckbox },
+};
+
+static void _CheckTable()
+{
+    for (DWORD i = 0; i < WFI_NUM_FIELDS; i++)
+    {
+        const WRAPPER_FIELD &rwf = g_rgWrapperFields[i];
+        TEST_CHECK(rwf.cpfd.dwFieldID == i);
+        TEST_CHECK(rwf.cpfd.cpft != CPFT_INVALID && rwf.cpfd.pszLabel != NULL && rwf.cpfd.pszLabel[0] != L'\0');
+        TEST_CHECK(rwf.cpfs != CPFS_HIDDEN);
+    }
+    TEST_CHECK(g_rgWrapperFields[WFI_USE_SSO].cpfd.cpft == CPFT_CHECKBOX);
+}
+
+static void _CheckRoute()
+{
+    static const DWORD c_rgcWrapped[] = { 0, 1, 5, 30 };
+
+    for (DWORD cWrapped : c_rgcWrapped)
+    {
+        for (DWORD dwFieldID = 0; dwFieldID < cWrapped + WFI_NUM_FIELDS + 3; dwFieldID++)
+        {
+            DWORD dwRoutedID;
+            FIELD_ROUTE fr = RouteFieldID(dwFieldID, cWrapped, &dwRoutedID);
+            if (dwFieldID < cWrapped)
+            {
+                TEST_CHECK(fr == FR_WRAPPED && dwRoutedID == dwFieldID);
+            }
+            else if (dwFieldID < cWrapped + WFI_NUM_FIELDS)
+            {
+                TEST_CHECK(fr == FR_WRAPPER && dwRoutedID == dwFieldID - cWrapped);
+                TEST_CHECK(WrapperFieldID(cWrapped, (WRAPPER_FIELD_INDEX)dwRoutedID) == dwFieldID);
+            }
+            else
+            {
+                TEST_CHECK(fr == FR_NONE);
+            }
+        }
+
+        DWORD dwRoutedID;
+        TEST_CHECK(RouteFieldID(0xFFFFFFFF, cWrapped, &dwRoutedID) == FR_NONE);
+    }
+}
+
+static void _CheckDispatch()
+{
+    const DWORD cWrapped = 5;
+    MockWrappedCredential wrapped(cWrapped);
+    MockTile tile(&wrapped, cWrapped);
+
+    // The wrapped credential's fields go to it with their own IDs.
+    for (DWORD dwFieldID = 0; dwFieldID < cWrapped; dwFieldID++)
+    {
+        CREDENTIAL_PROVIDER_FIELD_STATE cpfs;
+        CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis;
+        DWORD cCalls = wrapped.cCalls;
+        TEST_CHECK(SUCCEEDED(tile.GetFieldState(dwFieldID, &cpfs, &cpfis)));
+        TEST_CHECK(wrapped.cCalls == cCalls + 1 && wrapped.dwLastFieldID == dwFieldID);
+        TEST_CHECK(cpfs == (CREDENTIAL_PROVIDER_FIELD_STATE)(dwFieldID % 4) && cpfis == CPFIS_READONLY);
+    }
+
+    // Ours are answered from the table, without a call.
+    DWORD cCalls = wrapped.cCalls;
+    CREDENTIAL_PROVIDER_FIELD_STATE cpfs;
+    CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis;
+    DWORD dwSSO = WrapperFieldID(cWrapped, WFI_USE_SSO);
+    TEST_CHECK(SUCCEEDED(tile.GetFieldState(dwSSO, &cpfs, &cpfis)));
+    TEST_CHECK(cpfs == g_rgWrapperFields[WFI_USE_SSO].cpfs && cpfis == g_rgWrapperFields[WFI_USE_SSO].cpfis);
+
+    BOOL bChecked = FALSE;
+    PWSTR pwszLabel = NULL;
+    TEST_CHECK(SUCCEEDED(tile.GetCheckboxValue(dwSSO, &bChecked, &pwszLabel)));
+    TEST_CHECK(bChecked == TRUE && pwszLabel == g_rgWrapperFields[WFI_USE_SSO].cpfd.pszLabel);
+
+    // And an ID past ours goes nowhere.
+    TEST_CHECK(tile.GetFieldState(cWrapped + WFI_NUM_FIELDS, &cpfs, &cpfis) == E_INVALIDARG);
+    TEST_CHECK(tile.GetCheckboxValue(0xFFFFFFFF, &bChecked, &pwszLabel) == E_INVALIDARG);
+    TEST_CHECK(wrapped.cCalls == cCalls);
+
+    // With no wrapped credential, its fields fail as RaspWrapCredential's do.
+    MockTile tileEmpty(NULL, cWrapped);
+    TEST_CHECK(tileEmpty.GetFieldState(0, &cpfs, &cpfis) == E_UNEXPECTED);
+    TEST_CHECK(SUCCEEDED(tileEmpty.GetFieldState(dwSSO, &cpfs, &cpfis)));
+}
+
+static double _Seconds(std::chrono::steady_clock::time_point tStart)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+// Read through a volatile, so the compiler can't see which credential it is and skip the call.
+static MockCredentialBase *volatile s_pWrappedBench;
+
+static void _Bench()
+{
+    const int cCalls = 50000000;
+    const DWORD cWrapped = 5;
+    const DWORD cFields = cWrapped + WFI_NUM_FIELDS;
+
+    MockWrappedCredential wrapped(cFields);
+    s_pWrappedBench = &wrapped;
+    MockCredentialBase *pWrapped = s_pWrappedBench;
+    MockTile tile(pWrapped, cWrapped);
+    DWORD dwSum = 0;
+
+    // LogonUI laying out the tile over and over: every field in turn.
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    for (int iCall = 0; iCall < cCalls; iCall++)
+    {
+        CREDENTIAL_PROVIDER_FIELD_STATE cpfs;
+        CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis;
+        dwSum += SUCCEEDED(pWrapped->GetFieldState(iCall % cFields, &cpfs, &cpfis)) + cpfs;
+    }
+    double dDirect = _Seconds(tStart);
+
+    tStart = std::chrono::steady_clock::now();
+    for (int iCall = 0; iCall < cCalls; iCall++)
+    {
+        CREDENTIAL_PROVIDER_FIELD_STATE cpfs;
+        CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis;
+        dwSum += SUCCEEDED(tile.GetFieldStateOld(iCall % cFields, &cpfs, &cpfis)) + cpfs;
+    }
+    double dOld = _Seconds(tStart);
+
+    tStart = std::chrono::steady_clock::now();
+    for (int iCall = 0; iCall < cCalls; iCall++)
+    {
+        CREDENTIAL_PROVIDER_FIELD_STATE cpfs;
+        CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis;
+        dwSum += SUCCEEDED(tile.GetFieldState(iCall % cFields, &cpfs, &cpfis)) + cpfs;
+    }
+    double dRouted = _Seconds(tStart);
+
+    printf("GetFieldState over %u fields: wrapped credential directly %5.2f ns\n", cFields, dDirect * 1e9 / cCalls);
+    printf("                              one-field compare          %5.2f ns\n", dOld * 1e9 / cCalls);
+    printf("                              router and handler table   %5.2f ns\n", dRouted * 1e9 / cCalls);
+
+    // Keeps the loops from being optimized away.
+    TEST_CHECK(dwSum != 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "--bench"))
+    {
+        _Bench();
+        return TestFinish("wrapperfieldstest --bench");
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: wrapperfieldstest [--bench]\n");
+        return 2;
+    }
+
+    _CheckTable();
+    _CheckRoute();
+    _CheckDispatch();
+
+    return TestFinish("wrapperfieldstest");
+}
@@ -0,0 +1,172 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// flightdump prints the events kept in a RaspWrap flight recorder file
+// (see cpp/flightrecorder.h), oldest first.  It is plain C++ and builds
+// anywhere:
+//
+//   g++ -std=c++14 -O2 -I cpp -o flightdump tools/flightdump.cpp
+//   cl /EHsc /O2 /I cpp tools\flightdump.cpp
+//
+// Usage: flightdump <flight recorder file>
+//
+// The file can be read while the process that records into it is still
+// running, or after it has died.  Times are UTC.  An event that was still
+// being written, when the process died or while the file was read, is
+// shown as incomplete.
+
+#include "flightreader.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+struct EVENT_INFO
+{
+    uint16_t    usEventID;
+    const char *pszName;
+};
+
+static const EVENT_INFO c_rgEventInfo[] =
+{
+#define TRACE_EVENT_INFO(id, value, category, name) { value, name },
+    RASPWRAP_TRACE_EVENTS(TRACE_EVENT_INFO)
+#undef TRACE_EVENT_INFO
+};
+
+// FILETIME of 1970-01-01.
+static const uint64_t c_ullUnixEpoch = 116444736000000000ULL;
+
+static void _GetEventName(uint16_t usEventID, char *psz, size_t cch)
+{
+    for (size_t i = 0; i < sizeof(c_rgEventInfo) / sizeof(c_rgEventInfo[0]); i++)
+    {
+        if (c_rgEventInfo[i].usEventID == usEventID)
+        {
+            snprintf(psz, cch, "%s", c_rgEventInfo[i].pszName);
+            return;
+        }
+    }
+    snprintf(psz, cch, "event 0x%04x", usEventID);
+}
+
+static char _GetPhaseChar(uint16_t usPhase)
+{
+    switch (usPhase)
+    {
+    case TPH_BEGIN:     return 'B';
+    case TPH_END:       return 'E';
+    default:            return 'i';
+    }
+}
+
+// Formats a FILETIME as "YYYY-MM-DD hh:mm:ss.uuuuuu".
+static void _FormatTime(uint64_t ullFileTime, char *psz, size_t cch)
+{
+    uint64_t ullSinceEpoch = (ullFileTime > c_ullUnixEpoch) ? ullFileTime - c_ullUnixEpoch : 0;
+    time_t t = (time_t)(ullSinceEpoch / 10000000);
+    unsigned uMicroseconds = (unsigned)(ullSinceEpoch % 10000000 / 10);
+
+    const struct tm *ptm = gmtime(&t);
+    if (!ptm)
+    {
+        snprintf(psz, cch, "?");
+        return;
+    }
+
+    char szSeconds[32];
+    strftime(szSeconds, sizeof(szSeconds), "%Y-%m-%d %H:%M:%S", ptm);
+    snprintf(psz, cch, "%s.%06u", szSeconds, uMicroseconds);
+}
+
+static bool _ReadFile(const char *pszPath, std::vector<uint8_t> *pvb)
+{
+    FILE *pf = fopen(pszPath, "rb");
+    if (!pf)
+    {
+        return false;
+    }
+
+    uint8_t rgb[65536];
+    size_t cb;
+    while ((cb = fread(rgb, 1, sizeof(rgb), pf)) > 0)
+    {
+        pvb->insert(pvb->end(), rgb, rgb + cb);
+    }
+
+    bool fOk = !ferror(pf);
+    fclose(pf);
+    return fOk;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2 || argv[1][0] == '-')
+    {
+        fprintf(stderr, "usage: flightdump <flight recorder file>\n");
+        return 2;
+    }
+
+    std::vector<uint8_t> vb;
+    if (!_ReadFile(argv[1], &vb))
+    {
+        fprintf(stderr, "flightdump: cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    FLIGHT_RING ring;
+    const char *pszError;
+    if (!FlightRingOpen(vb.data(), vb.size(), &ring, &pszError))
+    {
+        fprintf(stderr, "flightdump: %s\n", pszError);
+        return 1;
+    }
+
+    const FLIGHT_FILE_HEADER &ffh = ring.ffh;
+
+    char szTime[64];
+    _FormatTime(ffh.ullStartTime, szTime, sizeof(szTime));
+    printf("process %u, started %s, %llu events recorded, the last %llu kept\n", ffh.dwProcessId, szTime,
+           (unsigned long long)ffh.ullNext, (unsigned long long)(ffh.ullNext - ring.ullFirst));
+
+    for (uint64_t ullEvent = ring.ullFirst; ullEvent < ffh.ullNext; ullEvent++)
+    {
+        FLIGHT_SLOT slot;
+        FLIGHT_EVENT_STATE fes = FlightRingRead(ring, ullEvent, &slot);
+        if (fes == FES_OVERWRITTEN)
+        {
+            continue;
+        }
+        if (fes == FES_INCOMPLETE)
+        {
+            printf("%-26s  %6s  -  [event %llu incomplete]\n", "", "", (unsigned long long)ullEvent);
+            continue;
+        }
+
+        const TRACE_RECORD &rec = slot.rec;
+        _FormatTime(FlightRingGetTime(ring, rec), szTime, sizeof(szTime));
+
+        char szName[128];
+        _GetEventName(rec.usEventID, szName, sizeof(szName));
+
+        printf("%-26s  %6u  %c  %s object=%016llx", szTime, rec.dwThreadId, _GetPhaseChar(rec.usPhase), szName,
+               (unsigned long long)rec.ullObject);
+        if (rec.dwFieldID != TRACE_NO_FIELD)
+        {
+            printf(" field=%u", rec.dwFieldID);
+        }
+        if (rec.usPhase == TPH_END)
+        {
+            printf(" hr=0x%08x", (uint32_t)rec.hr);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
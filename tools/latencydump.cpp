@@ -0,0 +1,327 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// latencydump prints the latency histograms the provider dumps (see
+// cpp/latency.h) as percentiles, one line per method and kind of time.  It
+// is plain C++ and builds anywhere:
+//
+//   g++ -std=c++14 -O2 -I cpp -o latencydump tools/latencydump.cpp
+//   cl /EHsc /O2 /I cpp tools\latencydump.cpp
+//
+// Usage: latencydump [--all] <latency file>
+//
+// The file is mapped and read the way the provider writes it, so it can be
+// read while LogonUI is running.  Times are in microseconds, or in TSC
+// ticks if the provider hadn't measured the TSC frequency yet.  --all also
+// lists the methods that were never called.
+
+#include "latencyformat.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char *const c_rgpszMethod[] =
+{
+#define LATENCY_METHOD_NAME(id, name) name,
+    RASPWRAP_LATENCY_METHODS(LATENCY_METHOD_NAME)
+#undef LATENCY_METHOD_NAME
+};
+
+static const char *const c_rgpszKind[] =
+{
+    "self",         // LK_SELF
+    "wrapped",      // LK_WRAPPED
+};
+
+static const double c_rgdPercentile[] = { 0.50, 0.90, 0.99, 0.999 };
+
+// A read-only view of a whole file.
+class MappedFile
+{
+public:
+    MappedFile() : _pb(NULL), _cb(0)
+    {
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (_pb)
+        {
+            UnmapViewOfFile(_pb);
+        }
+#else
+        if (_pb)
+        {
+            munmap(const_cast<uint8_t *>(_pb), _cb);
+        }
+#endif
+    }
+
+    bool Open(const char *pszPath)
+    {
+#ifdef _WIN32
+        HANDLE hFile = CreateFileA(pszPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER liSize;
+        HANDLE hMapping = NULL;
+        if (GetFileSizeEx(hFile, &liSize) && liSize.QuadPart > 0)
+        {
+            hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        }
+        if (hMapping)
+        {
+            _pb = static_cast<const uint8_t *>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+            _cb = (size_t)liSize.QuadPart;
+            CloseHandle(hMapping);
+        }
+        CloseHandle(hFile);
+#else
+        int fd = open(pszPath, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *pv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (pv != MAP_FAILED)
+            {
+                _pb = static_cast<const uint8_t *>(pv);
+                _cb = (size_t)st.st_size;
+            }
+        }
+        close(fd);
+#endif
+        return _pb != NULL;
+    }
+
+    const uint8_t *Data() const
+    {
+        return _pb;
+    }
+
+    size_t Size() const
+    {
+        return _cb;
+    }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const uint8_t  *_pb;
+    size_t          _cb;
+};
+
+static uint32_t _LoadGeneration(const uint8_t *pb)
+{
+    uint32_t dwGeneration;
+    memcpy(&dwGeneration, pb + offsetof(LATENCY_FILE_HEADER, dwGeneration), sizeof(dwGeneration));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return dwGeneration;
+}
+
+//
+// Copies the header and histograms out of the mapping while no rewrite is going on: the
+// generation count has to be even, and the same, before and after the copy.
+//
+static bool _ReadSnapshot(const MappedFile &file, LATENCY_FILE_HEADER *plfh, std::vector<LATENCY_FILE_HISTOGRAM> *pvhist)
+{
+    const uint8_t *pb = file.Data();
+    if (file.Size() < sizeof(*plfh))
+    {
+        fprintf(stderr, "latencydump: the file is too short\n");
+        return false;
+    }
+
+    for (int iTry = 0; iTry < 1000; iTry++)
+    {
+        uint32_t dwGeneration = _LoadGeneration(pb);
+        if (dwGeneration & 1)
+        {
+            continue;
+        }
+
+        memcpy(plfh, pb, sizeof(*plfh));
+        if (plfh->dwMagic != LATENCY_MAGIC || plfh->usVersion != LATENCY_VERSION || plfh->cbHeader != sizeof(*plfh) ||
+            plfh->cKinds != LK_COUNT || plfh->cBuckets != LATENCY_BUCKET_COUNT ||
+            plfh->dwSubBucketBits != LATENCY_SUB_BUCKET_BITS)
+        {
+            fprintf(stderr, "latencydump: not a latency file, or a version this reader doesn't know\n");
+            return false;
+        }
+
+        size_t chist = (size_t)plfh->cMethods * plfh->cKinds;
+        if (file.Size() < sizeof(*plfh) + chist * sizeof(LATENCY_FILE_HISTOGRAM))
+        {
+            fprintf(stderr, "latencydump: the file is too short for its %u methods\n", plfh->cMethods);
+            return false;
+        }
+
+        pvhist->resize(chist);
+        memcpy(pvhist->data(), pb + sizeof(*plfh), chist * sizeof(LATENCY_FILE_HISTOGRAM));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_LoadGeneration(pb) == dwGeneration)
+        {
+            return true;
+        }
+    }
+
+    fprintf(stderr, "latencydump: the provider kept rewriting the file; try again\n");
+    return false;
+}
+
+// The tick count below which a fraction dFraction of the calls fall, to within a bucket: the
+// middle of the bucket the percentile is in, but no more than the longest call.
+static uint64_t _Percentile(const LATENCY_FILE_HISTOGRAM &hist, uint64_t cCalls, double dFraction)
+{
+    uint64_t cWanted = (uint64_t)(dFraction * (double)cCalls);
+    if (cWanted < 1)
+    {
+        cWanted = 1;
+    }
+
+    uint64_t cSeen = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        cSeen += hist.rgcBuckets[i];
+        if (cSeen >= cWanted)
+        {
+            uint64_t ullLow = LatencyBucketLowerBound(i);
+            uint64_t ullHigh = (i + 1 < LATENCY_BUCKET_COUNT) ? LatencyBucketLowerBound(i + 1) : ullLow;
+            uint64_t ullMid = ullLow + (ullHigh - ullLow) / 2;
+            return (ullMid < hist.ullMaxTicks) ? ullMid : hist.ullMaxTicks;
+        }
+    }
+
+    return hist.ullMaxTicks;
+}
+
+static double _Scale(uint64_t ullTicks, double dTicksPerUnit)
+{
+    return (double)ullTicks / dTicksPerUnit;
+}
+
+int main(int argc, char **argv)
+{
+    bool fAll = false;
+    const char *pszPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--all"))
+        {
+            fAll = true;
+        }
+        else if (!pszPath && argv[i][0] != '-')
+        {
+            pszPath = argv[i];
+        }
+        else
+        {
+            pszPath = NULL;
+            break;
+        }
+    }
+
+    if (!pszPath)
+    {
+        fprintf(stderr, "usage: latencydump [--all] <latency file>\n");
+        return 2;
+    }
+
+    MappedFile file;
+    if (!file.Open(pszPath))
+    {
+        fprintf(stderr, "latencydump: cannot map %s\n", pszPath);
+        return 1;
+    }
+
+    LATENCY_FILE_HEADER lfh;
+    std::vector<LATENCY_FILE_HISTOGRAM> vhist;
+    if (!_ReadSnapshot(file, &lfh, &vhist))
+    {
+        return 1;
+    }
+
+    bool fTicks = (lfh.ullTicksPerSecond == 0);
+    double dTicksPerUnit = fTicks ? 1.0 : (double)lfh.ullTicksPerSecond / 1e6;
+
+    printf("process %u, TSC %.3f GHz, times in %s\n", lfh.dwProcessId,
+           (double)lfh.ullTicksPerSecond / 1e9, fTicks ? "ticks" : "us");
+    printf("%-56s %-8s %10s %10s %10s %10s %10s %10s %10s\n",
+           "method", "time", "calls", "mean", "p50", "p90", "p99", "p99.9", "max");
+
+    for (uint32_t iMethod = 0; iMethod < lfh.cMethods; iMethod++)
+    {
+        // A file from a newer provider can have methods this reader doesn't know the names of.
+        char szMethod[32];
+        const char *pszMethod = szMethod;
+        if (iMethod < LM_COUNT)
+        {
+            pszMethod = c_rgpszMethod[iMethod];
+        }
+        else
+        {
+            snprintf(szMethod, sizeof(szMethod), "method #%u", iMethod);
+        }
+
+        for (uint32_t iKind = 0; iKind < LK_COUNT; iKind++)
+        {
+            const LATENCY_FILE_HISTOGRAM &hist = vhist[(size_t)iMethod * LK_COUNT + iKind];
+
+            // The buckets are what the percentiles come from; cCalls can be a call or two
+            // ahead of them, if a thread was counting while the provider took the snapshot.
+            uint64_t cCalls = 0;
+            for (unsigned i = 0; i < LATENCY_BUCKET_COUNT; i++)
+            {
+                cCalls += hist.rgcBuckets[i];
+            }
+
+            if (cCalls == 0)
+            {
+                if (fAll)
+                {
+                    printf("%-56s %-8s %10u\n", pszMethod, c_rgpszKind[iKind], 0u);
+                }
+                continue;
+            }
+
+            printf("%-56s %-8s %10llu %10.1f", pszMethod, c_rgpszKind[iKind], (unsigned long long)cCalls,
+                   _Scale(hist.ullTotalTicks, dTicksPerUnit) / (double)hist.cCalls);
+            for (size_t i = 0; i < sizeof(c_rgdPercentile) / sizeof(c_rgdPercentile[0]); i++)
+            {
+                printf(" %10.1f", _Scale(_Percentile(hist, cCalls, c_rgdPercentile[i]), dTicksPerUnit));
+            }
+            printf(" %10.1f\n", _Scale(hist.ullMaxTicks, dTicksPerUnit));
+        }
+    }
+
+    return 0;
+}
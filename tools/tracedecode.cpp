@@ -0,0 +1,422 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// tracedecode turns a RaspWrap binary trace file (see cpp/trace.h) into
+// readable text, or into Chrome trace JSON for chrome://tracing or
+// https://ui.perfetto.dev.  It is plain C++ and builds anywhere:
+//
+//   g++ -std=c++14 -O2 -I cpp -o tracedecode tools/tracedecode.cpp
+//   cl /EHsc /O2 /I cpp tools\tracedecode.cpp
+//
+// Usage: tracedecode [--text | --chrome] <trace file>...
+//
+// Each process writes its own trace file; give them all to see the
+// processes side by side.  Timestamps are converted from TSC ticks to microseconds with the TSC
+// frequency worked out from each session's clock sync records, and are
+// placed on the QueryPerformanceCounter time line, so sessions from
+// different processes on the same boot line up.  Output starts at 0.
+
+#include "traceformat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+struct EVENT_INFO
+{
+    uint16_t    usEventID;
+    const char *pszCategory;
+    const char *pszName;
+};
+
+static const EVENT_INFO c_rgEventInfo[] =
+{
+#define TRACE_EVENT_INFO(id, value, category, name) { value, category, name },
+    RASPWRAP_TRACE_EVENTS(TRACE_EVENT_INFO)
+#undef TRACE_EVENT_INFO
+};
+
+struct SESSION
+{
+    uint32_t    dwProcessId;
+    uint64_t    ullQpcFrequency;
+    uint64_t    ullTscFirst;
+    uint64_t    ullQpcFirst;
+    uint64_t    ullTscLast;
+    uint64_t    ullQpcLast;
+};
+
+struct EVENT
+{
+    TRACE_RECORD    rec;
+    size_t          iSession;
+    double          dUs;        // filled in once every session's clock is known
+};
+
+static const EVENT_INFO *_FindEventInfo(uint16_t usEventID)
+{
+    for (size_t i = 0; i < sizeof(c_rgEventInfo) / sizeof(c_rgEventInfo[0]); i++)
+    {
+        if (c_rgEventInfo[i].usEventID == usEventID)
+        {
+            return &c_rgEventInfo[i];
+        }
+    }
+    return NULL;
+}
+
+static void _GetEventName(uint16_t usEventID, char *psz, size_t cch, const char **ppszCategory)
+{
+    const EVENT_INFO *pinfo = _FindEventInfo(usEventID);
+    if (pinfo)
+    {
+        snprintf(psz, cch, "%s", pinfo->pszName);
+        *ppszCategory = pinfo->pszCategory;
+    }
+    else
+    {
+        snprintf(psz, cch, "event 0x%04x", usEventID);
+        *ppszCategory = "unknown";
+    }
+}
+
+static bool _ReadFile(const char *pszPath, std::vector<uint8_t> *pvb)
+{
+    FILE *pf = fopen(pszPath, "rb");
+    if (!pf)
+    {
+        return false;
+    }
+
+    uint8_t rgb[65536];
+    size_t cb;
+    while ((cb = fread(rgb, 1, sizeof(rgb), pf)) > 0)
+    {
+        pvb->insert(pvb->end(), rgb, rgb + cb);
+    }
+
+    bool fOk = !ferror(pf);
+    fclose(pf);
+    return fOk;
+}
+
+//
+// Splits the file into sessions and events.  A session's header says how big its header and
+// records are, so a newer provider's files still parse as long as it only appends fields.  A
+// truncated record at the end (the writer was stopped mid-write) is reported and ignored.
+//
+static bool _Parse(const std::vector<uint8_t> &vb, std::vector<SESSION> *pvsessions, std::vector<EVENT> *pvevents)
+{
+    size_t ib = 0;
+    size_t cbRecord = 0;
+    bool fSession = false;      // records before this file's first header belong to no session
+
+    while (ib < vb.size())
+    {
+        uint16_t usMark;
+        if (vb.size() - ib < sizeof(usMark))
+        {
+            fprintf(stderr, "tracedecode: ignoring %zu trailing bytes\n", vb.size() - ib);
+            break;
+        }
+        memcpy(&usMark, &vb[ib], sizeof(usMark));
+
+        if (usMark == TRACE_SESSION_MARK)
+        {
+            TRACE_SESSION_HEADER tsh;
+            if (vb.size() - ib < sizeof(tsh))
+            {
+                fprintf(stderr, "tracedecode: ignoring a truncated session header at offset %zu\n", ib);
+                break;
+            }
+            memcpy(&tsh, &vb[ib], sizeof(tsh));
+
+            if (tsh.dwMagic != TRACE_MAGIC || tsh.cbHeader < sizeof(tsh) || tsh.cbRecord < sizeof(TRACE_RECORD))
+            {
+                fprintf(stderr, "tracedecode: bad session header at offset %zu\n", ib);
+                return false;
+            }
+            if (tsh.usVersion != TRACE_VERSION)
+            {
+                fprintf(stderr, "tracedecode: session at offset %zu is version %u, expected %u\n",
+                        ib, tsh.usVersion, TRACE_VERSION);
+            }
+
+            SESSION session;
+            session.dwProcessId = tsh.dwProcessId;
+            session.ullQpcFrequency = tsh.ullQpcFrequency;
+            session.ullTscFirst = session.ullTscLast = tsh.ullTimestamp;
+            session.ullQpcFirst = session.ullQpcLast = tsh.ullQpc;
+            pvsessions->push_back(session);
+
+            cbRecord = tsh.cbRecord;
+            fSession = true;
+            ib += tsh.cbHeader;
+            continue;
+        }
+
+        if (!fSession)
+        {
+            fprintf(stderr, "tracedecode: not a trace file (no session header at offset 0)\n");
+            return false;
+        }
+
+        if (vb.size() - ib < cbRecord)
+        {
+            fprintf(stderr, "tracedecode: ignoring a truncated record at offset %zu\n", ib);
+            break;
+        }
+
+        EVENT event;
+        memcpy(&event.rec, &vb[ib], sizeof(event.rec));
+        event.iSession = pvsessions->size() - 1;
+        event.dUs = 0;
+        ib += cbRecord;
+
+        if (event.rec.usEventID == TEID_CLOCK_SYNC)
+        {
+            SESSION &session = pvsessions->back();
+            session.ullTscLast = event.rec.ullTimestamp;
+            session.ullQpcLast = event.rec.ullObject;
+        }
+        else
+        {
+            pvevents->push_back(event);
+        }
+    }
+
+    return true;
+}
+
+// TSC ticks per microsecond over the session, or 0 if it has too little to go on.
+static double _GetTicksPerUs(const SESSION &session)
+{
+    if (session.ullQpcFrequency == 0 ||
+        session.ullQpcLast <= session.ullQpcFirst ||
+        session.ullTscLast <= session.ullTscFirst)
+    {
+        return 0;
+    }
+
+    double dUs = (double)(session.ullQpcLast - session.ullQpcFirst) * 1e6 / (double)session.ullQpcFrequency;
+    return (double)(session.ullTscLast - session.ullTscFirst) / dUs;
+}
+
+static void _ComputeTimes(const std::vector<SESSION> &vsessions, std::vector<EVENT> *pvevents)
+{
+    // A session without a usable clock sync (a process that stopped before its first full drain)
+    // borrows the frequency of the others; it is the same CPU.
+    double dTicksPerUsFallback = 0;
+    for (size_t i = 0; i < vsessions.size() && !dTicksPerUsFallback; i++)
+    {
+        dTicksPerUsFallback = _GetTicksPerUs(vsessions[i]);
+    }
+    if (!dTicksPerUsFallback)
+    {
+        fprintf(stderr, "tracedecode: no clock sync in the file; assuming 1 tick per nanosecond\n");
+        dTicksPerUsFallback = 1000;
+    }
+
+    std::vector<double> vdTicksPerUs;
+    std::vector<double> vdOriginUs;
+    for (size_t i = 0; i < vsessions.size(); i++)
+    {
+        const SESSION &session = vsessions[i];
+        double dTicksPerUs = _GetTicksPerUs(session);
+        vdTicksPerUs.push_back(dTicksPerUs ? dTicksPerUs : dTicksPerUsFallback);
+        vdOriginUs.push_back(session.ullQpcFrequency ?
+                             (double)session.ullQpcFirst * 1e6 / (double)session.ullQpcFrequency : 0);
+    }
+
+    double dMinUs = 0;
+    for (size_t i = 0; i < pvevents->size(); i++)
+    {
+        EVENT &event = (*pvevents)[i];
+        const SESSION &session = vsessions[event.iSession];
+
+        // Signed: a record can be stamped just before the header that starts its session.
+        double dTicks = (double)(int64_t)(event.rec.ullTimestamp - session.ullTscFirst);
+        event.dUs = vdOriginUs[event.iSession] + dTicks / vdTicksPerUs[event.iSession];
+        if (i == 0 || event.dUs < dMinUs)
+        {
+            dMinUs = event.dUs;
+        }
+    }
+
+    for (size_t i = 0; i < pvevents->size(); i++)
+    {
+        (*pvevents)[i].dUs -= dMinUs;
+    }
+
+    // Each thread's records are already in order (the TSC is invariant), so a stable sort only
+    // interleaves the threads and processes.
+    std::stable_sort(pvevents->begin(), pvevents->end(),
+                     [](const EVENT &a, const EVENT &b) { return a.dUs < b.dUs; });
+}
+
+static char _GetPhaseChar(uint16_t usPhase)
+{
+    switch (usPhase)
+    {
+    case TPH_BEGIN:     return 'B';
+    case TPH_END:       return 'E';
+    default:            return 'i';
+    }
+}
+
+static void _PrintText(const std::vector<SESSION> &vsessions, const std::vector<EVENT> &vevents)
+{
+    for (size_t i = 0; i < vevents.size(); i++)
+    {
+        const EVENT &event = vevents[i];
+        const TRACE_RECORD &rec = event.rec;
+
+        char szName[128];
+        const char *pszCategory;
+        _GetEventName(rec.usEventID, szName, sizeof(szName), &pszCategory);
+
+        printf("%14.3f  %6u %6u  %c  ", event.dUs, vsessions[event.iSession].dwProcessId, rec.dwThreadId,
+               _GetPhaseChar(rec.usPhase));
+
+        if (rec.usEventID == TEID_DROPPED)
+        {
+            printf("[%u records dropped]\n", rec.dwFieldID);
+            continue;
+        }
+
+        printf("%s object=%016llx", szName, (unsigned long long)rec.ullObject);
+        if (rec.dwFieldID != TRACE_NO_FIELD)
+        {
+            printf(" field=%u", rec.dwFieldID);
+        }
+        if (rec.usPhase == TPH_END)
+        {
+            printf(" hr=0x%08x", (uint32_t)rec.hr);
+        }
+        printf("\n");
+    }
+}
+
+static void _PrintChrome(const std::vector<SESSION> &vsessions, const std::vector<EVENT> &vevents)
+{
+    printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool fFirst = true;
+    for (size_t i = 0; i < vsessions.size(); i++)
+    {
+        printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"RaspWrap (%u)\"}}",
+               fFirst ? "" : ",\n", vsessions[i].dwProcessId, vsessions[i].dwProcessId);
+        fFirst = false;
+    }
+
+    for (size_t i = 0; i < vevents.size(); i++)
+    {
+        const EVENT &event = vevents[i];
+        const TRACE_RECORD &rec = event.rec;
+
+        char szName[128];
+        const char *pszCategory;
+        _GetEventName(rec.usEventID, szName, sizeof(szName), &pszCategory);
+
+        char chPhase = _GetPhaseChar(rec.usPhase);
+        printf("%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u,",
+               fFirst ? "" : ",\n", szName, pszCategory, chPhase, event.dUs,
+               vsessions[event.iSession].dwProcessId, rec.dwThreadId);
+        fFirst = false;
+
+        if (chPhase == 'i')
+        {
+            printf("\"s\":\"t\",");
+        }
+
+        if (rec.usEventID == TEID_DROPPED)
+        {
+            printf("\"args\":{\"records\":%u}}", rec.dwFieldID);
+            continue;
+        }
+
+        printf("\"args\":{\"object\":\"%016llx\"", (unsigned long long)rec.ullObject);
+        if (rec.dwFieldID != TRACE_NO_FIELD)
+        {
+            printf(",\"field\":%u", rec.dwFieldID);
+        }
+        if (rec.usPhase == TPH_END)
+        {
+            printf(",\"hr\":\"0x%08x\"", (uint32_t)rec.hr);
+        }
+        printf("}}");
+    }
+
+    printf("\n]}\n");
+}
+
+int main(int argc, char **argv)
+{
+    bool fChrome = false;
+    std::vector<const char*> vpszPaths;
+    bool fUsage = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--chrome"))
+        {
+            fChrome = true;
+        }
+        else if (!strcmp(argv[i], "--text"))
+        {
+            fChrome = false;
+        }
+        else if (argv[i][0] != '-')
+        {
+            vpszPaths.push_back(argv[i]);
+        }
+        else
+        {
+            fUsage = true;
+            break;
+        }
+    }
+
+    if (fUsage || vpszPaths.empty())
+    {
+        fprintf(stderr, "usage: tracedecode [--text | --chrome] <trace file>...\n");
+        return 2;
+    }
+
+    std::vector<SESSION> vsessions;
+    std::vector<EVENT> vevents;
+    for (size_t i = 0; i < vpszPaths.size(); i++)
+    {
+        std::vector<uint8_t> vb;
+        if (!_ReadFile(vpszPaths[i], &vb))
+        {
+            fprintf(stderr, "tracedecode: cannot read %s\n", vpszPaths[i]);
+            return 1;
+        }
+
+        if (!_Parse(vb, &vsessions, &vevents))
+        {
+            fprintf(stderr, "tracedecode: in %s\n", vpszPaths[i]);
+            return 1;
+        }
+    }
+
+    _ComputeTimes(vsessions, &vevents);
+
+    if (fChrome)
+    {
+        _PrintChrome(vsessions, vevents);
+    }
+    else
+    {
+        _PrintText(vsessions, vevents);
+    }
+
+    return 0;
+}